@@ -0,0 +1,108 @@
+dnl ===================================================================
+dnl   Licensed to the Apache Software Foundation (ASF) under one
+dnl   or more contributor license agreements.  See the NOTICE file
+dnl   distributed with this work for additional information
+dnl   regarding copyright ownership.  The ASF licenses this file
+dnl   to you under the Apache License, Version 2.0 (the
+dnl   "License"); you may not use this file except in compliance
+dnl   with the License.  You may obtain a copy of the License at
+dnl
+dnl     http://www.apache.org/licenses/LICENSE-2.0
+dnl
+dnl   Unless required by applicable law or agreed to in writing,
+dnl   software distributed under the License is distributed on an
+dnl   "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+dnl   KIND, either express or implied.  See the License for the
+dnl   specific language governing permissions and limitations
+dnl   under the License.
+dnl ===================================================================
+dnl
+dnl Zstandard is optional.  The default behaviour is to use pkg-config
+dnl to look for a libzstd and if that fails to simply try linking -lzstd.
+dnl If neither works, Subversion is built without zstd support.
+dnl
+dnl The user can specify --with-zstd=PREFIX to look in PREFIX and fail
+dnl if it is not found there, or --without-zstd to disable zstd support.
+
+AC_DEFUN(SVN_ZSTD,
+[
+  AC_ARG_WITH([zstd],
+    [AS_HELP_STRING([--with-zstd=PREFIX],
+                    [Zstandard compression library (optional)])],
+    [
+      if test "$withval" = yes; then
+        zstd_prefix=std
+      else
+        zstd_prefix="$withval"
+      fi
+      zstd_required=yes
+    ],
+    [
+      zstd_prefix=std
+      zstd_required=no
+    ])
+
+  zstd_found=no
+  if test "$zstd_prefix" = "no"; then
+    AC_MSG_NOTICE([zstd support disabled])
+  else
+    if test "$zstd_prefix" = "std"; then
+      SVN_ZSTD_STD
+    else
+      SVN_ZSTD_PREFIX
+    fi
+    if test "$zstd_found" = "yes"; then
+      AC_DEFINE([SVN_HAVE_ZSTD], [1],
+                [Defined if Zstandard compression support is enabled])
+    elif test "$zstd_required" = "yes"; then
+      AC_MSG_ERROR([--with-zstd requested, but zstd >= 1.3.0 not found])
+    fi
+  fi
+  AC_SUBST(SVN_ZSTD_INCLUDES)
+  AC_SUBST(SVN_ZSTD_LIBS)
+])
+
+dnl We need ZSTD_getDictID_fromFrame() and the advanced dictionary API,
+dnl both of which are stable since 1.3.0.
+AC_DEFUN(SVN_ZSTD_STD,
+[
+  if test -n "$PKG_CONFIG"; then
+    AC_MSG_CHECKING([for zstd library via pkg-config])
+    if $PKG_CONFIG libzstd --atleast-version=1.3.0; then
+      AC_MSG_RESULT([yes])
+      zstd_found=yes
+      SVN_ZSTD_INCLUDES=`$PKG_CONFIG libzstd --cflags`
+      SVN_ZSTD_LIBS=`$PKG_CONFIG libzstd --libs`
+      SVN_ZSTD_LIBS="`SVN_REMOVE_STANDARD_LIB_DIRS($SVN_ZSTD_LIBS)`"
+    else
+      AC_MSG_RESULT([no])
+    fi
+  fi
+  if test "$zstd_found" != "yes"; then
+    AC_MSG_NOTICE([zstd configuration without pkg-config])
+    AC_CHECK_HEADER(zstd.h, [
+      AC_CHECK_LIB(zstd, ZSTD_getDictID_fromFrame, [
+        zstd_found=yes
+        SVN_ZSTD_LIBS="-lzstd"
+      ])
+    ])
+  fi
+])
+
+AC_DEFUN(SVN_ZSTD_PREFIX,
+[
+  AC_MSG_NOTICE([zstd configuration via prefix])
+  save_cppflags="$CPPFLAGS"
+  CPPFLAGS="$CPPFLAGS -I$zstd_prefix/include"
+  save_ldflags="$LDFLAGS"
+  LDFLAGS="$LDFLAGS -L$zstd_prefix/lib"
+  AC_CHECK_HEADER(zstd.h, [
+    AC_CHECK_LIB(zstd, ZSTD_getDictID_fromFrame, [
+      zstd_found=yes
+      SVN_ZSTD_INCLUDES="-I$zstd_prefix/include"
+      SVN_ZSTD_LIBS="`SVN_REMOVE_STANDARD_LIB_DIRS(-L$zstd_prefix/lib)` -lzstd"
+    ])
+  ])
+  LDFLAGS="$save_ldflags"
+  CPPFLAGS="$save_cppflags"
+])
@@ -174,6 +174,21 @@ typedef struct svn_cache__info_t
    */
   apr_uint64_t total_entries;
 
+  /** Number of entries that have been removed from the cache to make
+   * room for new ones.  May be 0 if that information is not available.
+   *
+   * @since New in 1.12.
+   */
+  apr_uint64_t evictions;
+
+  /** Number of new entries that the cache declined to store, e.g. because
+   * the admission policy considered them less valuable than the existing
+   * entries.  May be 0 if that information is not available.
+   *
+   * @since New in 1.12.
+   */
+  apr_uint64_t rejections;
+
   /** Number of index buckets with the given number of entries.
    * Bucket sizes larger than the array will saturate into the
    * highest array index.
@@ -310,6 +325,108 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   svn_boolean_t allow_blocking_writes,
                                   apr_pool_t *result_pool);
 
+/**
+ * Like svn_cache__membuffer_cache_create() but place the cache in the
+ * named shared memory region @a name such that all processes on this
+ * host using the same @a name share the same cache contents.  If no such
+ * region exists, it will be created.  Otherwise, the existing region will
+ * be used, provided it has the same size and format.  The region remains
+ * in place when all processes detached from it, i.e. it will be available
+ * to processes started later.  Use svn_cache__membuffer_remove_shared()
+ * to remove it.
+ *
+ * The resulting cache is always thread-safe.  If a process dies while
+ * holding a lock on a cache segment, that segment will be cleared.
+ *
+ * Return #SVN_ERR_UNSUPPORTED_FEATURE if the platform does not support
+ * shared memory caches.
+ *
+ * The region will be unmapped when @a result_pool gets cleaned up.
+ *
+ * @since New in 1.12.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         const char *name,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *result_pool);
+
+/**
+ * Remove the shared memory cache region @a name created by
+ * svn_cache__membuffer_cache_create_shared().  Processes that are
+ * currently using it are not affected.  Succeed if no such region exists.
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.12.
+ */
+svn_error_t *
+svn_cache__membuffer_remove_shared(const char *name,
+                                   apr_pool_t *scratch_pool);
+
+/**
+ * Write a snapshot of all entries in @a cache to the file at @a path,
+ * replacing any previous file.  The entries are written segment by
+ * segment such that concurrent writers will only be blocked briefly.
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.12.
+ */
+svn_error_t *
+svn_cache__membuffer_save(svn_membuffer_t *cache,
+                          const char *path,
+                          apr_pool_t *scratch_pool);
+
+/**
+ * Add all entries from the snapshot file at @a path, written by
+ * svn_cache__membuffer_save(), to @a cache.  Snapshots from incompatible
+ * platforms as well as corrupted entries will be ignored.  Entries that
+ * don't fit into @a cache will be dropped as if they had been evicted.
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * Cache keys must fully identify the cached data.  So, snapshots must not
+ * be used after repositories have been replaced with different contents.
+ *
+ * @since New in 1.12.
+ */
+svn_error_t *
+svn_cache__membuffer_load(svn_membuffer_t *cache,
+                          const char *path,
+                          apr_pool_t *scratch_pool);
+
+/**
+ * Admission and eviction policies for membuffer caches.
+ *
+ * @since New in 1.12.
+ */
+typedef enum svn_cache__membuffer_policy_t
+{
+  /** Promote entries to L2 and evict them based on their priority and
+   * the number of hits they received while in cache. */
+  svn_cache__membuffer_policy_default,
+
+  /** Like #svn_cache__membuffer_policy_default but track the approximate
+   * access frequency of all keys - including those not in cache - and
+   * admit new entries to L2 only if they are requested more frequently
+   * than the entries they would replace (TinyLFU).  This prevents large
+   * scans from flushing the frequently used working set. */
+  svn_cache__membuffer_policy_tinylfu
+} svn_cache__membuffer_policy_t;
+
+/**
+ * Make @a cache use the admission and eviction @a policy.  This may be
+ * changed at any time but the access frequencies used by
+ * #svn_cache__membuffer_policy_tinylfu are only being tracked while that
+ * policy is active.
+ *
+ * @since New in 1.12.
+ */
+void
+svn_cache__membuffer_set_policy(svn_membuffer_t *cache,
+                                svn_cache__membuffer_policy_t policy);
+
 /**
  * @defgroup Standard priority classes for #svn_cache__create_membuffer_cache.
  * @{
@@ -554,6 +671,77 @@ svn_cache__format_info(const svn_cache__info_t *info,
 struct svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void);
 
+/**
+ * Make the process-global membuffer cache use the shared memory region
+ * @a name, see svn_cache__membuffer_cache_create_shared().  If that fails,
+ * a process-local cache will be used instead and
+ * svn_cache__init_global_membuffer_cache() reports why.  @c NULL, the default,
+ * selects a process-local cache.  @a name must remain valid for the
+ * lifetime of the process.
+ *
+ * Like svn_cache_config_set(), this must be called before the global
+ * cache gets used for the first time and is not thread-safe.
+ *
+ * @since New in 1.12.
+ */
+void
+svn_cache__config_set_shared_name(const char *name);
+
+/**
+ * Make the process-global membuffer cache use the admission and eviction
+ * @a policy.  The default is #svn_cache__membuffer_policy_default.
+ *
+ * Like svn_cache_config_set(), this must be called before the global
+ * cache gets used for the first time and is not thread-safe.
+ *
+ * @since New in 1.12.
+ */
+void
+svn_cache__config_set_policy(svn_cache__membuffer_policy_t policy);
+
+/**
+ * Make the process-global membuffer cache load its initial contents from
+ * the snapshot file at @a path when it gets created.  Missing or unusable
+ * snapshot files will be ignored.  @c NULL, the default, disables this.
+ * @a path must remain valid for the lifetime of the process.
+ *
+ * Like svn_cache_config_set(), this must be called before the global
+ * cache gets used for the first time and is not thread-safe.
+ *
+ * @see svn_cache__save_global_membuffer_cache()
+ * @since New in 1.12.
+ */
+void
+svn_cache__config_set_snapshot_path(const char *path);
+
+/**
+ * Create the process-global membuffer cache now, if that has not happened
+ * yet.  Servers should call this upon start-up to report configuration
+ * problems early.
+ *
+ * Return an error if the cache could not be created at all.  If a shared
+ * memory region has been configured via svn_cache__config_set_shared_name()
+ * but could not be used, a process-local cache will still be in place and
+ * the error explains why the shared region was not used.  In that case,
+ * the caller should log the error and continue.
+ *
+ * @since New in 1.12.
+ */
+svn_error_t *
+svn_cache__init_global_membuffer_cache(void);
+
+/**
+ * Write the contents of the process-global membuffer cache to the
+ * snapshot file configured via svn_cache__config_set_snapshot_path().
+ * This is a no-op if no snapshot file has been configured or the global
+ * cache has not been created.  Use @a scratch_pool for temporary
+ * allocations.
+ *
+ * @since New in 1.12.
+ */
+svn_error_t *
+svn_cache__save_global_membuffer_cache(apr_pool_t *scratch_pool);
+
 /**
  * Return total access and size stats over all membuffer caches as they
  * share the underlying data buffer.  The result will be allocated in POOL.
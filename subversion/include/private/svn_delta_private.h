@@ -108,6 +108,51 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
                                  apr_pool_t *pool);
 
+/** Like svn_txdelta_target_push() but compute the delta windows using
+ * up to @a thread_count threads in parallel and return the stream in
+ * @a *stream.  The windows will still be passed to @a handler in order
+ * and from the thread that writes to @a *stream.  If @a thread_count is
+ * 1 or less, this is equivalent to svn_txdelta_target_push().
+ */
+svn_error_t *
+svn_txdelta__target_push_parallel(svn_stream_t **stream,
+                                  svn_txdelta_window_handler_t handler,
+                                  void *handler_baton,
+                                  svn_stream_t *source,
+                                  int thread_count,
+                                  apr_pool_t *pool);
+
+/** Like svn_txdelta_to_svndiff3() but compress the windows in up to
+ * @a thread_count background threads while the caller produces the next
+ * windows.  The encoded windows will still be written to @a output in
+ * order and from the thread that calls @a *handler.  If @a thread_count
+ * is 1 or less or @a svndiff_version is 0, this is equivalent to
+ * svn_txdelta_to_svndiff3().
+ *
+ * If @a svndiff_version is 3 and @a zstd_dict is not NULL, compress the
+ * windows with that Zstandard dictionary.  Readers must pass the same
+ * dictionary to svn_txdelta__read_svndiff_window().
+ */
+svn_error_t *
+svn_txdelta__to_svndiff_parallel(svn_txdelta_window_handler_t *handler,
+                                 void **handler_baton,
+                                 svn_stream_t *output,
+                                 int svndiff_version,
+                                 int compression_level,
+                                 const svn_string_t *zstd_dict,
+                                 int thread_count,
+                                 apr_pool_t *pool);
+
+/** Like svn_txdelta_read_svndiff_window() but decompress svndiff3 data
+ * with the Zstandard dictionary @a zstd_dict, which may be NULL.
+ */
+svn_error_t *
+svn_txdelta__read_svndiff_window(svn_txdelta_window_t **window,
+                                 svn_stream_t *stream,
+                                 int svndiff_version,
+                                 const svn_string_t *zstd_dict,
+                                 apr_pool_t *pool);
+
 /* Return a debug editor that wraps @a wrapped_editor.
  *
  * The debug editor simply prints an indication of what callbacks are being
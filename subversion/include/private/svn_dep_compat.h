@@ -95,6 +95,19 @@ extern "C" {
 #endif
 #endif
 
+/**
+ * Indicate whether SSE2 intrinsics from <emmintrin.h> may be used.  SSE2
+ * is part of the x64 baseline and enabled by default on virtually all
+ * compilers targeting x86, so we don't need runtime detection for it.
+ *
+ * @since New in 1.12.
+ */
+#ifndef SVN__HAVE_SSE2
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#  define SVN__HAVE_SSE2
+#endif
+#endif
+
 /**
  * APR keeps a few interesting defines hidden away in its private
  * headers apr_arch_file_io.h, so we redefined them here.
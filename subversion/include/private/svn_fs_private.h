@@ -211,6 +211,35 @@ svn_fs__get_deleted_node(svn_fs_root_t **node_root,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool);
 
+/** Try to locate the fulltext of the file @a path under @a root as a
+ * contiguous, uncompressed byte range on disk.  On success, set @a *file
+ * to an open handle of the file containing the data, @a *offset to the
+ * position of the first byte within it and @a *length to the number of
+ * bytes.  The caller may then send the data directly from @a *file, e.g.
+ * using sendfile(), instead of going through svn_fs_file_contents().
+ *
+ * If the back-end does not support this or the contents are not stored
+ * in that form (e.g. deltified or within a transaction), set @a *file
+ * to @c NULL.  Note that @a *file remains valid even if the repository
+ * gets packed concurrently.
+ *
+ * Unlike svn_fs_file_contents(), this does not verify the data against
+ * the file's checksums.  A streaming reader can only detect a mismatch
+ * after it has passed on all the data, so the caller should rather hand
+ * the checksum to its client, e.g. from svn_fs_file_checksum().
+ *
+ * Allocate @a *file in @a result_pool; it will be closed when that pool
+ * gets cleaned up.  Use @a scratch_pool for temporaries.
+ */
+svn_error_t *
+svn_fs__file_contents_location(apr_file_t **file,
+                               apr_off_t *offset,
+                               svn_filesize_t *length,
+                               svn_fs_root_t *root,
+                               const char *path,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool);
+
 
 /** @} */
 
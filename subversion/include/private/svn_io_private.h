@@ -85,6 +85,51 @@ svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool);
 
 
+/**
+ * Tell the operating system that @a length bytes starting at @a offset in
+ * @a file will be read soon, so it may start fetching them asynchronously.
+ * This is only a hint; it is a no-op on platforms that don't support it.
+ */
+void
+svn_io__file_prefetch(apr_file_t *file,
+                      apr_off_t offset,
+                      apr_off_t length);
+
+
+/**
+ * Try to copy @a size bytes from the current position in @a source to the
+ * current position in @a dest without passing the data through user space,
+ * e.g. using copy_file_range().  Set @a *copied to the number of bytes that
+ * have been copied that way and advance both file positions accordingly.
+ *
+ * If the platform or the file systems involved don't support this, fewer
+ * bytes than @a size (possibly 0) may be copied.  The caller is expected
+ * to copy the remainder using regular reads and writes.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__file_copy_range(apr_off_t *copied,
+                        apr_file_t *dest,
+                        apr_file_t *source,
+                        apr_off_t size,
+                        apr_pool_t *scratch_pool);
+
+
+/**
+ * Create @a link_path as a hard link to the existing file @a existing_path,
+ * such that both names refer to the same file.  Fail with an error wrapping
+ * the OS error code if @a link_path already exists or the file system
+ * does not support that, e.g. between different file systems.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__create_hardlink(const char *link_path,
+                        const char *existing_path,
+                        apr_pool_t *scratch_pool);
+
+
 /** Return the underlying file, if any, associated with the stream, or
  * NULL if not available.  Accessing the file bypasses the stream.
  */
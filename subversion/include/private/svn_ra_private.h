@@ -34,6 +34,7 @@
 #include "svn_delta.h"
 #include "svn_editor.h"
 #include "svn_io.h"
+#include "svn_diff.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -308,6 +309,63 @@ svn_ra__replay_ev2(svn_ra_session_t *session,
                    apr_pool_t *scratch_pool);
 
 
+/* One chunk of lines in a blame result as returned by svn_ra__get_blame. */
+typedef struct svn_ra__blame_chunk_t
+{
+  /* The first line of this chunk, counting from 0.  The chunk extends up
+     to the start of the next chunk or to the end of the file. */
+  apr_int64_t start;
+
+  /* The revision that last changed these lines, or SVN_INVALID_REVNUM if
+     they predate the blamed revision range. */
+  svn_revnum_t revision;
+} svn_ra__blame_chunk_t;
+
+/* Let the server determine which revision between START and END last
+   changed each line of the file at PATH in revision END, relative to
+   SESSION's URL.  Return the result in *CHUNKS as an array of
+   svn_ra__blame_chunk_t ordered by line, allocated in RESULT_POOL.
+   START must not be younger than END.
+
+   This gives the same attribution as blaming the file revisions reported
+   by svn_ra_get_file_revs2() from START - 1 to END with DIFF_OPTIONS,
+   without transmitting any of them.
+
+   Return SVN_ERR_RA_NOT_IMPLEMENTED if the server does not support
+   this.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_ra__get_blame(svn_ra_session_t *session,
+                  apr_array_header_t **chunks,
+                  const char *path,
+                  svn_revnum_t start,
+                  svn_revnum_t end,
+                  const svn_diff_file_options_t *diff_options,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool);
+
+/* Fetch the entries of all directories in PATHS, each relative to
+   SESSION's URL, in REVISION like svn_ra_get_dir2() would for each of
+   them.  Set *DIRENTS to a hash that maps each path in PATHS to the hash
+   of its entries, with the same key and value types as returned by
+   svn_ra_get_dir2().  DIRENT_FIELDS selects the fields to fill in.
+
+   RA layers that can do so send all requests without waiting for the
+   individual responses, such that the round trip time is being paid
+   roughly once instead of once per directory.  The order in which the
+   requests are processed is undefined.
+
+   REVISION must be a valid revision number.  Allocate *DIRENTS in
+   RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_ra__get_dirs(svn_ra_session_t *session,
+                 apr_hash_t **dirents,
+                 const apr_array_header_t *paths,
+                 svn_revnum_t revision,
+                 apr_uint32_t dirent_fields,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool);
+
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
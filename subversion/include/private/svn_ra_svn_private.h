@@ -169,6 +169,20 @@ svn_ra_svn__write_string(svn_ra_svn_conn_t *conn,
                          apr_pool_t *pool,
                          const svn_string_t *str);
 
+/** Write @a len bytes from @a file, starting at @a offset, as a string
+ * over the net.  If @a conn is directly connected to a socket, the data
+ * will be sent using sendfile() without copying it to user space.
+ * The file's current position is undefined after this call.
+ *
+ * Writes preceding the data will be flushed before sending it.
+ */
+svn_error_t *
+svn_ra_svn__write_file_range(svn_ra_svn_conn_t *conn,
+                             apr_pool_t *pool,
+                             apr_file_t *file,
+                             apr_off_t offset,
+                             apr_size_t len);
+
 /** Write a cstring over the net.
  *
  * Writes will be buffered until the next read or flush.
@@ -353,6 +367,13 @@ svn_ra_svn__read_cmd_response(svn_ra_svn_conn_t *conn,
                               apr_pool_t *pool,
                               const char *fmt, ...);
 
+/** Like svn_ra_svn__read_cmd_response() but parse the command response
+ * in @a item, which has already been read from the network.
+ */
+svn_error_t *
+svn_ra_svn__parse_cmd_response(const svn_ra_svn__item_t *item,
+                               const char *fmt, ...);
+
 /** Check the receive buffer and socket of @a conn whether there is some
  * unprocessed incoming data without waiting for new data to come in.
  * If data is found, set @a *has_command to TRUE.  If the connection does
@@ -771,6 +792,7 @@ svn_ra_svn__write_cmd_get_file(svn_ra_svn_conn_t *conn,
                                svn_boolean_t stream);
 
 /** Send a "update" command over connection @a conn.
+ * If @a send_texts is FALSE, ask the server to leave out the file contents.
  * Use @a pool for allocations.
  *
  * @see #svn_ra_do_update3 for a description.
@@ -783,9 +805,11 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
                              svn_boolean_t recurse,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry);
+                             svn_boolean_t ignore_ancestry,
+                             svn_boolean_t send_texts);
 
 /** Send a "switch" command over connection @a conn.
+ * If @a send_texts is FALSE, ask the server to leave out the file contents.
  * Use @a pool for allocations.
  *
  * @see #svn_ra_do_switch3 for a description.
@@ -799,7 +823,8 @@ svn_ra_svn__write_cmd_switch(svn_ra_svn_conn_t *conn,
                              const char *switch_url,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry);
+                             svn_boolean_t ignore_ancestry,
+                             svn_boolean_t send_texts);
 
 /** Send a "status" command over connection @a conn.
  * Use @a pool for allocations.
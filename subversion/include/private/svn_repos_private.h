@@ -34,6 +34,7 @@
 #include "svn_delta.h"
 #include "svn_editor.h"
 #include "svn_config.h"
+#include "svn_diff.h"
 
 #include "private/svn_object_pool.h"
 #include "private/svn_string_private.h"
@@ -388,6 +389,84 @@ svn_repos__get_dump_editor(const svn_delta_editor_t **editor,
                            const char *update_anchor_relpath,
                            apr_pool_t *pool);
 
+/**
+ * Rebuild all auxiliary indexes of @a repos from the revision data,
+ * replacing any existing ones.  These are the revision date index used
+ * by svn_repos_dated_revision() and the changed-paths index used by
+ * svn_repos_get_logs5().
+ *
+ * Use @a cancel_func and @a cancel_baton to allow cancellation and
+ * @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.12.
+ */
+svn_error_t *
+svn_repos__rebuild_indexes(svn_repos_t *repos,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool);
+
+/**
+ * One chunk of lines in a blame result as returned by
+ * svn_repos__get_blame().
+ *
+ * @since New in 1.12.
+ */
+typedef struct svn_repos__blame_chunk_t
+{
+  /** The first line of this chunk, counting from 0.  The chunk extends
+   * up to the start of the next chunk or to the end of the file. */
+  apr_int64_t start;
+
+  /** The revision that last changed these lines, or #SVN_INVALID_REVNUM
+   * if they predate the blamed revision range. */
+  svn_revnum_t revision;
+} svn_repos__blame_chunk_t;
+
+/**
+ * Determine which revision last changed each line of the file @a path
+ * in @a repos between the revisions @a start and @a end, following the
+ * file's history across copies.  Return the result in @a *chunks as an
+ * array of #svn_repos__blame_chunk_t ordered by line, allocated in
+ * @a result_pool.  The lines are those of @a path in revision @a end.
+ *
+ * This gives the same attribution as a client-side blame that feeds
+ * the file revisions reported by svn_repos_get_file_revs2() from
+ * @a start - 1 to @a end through svn_diff_mem_string_diff() using
+ * @a diff_options.  @a start must not be younger than @a end.
+ *
+ * If @a authz_read_func is not @c NULL, the blame will not go beyond the
+ * first location in the file's history for which it returns FALSE.
+ *
+ * Return #SVN_ERR_REPOS_BLAME_REFUSED if @a path has a binary
+ * svn:mime-type in @a end or if @a max_text_size is not 0 and any of
+ * the texts to compare is larger than that.  Callers may then still
+ * blame the file revisions themselves.
+ *
+ * Results are being cached per node revision in the global membuffer
+ * cache.  Subsequent requests for newer revisions of the same file will
+ * only have to process the revisions added since.
+ *
+ * Use @a cancel_func and @a cancel_baton to allow cancellation and
+ * @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.12.
+ */
+svn_error_t *
+svn_repos__get_blame(apr_array_header_t **chunks,
+                     svn_repos_t *repos,
+                     const char *path,
+                     svn_revnum_t start,
+                     svn_revnum_t end,
+                     const svn_diff_file_options_t *diff_options,
+                     svn_filesize_t max_text_size,
+                     svn_repos_authz_func_t authz_read_func,
+                     void *authz_read_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -591,6 +591,34 @@ svn__decompress_lz4(const void *data, apr_size_t len,
                     svn_stringbuf_t *out,
                     apr_size_t limit);
 
+/* Return TRUE if this build supports Zstandard compression. */
+svn_boolean_t
+svn__zstd_available(void);
+
+/* Same as svn__compress_zlib(), but use Zstandard compression with the
+ * given LEVEL (clipped to the range supported by the library).  If DICT
+ * is not NULL, use it as the compression dictionary; the resulting data
+ * can then only be decompressed with the same dictionary.
+ *
+ * Return SVN_ERR_UNSUPPORTED_FEATURE if svn__zstd_available() is FALSE.
+ */
+svn_error_t *
+svn__compress_zstd(const void *data, apr_size_t len,
+                   svn_stringbuf_t *out,
+                   int level,
+                   const svn_string_t *dict);
+
+/* Same as svn__decompress_zlib(), but use Zstandard compression.  DICT
+ * must be the dictionary that was used for compression, if any.
+ *
+ * Return SVN_ERR_UNSUPPORTED_FEATURE if svn__zstd_available() is FALSE.
+ */
+svn_error_t *
+svn__decompress_zstd(const void *data, apr_size_t len,
+                     svn_stringbuf_t *out,
+                     apr_size_t limit,
+                     const svn_string_t *dict);
+
 /** @} */
 
 /**
@@ -746,6 +774,14 @@ const char *svn_lz4__compiled_version(void);
  */
 int svn_lz4__runtime_version(void);
 
+/* Return the zstd version we compiled against or NULL if we have been
+ * built without zstd support. */
+const char *svn_zstd__compiled_version(void);
+
+/* Return the zstd version we run against or NULL if we have been
+ * built without zstd support. */
+const char *svn_zstd__runtime_version(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
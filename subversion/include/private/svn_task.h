@@ -0,0 +1,149 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_task.h
+ * @brief ordered, concurrent task execution
+ *
+ * A task queue executes a sequence of independent tasks on a process-wide
+ * pool of worker threads but hands their results to the caller strictly
+ * in the order in which the tasks had been added.  This allows us to
+ * parallelize CPU-heavy steps - like delta computation or compression -
+ * without changing the output of the respective operation.
+ *
+ * Every task lives in its own root pool which is safe to be used from a
+ * different thread.  The caller allocates the task baton in that pool and
+ * hands it over to the queue.  Processing results are allocated in the
+ * same pool, which gets destroyed once the results have been passed to
+ * the output function.
+ *
+ * The number of tasks in flight is bounded.  Adding a task will block
+ * until the oldest pending task has been processed, if necessary.  Thus,
+ * memory consumption is limited by the size of the individual tasks.
+ *
+ * If APR does not support threads or only a single thread has been
+ * requested, all tasks will be executed synchronously.  The results are
+ * the same, only slower.
+ */
+
+
+#ifndef SVN_TASK_H
+#define SVN_TASK_H
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+#include "svn_error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+
+/* The opaque task queue type. */
+typedef struct svn_task__queue_t svn_task__queue_t;
+
+/* Callback processing a single task.  It will usually be called from a
+ * worker thread.  Process the task described by BATON and return its
+ * output in *RESULT, allocated in RESULT_POOL.  Use SCRATCH_POOL for
+ * temporary allocations.
+ *
+ * Implementations must not access any data that may be used by other
+ * threads at the same time unless they synchronize that access.
+ */
+typedef svn_error_t *
+(*svn_task__process_func_t)(void **result,
+                            void *baton,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/* Callback consuming the RESULT of a single task.  This will always be
+ * called from the thread that added the task and in the order in which
+ * the tasks had been added.  OUTPUT_BATON is the baton given to
+ * svn_task__queue_create.  Use SCRATCH_POOL for temporary allocations.
+ */
+typedef svn_error_t *
+(*svn_task__output_func_t)(void *result,
+                           void *output_baton,
+                           apr_pool_t *scratch_pool);
+
+/* Create a new task queue in RESULT_POOL and return it in *QUEUE.  Tasks
+ * will be processed by PROCESS_FUNC using up to THREAD_COUNT threads in
+ * parallel.  Their results will then be passed to OUTPUT_FUNC along with
+ * OUTPUT_BATON.  At most MAX_PENDING tasks will be left in flight when
+ * svn_task__queue_add returns; values smaller than THREAD_COUNT will be
+ * raised to THREAD_COUNT.  Tasks in flight beyond THREAD_COUNT wait until
+ * a thread becomes available.  The threads are taken from a process-wide
+ * pool that is shared by all queues.
+ *
+ * If THREAD_COUNT is 1 or less, tasks will be processed synchronously.
+ *
+ * Clearing RESULT_POOL will wait for all running tasks to complete and
+ * discard any pending results.
+ */
+svn_error_t *
+svn_task__queue_create(svn_task__queue_t **queue,
+                       int thread_count,
+                       int max_pending,
+                       svn_task__process_func_t process_func,
+                       svn_task__output_func_t output_func,
+                       void *output_baton,
+                       apr_pool_t *result_pool);
+
+/* Return a new root pool to allocate the baton of the next task in
+ * QUEUE from.  Ownership of the pool will be passed to QUEUE upon
+ * svn_task__queue_add.  Otherwise, the caller must destroy it.
+ */
+apr_pool_t *
+svn_task__queue_task_pool(svn_task__queue_t *queue);
+
+/* Add a new task to QUEUE.  BATON will be passed to the queue's process
+ * function and must have been allocated in TASK_POOL, which must have
+ * been returned by svn_task__queue_task_pool.
+ *
+ * Pass any results of previously added tasks that have been completed
+ * in the meantime to the queue's output function.  If necessary, block
+ * until the number of pending tasks drops below the limit.
+ *
+ * If processing or output of any task failed, return that error.  Once
+ * an error has been returned, QUEUE must not be used anymore.
+ */
+svn_error_t *
+svn_task__queue_add(svn_task__queue_t *queue,
+                    void *baton,
+                    apr_pool_t *task_pool);
+
+/* Wait for all tasks in QUEUE to complete and pass their results to the
+ * queue's output function.  If processing or output of any task failed,
+ * return that error.
+ *
+ * If no error has been returned, QUEUE may be used to process more tasks
+ * afterwards.
+ */
+svn_error_t *
+svn_task__queue_finish(svn_task__queue_t *queue);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_TASK_H */
@@ -112,6 +112,8 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_OPTION_HTTP_MAX_CONNECTIONS      "http-max-connections"
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_HTTP_CHUNKED_REQUESTS     "http-chunked-requests"
+/** @since New in 1.12. */
+#define SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS       "svn-max-connections"
 
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_SERF_LOG_COMPONENTS       "serf-log-components"
@@ -171,6 +173,12 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_OPTION_SQLITE_EXCLUSIVE_CLIENTS  "exclusive-locking-clients"
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_SQLITE_BUSY_TIMEOUT       "busy-timeout"
+/** @since New in 1.12. */
+#define SVN_CONFIG_OPTION_SQLITE_WAL                "write-ahead-log"
+/** @since New in 1.12. */
+#define SVN_CONFIG_OPTION_WC_WORKER_THREADS         "worker-threads"
+/** @since New in 1.12. */
+#define SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE     "shared-pristine-store"
 /** @} */
 
 /** @name Repository conf directory configuration files strings
@@ -235,6 +243,7 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_DEFAULT_OPTION_STORE_SSL_CLIENT_CERT_PP_PLAINTEXT \
                                                              SVN_CONFIG_ASK
 #define SVN_CONFIG_DEFAULT_OPTION_HTTP_MAX_CONNECTIONS       4
+#define SVN_CONFIG_DEFAULT_OPTION_SVN_MAX_CONNECTIONS        4
 
 /** Read configuration information from the standard sources and merge it
  * into the hash @a *cfg_hash.  If @a config_dir is not NULL it specifies a
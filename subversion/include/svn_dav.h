@@ -413,6 +413,16 @@ extern "C" {
 #define SVN_DAV_NS_DAV_SVN_SVNDIFF2\
             SVN_DAV_PROP_NS_DAV "svn/svndiff2"
 
+/** Presence of this in a DAV header in an OPTIONS response indicates
+ * that the transmitter (in this case, the server) knows how to handle
+ * svndiff3 (Zstandard) format encoding.  Only servers built with zstd
+ * support send it.
+ *
+ * @since New in 1.12.
+ */
+#define SVN_DAV_NS_DAV_SVN_SVNDIFF3\
+            SVN_DAV_PROP_NS_DAV "svn/svndiff3"
+
 /** Presence of this in a DAV header in an OPTIONS response indicates
  * that the transmitter (in this case, the server) sends the result
  * checksum in the response to a successful PUT request.
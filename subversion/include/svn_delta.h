@@ -522,7 +522,11 @@ svn_txdelta_apply(svn_stream_t *source,
  *
  * @since New in 1.7.  Since 1.10, @a svndiff_version can be 2 for the
  * svndiff2 format.  @a compression_level is currently ignored if
- * @a svndiff_version is set to 2.
+ * @a svndiff_version is set to 2.  Since 1.12, @a svndiff_version can be
+ * 3 for the Zstandard based svndiff3 format, in which case
+ * @a compression_level is used as the zstd compression level.  Writing
+ * and reading svndiff3 fails with #SVN_ERR_UNSUPPORTED_FEATURE if
+ * Subversion has been built without zstd support.
  */
 void
 svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
@@ -166,6 +166,27 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_FSFS_LOG_ADDRESSING       "fsfs-log-addressing"
 
+/** String with a decimal representation of the number of threads that
+ * FSFS may use to compute and compress the deltas of large
+ * representations during a commit.  Values of 1 or less ("1", the
+ * default) disable concurrent delta processing.  The repository contents
+ * are not affected.
+ *
+ * @since New in 1.12.
+ */
+#define SVN_FS_CONFIG_FSFS_DELTA_THREADS        "fsfs-delta-threads"
+
+/** String with a decimal representation of the number of shards that
+ * FSFS and FSX may pack concurrently during svn_fs_pack2().  Every worker
+ * thread uses its own memory budget.  Switching over to the packed shards
+ * still happens one shard at a time and in shard order.  Values of 1 or
+ * less ("1", the default) disable concurrent packing.  Larger values
+ * require the caches not to be configured as single-threaded.
+ *
+ * @since New in 1.12.
+ */
+#define SVN_FS_CONFIG_FSFS_PACK_THREADS         "fsfs-pack-threads"
+
 /* Note to maintainers: if you add further SVN_FS_CONFIG_FSFS_CACHE_* knobs,
    update fs_fs.c:verify_as_revision_before_current_plus_plus(). */
 
@@ -3304,8 +3325,28 @@ typedef svn_error_t *(*svn_fs_pack_notify_t)(void *baton,
  * Possibly update the filesystem located in the directory @a path
  * to use disk space more efficiently.
  *
+ * @a fs_config is passed to the backend when opening the filesystem and
+ * may be @c NULL.  Use #SVN_FS_CONFIG_FSFS_PACK_THREADS to pack multiple
+ * shards concurrently.
+ *
+ * @since New in 1.12.
+ */
+svn_error_t *
+svn_fs_pack2(const char *db_path,
+             apr_hash_t *fs_config,
+             svn_fs_pack_notify_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool);
+
+/**
+ * Like svn_fs_pack2(), but with @a fs_config set to @c NULL.
+ *
  * @since New in 1.6.
+ * @deprecated Provided for backward compatibility with the 1.11 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_pack(const char *db_path,
             svn_fs_pack_notify_t notify_func,
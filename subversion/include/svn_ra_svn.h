@@ -50,6 +50,8 @@ extern "C" {
 #define SVN_RA_SVN_CAP_EDIT_PIPELINE "edit-pipeline"
 #define SVN_RA_SVN_CAP_SVNDIFF1 "svndiff1"
 #define SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED "accepts-svndiff2"
+/** @since New in 1.12. Only advertised by builds with zstd support. */
+#define SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED "accepts-svndiff3"
 #define SVN_RA_SVN_CAP_ABSENT_ENTRIES "absent-entries"
 /* maps to SVN_RA_CAPABILITY_COMMIT_REVPROPS: */
 #define SVN_RA_SVN_CAP_COMMIT_REVPROPS "commit-revprops"
@@ -71,6 +73,10 @@ extern "C" {
 #define SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE "file-revs-reverse"
 /* maps to SVN_RA_CAPABILITY_LIST */
 #define SVN_RA_SVN_CAP_LIST "list"
+/* server may leave out file contents in update and switch edits */
+#define SVN_RA_SVN_CAP_UPDATE_SKELETON "update-skeleton"
+/* server accepts pipelined commands wrapped in "tagged" */
+#define SVN_RA_SVN_CAP_TAGGED_COMMANDS "tagged-commands"
 
 
 /** ra_svn passes @c svn_dirent_t fields over the wire as a list of
@@ -3134,10 +3134,10 @@ enum svn_repos_load_uuid
   svn_repos_load_uuid_force
 };
 
-/** Callback type for use with svn_repos_verify_fs3().  @a revision
+/** Callback type for use with svn_repos_verify_fs4().  @a revision
  * and @a verify_err are the details of a single verification failure
- * that occurred during the svn_repos_verify_fs3() call.  @a baton is
- * the same baton given to svn_repos_verify_fs3().  @a scratch_pool is
+ * that occurred during the svn_repos_verify_fs4() call.  @a baton is
+ * the same baton given to svn_repos_verify_fs4().  @a scratch_pool is
  * provided for the convenience of the implementor, who should not
  * expect it to live longer than a single callback call.
  *
@@ -3147,7 +3147,7 @@ enum svn_repos_load_uuid
  * should also call svn_error_dup() for @a verify_err.  Implementors of this
  * callback are forbidden to call svn_error_clear() for @a verify_err.
  *
- * @see svn_repos_verify_fs3
+ * @see svn_repos_verify_fs4
  *
  * @since New in 1.9.
  */
@@ -3176,6 +3176,13 @@ typedef svn_error_t *(*svn_repos_verify_callback_t)(void *baton,
  * file context reconstruction and verification.  For FSFS format 7+ and
  * FSX, this allows for a very fast check against external corruption.
  *
+ * If @a jobs is larger than 1, verify up to @a jobs shards and revisions
+ * concurrently, each using its own file system instance.  Notifications
+ * and failures will still be reported in revision order and from the
+ * calling thread.  Parallel verification requires a thread-safe cache
+ * configuration, see svn_cache_config_t.  @a cancel_func may get called
+ * from other threads than the calling one but never concurrently.
+ *
  * If @a verify_callback is not @c NULL, call it with @a verify_baton upon
  * receiving an FS-specific structure failure or a revision verification
  * failure.  Set @c revision callback argument to #SVN_INVALID_REVNUM or
@@ -3224,8 +3231,30 @@ typedef svn_error_t *(*svn_repos_verify_callback_t)(void *baton,
  *
  * @see svn_repos_verify_callback_t
  *
+ * @since New in 1.12.
+ */
+svn_error_t *
+svn_repos_verify_fs4(svn_repos_t *repos,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     svn_boolean_t check_normalization,
+                     svn_boolean_t metadata_only,
+                     int jobs,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_repos_verify_callback_t verify_callback,
+                     void *verify_baton,
+                     svn_cancel_func_t cancel,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_repos_verify_fs4(), but with @a jobs set to 1.
+ *
  * @since New in 1.9.
+ * @deprecated Provided for backward compatibility with the 1.11 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_verify_fs3(svn_repos_t *repos,
                      svn_revnum_t start_rev,
@@ -37,6 +37,7 @@
 #include "svn_hash.h"
 #include "svn_sorts.h"
 
+#include "private/svn_ra_private.h"
 #include "private/svn_wc_private.h"
 
 #include "svn_private_config.h"
@@ -655,6 +656,123 @@ normalize_blames(struct blame_chain *chain,
     }
 }
 
+/* Try to let the server calculate the blame for FRB->START_REV through
+   FRB->END_REV of the file that RA_SESSION points to.  On success, set
+   FRB->CHAIN, FRB->LAST_REV and FRB->LAST_FILENAME as if file_rev_handler
+   had been called for all revisions and set *HANDLED to TRUE.  If the
+   server does not support this or refuses to blame this file, set
+   *HANDLED to FALSE and leave FRB untouched.  Unless IGNORE_MIME_TYPE is
+   set, refuse to blame files that have a binary svn:mime-type in END_REV,
+   just as file_rev_handler would.  The contents of END_REV are only
+   downloaded once the server has provided the blame.  Use FRB->MAINPOOL for everything that has to live for the
+   whole operation and SCRATCH_POOL for temporaries. */
+static svn_error_t *
+get_server_blame(svn_boolean_t *handled,
+                 struct file_rev_baton *frb,
+                 svn_ra_session_t *ra_session,
+                 svn_boolean_t ignore_mime_type,
+                 apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *chunks;
+  apr_hash_t *revs;
+  apr_hash_t *props;
+  svn_stream_t *stream;
+  const char *filename;
+  struct blame *last = NULL;
+  apr_pool_t *iterpool;
+  svn_error_t *err;
+  int i;
+
+  *handled = FALSE;
+
+  /* Don't let the server blame a binary file.  The properties are enough
+     to tell. */
+  if (!ignore_mime_type)
+    {
+      const char *value;
+
+      SVN_ERR(svn_ra_get_file(ra_session, "", frb->end_rev, NULL, NULL,
+                              &props, scratch_pool));
+      value = svn_prop_get_value(props, SVN_PROP_MIME_TYPE);
+
+      if (value && svn_mime_type_is_binary(value))
+        return svn_error_createf(
+            SVN_ERR_CLIENT_IS_BINARY_FILE, NULL,
+            _("Cannot calculate blame information for binary file '%s'"),
+            (svn_path_is_url(frb->target)
+                   ? frb->target
+                   : svn_dirent_local_style(frb->target, scratch_pool)));
+    }
+
+  err = svn_ra__get_blame(ra_session, &chunks, "", frb->start_rev,
+                          frb->end_rev, frb->diff_options,
+                          scratch_pool, scratch_pool);
+  if (err && (err->apr_err == SVN_ERR_RA_NOT_IMPLEMENTED
+              || svn_error_find_cause(err, SVN_ERR_REPOS_BLAME_REFUSED)))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  /* The chunks refer to the contents of END_REV. */
+  SVN_ERR(svn_stream_open_unique(&stream, &filename, NULL,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 frb->mainpool, scratch_pool));
+  SVN_ERR(svn_ra_get_file(ra_session, "", frb->end_rev, stream, NULL,
+                          NULL, scratch_pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  frb->last_filename = filename;
+
+  /* Build the chain, sharing one rev struct per revision.  Lines that
+     were last changed before START_REV are not blamed on any revision. */
+  revs = apr_hash_make(scratch_pool);
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      const svn_ra__blame_chunk_t *chunk
+        = &APR_ARRAY_IDX(chunks, i, svn_ra__blame_chunk_t);
+      struct rev *rev = apr_hash_get(revs, &chunk->revision,
+                                     sizeof(chunk->revision));
+      struct blame *blame;
+
+      svn_pool_clear(iterpool);
+      if (frb->ctx->cancel_func)
+        SVN_ERR(frb->ctx->cancel_func(frb->ctx->cancel_baton));
+
+      if (!rev)
+        {
+          rev = apr_pcalloc(frb->mainpool, sizeof(*rev));
+          rev->revision = chunk->revision;
+          if (SVN_IS_VALID_REVNUM(chunk->revision))
+            {
+              apr_hash_t *rev_props;
+
+              SVN_ERR(svn_ra_rev_proplist(ra_session, chunk->revision,
+                                          &rev_props, iterpool));
+              rev->rev_props = svn_prop_hash_dup(rev_props, frb->mainpool);
+            }
+
+          apr_hash_set(revs, &rev->revision, sizeof(rev->revision), rev);
+        }
+
+      blame = blame_create(frb->chain, rev, (apr_off_t)chunk->start);
+      if (last)
+        last->next = blame;
+      else
+        frb->chain->blame = blame;
+
+      last = blame;
+      if (!frb->last_rev || rev->revision > frb->last_rev->revision)
+        frb->last_rev = rev;
+    }
+  svn_pool_destroy(iterpool);
+
+  *handled = TRUE;
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_client_blame6(svn_revnum_t *start_revnum_p,
                   svn_revnum_t *end_revnum_p,
@@ -678,6 +796,7 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
   svn_stream_t *last_stream;
   svn_stream_t *stream;
   const char *target_abspath_or_url;
+  svn_boolean_t server_blame;
 
   if (start->kind == svn_opt_revision_unspecified
       || end->kind == svn_opt_revision_unspecified)
@@ -811,16 +930,24 @@ svn_client_blame6(svn_revnum_t *start_revnum_p,
       frb.prevfilepool = svn_pool_create(pool);
     }
 
+  /* Let the server do the work if it can.  It does not track merges
+     and only calculates the blame forward in history. */
+  server_blame = FALSE;
+  if (!include_merged_revisions && !frb.backwards)
+    SVN_ERR(get_server_blame(&server_blame, &frb, ra_session,
+                             ignore_mime_type, pool));
+
   /* Collect all blame information.
      We need to ensure that we get one revision before the start_rev,
      if available so that we can know what was actually changed in the start
      revision. */
-  SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
-                                frb.backwards ? start_revnum
-                                              : MAX(0, start_revnum-1),
-                                end_revnum,
-                                include_merged_revisions,
-                                file_rev_handler, &frb, pool));
+  if (!server_blame)
+    SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
+                                  frb.backwards ? start_revnum
+                                                : MAX(0, start_revnum-1),
+                                  end_revnum,
+                                  include_merged_revisions,
+                                  file_rev_handler, &frb, pool));
 
   if (end->kind == svn_opt_revision_working)
     {
@@ -36,6 +36,7 @@
 
 #include "svn_private_config.h"
 #include "private/svn_fspath.h"
+#include "private/svn_ra_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_wc_private.h"
 
@@ -179,12 +180,18 @@ build_info_from_dirent(svn_client_info2_t **info,
    RECEIVER on all children of DIR, but none of their children; if
    svn_depth_files, then invoke RECEIVER on file children of DIR but
    not on subdirectories; if svn_depth_infinity, recurse fully.
-   DIR is a relpath, relative to the root of RA_SESSION.
+   DIR is a relpath, relative to the root of RA_SESSION, and DIRENTS
+   are its entries as returned by svn_ra_get_dir2().
+
+   The entries of all subdirectories of DIR are fetched in one go, such
+   that RA layers that support pipelining need not wait for a server
+   round trip per subdirectory.
 */
 static svn_error_t *
 push_dir_info(svn_ra_session_t *ra_session,
               const svn_client__pathrev_t *pathrev,
               const char *dir,
+              apr_hash_t *dirents,
               svn_client_info_receiver2_t receiver,
               void *receiver_baton,
               svn_depth_t depth,
@@ -192,14 +199,31 @@ push_dir_info(svn_ra_session_t *ra_session,
               apr_hash_t *locks,
               apr_pool_t *pool)
 {
-  apr_hash_t *tmpdirents;
+  apr_hash_t *subdir_dirents = NULL;
   apr_hash_index_t *hi;
-  apr_pool_t *subpool = svn_pool_create(pool);
+  apr_pool_t *subpool;
+
+  if (depth == svn_depth_infinity)
+    {
+      apr_array_header_t *subdirs = apr_array_make(pool, 0,
+                                                   sizeof(const char *));
+
+      for (hi = apr_hash_first(pool, dirents); hi; hi = apr_hash_next(hi))
+        {
+          svn_dirent_t *the_ent = apr_hash_this_val(hi);
+
+          if (the_ent->kind == svn_node_dir)
+            APR_ARRAY_PUSH(subdirs, const char *)
+              = svn_relpath_join(dir, apr_hash_this_key(hi), pool);
+        }
 
-  SVN_ERR(svn_ra_get_dir2(ra_session, &tmpdirents, NULL, NULL,
-                          dir, pathrev->rev, DIRENT_FIELDS, pool));
+      if (subdirs->nelts)
+        SVN_ERR(svn_ra__get_dirs(ra_session, &subdir_dirents, subdirs,
+                                 pathrev->rev, DIRENT_FIELDS, pool, pool));
+    }
 
-  for (hi = apr_hash_first(pool, tmpdirents); hi; hi = apr_hash_next(hi))
+  subpool = svn_pool_create(pool);
+  for (hi = apr_hash_first(pool, dirents); hi; hi = apr_hash_next(hi))
     {
       const char *path, *fs_path;
       svn_lock_t *lock;
@@ -231,6 +255,7 @@ push_dir_info(svn_ra_session_t *ra_session,
       if (depth == svn_depth_infinity && the_ent->kind == svn_node_dir)
         {
           SVN_ERR(push_dir_info(ra_session, child_pathrev, path,
+                                svn_hash_gets(subdir_dirents, path),
                                 receiver, receiver_baton,
                                 depth, ctx, locks, subpool));
         }
@@ -435,6 +460,7 @@ svn_client_info4(const char *abspath_or_url,
   if (depth > svn_depth_empty && (the_ent->kind == svn_node_dir))
     {
       apr_hash_t *locks;
+      apr_hash_t *dirents;
 
       if (peg_revision->kind == svn_opt_revision_head)
         {
@@ -453,7 +479,9 @@ svn_client_info4(const char *abspath_or_url,
       else
         locks = apr_hash_make(pool); /* use an empty hash */
 
-      SVN_ERR(push_dir_info(ra_session, pathrev, "",
+      SVN_ERR(svn_ra_get_dir2(ra_session, &dirents, NULL, NULL, "",
+                              pathrev->rev, DIRENT_FIELDS, pool));
+      SVN_ERR(push_dir_info(ra_session, pathrev, "", dirents,
                             receiver, receiver_baton,
                             depth, ctx, locks, pool));
     }
@@ -88,6 +88,20 @@ void svn_txdelta__xdelta(svn_txdelta__ops_baton_t *build_baton,
                          apr_size_t target_len,
                          apr_pool_t *pool);
 
+/* Return the size of the blocks that the xdelta engine checksums. */
+apr_size_t
+svn_txdelta__xdelta_block_size(void);
+
+/* Set *CHECKSUM to the checksum that the xdelta engine calculates for the
+   block of svn_txdelta__xdelta_block_size() bytes at DATA, and set
+   *PORTABLE_CHECKSUM to what the portable implementation calculates for
+   it.  The two differ only if a platform-specific implementation is
+   broken.  For use by the test suite. */
+void
+svn_txdelta__xdelta_block_checksums(apr_uint32_t *checksum,
+                                    apr_uint32_t *portable_checksum,
+                                    const char *data);
+
 
 #ifdef __cplusplus
 }
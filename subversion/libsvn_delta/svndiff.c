@@ -35,17 +35,21 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_task.h"
 
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
 static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
+static const char SVNDIFF_V3[] = { 'S', 'V', 'N', 3 };
 
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
 static const char *
 get_svndiff_header(int version)
 {
-  if (version == 2)
+  if (version == 3)
+    return SVNDIFF_V3;
+  else if (version == 2)
     return SVNDIFF_V2;
   else if (version == 1)
     return SVNDIFF_V1;
@@ -63,10 +67,34 @@ struct encoder_baton {
   svn_boolean_t header_done;
   int version;
   int compression_level;
+  /* Zstandard dictionary for svndiff3 or NULL. */
+  const svn_string_t *zstd_dict;
   /* Pool for temporary allocations, will be cleared periodically. */
   apr_pool_t *scratch_pool;
+  /* If not NULL, encode the windows concurrently using this queue. */
+  svn_task__queue_t *queue;
 };
 
+/* An encoded svndiff window, as returned by encode_window. */
+typedef struct encoded_window_t
+{
+  svn_stringbuf_t *instructions;
+  svn_stringbuf_t *header;
+  const svn_string_t *newdata;
+} encoded_window_t;
+
+/* Input for a window encoding task in pipelined mode. */
+typedef struct encode_task_t
+{
+  /* Copy of the window to encode, allocated in the task pool. */
+  svn_txdelta_window_t *window;
+
+  /* Encoding parameters as in struct encoder_baton. */
+  int version;
+  int compression_level;
+  const svn_string_t *zstd_dict;
+} encode_task_t;
+
 /* This is at least as big as the largest size for a single instruction. */
 #define MAX_INSTRUCTION_LEN (2*SVN__MAX_ENCODED_UINT_LEN+1)
 /* This is at least as big as the largest possible instructions
@@ -152,7 +180,8 @@ send_simple_insertion_window(svn_txdelta_window_t *window,
 
 /* Encodes delta window WINDOW to svndiff-format.
    The svndiff version is VERSION. COMPRESSION_LEVEL is the
-   compression level to use.
+   compression level to use and ZSTD_DICT the optional dictionary
+   for svndiff3.
    Returned values will be allocated in POOL or refer to *WINDOW
    fields. */
 static svn_error_t *
@@ -162,6 +191,7 @@ encode_window(svn_stringbuf_t **instructions_p,
               svn_txdelta_window_t *window,
               int version,
               int compression_level,
+              const svn_string_t *zstd_dict,
               apr_pool_t *pool)
 {
   svn_stringbuf_t *instructions;
@@ -198,7 +228,16 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, window->sview_offset);
   append_encoded_int(header, window->sview_len);
   append_encoded_int(header, window->tview_len);
-  if (version == 2)
+  if (version == 3)
+    {
+      svn_stringbuf_t *compressed_instructions;
+      compressed_instructions = svn_stringbuf_create_empty(pool);
+      SVN_ERR(svn__compress_zstd(instructions->data, instructions->len,
+                                 compressed_instructions, compression_level,
+                                 zstd_dict));
+      instructions = compressed_instructions;
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *compressed_instructions;
       compressed_instructions = svn_stringbuf_create_empty(pool);
@@ -217,7 +256,16 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, instructions->len);
 
   /* Encode the data. */
-  if (version == 2)
+  if (version == 3)
+    {
+      svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+
+      SVN_ERR(svn__compress_zstd(window->new_data->data,
+                                 window->new_data->len,
+                                 compressed, compression_level, zstd_dict));
+      newdata = svn_stringbuf__morph_into_string(compressed);
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
 
@@ -245,6 +293,60 @@ encode_window(svn_stringbuf_t **instructions_p,
   return SVN_NO_ERROR;
 }
 
+/* Write the encoded window ENCODED to EB's output stream. */
+static svn_error_t *
+write_encoded_window(struct encoder_baton *eb,
+                     const encoded_window_t *encoded)
+{
+  apr_size_t len;
+
+  len = encoded->header->len;
+  SVN_ERR(svn_stream_write(eb->output, encoded->header->data, &len));
+  if (encoded->instructions->len > 0)
+    {
+      len = encoded->instructions->len;
+      SVN_ERR(svn_stream_write(eb->output, encoded->instructions->data,
+                               &len));
+    }
+  if (encoded->newdata->len > 0)
+    {
+      len = encoded->newdata->len;
+      SVN_ERR(svn_stream_write(eb->output, encoded->newdata->data, &len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.  Encode the window of the
+ * encode_task_t given as BATON and return it as encoded_window_t. */
+static svn_error_t *
+encode_window_task(void **result,
+                   void *baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  encode_task_t *task = baton;
+  encoded_window_t *encoded = apr_palloc(result_pool, sizeof(*encoded));
+
+  SVN_ERR(encode_window(&encoded->instructions, &encoded->header,
+                        &encoded->newdata, task->window, task->version,
+                        task->compression_level, task->zstd_dict,
+                        result_pool));
+  *result = encoded;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Write the encoded_window_t in
+ * RESULT to the output of the struct encoder_baton given as BATON. */
+static svn_error_t *
+write_encoded_window_task(void *result,
+                          void *baton,
+                          apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(write_encoded_window(baton, result));
+}
+
 /* Note: When changing things here, check the related comment in
    the svn_txdelta_to_svndiff_stream() function.  */
 static svn_error_t *
@@ -252,9 +354,7 @@ window_handler(svn_txdelta_window_t *window, void *baton)
 {
   struct encoder_baton *eb = baton;
   apr_size_t len;
-  svn_stringbuf_t *instructions;
-  svn_stringbuf_t *header;
-  const svn_string_t *newdata;
+  encoded_window_t encoded;
 
   /* use specialized code if there is no source */
   if (window && !window->src_ops && window->num_ops == 1 && !eb->version)
@@ -271,6 +371,10 @@ window_handler(svn_txdelta_window_t *window, void *baton)
 
   if (window == NULL)
     {
+      /* Write out all windows still being encoded. */
+      if (eb->queue)
+        SVN_ERR(svn_task__queue_finish(eb->queue));
+
       /* We're done; clean up. */
       SVN_ERR(svn_stream_close(eb->output));
 
@@ -279,27 +383,32 @@ window_handler(svn_txdelta_window_t *window, void *baton)
       return SVN_NO_ERROR;
     }
 
+  /* In pipelined mode, the window will be compressed in the background
+   * and written out as soon as all previous windows have been written.
+   * WINDOW is only valid during this call, so we need a copy. */
+  if (eb->queue)
+    {
+      apr_pool_t *task_pool = svn_task__queue_task_pool(eb->queue);
+      encode_task_t *task = apr_palloc(task_pool, sizeof(*task));
+
+      task->window = svn_txdelta_window_dup(window, task_pool);
+      task->version = eb->version;
+      task->compression_level = eb->compression_level;
+      task->zstd_dict = eb->zstd_dict;
+
+      return svn_error_trace(svn_task__queue_add(eb->queue, task,
+                                                 task_pool));
+    }
+
   svn_pool_clear(eb->scratch_pool);
 
-  SVN_ERR(encode_window(&instructions, &header, &newdata, window,
-                        eb->version, eb->compression_level,
+  SVN_ERR(encode_window(&encoded.instructions, &encoded.header,
+                        &encoded.newdata, window, eb->version,
+                        eb->compression_level, eb->zstd_dict,
                         eb->scratch_pool));
 
   /* Write out the window.  */
-  len = header->len;
-  SVN_ERR(svn_stream_write(eb->output, header->data, &len));
-  if (instructions->len > 0)
-    {
-      len = instructions->len;
-      SVN_ERR(svn_stream_write(eb->output, instructions->data, &len));
-    }
-  if (newdata->len > 0)
-    {
-      len = newdata->len;
-      SVN_ERR(svn_stream_write(eb->output, newdata->data, &len));
-    }
-
-  return SVN_NO_ERROR;
+  return svn_error_trace(write_encoded_window(eb, &encoded));
 }
 
 void
@@ -318,11 +427,42 @@ svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
   eb->scratch_pool = svn_pool_create(pool);
   eb->version = svndiff_version;
   eb->compression_level = compression_level;
+  eb->zstd_dict = NULL;
+  eb->queue = NULL;
 
   *handler = window_handler;
   *handler_baton = eb;
 }
 
+svn_error_t *
+svn_txdelta__to_svndiff_parallel(svn_txdelta_window_handler_t *handler,
+                                 void **handler_baton,
+                                 svn_stream_t *output,
+                                 int svndiff_version,
+                                 int compression_level,
+                                 const svn_string_t *zstd_dict,
+                                 int thread_count,
+                                 apr_pool_t *pool)
+{
+  struct encoder_baton *eb;
+
+  svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
+                          compression_level, pool);
+
+  /* svndiff0 does not compress anything, so there is nothing to gain from
+   * encoding it in the background. */
+  eb = *handler_baton;
+  if (svndiff_version == 3)
+    eb->zstd_dict = zstd_dict;
+  if (thread_count > 1 && svndiff_version > 0)
+    SVN_ERR(svn_task__queue_create(&eb->queue, thread_count,
+                                   2 * thread_count,
+                                   encode_window_task,
+                                   write_encoded_window_task, eb, pool));
+
+  return SVN_NO_ERROR;
+}
+
 void
 svn_txdelta_to_svndiff2(svn_txdelta_window_handler_t *handler,
                         void **handler_baton,
@@ -546,12 +686,12 @@ count_and_verify_instructions(int *ninst,
    the remainder of the window contents, fill in a delta window
    structure *WINDOW.  New allocations will be performed in POOL;
    the new_data field of *WINDOW will refer directly to memory pointed
-   to by DATA. */
+   to by DATA.  ZSTD_DICT is the optional dictionary for svndiff3. */
 static svn_error_t *
 decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
               apr_size_t sview_len, apr_size_t tview_len, apr_size_t inslen,
               apr_size_t newlen, const unsigned char *data, apr_pool_t *pool,
-              unsigned int version)
+              unsigned int version, const svn_string_t *zstd_dict)
 {
   const unsigned char *insend;
   int ninst;
@@ -565,7 +705,23 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   insend = data + inslen;
 
-  if (version == 2)
+  if (version == 3)
+    {
+      svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
+      svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
+
+      SVN_ERR(svn__decompress_zstd(insend, newlen, ndout,
+                                   SVN_DELTA_WINDOW_SIZE, zstd_dict));
+      SVN_ERR(svn__decompress_zstd(data, insend - data, instout,
+                                   MAX_INSTRUCTION_SECTION_LEN, zstd_dict));
+
+      newlen = ndout->len;
+      data = (unsigned char *)instout->data;
+      insend = (unsigned char *)instout->data + instout->len;
+
+      new_data = svn_stringbuf__morph_into_string(ndout);
+    }
+  else if (version == 2)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
@@ -653,6 +809,8 @@ write_handler(void *baton,
         db->version = 1;
       else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
         db->version = 2;
+      else if (memcmp(buffer, SVNDIFF_V3 + db->header_bytes, nheader) == 0)
+        db->version = 3;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -758,7 +916,7 @@ write_handler(void *baton,
       /* Decode the window and send it off. */
       SVN_ERR(decode_window(&window, db->sview_offset, db->sview_len,
                             db->tview_len, db->inslen, db->newlen, p,
-                            db->subpool, db->version));
+                            db->subpool, db->version, NULL));
       SVN_ERR(db->consumer_func(&window, db->consumer_baton));
 
       p += db->inslen + db->newlen;
@@ -940,10 +1098,11 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
 }
 
 svn_error_t *
-svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
-                                svn_stream_t *stream,
-                                int svndiff_version,
-                                apr_pool_t *pool)
+svn_txdelta__read_svndiff_window(svn_txdelta_window_t **window,
+                                 svn_stream_t *stream,
+                                 int svndiff_version,
+                                 const svn_string_t *zstd_dict,
+                                 apr_pool_t *pool)
 {
   svn_filesize_t sview_offset;
   apr_size_t sview_len, tview_len, inslen, newlen, len, header_len;
@@ -959,7 +1118,18 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
                             _("Unexpected end of svndiff input"));
   *window = apr_palloc(pool, sizeof(**window));
   return decode_window(*window, sview_offset, sview_len, tview_len, inslen,
-                       newlen, buf, pool, svndiff_version);
+                       newlen, buf, pool, svndiff_version, zstd_dict);
+}
+
+svn_error_t *
+svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
+                                svn_stream_t *stream,
+                                int svndiff_version,
+                                apr_pool_t *pool)
+{
+  return svn_error_trace(svn_txdelta__read_svndiff_window(window, stream,
+                                                          svndiff_version,
+                                                          NULL, pool));
 }
 
 
@@ -33,6 +33,9 @@
 #include "svn_pools.h"
 #include "svn_checksum.h"
 
+#include "private/svn_delta_private.h"
+#include "private/svn_task.h"
+
 #include "delta.h"
 
 
@@ -80,6 +83,9 @@ struct tpush_baton {
   apr_size_t source_len;
   svn_boolean_t source_done;
   apr_size_t target_len;
+
+  /* If not NULL, compute the windows concurrently using this queue. */
+  svn_task__queue_t *queue;
 };
 
 
@@ -502,6 +508,77 @@ svn_txdelta(svn_txdelta_stream_t **stream,
 
 /* Functions for implementing a "target push" delta. */
 
+/* Input for a delta window computation task in parallel target-push
+ * mode. */
+typedef struct window_task_t
+{
+  /* Source data followed by target data. */
+  char *buf;
+
+  /* Parameters to pass to compute_window. */
+  apr_size_t source_len;
+  apr_size_t target_len;
+  svn_filesize_t source_offset;
+} window_task_t;
+
+/* Implements svn_task__process_func_t.  Compute the delta window for the
+ * window_task_t given as BATON. */
+static svn_error_t *
+compute_window_task(void **result,
+                    void *baton,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  window_task_t *task = baton;
+  *result = compute_window(task->buf, task->source_len, task->target_len,
+                           task->source_offset, result_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Send the svn_txdelta_window_t
+ * in RESULT to the handler in the tpush_baton given as BATON. */
+static svn_error_t *
+send_window_task(void *result,
+                 void *baton,
+                 apr_pool_t *scratch_pool)
+{
+  struct tpush_baton *tb = baton;
+  return svn_error_trace(tb->wh(result, tb->whb));
+}
+
+/* Compute the delta window for the data buffered in TB and send it to
+ * TB's window handler.  If TB has a task queue, the window will be
+ * computed asynchronously and sent as soon as all previous windows have
+ * been sent.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+tpush_send_window(struct tpush_baton *tb,
+                  apr_pool_t *scratch_pool)
+{
+  if (tb->queue)
+    {
+      apr_pool_t *task_pool = svn_task__queue_task_pool(tb->queue);
+      window_task_t *task = apr_palloc(task_pool, sizeof(*task));
+
+      task->source_len = tb->source_len;
+      task->target_len = tb->target_len;
+      task->source_offset = tb->source_offset;
+      task->buf = apr_pmemdup(task_pool, tb->buf,
+                              tb->source_len + tb->target_len);
+
+      SVN_ERR(svn_task__queue_add(tb->queue, task, task_pool));
+    }
+  else
+    {
+      svn_txdelta_window_t *window
+        = compute_window(tb->buf, tb->source_len, tb->target_len,
+                         tb->source_offset, scratch_pool);
+      SVN_ERR(tb->wh(window, tb->whb));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* This is the write handler for a target-push delta stream.  It reads
  * source data, buffers target data, and fires off delta windows when
  * the target data buffer is full. */
@@ -511,7 +588,6 @@ tpush_write_handler(void *baton, const char *data, apr_size_t *len)
   struct tpush_baton *tb = baton;
   apr_size_t chunk_len, data_len = *len;
   apr_pool_t *pool = svn_pool_create(tb->pool);
-  svn_txdelta_window_t *window;
 
   while (data_len > 0)
     {
@@ -538,9 +614,7 @@ tpush_write_handler(void *baton, const char *data, apr_size_t *len)
       /* If we're full of target data, compute and fire off a window. */
       if (tb->target_len == SVN_DELTA_WINDOW_SIZE)
         {
-          window = compute_window(tb->buf, tb->source_len, tb->target_len,
-                                  tb->source_offset, pool);
-          SVN_ERR(tb->wh(window, tb->whb));
+          SVN_ERR(tpush_send_window(tb, pool));
           tb->source_offset += tb->source_len;
           tb->source_len = 0;
           tb->target_len = 0;
@@ -559,28 +633,32 @@ static svn_error_t *
 tpush_close_handler(void *baton)
 {
   struct tpush_baton *tb = baton;
-  svn_txdelta_window_t *window;
 
   /* Send a final window if we have any residual target data. */
   if (tb->target_len > 0)
-    {
-      window = compute_window(tb->buf, tb->source_len, tb->target_len,
-                              tb->source_offset, tb->pool);
-      SVN_ERR(tb->wh(window, tb->whb));
-    }
+    SVN_ERR(tpush_send_window(tb, tb->pool));
+
+  /* Wait for all pending windows to be sent. */
+  if (tb->queue)
+    SVN_ERR(svn_task__queue_finish(tb->queue));
 
   /* Send a final NULL window signifying the end. */
   return tb->wh(NULL, tb->whb);
 }
 
 
-svn_stream_t *
-svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
-                        void *handler_baton, svn_stream_t *source,
-                        apr_pool_t *pool)
+/* Implement svn_txdelta_target_push and svn_txdelta__target_push_parallel.
+ * Return the stream in *STREAM.  Compute the windows using up to
+ * THREAD_COUNT threads.  */
+static svn_error_t *
+target_push(svn_stream_t **stream,
+            svn_txdelta_window_handler_t handler,
+            void *handler_baton,
+            svn_stream_t *source,
+            int thread_count,
+            apr_pool_t *pool)
 {
   struct tpush_baton *tb;
-  svn_stream_t *stream;
 
   /* Initialize baton. */
   tb = apr_palloc(pool, sizeof(*tb));
@@ -593,14 +671,49 @@ svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
   tb->source_len = 0;
   tb->source_done = FALSE;
   tb->target_len = 0;
+  tb->queue = NULL;
+
+  /* Keep up to 2 windows per thread in flight such that the workers
+   * don't need to wait for us reading the source and target data. */
+  if (thread_count > 1)
+    SVN_ERR(svn_task__queue_create(&tb->queue, thread_count,
+                                   2 * thread_count,
+                                   compute_window_task, send_window_task,
+                                   tb, pool));
 
   /* Create and return writable stream. */
-  stream = svn_stream_create(tb, pool);
-  svn_stream_set_write(stream, tpush_write_handler);
-  svn_stream_set_close(stream, tpush_close_handler);
+  *stream = svn_stream_create(tb, pool);
+  svn_stream_set_write(*stream, tpush_write_handler);
+  svn_stream_set_close(*stream, tpush_close_handler);
+
+  return SVN_NO_ERROR;
+}
+
+svn_stream_t *
+svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
+                        void *handler_baton, svn_stream_t *source,
+                        apr_pool_t *pool)
+{
+  svn_stream_t *stream;
+
+  /* Without a task queue, this cannot fail. */
+  svn_error_clear(target_push(&stream, handler, handler_baton, source, 1,
+                              pool));
   return stream;
 }
 
+svn_error_t *
+svn_txdelta__target_push_parallel(svn_stream_t **stream,
+                                  svn_txdelta_window_handler_t handler,
+                                  void *handler_baton,
+                                  svn_stream_t *source,
+                                  int thread_count,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(target_push(stream, handler, handler_baton, source,
+                                     thread_count, pool));
+}
+
 
 
 /* Functions for applying deltas.  */
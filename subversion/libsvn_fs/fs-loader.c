@@ -710,18 +710,19 @@ svn_fs_hotcopy3(const char *src_path, const char *dst_path,
 }
 
 svn_error_t *
-svn_fs_pack(const char *path,
-            svn_fs_pack_notify_t notify_func,
-            void *notify_baton,
-            svn_cancel_func_t cancel_func,
-            void *cancel_baton,
-            apr_pool_t *pool)
+svn_fs_pack2(const char *path,
+             apr_hash_t *fs_config,
+             svn_fs_pack_notify_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool)
 {
   fs_library_vtable_t *vtable;
   svn_fs_t *fs;
 
   SVN_ERR(fs_library_vtable(&vtable, path, pool));
-  fs = fs_new(NULL, pool);
+  fs = fs_new(fs_config, pool);
 
   SVN_ERR(vtable->pack_fs(fs, path, notify_func, notify_baton,
                           cancel_func, cancel_baton, common_pool_lock,
@@ -1564,6 +1565,29 @@ svn_fs_try_process_file_contents(svn_boolean_t *success,
                          processor, baton, pool));
 }
 
+svn_error_t *
+svn_fs__file_contents_location(apr_file_t **file,
+                               apr_off_t *offset,
+                               svn_filesize_t *length,
+                               svn_fs_root_t *root,
+                               const char *path,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool)
+{
+  /* if the FS doesn't implement this function, the data is not available
+     as a plain byte range */
+  if (root->vtable->file_contents_location == NULL)
+    {
+      *file = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(root->vtable->file_contents_location(
+                         file, offset, length,
+                         root, path,
+                         result_pool, scratch_pool));
+}
+
 svn_error_t *
 svn_fs_make_file(svn_fs_root_t *root, const char *path, apr_pool_t *pool)
 {
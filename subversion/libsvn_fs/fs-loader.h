@@ -427,6 +427,15 @@ typedef struct root_vtable_t
                                 svn_fs_mergeinfo_receiver_t receiver,
                                 void *baton,
                                 apr_pool_t *scratch_pool);
+
+  /* Zero-copy support.  May be NULL. */
+  svn_error_t *(*file_contents_location)(apr_file_t **file,
+                                         apr_off_t *offset,
+                                         svn_filesize_t *length,
+                                         svn_fs_root_t *root,
+                                         const char *path,
+                                         apr_pool_t *result_pool,
+                                         apr_pool_t *scratch_pool);
 } root_vtable_t;
 
 
@@ -193,6 +193,44 @@ dbg_log_access(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* If read-ahead has been enabled for FS, tell the OS that we are about to
+   read REV_FILE sequentially from OFFSET onwards but not beyond END.  The
+   hint covers up to FFD->READ_AHEAD bytes.  To keep the number of system
+   calls low, a new hint will only be given once the reader got past the
+   first half of the previous one.  Sections that fit into a single block
+   get read with one request anyway and need no hint. */
+static void
+prefetch(svn_fs_t *fs,
+         svn_fs_fs__revision_file_t *rev_file,
+         apr_off_t offset,
+         apr_off_t end)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_off_t start = offset;
+
+  if (ffd->read_ahead == 0 || end - offset <= ffd->block_size)
+    return;
+
+  end = MIN(end, offset + ffd->read_ahead);
+  if (   offset >= rev_file->prefetch_start
+      && offset < rev_file->prefetch_end)
+    {
+      /* Still well within the section we prefetched before? */
+      if (offset + ffd->read_ahead / 2 < rev_file->prefetch_end)
+        return;
+
+      /* Only extend the hint. */
+      start = rev_file->prefetch_end;
+    }
+
+  if (end > start)
+    {
+      svn_io__file_prefetch(rev_file->file, start, end - start);
+      rev_file->prefetch_start = offset;
+      rev_file->prefetch_end = end;
+    }
+}
+
 /* Convenience wrapper around svn_io_file_aligned_seek, taking filesystem
    FS instead of a block size. */
 static svn_error_t *
@@ -1244,6 +1282,7 @@ get_window_key(window_cache_key_t *key, rep_state_t *rs)
 
 /* Implement svn_cache__partial_getter_func_t for raw txdelta windows.
  * Parse the raw data and return a svn_fs_fs__txdelta_cached_window_t.
+ * BATON is the svn_fs_t the window belongs to.
  */
 static svn_error_t *
 parse_raw_window(void **out,
@@ -1252,6 +1291,8 @@ parse_raw_window(void **out,
                  void *baton,
                  apr_pool_t *result_pool)
 {
+  svn_fs_t *fs = baton;
+  fs_fs_data_t *ffd = fs->fsap_data;
   svn_string_t raw_window;
   svn_stream_t *stream;
 
@@ -1268,8 +1309,9 @@ parse_raw_window(void **out,
   stream = svn_stream_from_string(&raw_window, result_pool);
 
   /* parse it */
-  SVN_ERR(svn_txdelta_read_svndiff_window(&result->window, stream, window->ver,
-                                          result_pool));
+  SVN_ERR(svn_txdelta__read_svndiff_window(&result->window, stream,
+                                           window->ver, ffd->zstd_dict,
+                                           result_pool));
 
   /* complete the window and return it */
   result->end_offset = window->end_offset;
@@ -1320,7 +1362,8 @@ get_cached_window(svn_txdelta_window_t **window_p,
         {
           SVN_ERR(svn_cache__get_partial((void **) &cached_window, is_cached,
                                          rs->raw_window_cache, &key,
-                                         parse_raw_window, NULL, result_pool));
+                                         parse_raw_window, rs->sfile->fs,
+                                         result_pool));
           if (*is_cached)
             SVN_ERR(svn_cache__set(rs->window_cache, &key, cached_window,
                                    scratch_pool));
@@ -1549,6 +1592,7 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
                   rep_state_t *rs, apr_pool_t *result_pool,
                   apr_pool_t *scratch_pool)
 {
+  fs_fs_data_t *ffd = rs->sfile->fs->fsap_data;
   svn_boolean_t is_cached;
   apr_off_t start_offset;
   apr_off_t end_offset;
@@ -1597,6 +1641,10 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   start_offset = rs->start + rs->current;
   SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, scratch_pool));
 
+  /* Windows are usually read one after another until the end of the rep. */
+  prefetch(rs->sfile->fs, rs->sfile->rfile, start_offset,
+           rs->start + rs->size);
+
   /* Skip windows to reach the current chunk if we aren't there yet. */
   iterpool = svn_pool_create(scratch_pool);
   while (rs->chunk_index < this_chunk)
@@ -1616,8 +1664,9 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   svn_pool_destroy(iterpool);
 
   /* Actually read the next window. */
-  SVN_ERR(svn_txdelta_read_svndiff_window(nwin, rs->sfile->rfile->stream,
-                                          rs->ver, result_pool));
+  SVN_ERR(svn_txdelta__read_svndiff_window(nwin, rs->sfile->rfile->stream,
+                                           rs->ver, ffd->zstd_dict,
+                                           result_pool));
   SVN_ERR(get_file_offset(&end_offset, rs, scratch_pool));
   rs->current = end_offset - rs->start;
   if (rs->current > rs->size)
@@ -1648,6 +1697,7 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
 
   offset = rs->start + rs->current;
   SVN_ERR(rs_aligned_seek(rs, NULL, offset, scratch_pool));
+  prefetch(rs->sfile->fs, rs->sfile->rfile, offset, rs->start + rs->size);
 
   /* Read the plain data. */
   *nwin = svn_stringbuf_create_ensure(size, result_pool);
@@ -2259,6 +2309,48 @@ svn_fs_fs__get_contents(svn_stream_t **contents_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__get_contents_location(apr_file_t **file,
+                                 apr_off_t *offset,
+                                 svn_filesize_t *length,
+                                 svn_fs_t *fs,
+                                 representation_t *rep,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__rep_header_t *rep_header;
+  apr_off_t item_offset;
+
+  *file = NULL;
+
+  /* Empty files have no rep and data within transactions may still
+   * change.  Neither can be handed out as a byte range. */
+  if (!rep || svn_fs_fs__id_txn_used(&rep->txn_id))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__ensure_revision_exists(rep->revision, fs,
+                                            scratch_pool));
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, rep->revision,
+                                           result_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__item_offset(&item_offset, fs, rev_file, rep->revision,
+                                 NULL, rep->item_index, scratch_pool));
+  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, item_offset,
+                       scratch_pool));
+  SVN_ERR(svn_fs_fs__read_rep_header(&rep_header, rev_file->stream,
+                                     scratch_pool, scratch_pool));
+
+  /* Only PLAIN reps store the fulltext verbatim. */
+  if (rep_header->type != svn_fs_fs__rep_plain)
+    return svn_error_trace(svn_fs_fs__close_revision_file(rev_file));
+
+  *file = rev_file->file;
+  *offset = item_offset + rep_header->header_size;
+  *length = rep->size;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
                                   svn_fs_t *fs,
@@ -3658,6 +3750,29 @@ block_read_noderev(node_revision_t **noderev_p,
   return SVN_NO_ERROR;
 }
 
+svn_boolean_t
+svn_fs_fs__continues_block_read(svn_fs_t *fs,
+                                svn_fs_fs__revision_file_t *rev_file,
+                                apr_off_t block_start,
+                                apr_off_t block_end)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  /* Re-reading the last block, e.g. for an item crossing its end, still
+   * counts as sequential. */
+  svn_boolean_t result
+    =    ffd->last_block_file == rev_file->start_revision
+      && ffd->last_block_packed == rev_file->is_packed
+      && block_start <= ffd->last_block_end
+      && block_start >= ffd->last_block_end - ffd->block_size;
+
+  ffd->last_block_file = rev_file->start_revision;
+  ffd->last_block_packed = rev_file->is_packed;
+  ffd->last_block_end = block_end;
+
+  return result;
+}
+
 /* Read the whole (e.g. 64kB) block containing ITEM_INDEX of REVISION in FS
  * and put all data into cache.  If necessary and depending on heuristics,
  * neighboring blocks may also get read.  The data is being read from
@@ -3798,6 +3913,19 @@ block_read(void **result,
   while(run_count++ == 1); /* can only be true once and only if a block
                             * boundary got crossed */
 
+  /* Sequential readers like dump or replay will ask for the items that
+   * follow next.  Let the OS fetch them in the background but stop where
+   * the rev / pack file's index data begins.  Random access, e.g. by
+   * checkouts of older revisions, shall not cause extra I/O, though. */
+  if (svn_fs_fs__continues_block_read(fs, revision_file,
+                                      wanted_offset
+                                        - (wanted_offset % ffd->block_size),
+                                      block_start + ffd->block_size))
+    prefetch(fs, revision_file, block_start + ffd->block_size,
+             revision_file->l2p_offset >= 0
+               ? revision_file->l2p_offset
+               : block_start + ffd->block_size + ffd->read_ahead);
+
   /* if the caller requested a result, we must have provided one by now */
   assert(!result || *result);
   svn_pool_destroy(iterpool);
@@ -105,6 +105,31 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
                                   apr_off_t offset,
                                   apr_pool_t *pool);
 
+/* If the text representation REP in filesystem FS is a committed PLAIN
+   rep, i.e. its fulltext is stored verbatim, set *FILE to the open rev or
+   pack file containing it, *OFFSET to the position of its first byte and
+   *LENGTH to its size.  Otherwise, set *FILE to NULL.  The caller is
+   responsible for verifying the contents, if desired.
+   Allocate *FILE in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_fs_fs__get_contents_location(apr_file_t **file,
+                                 apr_off_t *offset,
+                                 svn_filesize_t *length,
+                                 svn_fs_t *fs,
+                                 representation_t *rep,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool);
+
+/* Return TRUE if a block read of the section of REV_FILE in FS starting at
+   BLOCK_START directly follows the previous block read in FS, i.e. if the
+   reader seems to scan the file sequentially.  Remember BLOCK_END as the
+   end of this block read for the next call. */
+svn_boolean_t
+svn_fs_fs__continues_block_read(svn_fs_t *fs,
+                                svn_fs_fs__revision_file_t *rev_file,
+                                apr_off_t block_start,
+                                apr_off_t block_end);
+
 /* Attempt to fetch the text representation of node-revision NODEREV as
    seen in filesystem FS and pass it along with the BATON to the PROCESSOR.
    Set *SUCCESS only of the data could be provided and the processing
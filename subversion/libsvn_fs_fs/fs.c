@@ -293,12 +293,41 @@ initialize_fs_struct(svn_fs_t *fs)
   ffd->use_log_addressing = FALSE;
   ffd->revprop_prefix = 0;
   ffd->flush_to_disk = TRUE;
+  ffd->last_block_file = SVN_INVALID_REVNUM;
 
   fs->vtable = &fs_vtable;
   fs->fsap_data = ffd;
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__open_instance(svn_fs_t **new_fs,
+                         svn_fs_t *fs,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_data_t *new_ffd;
+  svn_fs_t *instance = apr_pcalloc(result_pool, sizeof(*instance));
+
+  instance->pool = result_pool;
+  instance->config = fs->config;
+  instance->warning = fs->warning;
+  instance->warning_baton = fs->warning_baton;
+
+  SVN_ERR(initialize_fs_struct(instance));
+  SVN_ERR(svn_fs_fs__open(instance, fs->path, scratch_pool));
+  SVN_ERR(svn_fs_fs__initialize_caches(instance, scratch_pool));
+
+  /* Use the same locks etc. as all other instances. */
+  new_ffd = instance->fsap_data;
+  new_ffd->shared = ffd->shared;
+  new_ffd->svn_fs_open_ = ffd->svn_fs_open_;
+
+  *new_fs = instance;
+  return SVN_NO_ERROR;
+}
+
 /* Reset vtable and fsap_data fields in FS such that the FS is basically
  * closed now.  Note that FS must not hold locks when you call this. */
 static void
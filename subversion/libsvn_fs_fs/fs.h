@@ -78,6 +78,7 @@ extern "C" {
                                                     to-log index */
 /* If you change this, look at tests/svn_test_fs.c(maybe_install_fsfs_conf) */
 #define PATH_CONFIG           "fsfs.conf"        /* Configuration */
+#define PATH_ZSTD_DICTIONARY  "zstd-dictionary"  /* Zstandard dictionary */
 
 /* Names of special files and file extensions for transactions */
 #define PATH_CHANGES       "changes"       /* Records changes made so far */
@@ -115,6 +116,7 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_READ_AHEAD         "read-ahead"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
@@ -127,7 +129,7 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -188,6 +190,12 @@ extern "C" {
 /* The minimum format number that supports svndiff version 2. */
 #define SVN_FS_FS__MIN_SVNDIFF2_FORMAT 8
 
+/* The minimum format number that supports svndiff version 3. */
+#define SVN_FS_FS__MIN_SVNDIFF3_FORMAT 9
+
+/* The zstd compression level used for "compression = zstd". */
+#define SVN_FS_FS__ZSTD_DEFAULT_LEVEL 3
+
 /* The minimum format number that supports the special notation ("-")
    for optional values that are not present in the representation strings,
    such as SHA1 or the uniquifier.  For example:
@@ -315,7 +323,8 @@ typedef enum compression_type_t
 {
   compression_type_none,
   compression_type_zlib,
-  compression_type_lz4
+  compression_type_lz4,
+  compression_type_zstd
 } compression_type_t;
 
 /* Private (non-shared) FSFS-specific data for each svn_fs_t object.
@@ -336,6 +345,18 @@ typedef struct fs_fs_data_t
   /* Rev / pack file read granularity in bytes. */
   apr_int64_t block_size;
 
+  /* Number of bytes beyond the current read position in a rev / pack file
+   * that we ask the OS to prefetch.  0 disables read-ahead hints. */
+  apr_int64_t read_ahead;
+
+  /* The rev / pack file, identified by its first revision and whether it
+   * is packed, and the offset at which the last block read ended.  Block
+   * reads only give read-ahead hints if they continue from there.
+   * LAST_BLOCK_FILE is SVN_INVALID_REVNUM if there was no block read yet. */
+  svn_revnum_t last_block_file;
+  svn_boolean_t last_block_packed;
+  apr_off_t last_block_end;
+
   /* Capacity in entries of log-to-phys index pages */
   apr_int64_t l2p_page_size;
 
@@ -496,9 +517,13 @@ typedef struct fs_fs_data_t
   /* Compression type to use with txdelta storage format in new revs. */
   compression_type_t delta_compression_type;
 
-  /* Compression level (currently, only used with compression_type_zlib). */
+  /* Compression level (used with compression_type_zlib and
+     compression_type_zstd). */
   int delta_compression_level;
 
+  /* Zstandard dictionary to use with compression_type_zstd or NULL. */
+  const svn_string_t *zstd_dict;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
@@ -514,6 +539,12 @@ typedef struct fs_fs_data_t
   /* Ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
 
+  /* Number of threads to use for delta computation. 1 = no concurrency. */
+  int delta_threads;
+
+  /* Number of shards to pack concurrently. 1 = no concurrency. */
+  int pack_threads;
+
   /* Pointer to svn_fs_open. */
   svn_error_t *(*svn_fs_open_)(svn_fs_t **, const char *, apr_hash_t *,
                                apr_pool_t *, apr_pool_t *);
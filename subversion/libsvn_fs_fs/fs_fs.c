@@ -692,7 +692,8 @@ parse_compression_option(compression_type_t *compression_type_p,
   int level;
   svn_boolean_t is_valid = TRUE;
 
-  /* compression = none | lz4 | zlib | zlib-1 ... zlib-9 */
+  /* compression = none | lz4 | zlib | zlib-1 ... zlib-9
+                 | zstd | zstd-1 ... zstd-19 */
   if (strcmp(value, "none") == 0)
     {
       type = compression_type_none;
@@ -722,6 +723,25 @@ parse_compression_option(compression_type_t *compression_type_p,
       else
         is_valid = FALSE;
     }
+  else if (strncmp(value, "zstd", 4) == 0)
+    {
+      const char *p = value + 4;
+
+      type = compression_type_zstd;
+      if (*p == 0)
+        {
+          level = SVN_FS_FS__ZSTD_DEFAULT_LEVEL;
+        }
+      else if (*p == '-')
+        {
+          p++;
+          SVN_ERR(svn_cstring_atoi(&level, p));
+          if (level < 1 || level > 19)
+            is_valid = FALSE;
+        }
+      else
+        is_valid = FALSE;
+    }
   else
     {
       is_valid = FALSE;
@@ -824,6 +844,10 @@ read_config(fs_fs_data_t *ffd,
                                    CONFIG_SECTION_IO,
                                    CONFIG_OPTION_P2L_PAGE_SIZE,
                                    0x400));
+      SVN_ERR(svn_config_get_int64(config, &ffd->read_ahead,
+                                   CONFIG_SECTION_IO,
+                                   CONFIG_OPTION_READ_AHEAD,
+                                   0x400));
 
       /* Don't accept unreasonable or illegal values.
        * Block size and P2L page size are in kbytes;
@@ -834,10 +858,19 @@ read_config(fs_fs_data_t *ffd,
                                 CONFIG_OPTION_P2L_PAGE_SIZE, scratch_pool));
       SVN_ERR(verify_block_size(ffd->l2p_page_size, sizeof(apr_off_t),
                                 CONFIG_OPTION_L2P_PAGE_SIZE, scratch_pool));
+      if (ffd->read_ahead < 0 || ffd->read_ahead > SVN_MAX_OBJECT_SIZE / 0x400)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("%s is invalid for fsfs.conf setting "
+                                   "'%s'."),
+                                 apr_psprintf(scratch_pool,
+                                              "%" APR_INT64_T_FMT,
+                                              ffd->read_ahead),
+                                 CONFIG_OPTION_READ_AHEAD);
 
       /* convert kBytes to bytes */
       ffd->block_size *= 0x400;
       ffd->p2l_page_size *= 0x400;
+      ffd->read_ahead *= 0x400;
       /* L2P pages are in entries - not in (k)Bytes */
     }
   else
@@ -846,6 +879,7 @@ read_config(fs_fs_data_t *ffd,
       ffd->block_size = 0x1000; /* Matches default APR file buffer size. */
       ffd->l2p_page_size = 0x2000;    /* Matches above default. */
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
+      ffd->read_ahead = 0;
     }
 
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
@@ -890,6 +924,17 @@ read_config(fs_fs_data_t *ffd,
                                       _("Compression type 'lz4' requires "
                                         "filesystem format 8 or higher"));
             }
+          if (ffd->delta_compression_type == compression_type_zstd)
+            {
+              if (ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+                return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                        _("Compression type 'zstd' requires "
+                                          "filesystem format 9 or higher"));
+              if (!svn__zstd_available())
+                return svn_error_create(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                        _("Compression type 'zstd' is not "
+                                          "supported by this build"));
+            }
         }
       else if (compression_level_val)
         {
@@ -925,6 +970,29 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
     }
 
+  /* The dictionary is needed to read revisions written with it, even
+   * after switching to a different compression type.  So, always load
+   * it when present. */
+  ffd->zstd_dict = NULL;
+  if (ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    {
+      svn_stringbuf_t *dict;
+      svn_error_t *err;
+
+      err = svn_stringbuf_from_file2(&dict,
+                                     svn_dirent_join(fs_path,
+                                                     PATH_ZSTD_DICTIONARY,
+                                                     scratch_pool),
+                                     result_pool);
+      if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+        svn_error_clear(err);
+      else
+        {
+          SVN_ERR(err);
+          ffd->zstd_dict = svn_stringbuf__morph_into_string(dict);
+        }
+    }
+
 #ifdef SVN_DEBUG
   SVN_ERR(svn_config_get_bool(config, &ffd->verify_before_commit,
                               CONFIG_SECTION_DEBUG,
@@ -1065,12 +1133,22 @@ write_config(svn_fs_t *fs,
 "### usually lower than the one provided by zlib, but using it can"          NL
 "### significantly speed up commits as well as reading the data."            NL
 "### lz4 compression algorithm is supported, starting from format 8"         NL
-"### repositories, available in Subversion 1.10 and higher."                 NL
+"### repositories, available in Subversion 1.10 and higher, and zstd"        NL
+"### starting from format 9 repositories, available in Subversion 1.12"      NL
+"### and higher."                                                            NL
 "### The syntax of this option is:"                                          NL
 "###   " CONFIG_OPTION_COMPRESSION " = none | lz4 | zlib | zlib-1 ... zlib-9" NL
+"###                 | zstd | zstd-1 ... zstd-19"                             NL
 "### Versions prior to Subversion 1.10 will ignore this option."             NL
+"### zstd (Zstandard) typically compresses better than zlib at speeds close" NL
+"### to lz4; higher levels trade commit speed for size.  'zstd' is"          NL
+"### equivalent to 'zstd-3'.  It is only available if Subversion has been"   NL
+"### built with zstd support.  Builds without zstd support cannot read"      NL
+"### revisions written with zstd compression."                               NL
 "### The default value is 'lz4' if supported by the repository format and"   NL
 "### 'zlib' otherwise.  'zlib' is currently equivalent to 'zlib-5'."         NL
+"### With 'none', file contents that do not get deltified are stored"       NL
+"### verbatim, which allows servers to send them without copying."          NL
 "# " CONFIG_OPTION_COMPRESSION " = lz4"                                      NL
 "###"                                                                        NL
 "### DEPRECATED: The new '" CONFIG_OPTION_COMPRESSION "' option deprecates previously used" NL
@@ -1079,6 +1157,14 @@ write_config(svn_fs_t *fs,
 "### still be used (and it will result in zlib compression with the"         NL
 "### corresponding compression level)."                                      NL
 "###   " CONFIG_OPTION_COMPRESSION_LEVEL " = 0 ... 9 (default is 5)"         NL
+"###"                                                                        NL
+"### Small files compress poorly on their own.  A dictionary trained on"     NL
+"### typical repository contents (e.g. using 'zstd --train') can improve"    NL
+"### zstd compression of such files considerably.  To use one, copy it to"   NL
+"### the file '" PATH_ZSTD_DICTIONARY "' in the db directory.  It must"       NL
+"### remain there unchanged for as long as revisions that were compressed"   NL
+"### with it exist.  To change the dictionary, dump and load the"            NL
+"### repository."                                                            NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -1147,6 +1233,18 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### While reading data sequentially, e.g. during 'svnadmin dump' or when"   NL
+"### replaying revisions, FSFS asks the operating system to prefetch the"    NL
+"### data following the current read position.  This lets the OS fetch the"  NL
+"### next blocks in the background while the current ones get processed."    NL
+"### Hints are only given for large representations and once block reads"    NL
+"### continue where the previous ones ended, so random access is not"        NL
+"### affected.  Large values help on network file systems and spinning"      NL
+"### disks; 0 disables read-ahead.  Has no effect on platforms without"      NL
+"### posix_fadvise()."                                                       NL
+"### read-ahead is given in kBytes and with a default of 1024 kBytes."       NL
+"# " CONFIG_OPTION_READ_AHEAD " = 1024"                                      NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
@@ -1166,6 +1264,8 @@ static svn_error_t *
 read_global_config(svn_fs_t *fs)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
+  const char *delta_threads;
+  const char *pack_threads;
 
   ffd->use_block_read = svn_hash__get_bool(fs->config,
                                            SVN_FS_CONFIG_FSFS_BLOCK_READ,
@@ -1174,6 +1274,34 @@ read_global_config(svn_fs_t *fs)
                                            SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                                            FALSE);
 
+  delta_threads = svn_hash__get_cstring(fs->config,
+                                        SVN_FS_CONFIG_FSFS_DELTA_THREADS,
+                                        NULL);
+  if (delta_threads)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, delta_threads, 0, 64, 10));
+      ffd->delta_threads = (int)val;
+    }
+  else
+    {
+      ffd->delta_threads = 1;
+    }
+
+  pack_threads = svn_hash__get_cstring(fs->config,
+                                       SVN_FS_CONFIG_FSFS_PACK_THREADS,
+                                       NULL);
+  if (pack_threads)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, pack_threads, 0, 64, 10));
+      ffd->pack_threads = (int)val;
+    }
+  else
+    {
+      ffd->pack_threads = 1;
+    }
+
   /* Ignore the user-specified larger block size if we don't use block-read.
      Defaulting to 4k gives us the same access granularity in format 7 as in
      older formats. */
@@ -1951,6 +2079,10 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 9: format = 7;
                   break;
 
+          case 10:
+          case 11: format = 8;
+                  break;
+
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
@@ -2322,8 +2454,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 12;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
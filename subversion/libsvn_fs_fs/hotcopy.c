@@ -885,6 +885,17 @@ hotcopy_body(void *baton, apr_pool_t *pool)
         }
     }
 
+  /* Revisions compressed with the zstd dictionary cannot be read without
+   * it, so copy it before any of them. */
+  if (src_ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    {
+      src_subdir = svn_dirent_join(src_fs->path, PATH_ZSTD_DICTIONARY, pool);
+      SVN_ERR(svn_io_check_path(src_subdir, &kind, pool));
+      if (kind == svn_node_file)
+        SVN_ERR(svn_io_dir_file_copy(src_fs->path, dst_fs->path,
+                                     PATH_ZSTD_DICTIONARY, pool));
+    }
+
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
@@ -30,6 +30,7 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_io_private.h"
+#include "private/svn_task.h"
 
 #include "fs_fs.h"
 #include "pack.h"
@@ -449,9 +450,24 @@ copy_file_data(pack_context_t *context,
        * the allocation of larger buffers and we should make sure that
        * this extra memory is released asap. */
       fs_fs_data_t *ffd = context->fs->fsap_data;
-      apr_pool_t *copypool = svn_pool_create(pool);
-      char *buffer = apr_palloc(copypool, ffd->block_size);
+      apr_pool_t *copypool;
+      char *buffer;
 
+      /* Large items may be copied by the OS directly from one file to the
+       * other, saving us the data transfers and the many small syscalls.
+       * Copy whatever remains the traditional way. */
+      if (size >= ffd->block_size)
+        {
+          apr_off_t copied;
+          SVN_ERR(svn_io__file_copy_range(&copied, dest, source, size,
+                                          pool));
+          size -= copied;
+          if (size == 0)
+            return SVN_NO_ERROR;
+        }
+
+      copypool = svn_pool_create(pool);
+      buffer = apr_palloc(copypool, ffd->block_size);
       while (size)
         {
           apr_size_t to_copy = (apr_size_t)(MIN(size, ffd->block_size));
@@ -1957,6 +1973,56 @@ synced_pack_shard(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Switch the shard described by BATON over to the packed revision data
+ * that has already been written to the pack directory and pack its
+ * revprops.  Use POOL for temporary allocations.
+ */
+static svn_error_t *
+switch_to_packed_shard(struct pack_baton *baton,
+                       apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
+
+  /* For newer repo formats, we only acquired the pack lock so far.
+     Before modifying the repo state by switching over to the packed
+     data, we need to acquire the global (write) lock. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
+    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
+                                       pool));
+  else
+    SVN_ERR(synced_pack_shard(baton, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the path of the pack directory for SHARD in REVS_DIR,
+ * allocated in RESULT_POOL. */
+static const char *
+rev_pack_dir(const char *revs_dir,
+             apr_int64_t shard,
+             apr_pool_t *result_pool)
+{
+  return svn_dirent_join(revs_dir,
+                         apr_psprintf(result_pool,
+                                      "%" APR_INT64_T_FMT
+                                      PATH_EXT_PACKED_SHARD,
+                                      shard),
+                         result_pool);
+}
+
+/* Return the path of the non-packed SHARD in REVS_DIR, allocated in
+ * RESULT_POOL. */
+static const char *
+rev_shard_dir(const char *revs_dir,
+              apr_int64_t shard,
+              apr_pool_t *result_pool)
+{
+  return svn_dirent_join(revs_dir,
+                         apr_psprintf(result_pool, "%" APR_INT64_T_FMT,
+                                      shard),
+                         result_pool);
+}
+
 /* Pack the shard described by BATON.
  *
  * If for some reason we detect a partial packing already performed,
@@ -1975,16 +2041,8 @@ pack_shard(struct pack_baton *baton,
                                svn_fs_pack_notify_start, pool));
 
   /* Some useful paths. */
-  rev_pack_file_dir = svn_dirent_join(baton->revs_dir,
-                  apr_psprintf(pool,
-                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
-                               baton->shard),
-                  pool);
-  baton->rev_shard_path = svn_dirent_join(baton->revs_dir,
-                                          apr_psprintf(pool,
-                                                       "%" APR_INT64_T_FMT,
-                                                       baton->shard),
-                                          pool);
+  rev_pack_file_dir = rev_pack_dir(baton->revs_dir, baton->shard, pool);
+  baton->rev_shard_path = rev_shard_dir(baton->revs_dir, baton->shard, pool);
 
   /* pack the revision content */
   SVN_ERR(pack_rev_shard(baton->fs, rev_pack_file_dir, baton->rev_shard_path,
@@ -1992,14 +2050,7 @@ pack_shard(struct pack_baton *baton,
                          baton->max_mem, ffd->flush_to_disk,
                          baton->cancel_func, baton->cancel_baton, pool));
 
-  /* For newer repo formats, we only acquired the pack lock so far.
-     Before modifying the repo state by switching over to the packed
-     data, we need to acquire the global (write) lock. */
-  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
-    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
-                                       pool));
-  else
-    SVN_ERR(synced_pack_shard(baton, pool));
+  SVN_ERR(switch_to_packed_shard(baton, pool));
 
   /* Notify caller we're starting to pack this shard. */
   if (baton->notify_func)
@@ -2009,6 +2060,136 @@ pack_shard(struct pack_baton *baton,
   return SVN_NO_ERROR;
 }
 
+/* A shard to be packed by a worker thread. */
+typedef struct pack_task_t
+{
+  /* Separate instance of the filesystem being packed. */
+  svn_fs_t *fs;
+
+  /* The shard to pack and its paths. */
+  apr_int64_t shard;
+  const char *rev_pack_file_dir;
+  const char *rev_shard_path;
+
+  /* Parameters to pack_rev_shard. */
+  int max_files_per_dir;
+  apr_size_t max_mem;
+  svn_boolean_t flush_to_disk;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} pack_task_t;
+
+/* Implements svn_task__process_func_t.  Pack the revision contents of
+ * the pack_task_t given as BATON into the pack directory and return the
+ * task itself in *RESULT. */
+static svn_error_t *
+pack_shard_process(void **result,
+                   void *baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  pack_task_t *task = baton;
+
+  SVN_ERR(pack_rev_shard(task->fs, task->rev_pack_file_dir,
+                         task->rev_shard_path, task->shard,
+                         task->max_files_per_dir, task->max_mem,
+                         task->flush_to_disk,
+                         task->cancel_func, task->cancel_baton,
+                         scratch_pool));
+
+  *result = task;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Switch the shard of the
+ * pack_task_t given as RESULT over to its packed data.  BATON is the
+ * 'struct pack_baton *' of the pack operation. */
+static svn_error_t *
+pack_shard_output(void *result,
+                  void *baton,
+                  apr_pool_t *scratch_pool)
+{
+  pack_task_t *task = result;
+  struct pack_baton *pb = baton;
+
+  pb->shard = task->shard;
+  pb->rev_shard_path = task->rev_shard_path;
+
+  /* For consistency, report the start only after the heavy lifting
+   * happened in the background. */
+  if (pb->notify_func)
+    SVN_ERR(pb->notify_func(pb->notify_baton, pb->shard,
+                            svn_fs_pack_notify_start, scratch_pool));
+
+  SVN_ERR(switch_to_packed_shard(pb, scratch_pool));
+
+  if (pb->notify_func)
+    SVN_ERR(pb->notify_func(pb->notify_baton, pb->shard,
+                            svn_fs_pack_notify_end, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Pack the shards FIRST_SHARD up to but not including END_SHARD as
+ * described by PB using FFD->PACK_THREADS worker threads.  Each worker
+ * packs the revision contents of one shard using its own instance of the
+ * filesystem.  The remainder - revprop packing, the min-unpacked-rev bump
+ * and the removal of the non-packed shard - is being done from this
+ * thread, strictly in shard order and under the write lock.  Thus, no
+ * reader will ever see a gap in the packed revision range.
+ *
+ * Use POOL for temporary allocations.
+ */
+static svn_error_t *
+pack_shards_concurrently(struct pack_baton *pb,
+                         apr_int64_t first_shard,
+                         apr_int64_t end_shard,
+                         apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = pb->fs->fsap_data;
+  svn_task__queue_t *queue;
+  apr_int64_t shard;
+
+  /* Don't let finished shards pile up on disk and in memory. */
+  SVN_ERR(svn_task__queue_create(&queue, ffd->pack_threads,
+                                 ffd->pack_threads,
+                                 pack_shard_process, pack_shard_output, pb,
+                                 pool));
+
+  for (shard = first_shard; shard < end_shard; shard++)
+    {
+      apr_pool_t *task_pool;
+      pack_task_t *task;
+      svn_error_t *err;
+
+      if (pb->cancel_func)
+        SVN_ERR(pb->cancel_func(pb->cancel_baton));
+
+      task_pool = svn_task__queue_task_pool(queue);
+      task = apr_pcalloc(task_pool, sizeof(*task));
+      task->shard = shard;
+      task->rev_pack_file_dir = rev_pack_dir(pb->revs_dir, shard, task_pool);
+      task->rev_shard_path = rev_shard_dir(pb->revs_dir, shard, task_pool);
+      task->max_files_per_dir = ffd->max_files_per_dir;
+      task->max_mem = pb->max_mem;
+      task->flush_to_disk = ffd->flush_to_disk;
+      task->cancel_func = pb->cancel_func;
+      task->cancel_baton = pb->cancel_baton;
+
+      err = svn_fs_fs__open_instance(&task->fs, pb->fs, task_pool,
+                                     task_pool);
+      if (err)
+        {
+          svn_pool_destroy(task_pool);
+          return svn_error_trace(err);
+        }
+
+      SVN_ERR(svn_task__queue_add(queue, task, task_pool));
+    }
+
+  return svn_error_trace(svn_task__queue_finish(queue));
+}
+
 /* Read the youngest rev and the first non-packed rev info for FS from disk.
    Set *FULLY_PACKED when there is no completed unpacked shard.
    Use SCRATCH_POOL for temporary allocations.
@@ -2080,6 +2261,12 @@ pack_body(void *baton,
     pb->revsprops_dir = svn_dirent_join(pb->fs->path, PATH_REVPROPS_DIR,
                                         pool);
 
+  /* Pack several shards at once? */
+  if (ffd->pack_threads > 1)
+    return svn_error_trace(pack_shards_concurrently(pb,
+                               ffd->min_unpacked_rev / ffd->max_files_per_dir,
+                               completed_shards, pool));
+
   iterpool = svn_pool_create(pool);
   for (pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
        pb->shard < completed_shards;
@@ -54,6 +54,8 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
   file->p2l_offset = -1;
   file->p2l_checksum = NULL;
   file->footer_offset = -1;
+  file->prefetch_start = 0;
+  file->prefetch_end = 0;
   file->pool = pool;
 }
 
@@ -140,9 +142,11 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
     {
       const char *path = svn_fs_fs__path_rev_absolute(fs, rev, scratch_pool);
       apr_file_t *apr_file;
+      /* Read-only files may get handed out for sendfile() delivery,
+       * see svn_fs_fs__get_contents_location(). */
       apr_int32_t flags = writable
                         ? APR_READ | APR_WRITE | APR_BUFFERED
-                        : APR_READ | APR_BUFFERED;
+                        : APR_READ | APR_BUFFERED | APR_SENDFILE_ENABLED;
 
       /* We may have to *temporarily* enable write access. */
       err = writable ? auto_make_writable(path, result_pool, scratch_pool)
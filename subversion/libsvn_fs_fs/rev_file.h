@@ -90,6 +90,11 @@ typedef struct svn_fs_fs__revision_file_t
    * been called, yet. */
   apr_off_t footer_offset;
 
+  /* Section [PREFETCH_START, PREFETCH_END) of FILE for which a read-ahead
+   * hint has been given to the OS.  Empty if no hint has been given yet. */
+  apr_off_t prefetch_start;
+  apr_off_t prefetch_end;
+
   /* pool containing this object */
   apr_pool_t *pool;
 } svn_fs_fs__revision_file_t;
@@ -43,6 +43,7 @@
 #include "lock.h"
 #include "rep-cache.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
@@ -2159,17 +2160,27 @@ rep_write_cleanup(void *data)
   return APR_SUCCESS;
 }
 
-static void
+/* Return in *HANDLER and *HANDLER_BATON a window handler that writes
+   svndiff data to OUTPUT, using the svndiff version and compression
+   settings of FS.  Use up to THREAD_COUNT threads to compress the data.
+   Allocate the handler in POOL. */
+static svn_error_t *
 txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
                    void **handler_baton,
                    svn_stream_t *output,
                    svn_fs_t *fs,
+                   int thread_count,
                    apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   int svndiff_version;
 
-  if (ffd->delta_compression_type == compression_type_lz4)
+  if (ffd->delta_compression_type == compression_type_zstd)
+    {
+      SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF3_FORMAT);
+      svndiff_version = 3;
+    }
+  else if (ffd->delta_compression_type == compression_type_lz4)
     {
       SVN_ERR_ASSERT_NO_RETURN(ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT);
       svndiff_version = 2;
@@ -2184,8 +2195,12 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
       svndiff_version = 0;
     }
 
-  svn_txdelta_to_svndiff3(handler, handler_baton, output, svndiff_version,
-                          ffd->delta_compression_level, pool);
+  return svn_error_trace(
+           svn_txdelta__to_svndiff_parallel(handler, handler_baton, output,
+                                            svndiff_version,
+                                            ffd->delta_compression_level,
+                                            ffd->zstd_dict,
+                                            thread_count, pool));
 }
 
 /* Get a rep_write_baton and store it in *WB_P for the representation
@@ -2198,6 +2213,7 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
                     node_revision_t *noderev,
                     apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_write_baton *b;
   apr_file_t *file;
   representation_t *base_rep;
@@ -2232,10 +2248,10 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
 
   /* Get the base for this delta. */
   SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE, b->scratch_pool));
-  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
-                                  b->scratch_pool));
 
-  /* Write out the rep header. */
+  /* Write out the rep header.  Without a base and compression, a self-
+     delta would only add overhead to the fulltext.  Storing it verbatim
+     also allows servers to send it straight from the rev file. */
   if (base_rep)
     {
       header.base_revision = base_rep->revision;
@@ -2243,6 +2259,10 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
       header.base_length = base_rep->size;
       header.type = svn_fs_fs__rep_delta;
     }
+  else if (ffd->delta_compression_type == compression_type_none)
+    {
+      header.type = svn_fs_fs__rep_plain;
+    }
   else
     {
       header.type = svn_fs_fs__rep_self_delta;
@@ -2258,11 +2278,23 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
   apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
                             apr_pool_cleanup_null);
 
+  /* PLAIN reps get written to REP_STREAM directly. */
+  if (header.type == svn_fs_fs__rep_plain)
+    {
+      *wb_p = b;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
+                                  b->scratch_pool));
+
   /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, pool);
+  SVN_ERR(txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs,
+                             ffd->delta_threads, pool));
 
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->scratch_pool);
+  SVN_ERR(svn_txdelta__target_push_parallel(&b->delta_stream, wh, whb,
+                                            source, ffd->delta_threads,
+                                            b->scratch_pool));
 
   *wb_p = b;
 
@@ -2947,7 +2979,8 @@ write_container_delta_rep(representation_t *rep,
   SVN_ERR(svn_io_file_get_offset(&delta_start, file, scratch_pool));
 
   /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&diff_wh, &diff_whb, file_stream, fs, scratch_pool);
+  SVN_ERR(txdelta_to_svndiff(&diff_wh, &diff_whb, file_stream, fs, 1,
+                             scratch_pool));
 
   whb = apr_pcalloc(scratch_pool, sizeof(*whb));
   whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
@@ -2962,6 +2962,22 @@ fs_try_process_file_contents(svn_boolean_t *success,
 
 /* --- End machinery for svn_fs_try_process_file_contents() ---  */
 
+static svn_error_t *
+fs_file_contents_location(apr_file_t **file,
+                          apr_off_t *offset,
+                          svn_filesize_t *length,
+                          svn_fs_root_t *root,
+                          const char *path,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  dag_node_t *node;
+  SVN_ERR(get_dag(&node, root, path, scratch_pool));
+
+  return svn_fs_fs__dag_file_contents_location(file, offset, length, node,
+                                               result_pool, scratch_pool);
+}
+
 
 /* --- Machinery for svn_fs_apply_textdelta() ---  */
 
@@ -4579,6 +4595,7 @@ static root_vtable_t root_vtable = {
   fs_get_file_delta_stream,
   fs_merge,
   fs_get_mergeinfo,
+  fs_file_contents_location,
 };
 
 /* Construct a new root object in FS, allocated from POOL.  */
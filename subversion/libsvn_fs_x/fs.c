@@ -329,6 +329,34 @@ initialize_fs_struct(svn_fs_t *fs)
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_x__open_instance(svn_fs_t **new_fs,
+                        svn_fs_t *fs,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = fs->fsap_data;
+  svn_fs_x__data_t *new_ffd;
+  svn_fs_t *instance = apr_pcalloc(result_pool, sizeof(*instance));
+
+  instance->pool = result_pool;
+  instance->config = fs->config;
+  instance->warning = fs->warning;
+  instance->warning_baton = fs->warning_baton;
+
+  SVN_ERR(initialize_fs_struct(instance));
+  SVN_ERR(svn_fs_x__open(instance, fs->path, scratch_pool));
+  SVN_ERR(svn_fs_x__initialize_caches(instance, scratch_pool));
+
+  /* Use the same locks etc. as all other instances. */
+  new_ffd = instance->fsap_data;
+  new_ffd->shared = ffd->shared;
+  new_ffd->svn_fs_open_ = ffd->svn_fs_open_;
+
+  *new_fs = instance;
+  return SVN_NO_ERROR;
+}
+
 /* Reset vtable and fsap_data fields in FS such that the FS is basically
  * closed now.  Note that FS must not hold locks when you call this. */
 static void
@@ -406,6 +406,9 @@ typedef struct svn_fs_x__data_t
   /* Ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
 
+  /* Number of shards to pack concurrently. 1 = no concurrency. */
+  int pack_threads;
+
   /* Pointer to svn_fs_open. */
   svn_error_t *(*svn_fs_open_)(svn_fs_t **, const char *, apr_hash_t *,
                                apr_pool_t *, apr_pool_t *);
@@ -541,11 +541,26 @@ static svn_error_t *
 read_global_config(svn_fs_t *fs)
 {
   svn_fs_x__data_t *ffd = fs->fsap_data;
+  const char *pack_threads;
 
   ffd->flush_to_disk = !svn_hash__get_bool(fs->config,
                                            SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                                            FALSE);
 
+  pack_threads = svn_hash__get_cstring(fs->config,
+                                       SVN_FS_CONFIG_FSFS_PACK_THREADS,
+                                       NULL);
+  if (pack_threads)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, pack_threads, 0, 64, 10));
+      ffd->pack_threads = (int)val;
+    }
+  else
+    {
+      ffd->pack_threads = 1;
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -51,6 +51,16 @@ svn_fs_x__initialize_shared_data(svn_fs_t *fs,
                                  apr_pool_t *scratch_pool,
                                  apr_pool_t *common_pool);
 
+/* Open another instance of the filesystem FS in *NEW_FS, allocated in
+   RESULT_POOL.  The new instance shares the process-wide data with FS
+   but has its own caches and state, so it may be used by another thread
+   while FS is in use.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_x__open_instance(svn_fs_t **new_fs,
+                        svn_fs_t *fs,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool);
+
 /* Upgrade the fsx filesystem FS.  Indicate progress via the optional
  * NOTIFY_FUNC callback using NOTIFY_BATON.  The optional CANCEL_FUNC
  * will periodically be called with CANCEL_BATON to allow for preemption.
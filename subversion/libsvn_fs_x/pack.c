@@ -28,6 +28,7 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_temp_serializer.h"
+#include "private/svn_task.h"
 
 #include "fs_x.h"
 #include "pack.h"
@@ -2049,6 +2050,85 @@ pack_rev_shard(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Return the path of the pack directory for SHARD in DIR, allocated in
+ * RESULT_POOL. */
+static const char *
+get_pack_dir(const char *dir,
+             apr_int64_t shard,
+             apr_pool_t *result_pool)
+{
+  return svn_dirent_join(dir,
+                         apr_psprintf(result_pool,
+                                      "%" APR_INT64_T_FMT
+                                      PATH_EXT_PACKED_SHARD,
+                                      shard),
+                         result_pool);
+}
+
+/* Return the path of the non-packed SHARD in DIR, allocated in
+ * RESULT_POOL. */
+static const char *
+get_shard_dir(const char *dir,
+              apr_int64_t shard,
+              apr_pool_t *result_pool)
+{
+  return svn_dirent_join(dir,
+                         apr_psprintf(result_pool, "%" APR_INT64_T_FMT,
+                                      shard),
+                         result_pool);
+}
+
+/* In the file system FS, complete packing the SHARD in DIR containing
+ * exactly MAX_FILES_PER_DIR revisions after its revision contents have
+ * been written to the pack directory:  Pack the revprops using
+ * MAX_PACK_SIZE and COMPRESSION_LEVEL, make the packed shard visible
+ * and remove the non-packed data.  Schedule necessary fsync calls in
+ * BATCH and execute them.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * CANCEL_FUNC and CANCEL_BATON are what you think they are.
+ */
+static svn_error_t *
+switch_to_packed_shard(const char *dir,
+                       svn_fs_t *fs,
+                       apr_int64_t shard,
+                       int max_files_per_dir,
+                       apr_off_t max_pack_size,
+                       int compression_level,
+                       svn_fs_x__batch_fsync_t *batch,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = fs->fsap_data;
+  const char *pack_file_dir = get_pack_dir(dir, shard, scratch_pool);
+  const char *shard_path = get_shard_dir(dir, shard, scratch_pool);
+
+  /* pack the revprops in an equivalent way */
+  SVN_ERR(svn_fs_x__pack_revprops_shard(fs,
+                                        pack_file_dir,
+                                        shard_path,
+                                        shard, max_files_per_dir,
+                                        (int)(0.9 * max_pack_size),
+                                        compression_level, batch,
+                                        cancel_func, cancel_baton,
+                                        scratch_pool));
+
+  /* Update the min-unpacked-rev file to reflect our newly packed shard. */
+  SVN_ERR(svn_fs_x__write_min_unpacked_rev(fs,
+                          (svn_revnum_t)((shard + 1) * max_files_per_dir),
+                          scratch_pool));
+  ffd->min_unpacked_rev = (svn_revnum_t)((shard + 1) * max_files_per_dir);
+
+  /* Ensure that packed file is written to disk.*/
+  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
+
+  /* Finally, remove the existing shard directories. */
+  SVN_ERR(svn_io_remove_dir2(shard_path, TRUE,
+                             cancel_func, cancel_baton, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* In the file system at FS_PATH, pack the SHARD in DIR containing exactly
  * MAX_FILES_PER_DIR revisions, using SCRATCH_POOL temporary for allocations.
  * COMPRESSION_LEVEL and MAX_PACK_SIZE will be ignored in that case.
@@ -2088,42 +2168,17 @@ pack_shard(const char *dir,
                                        scratch_pool));
 
   /* Some useful paths. */
-  pack_file_dir = svn_dirent_join(dir,
-                  apr_psprintf(scratch_pool,
-                               "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
-                               shard),
-                  scratch_pool);
-  shard_path = svn_dirent_join(dir,
-                      apr_psprintf(scratch_pool, "%" APR_INT64_T_FMT, shard),
-                      scratch_pool);
+  pack_file_dir = get_pack_dir(dir, shard, scratch_pool);
+  shard_path = get_shard_dir(dir, shard, scratch_pool);
 
   /* pack the revision content */
   SVN_ERR(pack_rev_shard(fs, pack_file_dir, shard_path,
                          shard, max_files_per_dir, max_mem, batch,
                          cancel_func, cancel_baton, scratch_pool));
 
-  /* pack the revprops in an equivalent way */
-  SVN_ERR(svn_fs_x__pack_revprops_shard(fs,
-                                        pack_file_dir,
-                                        shard_path,
-                                        shard, max_files_per_dir,
-                                        (int)(0.9 * max_pack_size),
-                                        compression_level, batch,
-                                        cancel_func, cancel_baton,
-                                        scratch_pool));
-
-  /* Update the min-unpacked-rev file to reflect our newly packed shard. */
-  SVN_ERR(svn_fs_x__write_min_unpacked_rev(fs,
-                          (svn_revnum_t)((shard + 1) * max_files_per_dir),
-                          scratch_pool));
-  ffd->min_unpacked_rev = (svn_revnum_t)((shard + 1) * max_files_per_dir);
-
-  /* Ensure that packed file is written to disk.*/
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
-
-  /* Finally, remove the existing shard directories. */
-  SVN_ERR(svn_io_remove_dir2(shard_path, TRUE,
-                             cancel_func, cancel_baton, scratch_pool));
+  SVN_ERR(switch_to_packed_shard(dir, fs, shard, max_files_per_dir,
+                                 max_pack_size, compression_level, batch,
+                                 cancel_func, cancel_baton, scratch_pool));
 
   /* Notify caller we're starting to pack this shard. */
   if (notify_func)
@@ -2171,6 +2226,160 @@ typedef struct pack_baton_t
   void *cancel_baton;
 } pack_baton_t;
 
+/* A shard to be packed by a worker thread. */
+typedef struct pack_task_t
+{
+  /* Separate instance of the filesystem being packed. */
+  svn_fs_t *fs;
+
+  /* The shard to pack and its paths. */
+  apr_int64_t shard;
+  const char *pack_file_dir;
+  const char *shard_path;
+
+  /* Parameters to pack_rev_shard. */
+  int max_files_per_dir;
+  apr_size_t max_mem;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} pack_task_t;
+
+/* Baton for pack_shard_output. */
+typedef struct pack_output_baton_t
+{
+  /* The pack operation. */
+  pack_baton_t *pb;
+
+  /* Directory containing the revision shards. */
+  const char *data_path;
+} pack_output_baton_t;
+
+/* Implements svn_task__process_func_t.  Pack the revision contents of
+ * the pack_task_t given as BATON into the pack directory, flush them to
+ * disk and return the task itself in *RESULT. */
+static svn_error_t *
+pack_shard_process(void **result,
+                   void *baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  pack_task_t *task = baton;
+  svn_fs_x__data_t *ffd = task->fs->fsap_data;
+  svn_fs_x__batch_fsync_t *batch;
+
+  SVN_ERR(svn_fs_x__batch_fsync_create(&batch, ffd->flush_to_disk,
+                                       scratch_pool));
+  SVN_ERR(pack_rev_shard(task->fs, task->pack_file_dir, task->shard_path,
+                         task->shard, task->max_files_per_dir,
+                         task->max_mem, batch,
+                         task->cancel_func, task->cancel_baton,
+                         scratch_pool));
+  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
+
+  *result = task;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Switch the shard of the
+ * pack_task_t given as RESULT over to its packed data.  BATON is a
+ * pack_output_baton_t. */
+static svn_error_t *
+pack_shard_output(void *result,
+                  void *baton,
+                  apr_pool_t *scratch_pool)
+{
+  pack_task_t *task = result;
+  pack_output_baton_t *output = baton;
+  pack_baton_t *pb = output->pb;
+  svn_fs_x__data_t *ffd = pb->fs->fsap_data;
+  svn_fs_x__batch_fsync_t *batch;
+
+  /* For consistency, report the start only after the heavy lifting
+   * happened in the background. */
+  if (pb->notify_func)
+    SVN_ERR(pb->notify_func(pb->notify_baton, task->shard,
+                            svn_fs_pack_notify_start, scratch_pool));
+
+  SVN_ERR(svn_fs_x__batch_fsync_create(&batch, ffd->flush_to_disk,
+                                       scratch_pool));
+  SVN_ERR(switch_to_packed_shard(output->data_path, pb->fs, task->shard,
+                                 ffd->max_files_per_dir,
+                                 ffd->revprop_pack_size,
+                                 ffd->compress_packed_revprops
+                                   ? SVN__COMPRESSION_ZLIB_DEFAULT
+                                   : SVN__COMPRESSION_NONE,
+                                 batch, pb->cancel_func, pb->cancel_baton,
+                                 scratch_pool));
+
+  if (pb->notify_func)
+    SVN_ERR(pb->notify_func(pb->notify_baton, task->shard,
+                            svn_fs_pack_notify_end, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Pack the shards FIRST_SHARD up to but not including END_SHARD in
+ * DATA_PATH as described by PB using FFD->PACK_THREADS worker threads.
+ * Each worker packs the revision contents of one shard using its own
+ * instance of the filesystem.  The revprops, the min-unpacked-rev bump
+ * and the removal of the non-packed shard are being handled by this
+ * thread, strictly in shard order.
+ *
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+pack_shards_concurrently(pack_baton_t *pb,
+                         const char *data_path,
+                         apr_int64_t first_shard,
+                         apr_int64_t end_shard,
+                         apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = pb->fs->fsap_data;
+  svn_task__queue_t *queue;
+  pack_output_baton_t output;
+  apr_int64_t shard;
+
+  output.pb = pb;
+  output.data_path = data_path;
+
+  /* Don't let finished shards pile up on disk and in memory. */
+  SVN_ERR(svn_task__queue_create(&queue, ffd->pack_threads,
+                                 ffd->pack_threads,
+                                 pack_shard_process, pack_shard_output,
+                                 &output, scratch_pool));
+
+  for (shard = first_shard; shard < end_shard; shard++)
+    {
+      apr_pool_t *task_pool;
+      pack_task_t *task;
+      svn_error_t *err;
+
+      if (pb->cancel_func)
+        SVN_ERR(pb->cancel_func(pb->cancel_baton));
+
+      task_pool = svn_task__queue_task_pool(queue);
+      task = apr_pcalloc(task_pool, sizeof(*task));
+      task->shard = shard;
+      task->pack_file_dir = get_pack_dir(data_path, shard, task_pool);
+      task->shard_path = get_shard_dir(data_path, shard, task_pool);
+      task->max_files_per_dir = ffd->max_files_per_dir;
+      task->max_mem = pb->max_mem;
+      task->cancel_func = pb->cancel_func;
+      task->cancel_baton = pb->cancel_baton;
+
+      err = svn_fs_x__open_instance(&task->fs, pb->fs, task_pool, task_pool);
+      if (err)
+        {
+          svn_pool_destroy(task_pool);
+          return svn_error_trace(err);
+        }
+
+      SVN_ERR(svn_task__queue_add(queue, task, task_pool));
+    }
+
+  return svn_error_trace(svn_task__queue_finish(queue));
+}
+
 
 /* The work-horse for svn_fs_x__pack, called with the FS write lock.
    This implements the svn_fs_x__with_write_lock() 'body' callback
@@ -2214,6 +2423,12 @@ pack_body(void *baton,
   completed_shards = (ffd->youngest_rev_cache + 1) / ffd->max_files_per_dir;
   data_path = svn_dirent_join(pb->fs->path, PATH_REVS_DIR, scratch_pool);
 
+  /* Pack several shards at once? */
+  if (ffd->pack_threads > 1)
+    return svn_error_trace(pack_shards_concurrently(pb, data_path,
+                               ffd->min_unpacked_rev / ffd->max_files_per_dir,
+                               completed_shards, scratch_pool));
+
   iterpool = svn_pool_create(scratch_pool);
   for (i = ffd->min_unpacked_rev / ffd->max_files_per_dir;
        i < completed_shards;
@@ -1167,6 +1167,65 @@ svn_ra__replay_ev2(svn_ra_session_t *session,
   SVN__NOT_IMPLEMENTED();
 }
 
+svn_error_t *
+svn_ra__get_blame(svn_ra_session_t *session,
+                  apr_array_header_t **chunks,
+                  const char *path,
+                  svn_revnum_t start,
+                  svn_revnum_t end,
+                  const svn_diff_file_options_t *diff_options,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  SVN_ERR_ASSERT(svn_relpath_is_canonical(path));
+
+  if (session->vtable->get_blame == NULL)
+    return svn_error_create(SVN_ERR_RA_NOT_IMPLEMENTED, NULL, NULL);
+
+  return svn_error_trace(session->vtable->get_blame(session, chunks, path,
+                                                    start, end,
+                                                    diff_options,
+                                                    result_pool,
+                                                    scratch_pool));
+}
+
+svn_error_t *
+svn_ra__get_dirs(svn_ra_session_t *session,
+                 apr_hash_t **dirents,
+                 const apr_array_header_t *paths,
+                 svn_revnum_t revision,
+                 apr_uint32_t dirent_fields,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  int i;
+
+  SVN_ERR_ASSERT(SVN_IS_VALID_REVNUM(revision));
+  for (i = 0; i < paths->nelts; i++)
+    SVN_ERR_ASSERT(svn_relpath_is_canonical(APR_ARRAY_IDX(paths, i,
+                                                          const char *)));
+
+  if (session->vtable->get_dirs)
+    return svn_error_trace(session->vtable->get_dirs(session, dirents, paths,
+                                                     revision, dirent_fields,
+                                                     result_pool,
+                                                     scratch_pool));
+
+  /* Fall back to one request per directory. */
+  *dirents = apr_hash_make(result_pool);
+  for (i = 0; i < paths->nelts; i++)
+    {
+      const char *path = APR_ARRAY_IDX(paths, i, const char *);
+      apr_hash_t *entries;
+
+      SVN_ERR(session->vtable->get_dir(session, &entries, NULL, NULL, path,
+                                       revision, dirent_fields, result_pool));
+      svn_hash_sets(*dirents, apr_pstrdup(result_pool, path), entries);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 replay_range_from_replays(svn_ra_session_t *session,
                           svn_revnum_t start_revision,
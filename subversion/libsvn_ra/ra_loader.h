@@ -378,6 +378,25 @@ typedef struct svn_ra__vtable_t {
     void *replay_baton,
     apr_pool_t *scratch_pool);
 
+  /* See svn_ra__get_blame() */
+  svn_error_t *(*get_blame)(svn_ra_session_t *session,
+                            apr_array_header_t **chunks,
+                            const char *path,
+                            svn_revnum_t start,
+                            svn_revnum_t end,
+                            const svn_diff_file_options_t *diff_options,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+  /* See svn_ra__get_dirs().  May be NULL. */
+  svn_error_t *(*get_dirs)(svn_ra_session_t *session,
+                           apr_hash_t **dirents,
+                           const apr_array_header_t *paths,
+                           svn_revnum_t revision,
+                           apr_uint32_t dirent_fields,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool);
+
 } svn_ra__vtable_t;
 
 /* The RA session object. */
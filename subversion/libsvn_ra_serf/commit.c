@@ -40,6 +40,7 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_fspath.h"
 #include "private/svn_skel.h"
+#include "private/svn_subr_private.h"
 
 #include "ra_serf.h"
 #include "../libsvn_ra/ra_loader.h"
@@ -1886,6 +1887,8 @@ negotiate_put_encoding(int *svndiff_version_p,
       if (session->supports_svndiff2 &&
           svn_ra_serf__is_low_latency_connection(session))
         svndiff_version = 2;
+      else if (session->supports_svndiff3 && svn__zstd_available())
+        svndiff_version = 3;
       else if (session->supports_svndiff1)
         svndiff_version = 1;
       else if (session->supports_svndiff2)
@@ -1902,8 +1905,12 @@ negotiate_put_encoding(int *svndiff_version_p,
        *
        * Note: For future compatibility, we also handle a theoretically
        * possible case where the server has advertised only svndiff2 support.
+       *
+       * svndiff3 beats svndiff1 in both respects, so use it if we can.
        */
-      if (session->supports_svndiff1)
+      if (session->supports_svndiff3 && svn__zstd_available())
+        svndiff_version = 3;
+      else if (session->supports_svndiff1)
         svndiff_version = 1;
       else if (session->supports_svndiff2)
         svndiff_version = 2;
@@ -247,6 +247,11 @@ capabilities_headers_iterator_callback(void *baton,
           /* Same for svndiff2. */
           session->supports_svndiff2 = TRUE;
         }
+      if (svn_cstring_match_list(SVN_DAV_NS_DAV_SVN_SVNDIFF3, vals))
+        {
+          /* Same for svndiff3, advertised by servers with zstd support. */
+          session->supports_svndiff3 = TRUE;
+        }
       if (svn_cstring_match_list(SVN_DAV_NS_DAV_SVN_PUT_RESULT_CHECKSUM, vals))
         {
           session->supports_put_result_checksum = TRUE;
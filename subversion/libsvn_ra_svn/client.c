@@ -81,12 +81,51 @@ typedef struct ra_svn_commit_callback_baton_t {
   void *callback_baton;
 } ra_svn_commit_callback_baton_t;
 
+/* A reporter call that has not been sent to the server yet. */
+typedef struct deferred_path_t {
+  /* URL is set for link-path and NULL for set-path commands. */
+  svn_boolean_t is_delete;
+  const char *path;
+  const char *url;
+  svn_revnum_t rev;
+  svn_depth_t depth;
+  svn_boolean_t start_empty;
+  const char *lock_token;
+} deferred_path_t;
+
+/* An update or switch command that has not been sent to the server yet.
+ * Whether to ask for the edit skeleton only depends on the report: the
+ * fetch editor can only find the files within the update or switch URL.
+ * But updates follow any paths that the report links to a different URL,
+ * so we let the server send all contents in that case. */
+typedef struct deferred_report_t {
+  /* Arguments of the command.  SWITCH_URL is NULL for updates. */
+  svn_revnum_t rev;
+  const char *target;
+  svn_boolean_t recurse;
+  const char *switch_url;
+  svn_depth_t depth;
+  svn_boolean_t send_copyfrom_args;
+  svn_boolean_t ignore_ancestry;
+
+  /* The reporter calls received so far (deferred_path_t). */
+  apr_array_header_t *paths;
+  svn_boolean_t has_link_path;
+
+  /* Editor to drive if the server sends the edit skeleton only. */
+  const svn_delta_editor_t *fetch_editor;
+  void *fetch_baton;
+} deferred_report_t;
+
 typedef struct ra_svn_reporter_baton_t {
   svn_ra_svn__session_baton_t *sess_baton;
   svn_ra_svn_conn_t *conn;
   apr_pool_t *pool;
   const svn_delta_editor_t *editor;
   void *edit_baton;
+
+  /* If not NULL, the report gets sent upon finish_report(). */
+  deferred_report_t *deferred;
 } ra_svn_reporter_baton_t;
 
 /* Parse an svn URL's tunnel portion into tunnel, if there is a tunnel
@@ -252,8 +291,100 @@ static svn_error_t *handle_auth_request(svn_ra_svn__session_baton_t *sess,
   return DO_AUTH(sess, mechlist, realm, pool);
 }
 
+svn_error_t *
+svn_ra_svn__handle_auth_request(svn_ra_svn__session_baton_t *sess,
+                                apr_pool_t *pool)
+{
+  return svn_error_trace(handle_auth_request(sess, pool));
+}
+
 /* --- REPORTER IMPLEMENTATION --- */
 
+/* Append a copy of a reporter call with the given arguments to the
+ * deferred report in B. */
+static void
+defer_path(ra_svn_reporter_baton_t *b,
+           svn_boolean_t is_delete,
+           const char *path,
+           const char *url,
+           svn_revnum_t rev,
+           svn_depth_t depth,
+           svn_boolean_t start_empty,
+           const char *lock_token)
+{
+  deferred_path_t *entry = apr_pcalloc(b->pool, sizeof(*entry));
+
+  entry->is_delete = is_delete;
+  entry->path = apr_pstrdup(b->pool, path);
+  entry->url = url ? apr_pstrdup(b->pool, url) : NULL;
+  entry->rev = rev;
+  entry->depth = depth;
+  entry->start_empty = start_empty;
+  entry->lock_token = lock_token ? apr_pstrdup(b->pool, lock_token) : NULL;
+
+  APR_ARRAY_PUSH(b->deferred->paths, deferred_path_t *) = entry;
+}
+
+/* Send the deferred update or switch command in B, followed by the report
+ * so far.  Select the editor to drive depending on the report. */
+static svn_error_t *
+send_deferred_report(ra_svn_reporter_baton_t *b,
+                     apr_pool_t *scratch_pool)
+{
+  deferred_report_t *d = b->deferred;
+  svn_boolean_t send_texts = d->has_link_path && !d->switch_url;
+  apr_pool_t *iterpool;
+  int i;
+
+  b->deferred = NULL;
+  if (d->switch_url)
+    SVN_ERR(svn_ra_svn__write_cmd_switch(b->conn, scratch_pool, d->rev,
+                                         d->target, d->recurse,
+                                         d->switch_url, d->depth,
+                                         d->send_copyfrom_args,
+                                         d->ignore_ancestry, send_texts));
+  else
+    SVN_ERR(svn_ra_svn__write_cmd_update(b->conn, scratch_pool, d->rev,
+                                         d->target, d->recurse, d->depth,
+                                         d->send_copyfrom_args,
+                                         d->ignore_ancestry, send_texts));
+  SVN_ERR(handle_auth_request(b->sess_baton, scratch_pool));
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < d->paths->nelts; ++i)
+    {
+      const deferred_path_t *entry
+        = APR_ARRAY_IDX(d->paths, i, const deferred_path_t *);
+
+      svn_pool_clear(iterpool);
+      if (entry->is_delete)
+        SVN_ERR(svn_ra_svn__write_cmd_delete_path(b->conn, iterpool,
+                                                  entry->path));
+      else if (entry->url)
+        SVN_ERR(svn_ra_svn__write_cmd_link_path(b->conn, iterpool,
+                                                entry->path, entry->url,
+                                                entry->rev,
+                                                entry->start_empty,
+                                                entry->lock_token,
+                                                entry->depth));
+      else
+        SVN_ERR(svn_ra_svn__write_cmd_set_path(b->conn, iterpool,
+                                               entry->path, entry->rev,
+                                               entry->start_empty,
+                                               entry->lock_token,
+                                               entry->depth));
+    }
+  svn_pool_destroy(iterpool);
+
+  if (!send_texts)
+    {
+      b->editor = d->fetch_editor;
+      b->edit_baton = d->fetch_baton;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *ra_svn_set_path(void *baton, const char *path,
                                     svn_revnum_t rev,
                                     svn_depth_t depth,
@@ -263,6 +394,12 @@ static svn_error_t *ra_svn_set_path(void *baton, const char *path,
 {
   ra_svn_reporter_baton_t *b = baton;
 
+  if (b->deferred)
+    {
+      defer_path(b, FALSE, path, NULL, rev, depth, start_empty, lock_token);
+      return SVN_NO_ERROR;
+    }
+
   SVN_ERR(svn_ra_svn__write_cmd_set_path(b->conn, pool, path, rev,
                                          start_empty, lock_token, depth));
   return SVN_NO_ERROR;
@@ -273,6 +410,13 @@ static svn_error_t *ra_svn_delete_path(void *baton, const char *path,
 {
   ra_svn_reporter_baton_t *b = baton;
 
+  if (b->deferred)
+    {
+      defer_path(b, TRUE, path, NULL, SVN_INVALID_REVNUM, svn_depth_unknown,
+                 FALSE, NULL);
+      return SVN_NO_ERROR;
+    }
+
   SVN_ERR(svn_ra_svn__write_cmd_delete_path(b->conn, pool, path));
   return SVN_NO_ERROR;
 }
@@ -287,6 +431,14 @@ static svn_error_t *ra_svn_link_path(void *baton, const char *path,
 {
   ra_svn_reporter_baton_t *b = baton;
 
+  if (b->deferred)
+    {
+      /* Updates will get switched subtrees from a different URL. */
+      b->deferred->has_link_path = TRUE;
+      defer_path(b, FALSE, path, url, rev, depth, start_empty, lock_token);
+      return SVN_NO_ERROR;
+    }
+
   SVN_ERR(svn_ra_svn__write_cmd_link_path(b->conn, pool, path, url, rev,
                                           start_empty, lock_token, depth));
   return SVN_NO_ERROR;
@@ -297,6 +449,9 @@ static svn_error_t *ra_svn_finish_report(void *baton,
 {
   ra_svn_reporter_baton_t *b = baton;
 
+  if (b->deferred)
+    SVN_ERR(send_deferred_report(b, pool));
+
   SVN_ERR(svn_ra_svn__write_cmd_finish_report(b->conn, b->pool));
   SVN_ERR(handle_auth_request(b->sess_baton, b->pool));
   SVN_ERR(svn_ra_svn_drive_editor2(b->conn, b->pool, b->editor, b->edit_baton,
@@ -310,6 +465,13 @@ static svn_error_t *ra_svn_abort_report(void *baton,
 {
   ra_svn_reporter_baton_t *b = baton;
 
+  /* Nothing has been sent yet. */
+  if (b->deferred)
+    {
+      b->deferred = NULL;
+      return SVN_NO_ERROR;
+    }
+
   SVN_ERR(svn_ra_svn__write_cmd_abort_report(b->conn, b->pool));
   return SVN_NO_ERROR;
 }
@@ -322,6 +484,30 @@ static svn_ra_reporter3_t ra_svn_reporter = {
   ra_svn_abort_report
 };
 
+/* Wrap *EDITOR and *EDIT_BATON for an edit of TARGET to DEPTH over the
+ * session SESS_BATON in a depth filter, if the server cannot do the
+ * filtering itself.  Allocate the filter in POOL. */
+static svn_error_t *
+filter_depth(const svn_delta_editor_t **editor,
+             void **edit_baton,
+             svn_ra_svn__session_baton_t *sess_baton,
+             const char *target,
+             svn_depth_t depth,
+             apr_pool_t *pool)
+{
+  /* We can skip the depth filtering when the user requested
+     depth_files or depth_infinity because the server will
+     transmit the right stuff anyway. */
+  if ((depth != svn_depth_files) && (depth != svn_depth_infinity)
+      && ! svn_ra_svn_has_capability(sess_baton->conn, SVN_RA_SVN_CAP_DEPTH))
+    SVN_ERR(svn_delta_depth_filter_editor(editor, edit_baton,
+                                          *editor, *edit_baton, depth,
+                                          *target != '\0',
+                                          pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Set *REPORTER and *REPORT_BATON to a new reporter which will drive
  * EDITOR/EDIT_BATON when it gets the finish_report() call.
  *
@@ -338,23 +524,9 @@ ra_svn_get_reporter(svn_ra_svn__session_baton_t *sess_baton,
                     void **report_baton)
 {
   ra_svn_reporter_baton_t *b;
-  const svn_delta_editor_t *filter_editor;
-  void *filter_baton;
 
-  /* We can skip the depth filtering when the user requested
-     depth_files or depth_infinity because the server will
-     transmit the right stuff anyway. */
-  if ((depth != svn_depth_files) && (depth != svn_depth_infinity)
-      && ! svn_ra_svn_has_capability(sess_baton->conn, SVN_RA_SVN_CAP_DEPTH))
-    {
-      SVN_ERR(svn_delta_depth_filter_editor(&filter_editor,
-                                            &filter_baton,
-                                            editor, edit_baton, depth,
-                                            *target != '\0',
-                                            pool));
-      editor = filter_editor;
-      edit_baton = filter_baton;
-    }
+  SVN_ERR(filter_depth(&editor, &edit_baton, sess_baton, target, depth,
+                       pool));
 
   b = apr_palloc(pool, sizeof(*b));
   b->sess_baton = sess_baton;
@@ -362,6 +534,7 @@ ra_svn_get_reporter(svn_ra_svn__session_baton_t *sess_baton,
   b->pool = pool;
   b->editor = editor;
   b->edit_baton = edit_baton;
+  b->deferred = NULL;
 
   *reporter = &ra_svn_reporter;
   *report_baton = b;
@@ -747,7 +920,7 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
    * capability list, and the URL, and subsequently there is an auth
    * request. */
   /* Client-side capabilities list: */
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwwww)cc(?c)",
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwwww?w)cc(?c)",
                                   (apr_uint64_t) 2,
                                   SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                   SVN_RA_SVN_CAP_SVNDIFF1,
@@ -756,6 +929,9 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
                                   SVN_RA_SVN_CAP_DEPTH,
                                   SVN_RA_SVN_CAP_MERGEINFO,
                                   SVN_RA_SVN_CAP_LOG_REVPROPS,
+                                  svn__zstd_available()
+                                    ? SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED
+                                    : NULL,
                                   url,
                                   SVN_RA_SVN__DEFAULT_USERAGENT,
                                   client_string));
@@ -788,6 +964,30 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_ra_svn__open_fetch_session(svn_ra_svn__session_baton_t **fetch_sess,
+                               svn_ra_svn__session_baton_t *sess,
+                               const char *url,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool)
+{
+  apr_uri_t uri;
+
+  SVN_ERR(parse_url(url, &uri, result_pool));
+  SVN_ERR(open_session(fetch_sess, url, &uri, sess->tunnel_name,
+                       sess->tunnel_argv, sess->config, sess->callbacks,
+                       sess->callbacks_baton, sess->auth_baton,
+                       result_pool, scratch_pool));
+
+  /* Account all further traffic to the main session such that progress
+   * is being reported as one continuous total. */
+  sess->bytes_read += (*fetch_sess)->bytes_read;
+  sess->bytes_written += (*fetch_sess)->bytes_written;
+  (*fetch_sess)->conn->session = sess;
+
+  return SVN_NO_ERROR;
+}
+
 
 #ifdef SVN_HAVE_SASL
 #define RA_SVN_DESCRIPTION \
@@ -1539,44 +1739,16 @@ send_dirent_fields(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *ra_svn_get_dir(svn_ra_session_t *session,
-                                   apr_hash_t **dirents,
-                                   svn_revnum_t *fetched_rev,
-                                   apr_hash_t **props,
-                                   const char *path,
-                                   svn_revnum_t rev,
-                                   apr_uint32_t dirent_fields,
-                                   apr_pool_t *pool)
+/* Parse the directory list DIRLIST, as received in a get-dir response,
+   into a hash *DIRENTS as returned by svn_ra_get_dir2().  Allocate the
+   result in POOL. */
+static svn_error_t *
+parse_dirlist(apr_hash_t **dirents,
+              const svn_ra_svn__list_t *dirlist,
+              apr_pool_t *pool)
 {
-  svn_ra_svn__session_baton_t *sess_baton = session->priv;
-  svn_ra_svn_conn_t *conn = sess_baton->conn;
-  svn_ra_svn__list_t *proplist, *dirlist;
   int i;
 
-  path = reparent_path(session, path, pool);
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w(c(?r)bb(!", "get-dir", path,
-                                  rev, (props != NULL), (dirents != NULL)));
-  SVN_ERR(send_dirent_fields(conn, dirent_fields, pool));
-
-  /* Always send the, nominally optional, want-iprops as "false" to
-     workaround a bug in svnserve 1.8.0-1.8.8 that causes the server
-     to see "true" if it is omitted. */
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!)b)", FALSE));
-
-  SVN_ERR(handle_auth_request(sess_baton, pool));
-  SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, "rll", &rev, &proplist,
-                                        &dirlist));
-
-  if (fetched_rev)
-    *fetched_rev = rev;
-  if (props)
-    SVN_ERR(svn_ra_svn__parse_proplist(proplist, pool, props));
-
-  /* We're done if dirents aren't wanted. */
-  if (!dirents)
-    return SVN_NO_ERROR;
-
-  /* Interpret the directory list. */
   *dirents = svn_hash__make(pool);
   for (i = 0; i < dirlist->nelts; i++)
     {
@@ -1625,6 +1797,224 @@ static svn_error_t *ra_svn_get_dir(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *ra_svn_get_dir(svn_ra_session_t *session,
+                                   apr_hash_t **dirents,
+                                   svn_revnum_t *fetched_rev,
+                                   apr_hash_t **props,
+                                   const char *path,
+                                   svn_revnum_t rev,
+                                   apr_uint32_t dirent_fields,
+                                   apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  svn_ra_svn__list_t *proplist, *dirlist;
+
+  path = reparent_path(session, path, pool);
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w(c(?r)bb(!", "get-dir", path,
+                                  rev, (props != NULL), (dirents != NULL)));
+  SVN_ERR(send_dirent_fields(conn, dirent_fields, pool));
+
+  /* Always send the, nominally optional, want-iprops as "false" to
+     workaround a bug in svnserve 1.8.0-1.8.8 that causes the server
+     to see "true" if it is omitted. */
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!)b)", FALSE));
+
+  SVN_ERR(handle_auth_request(sess_baton, pool));
+  SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, "rll", &rev, &proplist,
+                                        &dirlist));
+
+  if (fetched_rev)
+    *fetched_rev = rev;
+  if (props)
+    SVN_ERR(svn_ra_svn__parse_proplist(proplist, pool, props));
+
+  /* We're done if dirents aren't wanted. */
+  if (!dirents)
+    return SVN_NO_ERROR;
+
+  /* Interpret the directory list. */
+  return svn_error_trace(parse_dirlist(dirents, dirlist, pool));
+}
+
+/* Maximum number of tagged commands that we send before reading the
+   first response.  This keeps the amount of unread data that may pile
+   up in either direction small enough to not stall the connection. */
+#define MAX_TAGGED_COMMANDS 16
+
+/* Read the next tagged response from CONN.  Set *TAG to its tag and
+   *CMD_ERR to the error that the command reported before sending its
+   command response, if any.  Otherwise, set *RESPONSE to the command
+   response, to be parsed with svn_ra_svn__parse_cmd_response().
+   Allocate the result in POOL.
+
+   If the server asked for authentication, set *CMD_ERR to an error with
+   code SVN_ERR_RA_NOT_AUTHORIZED, such that the caller may retry the
+   command without tagging it. */
+static svn_error_t *
+read_tagged_response(apr_uint64_t *tag,
+                     svn_error_t **cmd_err,
+                     svn_ra_svn__item_t **response,
+                     svn_ra_svn_conn_t *conn,
+                     apr_pool_t *pool)
+{
+  svn_ra_svn__item_t *item;
+  svn_ra_svn__list_t *list, *mechlist;
+  const char *realm;
+
+  SVN_ERR(svn_ra_svn__read_item(conn, pool, &item));
+  if (item->kind != SVN_RA_SVN_LIST)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Tagged response not a list"));
+
+  list = &item->u.list;
+  if (list->nelts < 2
+      || SVN_RA_SVN__LIST_ITEM(list, 0).kind != SVN_RA_SVN_NUMBER)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Malformed tagged response"));
+
+  *tag = SVN_RA_SVN__LIST_ITEM(list, 0).u.number;
+  *response = NULL;
+
+  /* A command that fails early sends its failure instead of the auth
+     request. */
+  *cmd_err = svn_ra_svn__parse_cmd_response(&SVN_RA_SVN__LIST_ITEM(list, 1),
+                                            "lc", &mechlist, &realm);
+  if (*cmd_err)
+    return SVN_NO_ERROR;
+
+  if (mechlist->nelts != 0)
+    {
+      *cmd_err = svn_error_create(SVN_ERR_RA_NOT_AUTHORIZED, NULL, NULL);
+      return SVN_NO_ERROR;
+    }
+
+  if (list->nelts < 3)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Malformed tagged response"));
+
+  *response = &SVN_RA_SVN__LIST_ITEM(list, 2);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+ra_svn_get_dirs(svn_ra_session_t *session,
+                apr_hash_t **dirents,
+                const apr_array_header_t *paths,
+                svn_revnum_t revision,
+                apr_uint32_t dirent_fields,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  apr_array_header_t *retries;
+  svn_boolean_t *received;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_pool_t *iterpool;
+  int sent, pending, i;
+
+  *dirents = apr_hash_make(result_pool);
+
+  /* Without pipelining, fetch one directory after the other. */
+  if (!svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_TAGGED_COMMANDS))
+    {
+      for (i = 0; i < paths->nelts; i++)
+        {
+          const char *path = APR_ARRAY_IDX(paths, i, const char *);
+          apr_hash_t *entries;
+
+          SVN_ERR(ra_svn_get_dir(session, &entries, NULL, NULL, path,
+                                 revision, dirent_fields, result_pool));
+          svn_hash_sets(*dirents, apr_pstrdup(result_pool, path), entries);
+        }
+
+      return SVN_NO_ERROR;
+    }
+
+  /* Keep up to MAX_TAGGED_COMMANDS get-dir commands in flight, using the
+     index in PATHS as tag.  After an error, we only read the responses
+     to the commands already sent to keep the connection usable. */
+  retries = apr_array_make(scratch_pool, 0, sizeof(const char *));
+  received = apr_pcalloc(scratch_pool, paths->nelts * sizeof(*received));
+  iterpool = svn_pool_create(scratch_pool);
+  for (sent = 0, pending = 0; pending > 0 || (!err && sent < paths->nelts); )
+    {
+      apr_uint64_t tag;
+      svn_error_t *cmd_err;
+      svn_ra_svn__item_t *response;
+      svn_ra_svn__list_t *proplist, *dirlist;
+      svn_revnum_t fetched_rev;
+      const char *path;
+      apr_hash_t *entries;
+
+      svn_pool_clear(iterpool);
+
+      while (!err && sent < paths->nelts && pending < MAX_TAGGED_COMMANDS)
+        {
+          path = reparent_path(session,
+                               APR_ARRAY_IDX(paths, sent, const char *),
+                               iterpool);
+          SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "w(nw(c(?r)bb(!",
+                                          "tagged", (apr_uint64_t)sent,
+                                          "get-dir", path, revision,
+                                          FALSE, TRUE));
+          SVN_ERR(send_dirent_fields(conn, dirent_fields, iterpool));
+          SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "!)b))", FALSE));
+          ++sent;
+          ++pending;
+        }
+
+      /* The entries reference the response data, so read it into
+         RESULT_POOL. */
+      SVN_ERR(read_tagged_response(&tag, &cmd_err, &response, conn,
+                                   result_pool));
+      if (tag >= (apr_uint64_t)sent || received[tag])
+        return svn_error_compose_create(
+                 svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                  _("Unexpected tag in tagged response")),
+                 svn_error_compose_create(cmd_err, err));
+
+      received[tag] = TRUE;
+      --pending;
+      path = APR_ARRAY_IDX(paths, (int)tag, const char *);
+
+      if (!cmd_err)
+        cmd_err = svn_ra_svn__parse_cmd_response(response, "rll",
+                                                 &fetched_rev, &proplist,
+                                                 &dirlist);
+      if (!cmd_err)
+        cmd_err = parse_dirlist(&entries, dirlist, result_pool);
+
+      if (!cmd_err)
+        svn_hash_sets(*dirents, apr_pstrdup(result_pool, path), entries);
+      else if (cmd_err->apr_err == SVN_ERR_RA_NOT_AUTHORIZED)
+        {
+          /* We may have to authenticate first. */
+          svn_error_clear(cmd_err);
+          APR_ARRAY_PUSH(retries, const char *) = path;
+        }
+      else
+        err = svn_error_compose_create(err, cmd_err);
+    }
+  svn_pool_destroy(iterpool);
+  SVN_ERR(err);
+
+  /* Fetch the directories that may need authentication the normal way. */
+  for (i = 0; i < retries->nelts; i++)
+    {
+      const char *path = APR_ARRAY_IDX(retries, i, const char *);
+      apr_hash_t *entries;
+
+      SVN_ERR(ra_svn_get_dir(session, &entries, NULL, NULL, path, revision,
+                             dirent_fields, result_pool));
+      svn_hash_sets(*dirents, apr_pstrdup(result_pool, path), entries);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Converts a apr_uint64_t with values TRUE, FALSE or
    SVN_RA_SVN_UNSPECIFIED_NUMBER as provided by svn_ra_svn__parse_tuple
    to a svn_tristate_t */
@@ -1703,6 +2093,94 @@ static svn_error_t *ra_svn_get_mergeinfo(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
+/* Set *COUNT to the number of extra connections that SESS shall use to
+   fetch file contents during an update or switch.  0 means that the file
+   contents shall be sent as part of the edit. */
+static svn_error_t *
+get_fetch_conn_count(int *count,
+                     svn_ra_svn__session_baton_t *sess)
+{
+  svn_config_t *cfg;
+  const char *server_group;
+  apr_int64_t max_connections;
+
+  *count = 0;
+
+  if (!svn_ra_svn_has_capability(sess->conn, SVN_RA_SVN_CAP_UPDATE_SKELETON))
+    return SVN_NO_ERROR;
+
+  /* Tunnels may need interactive authentication for every connection.
+     So, only use extra tunnels if explicitly configured. */
+  cfg = sess->config
+      ? svn_hash_gets(sess->config, SVN_CONFIG_CATEGORY_SERVERS)
+      : NULL;
+  SVN_ERR(svn_config_get_int64(cfg, &max_connections,
+                               SVN_CONFIG_SECTION_GLOBAL,
+                               SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS,
+                               sess->is_tunneled
+                                 ? 1
+                                 : SVN_CONFIG_DEFAULT_OPTION_SVN_MAX_CONNECTIONS));
+
+  server_group = svn_auth_get_parameter(sess->auth_baton,
+                                        SVN_AUTH_PARAM_SERVER_GROUP);
+  if (server_group)
+    SVN_ERR(svn_config_get_int64(cfg, &max_connections, server_group,
+                                 SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS,
+                                 max_connections));
+
+  /* The main connection keeps driving the edit. */
+  if (max_connections > 1)
+    *count = (int)MIN(max_connections - 1,
+                      SVN_RA_SVN__MAX_FETCH_CONNECTIONS);
+
+  return SVN_NO_ERROR;
+}
+
+/* Make the reporter REPORT_BATON defer sending the update or switch
+ * command with the given arguments until the report is complete.  If the
+ * server is to send the edit skeleton only, drive a fetch editor for
+ * FETCH_URL and FETCH_TARGET over up to FETCH_CONNS extra connections
+ * that wraps UPDATE_EDITOR and UPDATE_BATON.  SWITCH_URL is NULL for
+ * updates.  Allocate everything in POOL. */
+static svn_error_t *
+defer_report(void *report_baton,
+             svn_revnum_t rev,
+             const char *target,
+             svn_boolean_t recurse,
+             const char *switch_url,
+             svn_depth_t depth,
+             svn_boolean_t send_copyfrom_args,
+             svn_boolean_t ignore_ancestry,
+             const char *fetch_url,
+             const char *fetch_target,
+             int fetch_conns,
+             const svn_delta_editor_t *update_editor,
+             void *update_baton,
+             apr_pool_t *pool)
+{
+  ra_svn_reporter_baton_t *b = report_baton;
+  deferred_report_t *d = apr_pcalloc(pool, sizeof(*d));
+
+  d->rev = rev;
+  d->target = apr_pstrdup(pool, target);
+  d->recurse = recurse;
+  d->switch_url = switch_url ? apr_pstrdup(pool, switch_url) : NULL;
+  d->depth = depth;
+  d->send_copyfrom_args = send_copyfrom_args;
+  d->ignore_ancestry = ignore_ancestry;
+  d->paths = apr_array_make(pool, 16, sizeof(deferred_path_t *));
+
+  SVN_ERR(svn_ra_svn__get_fetch_editor(&d->fetch_editor, &d->fetch_baton,
+                                       b->sess_baton, fetch_url,
+                                       fetch_target, fetch_conns,
+                                       update_editor, update_baton, pool));
+  SVN_ERR(filter_depth(&d->fetch_editor, &d->fetch_baton, b->sess_baton,
+                       target, depth, pool));
+
+  b->deferred = d;
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *ra_svn_update(svn_ra_session_t *session,
                                   const svn_ra_reporter3_t **reporter,
                                   void **report_baton, svn_revnum_t rev,
@@ -1717,14 +2195,32 @@ static svn_error_t *ra_svn_update(svn_ra_session_t *session,
   svn_ra_svn__session_baton_t *sess_baton = session->priv;
   svn_ra_svn_conn_t *conn = sess_baton->conn;
   svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+  int fetch_conns;
 
   /* Callbacks may assume that all data is relative the sessions's URL. */
   SVN_ERR(ensure_exact_server_parent(session, scratch_pool));
 
+  /* Fetch file contents in parallel, if the report permits it. */
+  SVN_ERR(get_fetch_conn_count(&fetch_conns, sess_baton));
+  if (fetch_conns > 0)
+    {
+      SVN_ERR(ra_svn_get_reporter(sess_baton, pool, update_editor,
+                                  update_baton, target, depth, reporter,
+                                  report_baton));
+      return svn_error_trace(defer_report(*report_baton, rev, target,
+                                          recurse, NULL, depth,
+                                          send_copyfrom_args,
+                                          ignore_ancestry,
+                                          sess_baton->parent->client_url->data,
+                                          NULL, fetch_conns,
+                                          update_editor, update_baton,
+                                          pool));
+    }
+
   /* Tell the server we want to start an update. */
   SVN_ERR(svn_ra_svn__write_cmd_update(conn, pool, rev, target, recurse,
                                        depth, send_copyfrom_args,
-                                       ignore_ancestry));
+                                       ignore_ancestry, TRUE));
   SVN_ERR(handle_auth_request(sess_baton, pool));
 
   /* Fetch a reporter for the caller to drive.  The reporter will drive
@@ -1751,14 +2247,32 @@ ra_svn_switch(svn_ra_session_t *session,
   svn_ra_svn__session_baton_t *sess_baton = session->priv;
   svn_ra_svn_conn_t *conn = sess_baton->conn;
   svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+  int fetch_conns;
 
   /* Callbacks may assume that all data is relative the sessions's URL. */
   SVN_ERR(ensure_exact_server_parent(session, scratch_pool));
 
+  /* Fetch file contents in parallel, if the report permits it. */
+  SVN_ERR(get_fetch_conn_count(&fetch_conns, sess_baton));
+  if (fetch_conns > 0)
+    {
+      SVN_ERR(ra_svn_get_reporter(sess_baton, pool, update_editor,
+                                  update_baton, target, depth, reporter,
+                                  report_baton));
+      return svn_error_trace(defer_report(*report_baton, rev, target,
+                                          recurse, switch_url, depth,
+                                          send_copyfrom_args,
+                                          ignore_ancestry, switch_url,
+                                          target, fetch_conns,
+                                          update_editor, update_baton,
+                                          pool));
+    }
+
   /* Tell the server we want to start a switch. */
   SVN_ERR(svn_ra_svn__write_cmd_switch(conn, pool, rev, target, recurse,
                                        switch_url, depth,
-                                       send_copyfrom_args, ignore_ancestry));
+                                       send_copyfrom_args, ignore_ancestry,
+                                       TRUE));
   SVN_ERR(handle_auth_request(sess_baton, pool));
 
   /* Fetch a reporter for the caller to drive.  The reporter will drive
@@ -3242,6 +3756,66 @@ ra_svn_list(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+ra_svn_get_blame(svn_ra_session_t *session,
+                 apr_array_header_t **chunks,
+                 const char *path,
+                 svn_revnum_t start,
+                 svn_revnum_t end,
+                 const svn_diff_file_options_t *diff_options,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  path = reparent_path(session, path, scratch_pool);
+
+  /* Send the blame request. */
+  SVN_ERR(svn_ra_svn__write_tuple(
+            conn, scratch_pool, "w(c(?r)(?r)bbb)", "get-blame",
+            path, start, end,
+            diff_options->ignore_space == svn_diff_file_ignore_space_change,
+            diff_options->ignore_space == svn_diff_file_ignore_space_all,
+            diff_options->ignore_eol_style));
+
+  /* Servers before 1.12 don't support this command. */
+  SVN_ERR(handle_unsupported_cmd(handle_auth_request(sess_baton,
+                                                     scratch_pool),
+                                 N_("'get-blame' not implemented")));
+
+  /* Read the blame chunks. */
+  *chunks = apr_array_make(result_pool, 16, sizeof(svn_ra__blame_chunk_t));
+  while (1)
+    {
+      svn_ra_svn__item_t *item;
+      svn_ra__blame_chunk_t *chunk;
+      apr_uint64_t start_line;
+      svn_revnum_t revision;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_ra_svn__read_item(conn, iterpool, &item));
+      if (is_done_response(item))
+        break;
+      if (item->kind != SVN_RA_SVN_LIST)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Blame entry not a list"));
+      SVN_ERR(svn_ra_svn__parse_tuple(&item->u.list, "n(?r)",
+                                      &start_line, &revision));
+
+      chunk = apr_array_push(*chunks);
+      chunk->start = (apr_int64_t)start_line;
+      chunk->revision = revision;
+    }
+  svn_pool_destroy(iterpool);
+
+  /* Read the actual command response. */
+  SVN_ERR(svn_ra_svn__read_cmd_response(conn, scratch_pool, ""));
+  return SVN_NO_ERROR;
+}
+
 static const svn_ra__vtable_t ra_svn_vtable = {
   svn_ra_svn_version,
   ra_svn_get_description,
@@ -3284,7 +3858,9 @@ static const svn_ra__vtable_t ra_svn_vtable = {
   ra_svn_list,
   ra_svn_register_editor_shim_callbacks,
   NULL /* commit_ev2 */,
-  NULL /* replay_range_ev2 */
+  NULL /* replay_range_ev2 */,
+  ra_svn_get_blame,
+  ra_svn_get_dirs
 };
 
 svn_error_t *
@@ -0,0 +1,995 @@
+/*
+ * fetch.c :  Fetching update file contents over parallel connections
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#define APR_WANT_STRFUNC
+#include <apr_want.h>
+#include <apr_general.h>
+#include <apr_strings.h>
+
+#include "svn_types.h"
+#include "svn_string.h"
+#include "svn_error.h"
+#include "svn_delta.h"
+#include "svn_dirent_uri.h"
+#include "svn_props.h"
+#include "svn_pools.h"
+#include "svn_private_config.h"
+
+#include "private/svn_subr_private.h"
+
+#include "ra_svn.h"
+
+/*
+ * When the server supports it, update and switch edits are being sent
+ * without file contents, i.e. as a mere tree skeleton.  The editor in
+ * this file sits between the edit driver and the actual update editor.
+ * It requests the contents of all changed files in batches over a number
+ * of extra connections while the skeleton is still streaming in over the
+ * main connection.
+ *
+ * The wrapped editor must see all calls in their original order, so we
+ * queue every editor operation and replay it once all file contents that
+ * precede it have arrived.  Contents that arrive early are buffered in a
+ * spill buffer per file.
+ */
+
+/* Maximum number of files to request in a single get-files command. */
+#define MAX_BATCH_SIZE 32
+
+/* Buffer that many bytes of file contents in memory per file before
+ * spilling them to disk. */
+#define SPILLBUF_BLOCKSIZE 4096
+#define SPILLBUF_MAXBUFFSIZE 65536
+
+/* Number of files that we are willing to queue per connection before we
+ * start blocking the edit driver. */
+#define QUEUED_FILES_PER_CONN (2 * MAX_BATCH_SIZE)
+
+typedef struct edit_baton_t edit_baton_t;
+typedef struct node_baton_t node_baton_t;
+typedef struct operation_t operation_t;
+
+/* The kinds of editor operations that we queue. */
+typedef enum operation_kind_t
+{
+  op_set_target_revision,
+  op_open_root,
+  op_delete_entry,
+  op_add_directory,
+  op_open_directory,
+  op_change_dir_prop,
+  op_close_directory,
+  op_absent_directory,
+  op_add_file,
+  op_open_file,
+  op_absent_file
+} operation_kind_t;
+
+/* An extra connection to fetch file contents over. */
+typedef struct fetch_conn_t
+{
+  svn_ra_svn__session_baton_t *sess;
+
+  /* Number of files in the current batch that we still have to read. */
+  int pending;
+
+  /* Whether we still have to handle the auth request of the current
+   * batch. */
+  svn_boolean_t auth_pending;
+
+  /* The file operations in the current batch, in request order. */
+  operation_t *first;
+  operation_t *last;
+} fetch_conn_t;
+
+/* A queued editor operation.  All file related calls are being combined
+ * into a single file operation. */
+struct operation_t
+{
+  operation_kind_t kind;
+
+  /* The node that this operation creates, changes or closes and its
+   * parent directory.  Either may be NULL. */
+  node_baton_t *node;
+  node_baton_t *parent;
+
+  /* Arguments of the original call, as far as applicable. */
+  const char *path;
+  svn_revnum_t revision;
+  const char *copyfrom_path;
+  svn_revnum_t copyfrom_revision;
+  const char *name;
+  const svn_string_t *value;
+
+  /* File operations only: the property changes as svn_prop_t, whether
+   * the contents changed and the checksums sent with the skeleton. */
+  apr_array_header_t *props;
+  svn_boolean_t has_text;
+  const char *base_checksum;
+  const char *text_checksum;
+
+  /* File operations only: whether the driver closed the file already. */
+  svn_boolean_t closed;
+
+  /* Files with changed contents only: the path relative to the fetch URL,
+   * the connection that got asked for the contents, the contents received
+   * so far and whether they are complete. */
+  const char *fetch_path;
+  fetch_conn_t *conn;
+  svn_spillbuf_t *contents;
+  svn_boolean_t received;
+
+  /* Links within the operation queue, the list of files still to request
+   * and the list of files requested from CONN, respectively. */
+  operation_t *next;
+  operation_t *request_next;
+  operation_t *conn_next;
+};
+
+/* Our directory and file batons. */
+struct node_baton_t
+{
+  edit_baton_t *eb;
+  node_baton_t *parent;
+
+  /* The baton returned by the wrapped editor.  Set during replay. */
+  void *wrapped_baton;
+
+  /* The file operation, if this is a file. */
+  operation_t *file_op;
+
+  /* All data of this node and the operations for it live in here.
+   * This pool gets destroyed once the node has been closed in the
+   * wrapped editor. */
+  apr_pool_t *pool;
+};
+
+struct edit_baton_t
+{
+  const svn_delta_editor_t *wrapped_editor;
+  void *wrapped_baton;
+
+  /* The main session, the URL to open extra connections to and the
+   * edit target that corresponds to that URL. */
+  svn_ra_svn__session_baton_t *sess;
+  const char *fetch_url;
+  const char *target;
+
+  /* Revision to fetch the contents from. */
+  svn_revnum_t revision;
+
+  /* Extra connections opened so far (fetch_conn_t *) and the maximum
+   * number of them. */
+  apr_array_header_t *conns;
+  int max_conns;
+
+  /* Queue of operations to replay. */
+  operation_t *head;
+  operation_t *tail;
+
+  /* Closed files whose contents still need to be requested. */
+  operation_t *request_head;
+  operation_t *request_tail;
+
+  /* Number of closed files with changed contents in the queue. */
+  int queued_files;
+
+  /* Pool for the extra connections. */
+  apr_pool_t *conn_pool;
+  apr_pool_t *pool;
+};
+
+/* Return a new node baton for a child of PARENT in EB. */
+static node_baton_t *
+make_node_baton(edit_baton_t *eb,
+                node_baton_t *parent)
+{
+  apr_pool_t *pool = svn_pool_create(eb->pool);
+  node_baton_t *node = apr_pcalloc(pool, sizeof(*node));
+
+  node->eb = eb;
+  node->parent = parent;
+  node->pool = pool;
+
+  return node;
+}
+
+/* Return a new operation of KIND for NODE and PARENT, allocated in POOL. */
+static operation_t *
+make_operation(operation_kind_t kind,
+               node_baton_t *node,
+               node_baton_t *parent,
+               const char *path,
+               apr_pool_t *pool)
+{
+  operation_t *op = apr_pcalloc(pool, sizeof(*op));
+
+  op->kind = kind;
+  op->node = node;
+  op->parent = parent;
+  op->path = path ? apr_pstrdup(pool, path) : NULL;
+  op->revision = SVN_INVALID_REVNUM;
+  op->copyfrom_revision = SVN_INVALID_REVNUM;
+
+  return op;
+}
+
+/* Append OP to the operation queue of EB. */
+static void
+enqueue(edit_baton_t *eb,
+        operation_t *op)
+{
+  if (eb->tail)
+    eb->tail->next = op;
+  else
+    eb->head = op;
+
+  eb->tail = op;
+}
+
+/* Open another fetch connection for EB and return it in *FC.  Set *FC to
+ * NULL if that fails for any but the first connection. */
+static svn_error_t *
+open_conn(fetch_conn_t **fc,
+          edit_baton_t *eb,
+          apr_pool_t *scratch_pool)
+{
+  apr_pool_t *pool = svn_pool_create(eb->conn_pool);
+  svn_ra_svn__session_baton_t *sess;
+  svn_error_t *err;
+
+  *fc = NULL;
+  err = svn_ra_svn__open_fetch_session(&sess, eb->sess, eb->fetch_url,
+                                       pool, scratch_pool);
+  if (err)
+    {
+      svn_pool_destroy(pool);
+      if (eb->conns->nelts == 0)
+        return svn_error_trace(err);
+
+      /* Simply make do with the connections we already have. */
+      svn_error_clear(err);
+      eb->max_conns = eb->conns->nelts;
+      return SVN_NO_ERROR;
+    }
+
+  *fc = apr_pcalloc(pool, sizeof(**fc));
+  (*fc)->sess = sess;
+  APR_ARRAY_PUSH(eb->conns, fetch_conn_t *) = *fc;
+
+  return SVN_NO_ERROR;
+}
+
+/* Request the next batch of files from EB's request list over the idle
+ * connection FC. */
+static svn_error_t *
+request_files(fetch_conn_t *fc,
+              edit_baton_t *eb,
+              apr_pool_t *scratch_pool)
+{
+  svn_ra_svn_conn_t *conn = fc->sess->conn;
+
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "w((?r)(!",
+                                  "get-files", eb->revision));
+  while (eb->request_head && fc->pending < MAX_BATCH_SIZE)
+    {
+      operation_t *op = eb->request_head;
+
+      eb->request_head = op->request_next;
+      if (!eb->request_head)
+        eb->request_tail = NULL;
+
+      SVN_ERR(svn_ra_svn__write_cstring(conn, scratch_pool, op->fetch_path));
+
+      op->conn = fc;
+      if (fc->last)
+        fc->last->conn_next = op;
+      else
+        fc->first = op;
+      fc->last = op;
+      fc->pending++;
+    }
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "!))"));
+  fc->auth_pending = TRUE;
+
+  return svn_error_trace(svn_ra_svn__flush(conn, scratch_pool));
+}
+
+/* Request the contents of as many files as possible in EB, opening
+ * more connections as needed. */
+static svn_error_t *
+issue_requests(edit_baton_t *eb,
+               apr_pool_t *scratch_pool)
+{
+  while (eb->request_head)
+    {
+      fetch_conn_t *fc = NULL;
+      int i;
+
+      for (i = 0; i < eb->conns->nelts; ++i)
+        if (APR_ARRAY_IDX(eb->conns, i, fetch_conn_t *)->pending == 0)
+          {
+            fc = APR_ARRAY_IDX(eb->conns, i, fetch_conn_t *);
+            break;
+          }
+
+      if (!fc && eb->conns->nelts < eb->max_conns)
+        SVN_ERR(open_conn(&fc, eb, scratch_pool));
+
+      /* All connections are busy. */
+      if (!fc)
+        break;
+
+      SVN_ERR(request_files(fc, eb, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if ITEM is the "done" word that ends a get-files response. */
+static svn_boolean_t
+is_done_item(const svn_ra_svn__item_t *item)
+{
+  return (item->kind == SVN_RA_SVN_WORD
+          && strcmp(item->u.word.data, "done") == 0);
+}
+
+/* Read the contents of the next file requested over FC in EB.  Once the
+ * batch is complete, request the next one. */
+static svn_error_t *
+receive_file(fetch_conn_t *fc,
+             edit_baton_t *eb,
+             apr_pool_t *scratch_pool)
+{
+  svn_ra_svn_conn_t *conn = fc->sess->conn;
+  operation_t *op = fc->first;
+  svn_ra_svn__item_t *item;
+  const char *path;
+  apr_pool_t *iterpool;
+
+  if (fc->auth_pending)
+    {
+      SVN_ERR(svn_ra_svn__handle_auth_request(fc->sess, scratch_pool));
+      fc->auth_pending = FALSE;
+    }
+
+  SVN_ERR(svn_ra_svn__read_item(conn, scratch_pool, &item));
+  if (is_done_item(item))
+    {
+      /* The server ran into an error and is about to tell us. */
+      SVN_ERR(svn_ra_svn__read_cmd_response(conn, scratch_pool, ""));
+      return svn_error_createf(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                               _("Missing contents of '%s' in server "
+                                 "response"), op->path);
+    }
+  if (item->kind != SVN_RA_SVN_LIST)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("File contents expected"));
+
+  SVN_ERR(svn_ra_svn__parse_tuple(&item->u.list, "c", &path));
+  if (strcmp(path, op->fetch_path) != 0)
+    return svn_error_createf(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                             _("Unexpected contents of '%s' in server "
+                               "response"), path);
+
+  iterpool = svn_pool_create(scratch_pool);
+  while (1)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__read_item(conn, iterpool, &item));
+      if (item->kind != SVN_RA_SVN_STRING)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Non-string as part of file contents"));
+      if (item->u.string.len == 0)
+        break;
+
+      SVN_ERR(svn_spillbuf__write(op->contents, item->u.string.data,
+                                  item->u.string.len, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  op->received = TRUE;
+  fc->first = op->conn_next;
+  if (--fc->pending > 0)
+    return SVN_NO_ERROR;
+
+  /* The batch is complete.  Read the trailer and move on. */
+  fc->last = NULL;
+  SVN_ERR(svn_ra_svn__read_item(conn, scratch_pool, &item));
+  if (!is_done_item(item))
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Too many files in server response"));
+  SVN_ERR(svn_ra_svn__read_cmd_response(conn, scratch_pool, ""));
+
+  return svn_error_trace(issue_requests(eb, scratch_pool));
+}
+
+/* Read all file contents that already arrived over any connection in EB,
+ * without blocking. */
+static svn_error_t *
+receive_available(edit_baton_t *eb,
+                  apr_pool_t *scratch_pool)
+{
+  int i;
+
+  for (i = 0; i < eb->conns->nelts; ++i)
+    {
+      fetch_conn_t *fc = APR_ARRAY_IDX(eb->conns, i, fetch_conn_t *);
+
+      while (fc->pending > 0)
+        {
+          svn_boolean_t available;
+
+          SVN_ERR(svn_ra_svn__data_available(fc->sess->conn, &available));
+          if (!available)
+            break;
+
+          SVN_ERR(receive_file(fc, eb, scratch_pool));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Forward the file operation OP to the wrapped editor in EB, including
+ * the file contents. */
+static svn_error_t *
+replay_file(edit_baton_t *eb,
+            operation_t *op,
+            apr_pool_t *scratch_pool)
+{
+  const svn_delta_editor_t *editor = eb->wrapped_editor;
+  node_baton_t *node = op->node;
+  int i;
+
+  if (op->kind == op_add_file)
+    SVN_ERR(editor->add_file(op->path, op->parent->wrapped_baton,
+                             op->copyfrom_path, op->copyfrom_revision,
+                             node->pool, &node->wrapped_baton));
+  else
+    SVN_ERR(editor->open_file(op->path, op->parent->wrapped_baton,
+                              op->revision, node->pool,
+                              &node->wrapped_baton));
+
+  for (i = 0; i < op->props->nelts; ++i)
+    {
+      const svn_prop_t *prop = &APR_ARRAY_IDX(op->props, i, svn_prop_t);
+
+      SVN_ERR(editor->change_file_prop(node->wrapped_baton, prop->name,
+                                       prop->value, scratch_pool));
+    }
+
+  if (op->has_text)
+    {
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_stream_t *target;
+
+      /* Send the contents as a self-contained delta, i.e. one that does
+       * not refer to the base text. */
+      SVN_ERR(editor->apply_textdelta(node->wrapped_baton,
+                                      op->base_checksum, node->pool,
+                                      &handler, &handler_baton));
+      target = svn_txdelta_target_push(handler, handler_baton,
+                                       svn_stream_empty(scratch_pool),
+                                       scratch_pool);
+      SVN_ERR(svn_stream_copy3(svn_stream__from_spillbuf(op->contents,
+                                                         scratch_pool),
+                               target, NULL, NULL, scratch_pool));
+    }
+
+  return svn_error_trace(editor->close_file(node->wrapped_baton,
+                                            op->text_checksum,
+                                            scratch_pool));
+}
+
+/* Forward OP to the wrapped editor in EB. */
+static svn_error_t *
+replay(edit_baton_t *eb,
+       operation_t *op,
+       apr_pool_t *scratch_pool)
+{
+  const svn_delta_editor_t *editor = eb->wrapped_editor;
+  node_baton_t *node = op->node;
+  void *parent_baton = op->parent ? op->parent->wrapped_baton : NULL;
+
+  switch (op->kind)
+    {
+      case op_set_target_revision:
+        return svn_error_trace(editor->set_target_revision(eb->wrapped_baton,
+                                                           op->revision,
+                                                           scratch_pool));
+
+      case op_open_root:
+        return svn_error_trace(editor->open_root(eb->wrapped_baton,
+                                                 op->revision, node->pool,
+                                                 &node->wrapped_baton));
+
+      case op_delete_entry:
+        return svn_error_trace(editor->delete_entry(op->path, op->revision,
+                                                    parent_baton,
+                                                    scratch_pool));
+
+      case op_add_directory:
+        return svn_error_trace(editor->add_directory(op->path, parent_baton,
+                                                     op->copyfrom_path,
+                                                     op->copyfrom_revision,
+                                                     node->pool,
+                                                     &node->wrapped_baton));
+
+      case op_open_directory:
+        return svn_error_trace(editor->open_directory(op->path, parent_baton,
+                                                      op->revision,
+                                                      node->pool,
+                                                      &node->wrapped_baton));
+
+      case op_change_dir_prop:
+        return svn_error_trace(editor->change_dir_prop(node->wrapped_baton,
+                                                       op->name, op->value,
+                                                       scratch_pool));
+
+      case op_close_directory:
+        SVN_ERR(editor->close_directory(node->wrapped_baton, scratch_pool));
+        svn_pool_destroy(node->pool);
+        return SVN_NO_ERROR;
+
+      case op_absent_directory:
+        return svn_error_trace(editor->absent_directory(op->path,
+                                                        parent_baton,
+                                                        scratch_pool));
+
+      case op_absent_file:
+        return svn_error_trace(editor->absent_file(op->path, parent_baton,
+                                                   scratch_pool));
+
+      case op_add_file:
+      case op_open_file:
+        SVN_ERR(replay_file(eb, op, scratch_pool));
+        if (op->has_text)
+          eb->queued_files--;
+
+        svn_pool_destroy(node->pool);
+        return SVN_NO_ERROR;
+
+      default:
+        SVN_ERR_MALFUNCTION();
+    }
+}
+
+/* Replay as many queued operations in EB as possible.  Block for file
+ * contents only if DRAIN is set or if too many files are waiting. */
+static svn_error_t *
+process_queue(edit_baton_t *eb,
+              svn_boolean_t drain,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(issue_requests(eb, iterpool));
+  while (eb->head)
+    {
+      operation_t *op = eb->head;
+
+      svn_pool_clear(iterpool);
+
+      /* Only the edit driver can complete an open file. */
+      if ((op->kind == op_add_file || op->kind == op_open_file)
+          && !op->closed)
+        break;
+
+      if (op->has_text && !op->received)
+        {
+          fetch_conn_t *fc = op->conn;
+          int i;
+
+          SVN_ERR(receive_available(eb, iterpool));
+          if (op->received)
+            continue;
+
+          if (!drain
+              && eb->queued_files <= eb->max_conns * QUEUED_FILES_PER_CONN)
+            break;
+
+          /* If the file has not been requested yet, all connections are
+           * busy.  Wait for any of them to finish its batch. */
+          for (i = 0; !fc && i < eb->conns->nelts; ++i)
+            if (APR_ARRAY_IDX(eb->conns, i, fetch_conn_t *)->pending > 0)
+              fc = APR_ARRAY_IDX(eb->conns, i, fetch_conn_t *);
+
+          SVN_ERR_ASSERT(fc != NULL);
+          SVN_ERR(receive_file(fc, eb, iterpool));
+          continue;
+        }
+
+      /* OP may be gone after the replay. */
+      eb->head = op->next;
+      if (!eb->head)
+        eb->tail = NULL;
+
+      SVN_ERR(replay(eb, op, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+set_target_revision(void *edit_baton,
+                    svn_revnum_t target_revision,
+                    apr_pool_t *pool)
+{
+  edit_baton_t *eb = edit_baton;
+  operation_t *op = make_operation(op_set_target_revision, NULL, NULL,
+                                   NULL, eb->pool);
+
+  op->revision = target_revision;
+  eb->revision = target_revision;
+  enqueue(eb, op);
+
+  return svn_error_trace(process_queue(eb, FALSE, pool));
+}
+
+static svn_error_t *
+open_root(void *edit_baton,
+          svn_revnum_t base_revision,
+          apr_pool_t *result_pool,
+          void **root_baton)
+{
+  edit_baton_t *eb = edit_baton;
+  node_baton_t *node = make_node_baton(eb, NULL);
+  operation_t *op = make_operation(op_open_root, node, NULL, NULL,
+                                   node->pool);
+
+  op->revision = base_revision;
+  enqueue(eb, op);
+  *root_baton = node;
+
+  return svn_error_trace(process_queue(eb, FALSE, result_pool));
+}
+
+static svn_error_t *
+delete_entry(const char *path,
+             svn_revnum_t revision,
+             void *parent_baton,
+             apr_pool_t *pool)
+{
+  node_baton_t *parent = parent_baton;
+  operation_t *op = make_operation(op_delete_entry, NULL, parent, path,
+                                   parent->pool);
+
+  op->revision = revision;
+  enqueue(parent->eb, op);
+
+  return svn_error_trace(process_queue(parent->eb, FALSE, pool));
+}
+
+static svn_error_t *
+add_directory(const char *path,
+              void *parent_baton,
+              const char *copyfrom_path,
+              svn_revnum_t copyfrom_revision,
+              apr_pool_t *dir_pool,
+              void **child_baton)
+{
+  node_baton_t *parent = parent_baton;
+  node_baton_t *node = make_node_baton(parent->eb, parent);
+  operation_t *op = make_operation(op_add_directory, node, parent, path,
+                                   node->pool);
+
+  op->copyfrom_path = apr_pstrdup(node->pool, copyfrom_path);
+  op->copyfrom_revision = copyfrom_revision;
+  enqueue(node->eb, op);
+  *child_baton = node;
+
+  return svn_error_trace(process_queue(node->eb, FALSE, dir_pool));
+}
+
+static svn_error_t *
+open_directory(const char *path,
+               void *parent_baton,
+               svn_revnum_t base_revision,
+               apr_pool_t *dir_pool,
+               void **child_baton)
+{
+  node_baton_t *parent = parent_baton;
+  node_baton_t *node = make_node_baton(parent->eb, parent);
+  operation_t *op = make_operation(op_open_directory, node, parent, path,
+                                   node->pool);
+
+  op->revision = base_revision;
+  enqueue(node->eb, op);
+  *child_baton = node;
+
+  return svn_error_trace(process_queue(node->eb, FALSE, dir_pool));
+}
+
+static svn_error_t *
+change_dir_prop(void *dir_baton,
+                const char *name,
+                const svn_string_t *value,
+                apr_pool_t *pool)
+{
+  node_baton_t *node = dir_baton;
+  operation_t *op = make_operation(op_change_dir_prop, node, node->parent,
+                                   NULL, node->pool);
+
+  op->name = apr_pstrdup(node->pool, name);
+  op->value = svn_string_dup(value, node->pool);
+  enqueue(node->eb, op);
+
+  return svn_error_trace(process_queue(node->eb, FALSE, pool));
+}
+
+static svn_error_t *
+close_directory(void *dir_baton,
+                apr_pool_t *pool)
+{
+  node_baton_t *node = dir_baton;
+  edit_baton_t *eb = node->eb;
+
+  enqueue(eb, make_operation(op_close_directory, node, node->parent, NULL,
+                             node->pool));
+
+  return svn_error_trace(process_queue(eb, FALSE, pool));
+}
+
+static svn_error_t *
+absent_directory(const char *path,
+                 void *parent_baton,
+                 apr_pool_t *pool)
+{
+  node_baton_t *parent = parent_baton;
+
+  enqueue(parent->eb, make_operation(op_absent_directory, NULL, parent, path,
+                                     parent->pool));
+
+  return svn_error_trace(process_queue(parent->eb, FALSE, pool));
+}
+
+/* Common implementation of add_file and open_file. */
+static node_baton_t *
+make_file_baton(operation_kind_t kind,
+                const char *path,
+                node_baton_t *parent)
+{
+  node_baton_t *node = make_node_baton(parent->eb, parent);
+
+  node->file_op = make_operation(kind, node, parent, path, node->pool);
+  node->file_op->props = apr_array_make(node->pool, 1, sizeof(svn_prop_t));
+
+  /* Keep the file's place in the queue. */
+  enqueue(node->eb, node->file_op);
+
+  return node;
+}
+
+static svn_error_t *
+add_file(const char *path,
+         void *parent_baton,
+         const char *copyfrom_path,
+         svn_revnum_t copyfrom_revision,
+         apr_pool_t *file_pool,
+         void **file_baton)
+{
+  node_baton_t *node = make_file_baton(op_add_file, path, parent_baton);
+
+  node->file_op->copyfrom_path = apr_pstrdup(node->pool, copyfrom_path);
+  node->file_op->copyfrom_revision = copyfrom_revision;
+  *file_baton = node;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+open_file(const char *path,
+          void *parent_baton,
+          svn_revnum_t base_revision,
+          apr_pool_t *file_pool,
+          void **file_baton)
+{
+  node_baton_t *node = make_file_baton(op_open_file, path, parent_baton);
+
+  node->file_op->revision = base_revision;
+  *file_baton = node;
+
+  return SVN_NO_ERROR;
+}
+
+/* Window handler for the text deltas of the edit driver.  Since the server
+ * has been asked to leave out the file contents, only the final NULL window
+ * is expected.  BATON is the file operation. */
+static svn_error_t *
+unexpected_window(svn_txdelta_window_t *window,
+                  void *baton)
+{
+  operation_t *op = baton;
+
+  if (window)
+    return svn_error_createf(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                             _("Unexpected text delta for '%s'"), op->path);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+apply_textdelta(void *file_baton,
+                const char *base_checksum,
+                apr_pool_t *pool,
+                svn_txdelta_window_handler_t *handler,
+                void **handler_baton)
+{
+  node_baton_t *node = file_baton;
+  edit_baton_t *eb = node->eb;
+  operation_t *op = node->file_op;
+
+  /* Map the path within the edit to the one below the fetch URL. */
+  op->fetch_path = op->path;
+  if (eb->target && *eb->target)
+    op->fetch_path = svn_relpath_skip_ancestor(eb->target, op->path);
+  if (!op->fetch_path)
+    return svn_error_createf(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                             _("Unexpected file '%s' outside the edit "
+                               "target"), op->path);
+
+  op->has_text = TRUE;
+  op->base_checksum = apr_pstrdup(node->pool, base_checksum);
+  op->contents = svn_spillbuf__create(SPILLBUF_BLOCKSIZE,
+                                      SPILLBUF_MAXBUFFSIZE, node->pool);
+
+  *handler = unexpected_window;
+  *handler_baton = op;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+change_file_prop(void *file_baton,
+                 const char *name,
+                 const svn_string_t *value,
+                 apr_pool_t *pool)
+{
+  node_baton_t *node = file_baton;
+  svn_prop_t *prop = apr_array_push(node->file_op->props);
+
+  prop->name = apr_pstrdup(node->pool, name);
+  prop->value = svn_string_dup(value, node->pool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+close_file(void *file_baton,
+           const char *text_checksum,
+           apr_pool_t *pool)
+{
+  node_baton_t *node = file_baton;
+  edit_baton_t *eb = node->eb;
+  operation_t *op = node->file_op;
+
+  op->text_checksum = apr_pstrdup(node->pool, text_checksum);
+  op->closed = TRUE;
+
+  if (op->has_text)
+    {
+      if (eb->request_tail)
+        eb->request_tail->request_next = op;
+      else
+        eb->request_head = op;
+
+      eb->request_tail = op;
+      eb->queued_files++;
+    }
+
+  return svn_error_trace(process_queue(eb, FALSE, pool));
+}
+
+static svn_error_t *
+absent_file(const char *path,
+            void *parent_baton,
+            apr_pool_t *pool)
+{
+  node_baton_t *parent = parent_baton;
+
+  enqueue(parent->eb, make_operation(op_absent_file, NULL, parent, path,
+                                     parent->pool));
+
+  return svn_error_trace(process_queue(parent->eb, FALSE, pool));
+}
+
+static svn_error_t *
+close_edit(void *edit_baton,
+           apr_pool_t *pool)
+{
+  edit_baton_t *eb = edit_baton;
+
+  SVN_ERR(process_queue(eb, TRUE, pool));
+  SVN_ERR(eb->wrapped_editor->close_edit(eb->wrapped_baton, pool));
+
+  /* Close the extra connections. */
+  svn_pool_clear(eb->conn_pool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+abort_edit(void *edit_baton,
+           apr_pool_t *pool)
+{
+  edit_baton_t *eb = edit_baton;
+
+  /* Any outstanding data on the extra connections is of no use anymore. */
+  svn_pool_clear(eb->conn_pool);
+
+  return svn_error_trace(eb->wrapped_editor->abort_edit(eb->wrapped_baton,
+                                                        pool));
+}
+
+svn_error_t *
+svn_ra_svn__get_fetch_editor(const svn_delta_editor_t **editor,
+                             void **edit_baton,
+                             svn_ra_svn__session_baton_t *sess,
+                             const char *fetch_url,
+                             const char *target,
+                             int max_conns,
+                             const svn_delta_editor_t *wrapped_editor,
+                             void *wrapped_baton,
+                             apr_pool_t *pool)
+{
+  svn_delta_editor_t *fetch_editor = svn_delta_default_editor(pool);
+  edit_baton_t *eb = apr_pcalloc(pool, sizeof(*eb));
+
+  eb->wrapped_editor = wrapped_editor;
+  eb->wrapped_baton = wrapped_baton;
+  eb->sess = sess;
+  eb->fetch_url = apr_pstrdup(pool, fetch_url);
+  eb->target = apr_pstrdup(pool, target);
+  eb->revision = SVN_INVALID_REVNUM;
+  eb->conns = apr_array_make(pool, max_conns, sizeof(fetch_conn_t *));
+  eb->max_conns = max_conns;
+  eb->conn_pool = svn_pool_create(pool);
+  eb->pool = pool;
+
+  fetch_editor->set_target_revision = set_target_revision;
+  fetch_editor->open_root = open_root;
+  fetch_editor->delete_entry = delete_entry;
+  fetch_editor->add_directory = add_directory;
+  fetch_editor->open_directory = open_directory;
+  fetch_editor->change_dir_prop = change_dir_prop;
+  fetch_editor->close_directory = close_directory;
+  fetch_editor->absent_directory = absent_directory;
+  fetch_editor->add_file = add_file;
+  fetch_editor->open_file = open_file;
+  fetch_editor->apply_textdelta = apply_textdelta;
+  fetch_editor->change_file_prop = change_file_prop;
+  fetch_editor->close_file = close_file;
+  fetch_editor->absent_file = absent_file;
+  fetch_editor->close_edit = close_edit;
+  fetch_editor->abort_edit = abort_edit;
+
+  *editor = fetch_editor;
+  *edit_baton = eb;
+
+  return SVN_NO_ERROR;
+}
@@ -273,13 +273,18 @@ svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn)
   if (svn_ra_svn_compression_level(conn) <= 0)
     return 0;
 
-  /* Prefer SVNDIFF2 over SVNDIFF1. */
+  /* Prefer SVNDIFF3 over SVNDIFF2 over SVNDIFF1.  We may only use SVNDIFF3
+   * if we can produce it ourselves; the other side only advertises it if
+   * it can read it. */
+  if (svn__zstd_available()
+      && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED))
+    return 3;
   if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED))
     return 2;
   if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF1))
     return 1;
 
-  /* The connection does not support SVNDIFF1/2; default to "version 0". */
+  /* The connection does not support SVNDIFF1/2/3; default to "version 0". */
   return 0;
 }
 
@@ -762,6 +767,98 @@ svn_ra_svn__write_string(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_SENDFILE
+/* Send LEN bytes starting at OFFSET in FILE directly to the socket SOCK
+ * of CONN, bypassing the write buffer.  The latter must be empty.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+sendfile_output(svn_ra_svn_conn_t *conn,
+                apr_pool_t *pool,
+                apr_socket_t *sock,
+                apr_file_t *file,
+                apr_off_t offset,
+                apr_size_t len)
+{
+  apr_pool_t *subpool = NULL;
+
+  /* Same accounting as in writebuf_output. */
+  conn->current_out += len;
+  SVN_ERR(check_io_limits(conn));
+
+  conn->written_since_error_check += len;
+  conn->may_check_for_error
+    = conn->written_since_error_check >= conn->error_check_interval;
+
+  while (len > 0)
+    {
+      apr_size_t count = len;
+      apr_status_t status = apr_socket_sendfile(sock, file, NULL, &offset,
+                                                &count, 0);
+      if (status && !APR_STATUS_IS_EAGAIN(status))
+        return svn_error_wrap_apr(status, _("Can't write to connection"));
+
+      if (count == 0 && conn->block_handler)
+        {
+          if (!subpool)
+            subpool = svn_pool_create(pool);
+          else
+            svn_pool_clear(subpool);
+          SVN_ERR(conn->block_handler(conn, subpool, conn->block_baton));
+        }
+
+      offset += count;
+      len -= count;
+    }
+
+  if (subpool)
+    svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+#endif
+
+svn_error_t *
+svn_ra_svn__write_file_range(svn_ra_svn_conn_t *conn,
+                             apr_pool_t *pool,
+                             apr_file_t *file,
+                             apr_off_t offset,
+                             apr_size_t len)
+{
+#if APR_HAS_SENDFILE
+  apr_socket_t *sock = svn_ra_svn__stream_sock(conn->stream);
+#endif
+
+  SVN_ERR(write_number(conn, pool, len, ':'));
+
+#if APR_HAS_SENDFILE
+  /* Let the kernel copy the data directly from the page cache, if the
+   * connection does not need to process it on the way. */
+  if (sock)
+    {
+      SVN_ERR(writebuf_flush(conn, pool));
+      SVN_ERR(sendfile_output(conn, pool, sock, file, offset, len));
+    }
+  else
+#endif
+    {
+      char buf[SVN__STREAM_CHUNK_SIZE];
+
+      SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+      while (len > 0)
+        {
+          apr_size_t count = MIN(len, sizeof(buf));
+
+          SVN_ERR(svn_io_file_read_full2(file, buf, count, NULL, NULL, pool));
+          SVN_ERR(writebuf_write(conn, pool, buf, count));
+          len -= count;
+        }
+    }
+
+  SVN_ERR(writebuf_writechar(conn, pool, ' '));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__write_cstring(svn_ra_svn_conn_t *conn,
                           apr_pool_t *pool,
@@ -1852,23 +1949,17 @@ svn_ra_svn__handle_failure_status(const svn_ra_svn__list_t *params)
   return err;
 }
 
-svn_error_t *
-svn_ra_svn__read_cmd_response(svn_ra_svn_conn_t *conn,
-                              apr_pool_t *pool,
-                              const char *fmt, ...)
+/* Interpret the command response with the given STATUS and PARAMS
+ * and parse PARAMS according to FMT and AP upon success. */
+static svn_error_t *
+vparse_cmd_response(const char *status,
+                    svn_ra_svn__list_t *params,
+                    const char *fmt,
+                    va_list *ap)
 {
-  va_list ap;
-  const char *status;
-  svn_ra_svn__list_t *params;
-  svn_error_t *err;
-
-  SVN_ERR(svn_ra_svn__read_tuple(conn, pool, "wl", &status, &params));
   if (strcmp(status, "success") == 0)
     {
-      va_start(ap, fmt);
-      err = vparse_tuple(params, &fmt, &ap);
-      va_end(ap);
-      return err;
+      return vparse_tuple(params, &fmt, ap);
     }
   else if (strcmp(status, "failure") == 0)
     {
@@ -1880,6 +1971,45 @@ svn_ra_svn__read_cmd_response(svn_ra_svn_conn_t *conn,
                            status);
 }
 
+svn_error_t *
+svn_ra_svn__read_cmd_response(svn_ra_svn_conn_t *conn,
+                              apr_pool_t *pool,
+                              const char *fmt, ...)
+{
+  va_list ap;
+  const char *status;
+  svn_ra_svn__list_t *params;
+  svn_error_t *err;
+
+  SVN_ERR(svn_ra_svn__read_tuple(conn, pool, "wl", &status, &params));
+  va_start(ap, fmt);
+  err = vparse_cmd_response(status, params, fmt, &ap);
+  va_end(ap);
+
+  return err;
+}
+
+svn_error_t *
+svn_ra_svn__parse_cmd_response(const svn_ra_svn__item_t *item,
+                               const char *fmt, ...)
+{
+  va_list ap;
+  const char *status;
+  svn_ra_svn__list_t *params;
+  svn_error_t *err;
+
+  if (item->kind != SVN_RA_SVN_LIST)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Command response not a list"));
+
+  SVN_ERR(svn_ra_svn__parse_tuple(&item->u.list, "wl", &status, &params));
+  va_start(ap, fmt);
+  err = vparse_cmd_response(status, params, fmt, &ap);
+  va_end(ap);
+
+  return err;
+}
+
 svn_error_t *
 svn_ra_svn__has_command(svn_boolean_t *has_command,
                         svn_boolean_t *terminated,
@@ -2463,7 +2593,8 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
                              svn_boolean_t recurse,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry)
+                             svn_boolean_t ignore_ancestry,
+                             svn_boolean_t send_texts)
 {
   SVN_ERR(writebuf_write_literal(conn, pool, "( update ( "));
   SVN_ERR(write_tuple_start_list(conn, pool));
@@ -2474,6 +2605,7 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
   SVN_ERR(write_tuple_depth(conn, pool, depth));
   SVN_ERR(write_tuple_boolean(conn, pool, send_copyfrom_args));
   SVN_ERR(write_tuple_boolean(conn, pool, ignore_ancestry));
+  SVN_ERR(write_tuple_boolean(conn, pool, send_texts));
   SVN_ERR(writebuf_write_literal(conn, pool, ") ) "));
 
   return SVN_NO_ERROR;
@@ -2488,7 +2620,8 @@ svn_ra_svn__write_cmd_switch(svn_ra_svn_conn_t *conn,
                              const char *switch_url,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry)
+                             svn_boolean_t ignore_ancestry,
+                             svn_boolean_t send_texts)
 {
   SVN_ERR(writebuf_write_literal(conn, pool, "( switch ( "));
   SVN_ERR(write_tuple_start_list(conn, pool));
@@ -2500,6 +2633,7 @@ svn_ra_svn__write_cmd_switch(svn_ra_svn_conn_t *conn,
   SVN_ERR(write_tuple_depth(conn, pool, depth));
   SVN_ERR(write_tuple_boolean(conn, pool, send_copyfrom_args));
   SVN_ERR(write_tuple_boolean(conn, pool, ignore_ancestry));
+  SVN_ERR(write_tuple_boolean(conn, pool, send_texts));
   SVN_ERR(writebuf_write_literal(conn, pool, ") ) "));
 
   return SVN_NO_ERROR;
@@ -235,6 +235,12 @@ svn_error_t *svn_ra_svn__read_command_only(svn_ra_svn_conn_t *conn,
                                            apr_pool_t *pool,
                                            const char **command);
 
+/* Return the socket that STREAM directly reads from and writes to or
+ * NULL, if there is no such socket, e.g. because the data gets piped
+ * or encrypted. */
+apr_socket_t *
+svn_ra_svn__stream_sock(svn_ra_svn__stream_t *stream);
+
 /* Set the timeout for operations on STREAM to INTERVAL. */
 void svn_ra_svn__stream_timeout(svn_ra_svn__stream_t *stream,
                                 apr_interval_time_t interval);
@@ -275,6 +281,49 @@ svn_boolean_t svn_ra_svn__find_mech(const svn_ra_svn__list_t *mechlist,
 /* Initialize the SASL library. */
 svn_error_t *svn_ra_svn__sasl_init(void);
 
+/* Read an auth request from SESS's connection and perform the
+ * authentication it asks for, if any. */
+svn_error_t *
+svn_ra_svn__handle_auth_request(svn_ra_svn__session_baton_t *sess,
+                                apr_pool_t *pool);
+
+/* Open a further connection to URL that uses the same callbacks, config
+ * and authentication as SESS and return it in *FETCH_SESS.  Progress and
+ * cancellation of the new connection get reported through SESS.
+ * Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+svn_ra_svn__open_fetch_session(svn_ra_svn__session_baton_t **fetch_sess,
+                               svn_ra_svn__session_baton_t *sess,
+                               const char *url,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool);
+
+/* Upper limit for the number of extra connections used to fetch file
+ * contents during an update. */
+#define SVN_RA_SVN__MAX_FETCH_CONNECTIONS 8
+
+/* Set *EDITOR and *EDIT_BATON to an editor that forwards all calls to
+ * WRAPPED_EDITOR and WRAPPED_BATON, except that it fetches the contents of
+ * all changed files over up to MAX_CONNS extra connections opened for
+ * SESS.  The edit driver must not send any text deltas itself, i.e. the
+ * server has been asked to leave out the file contents.
+ *
+ * FETCH_URL is the URL that corresponds to TARGET within the edit.
+ * If TARGET is NULL or empty, FETCH_URL is the URL of the edit's anchor.
+ * Allocate the editor and all connections in POOL.
+ */
+svn_error_t *
+svn_ra_svn__get_fetch_editor(const svn_delta_editor_t **editor,
+                             void **edit_baton,
+                             svn_ra_svn__session_baton_t *sess,
+                             const char *fetch_url,
+                             const char *target,
+                             int max_conns,
+                             const svn_delta_editor_t *wrapped_editor,
+                             void *wrapped_baton,
+                             apr_pool_t *pool);
+
 
 #ifdef __cplusplus
 }
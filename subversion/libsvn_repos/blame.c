@@ -0,0 +1,549 @@
+/* blame.c --- server-side line attribution for files
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_diff.h"
+#include "svn_fs.h"
+#include "svn_props.h"
+#include "svn_repos.h"
+#include "repos.h"
+#include "svn_private_config.h"
+
+#include "private/svn_cache.h"
+#include "private/svn_repos_private.h"
+#include "private/svn_string_private.h"
+
+
+
+/* One location in the history of the file being blamed. */
+typedef struct location_t
+{
+  const char *path;
+  svn_revnum_t revision;
+} location_t;
+
+/* Baton for the diff output functions below. */
+typedef struct diff_baton_t
+{
+  /* Blame of the original text. */
+  const apr_array_header_t *old_chunks;
+
+  /* Index of the chunk in OLD_CHUNKS that we looked at last. */
+  int cursor;
+
+  /* Blame of the modified text being built. */
+  apr_array_header_t *new_chunks;
+
+  /* The revision that introduced the modified text. */
+  svn_revnum_t revision;
+} diff_baton_t;
+
+/* Implements svn_cache__serialize_func_t for arrays of
+ * svn_repos__blame_chunk_t. */
+static svn_error_t *
+serialize_chunks(void **data,
+                 apr_size_t *data_len,
+                 void *in,
+                 apr_pool_t *pool)
+{
+  apr_array_header_t *chunks = in;
+
+  *data_len = chunks->nelts * chunks->elt_size;
+  *data = apr_pmemdup(pool, chunks->elts, *data_len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for arrays of
+ * svn_repos__blame_chunk_t. */
+static svn_error_t *
+deserialize_chunks(void **out,
+                   void *data,
+                   apr_size_t data_len,
+                   apr_pool_t *pool)
+{
+  apr_array_header_t *chunks
+    = apr_array_make(pool, 0, sizeof(svn_repos__blame_chunk_t));
+
+  /* DATA has been allocated in POOL and is ours to keep. */
+  chunks->elts = data;
+  chunks->nelts = (int)(data_len / sizeof(svn_repos__blame_chunk_t));
+  chunks->nalloc = chunks->nelts;
+
+  *out = chunks;
+  return SVN_NO_ERROR;
+}
+
+/* Set *CACHE to a blame cache for REPOS, allocated in RESULT_POOL, or to
+ * NULL if there is no global membuffer cache.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+open_cache(svn_cache__t **cache,
+           svn_repos_t *repos,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  const char *uuid, *prefix;
+
+  *cache = NULL;
+  if (! membuffer)
+    return SVN_NO_ERROR;
+
+  /* Node revision IDs are only unique within a repository.  Different
+     repositories may share the same UUID, e.g. after a hotcopy. */
+  SVN_ERR(svn_fs_get_uuid(repos->fs, &uuid, scratch_pool));
+  prefix = apr_pstrcat(scratch_pool, "repos-blame:", uuid, "/", repos->path,
+                       ":", SVN_VA_NULL);
+
+  return svn_error_trace(svn_cache__create_membuffer_cache(
+                           cache, membuffer,
+                           serialize_chunks, deserialize_chunks,
+                           APR_HASH_KEY_STRING, prefix,
+                           SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                           TRUE, FALSE, result_pool, scratch_pool));
+}
+
+/* Return the cache key for the blame of PATH in ROOT, when computed from
+ * FIRST_REV onwards with DIFF_OPTIONS.  Allocate it in POOL. */
+static svn_error_t *
+cache_key(const char **key,
+          svn_fs_root_t *root,
+          const char *path,
+          svn_revnum_t first_rev,
+          const svn_diff_file_options_t *diff_options,
+          apr_pool_t *pool)
+{
+  const svn_fs_id_t *id;
+
+  SVN_ERR(svn_fs_node_id(&id, root, path, pool));
+  *key = apr_psprintf(pool, "%ld:%d:%d:%s", first_rev,
+                      (int)diff_options->ignore_space,
+                      diff_options->ignore_eol_style,
+                      svn_fs_unparse_id(id, pool)->data);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return SVN_ERR_REPOS_BLAME_REFUSED if MAX_TEXT_SIZE is not 0 and
+ * LENGTH exceeds it.  PATH and REVISION are the file being blamed. */
+static svn_error_t *
+check_text_size(svn_filesize_t length,
+                svn_filesize_t max_text_size,
+                const char *path,
+                svn_revnum_t revision)
+{
+  if (max_text_size && length > max_text_size)
+    return svn_error_createf(SVN_ERR_REPOS_BLAME_REFUSED, NULL,
+                             _("'%s' in revision %ld is too large to be "
+                               "blamed on the server"), path, revision);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *TEXT to the contents of PATH in ROOT, allocated in POOL.  Refuse
+ * texts larger than MAX_TEXT_SIZE as check_text_size() does. */
+static svn_error_t *
+read_text(svn_string_t **text,
+          svn_fs_root_t *root,
+          const char *path,
+          svn_filesize_t max_text_size,
+          apr_pool_t *pool)
+{
+  svn_stream_t *stream;
+  svn_filesize_t length;
+  svn_stringbuf_t *buffer;
+
+  SVN_ERR(svn_fs_file_length(&length, root, path, pool));
+  SVN_ERR(check_text_size(length, max_text_size, path,
+                          svn_fs_revision_root_revision(root)));
+  SVN_ERR(svn_fs_file_contents(&stream, root, path, pool));
+  SVN_ERR(svn_stringbuf_from_stream(&buffer, stream, (apr_size_t)length,
+                                    pool));
+  *text = svn_stringbuf__morph_into_string(buffer);
+
+  return SVN_NO_ERROR;
+}
+
+/* Append a chunk starting at line START and attributed to REVISION to
+ * CHUNKS, unless it simply continues the last chunk. */
+static void
+append_chunk(apr_array_header_t *chunks,
+             apr_int64_t start,
+             svn_revnum_t revision)
+{
+  svn_repos__blame_chunk_t *chunk;
+
+  if (chunks->nelts)
+    {
+      chunk = &APR_ARRAY_IDX(chunks, chunks->nelts - 1,
+                             svn_repos__blame_chunk_t);
+      if (chunk->revision == revision)
+        return;
+    }
+
+  chunk = apr_array_push(chunks);
+  chunk->start = start;
+  chunk->revision = revision;
+}
+
+/* Implements svn_diff_output_fns_t.output_common.  Copy the blame of the
+ * unchanged lines over to the modified text. */
+static svn_error_t *
+output_common(void *baton,
+              apr_off_t original_start,
+              apr_off_t original_length,
+              apr_off_t modified_start,
+              apr_off_t modified_length,
+              apr_off_t latest_start,
+              apr_off_t latest_length)
+{
+  diff_baton_t *db = baton;
+  const apr_array_header_t *old_chunks = db->old_chunks;
+  apr_int64_t line = original_start;
+  apr_int64_t end = original_start + original_length;
+
+  while (line < end && db->cursor < old_chunks->nelts)
+    {
+      const svn_repos__blame_chunk_t *chunk
+        = &APR_ARRAY_IDX(old_chunks, db->cursor, svn_repos__blame_chunk_t);
+      apr_int64_t chunk_end = db->cursor + 1 < old_chunks->nelts
+                            ? APR_ARRAY_IDX(old_chunks, db->cursor + 1,
+                                            svn_repos__blame_chunk_t).start
+                            : end;
+
+      /* The common ranges come in ascending order.  So, skip all chunks
+         that end before this range. */
+      if (chunk_end <= line)
+        {
+          db->cursor++;
+          continue;
+        }
+
+      append_chunk(db->new_chunks, modified_start + (line - original_start),
+                   chunk->revision);
+      line = MIN(chunk_end, end);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_diff_output_fns_t.output_diff_modified.  Attribute the
+ * modified lines to the current revision. */
+static svn_error_t *
+output_diff_modified(void *baton,
+                     apr_off_t original_start,
+                     apr_off_t original_length,
+                     apr_off_t modified_start,
+                     apr_off_t modified_length,
+                     apr_off_t latest_start,
+                     apr_off_t latest_length)
+{
+  diff_baton_t *db = baton;
+
+  if (modified_length)
+    append_chunk(db->new_chunks, modified_start, db->revision);
+
+  return SVN_NO_ERROR;
+}
+
+static const svn_diff_output_fns_t output_fns = {
+        output_common,
+        output_diff_modified
+};
+
+/* Set *NEW_CHUNKS to the blame of MODIFIED, given the blame OLD_CHUNKS
+ * of ORIGINAL and attributing all changes to REVISION.  Allocate the
+ * result in RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+update_blame(apr_array_header_t **new_chunks,
+             const apr_array_header_t *old_chunks,
+             const svn_string_t *original,
+             const svn_string_t *modified,
+             svn_revnum_t revision,
+             const svn_diff_file_options_t *diff_options,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  svn_diff_t *diff;
+  diff_baton_t db;
+
+  db.old_chunks = old_chunks;
+  db.cursor = 0;
+  db.new_chunks = apr_array_make(result_pool, old_chunks->nelts + 1,
+                                 sizeof(svn_repos__blame_chunk_t));
+  db.revision = revision;
+
+  SVN_ERR(svn_diff_mem_string_diff(&diff, original, modified, diff_options,
+                                   scratch_pool));
+  SVN_ERR(svn_diff_output2(diff, &db, &output_fns,
+                           cancel_func, cancel_baton));
+
+  *new_chunks = db.new_chunks;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__get_blame(apr_array_header_t **chunks,
+                     svn_repos_t *repos,
+                     const char *path,
+                     svn_revnum_t start,
+                     svn_revnum_t end,
+                     const svn_diff_file_options_t *diff_options,
+                     svn_filesize_t max_text_size,
+                     svn_repos_authz_func_t authz_read_func,
+                     void *authz_read_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = repos->fs;
+  svn_revnum_t first_rev;
+  svn_fs_root_t *root, *prev_root;
+  svn_fs_history_t *history;
+  svn_node_kind_t kind;
+  svn_string_t *mime_type;
+  svn_filesize_t length;
+  svn_cache__t *cache;
+  apr_array_header_t *locations, *blame = NULL;
+  const char *key = NULL, *top_key = NULL;
+  const location_t *location;
+  svn_string_t *text;
+  int i, base = -1;
+  svn_boolean_t truncated = FALSE;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *last_pool = svn_pool_create(scratch_pool);
+  apr_pool_t *cur_pool, *next_pool;
+
+  if (! SVN_IS_VALID_REVNUM(end))
+    SVN_ERR(svn_fs_youngest_rev(&end, fs, scratch_pool));
+  if (! SVN_IS_VALID_REVNUM(start))
+    start = end;
+  if (start > end)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Reverse blame is not supported"));
+
+  /* Like the client, look at the last change before START as well such
+     that we know what actually changed in START. */
+  first_rev = MAX(0, start - 1);
+
+  /* The path had better be a file in this revision. */
+  SVN_ERR(svn_fs_revision_root(&root, fs, end, scratch_pool));
+  SVN_ERR(svn_fs_check_path(&kind, root, path, scratch_pool));
+  if (kind != svn_node_file)
+    return svn_error_createf
+      (SVN_ERR_FS_NOT_FILE, NULL, _("'%s' is not a file in revision %ld"),
+       path, end);
+
+  /* Like the client, don't diff binary files.  Also, don't let a single
+     request tie up the server with huge texts.  The client may still do
+     either on its own. */
+  SVN_ERR(svn_fs_node_prop(&mime_type, root, path, SVN_PROP_MIME_TYPE,
+                           scratch_pool));
+  if (mime_type && svn_mime_type_is_binary(mime_type->data))
+    return svn_error_createf(SVN_ERR_REPOS_BLAME_REFUSED, NULL,
+                             _("'%s' in revision %ld is a binary file"),
+                             path, end);
+
+  SVN_ERR(svn_fs_file_length(&length, root, path, scratch_pool));
+  SVN_ERR(check_text_size(length, max_text_size, path, end));
+
+  SVN_ERR(open_cache(&cache, repos, scratch_pool, scratch_pool));
+
+  /* Collect the interesting locations from the youngest down to the
+     youngest one we already know the blame of.  Authz restrictions,
+     however, require us to look at the whole range because a cached
+     blame might have been produced with another user's permissions. */
+  locations = apr_array_make(scratch_pool, 16, sizeof(location_t));
+  SVN_ERR(svn_fs_node_history2(&history, root, path, scratch_pool,
+                               scratch_pool));
+  while (1)
+    {
+      location_t *new_location;
+      const char *tmp_path;
+      svn_revnum_t tmp_revnum;
+      svn_fs_root_t *tmp_root;
+      apr_pool_t *tmp_pool;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(svn_fs_history_prev2(&history, history, TRUE, iterpool,
+                                   iterpool));
+      if (! history)
+        break;
+      SVN_ERR(svn_fs_history_location(&tmp_path, &tmp_revnum,
+                                      history, iterpool));
+      SVN_ERR(svn_fs_revision_root(&tmp_root, fs, tmp_revnum, iterpool));
+
+      if (authz_read_func)
+        {
+          svn_boolean_t readable;
+
+          SVN_ERR(authz_read_func(&readable, tmp_root, tmp_path,
+                                  authz_read_baton, iterpool));
+          if (! readable)
+            {
+              truncated = TRUE;
+              break;
+            }
+        }
+
+      new_location = apr_array_push(locations);
+      new_location->path = apr_pstrdup(scratch_pool, tmp_path);
+      new_location->revision = tmp_revnum;
+
+      if (cache && base < 0)
+        {
+          svn_boolean_t found;
+
+          SVN_ERR(cache_key(&key, tmp_root, tmp_path, first_rev,
+                            diff_options, scratch_pool));
+          if (! top_key)
+            top_key = key;
+
+          SVN_ERR(svn_cache__get((void **)&blame, &found, cache, key,
+                                 scratch_pool));
+          if (found)
+            {
+              base = locations->nelts - 1;
+              if (! authz_read_func)
+                break;
+            }
+        }
+
+      if (tmp_revnum <= first_rev)
+        break;
+
+      /* We need the HISTORY object to survive the next iteration. */
+      tmp_pool = iterpool;
+      iterpool = last_pool;
+      last_pool = tmp_pool;
+    }
+
+  /* Blaming unreadable history would disclose information. */
+  SVN_ERR_ASSERT(locations->nelts > 0 || truncated);
+  if (locations->nelts == 0)
+    return svn_error_createf(SVN_ERR_AUTHZ_UNREADABLE, NULL,
+                             _("Unreadable path encountered; access denied"));
+
+  /* Don't use what may have been produced with other permissions. */
+  if (truncated)
+    {
+      base = -1;
+      cache = NULL;
+    }
+
+  /* Start with either the cached blame or the oldest location, which gets
+     all the lines.  Lines older than START are not to be attributed. */
+  if (base < 0)
+    {
+      base = locations->nelts - 1;
+      location = &APR_ARRAY_IDX(locations, base, location_t);
+
+      blame = apr_array_make(scratch_pool, 1,
+                             sizeof(svn_repos__blame_chunk_t));
+      append_chunk(blame, 0, location->revision >= start
+                               ? location->revision
+                               : SVN_INVALID_REVNUM);
+    }
+  else
+    {
+      location = &APR_ARRAY_IDX(locations, base, location_t);
+    }
+
+  /* From here on, we need four pools: The text and blame of the latest
+     change live in CUR_POOL while NEXT_POOL receives those of the next
+     change.  The same scheme applies to the revision roots. */
+  svn_pool_clear(iterpool);
+  svn_pool_clear(last_pool);
+  cur_pool = svn_pool_create(scratch_pool);
+  next_pool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_fs_revision_root(&prev_root, fs, location->revision,
+                               last_pool));
+  SVN_ERR(read_text(&text, prev_root, location->path, max_text_size,
+                    cur_pool));
+
+  /* Apply the younger changes. */
+  for (i = base - 1; i >= 0; --i)
+    {
+      const location_t *prev_location = location;
+      svn_boolean_t changed;
+      apr_pool_t *tmp_pool;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      location = &APR_ARRAY_IDX(locations, i, location_t);
+      SVN_ERR(svn_fs_revision_root(&root, fs, location->revision, iterpool));
+      SVN_ERR(svn_fs_contents_different(&changed, prev_root,
+                                        prev_location->path, root,
+                                        location->path, iterpool));
+      if (changed)
+        {
+          svn_string_t *new_text;
+          apr_array_header_t *new_blame;
+
+          svn_pool_clear(next_pool);
+          SVN_ERR(read_text(&new_text, root, location->path, max_text_size,
+                            next_pool));
+          SVN_ERR(update_blame(&new_blame, blame, text, new_text,
+                               location->revision, diff_options,
+                               cancel_func, cancel_baton,
+                               next_pool, iterpool));
+
+          text = new_text;
+          blame = new_blame;
+          tmp_pool = cur_pool;
+          cur_pool = next_pool;
+          next_pool = tmp_pool;
+        }
+
+      /* ROOT must survive the next iteration. */
+      prev_root = root;
+      tmp_pool = iterpool;
+      iterpool = last_pool;
+      last_pool = tmp_pool;
+    }
+
+  /* Remember the result for the next time. */
+  if (cache && base > 0)
+    SVN_ERR(svn_cache__set(cache, top_key, blame, scratch_pool));
+
+  *chunks = apr_array_copy(result_pool, blame);
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(last_pool);
+  svn_pool_destroy(cur_pool);
+  svn_pool_destroy(next_pool);
+
+  return SVN_NO_ERROR;
+}
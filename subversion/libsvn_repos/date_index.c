@@ -0,0 +1,341 @@
+/* date_index.c --- maintain and query the revision date index
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* The date index is a flat file in the repository's db directory.  It
+ * starts with a fixed magic string, followed by one big-endian 64 bit
+ * apr_time_t per revision, starting at revision 0.  Revisions without a
+ * valid svn:date are recorded as 0.
+ *
+ * The index is only ever used as a hint.  Callers must verify any result
+ * against the actual revision properties because the index may lag behind
+ * or be out of date after revprop changes that bypassed libsvn_repos.
+ */
+
+#include <string.h>
+
+#include <apr_mmap.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_fs.h"
+#include "svn_props.h"
+#include "svn_time.h"
+#include "svn_repos.h"
+#include "repos.h"
+#include "svn_private_config.h"
+
+
+
+/* Name of the index file within the db directory. */
+#define DATE_INDEX_FILE "rev-dates"
+
+/* Magic string at the start of the index file. */
+#define DATE_INDEX_MAGIC "SVNRDX1\n"
+#define DATE_INDEX_MAGIC_LEN (sizeof(DATE_INDEX_MAGIC) - 1)
+
+/* Size of a single index entry. */
+#define DATE_INDEX_ENTRY_SIZE 8
+
+/* Do not let a commit add more than this many missing entries to the
+ * index.  Larger gaps need an explicit rebuild. */
+#define DATE_INDEX_MAX_CATCHUP 1000
+
+/* Return the path of the date index file in REPOS, allocated in POOL. */
+static const char *
+date_index_path(svn_repos_t *repos,
+                apr_pool_t *pool)
+{
+  return svn_dirent_join(repos->db_path, DATE_INDEX_FILE, pool);
+}
+
+/* Return the file offset of the entry for REVISION. */
+static apr_off_t
+entry_offset(svn_revnum_t revision)
+{
+  return DATE_INDEX_MAGIC_LEN + (apr_off_t)revision * DATE_INDEX_ENTRY_SIZE;
+}
+
+/* Write TM as big-endian 64 bit value to BUFFER. */
+static void
+encode_entry(unsigned char *buffer,
+             apr_time_t tm)
+{
+  apr_uint64_t value = (apr_uint64_t)tm;
+  int i;
+
+  for (i = DATE_INDEX_ENTRY_SIZE - 1; i >= 0; --i)
+    {
+      buffer[i] = (unsigned char)(value & 0xff);
+      value >>= 8;
+    }
+}
+
+/* Return the time stored as big-endian 64 bit value in BUFFER. */
+static apr_time_t
+decode_entry(const unsigned char *buffer)
+{
+  apr_uint64_t value = 0;
+  int i;
+
+  for (i = 0; i < DATE_INDEX_ENTRY_SIZE; ++i)
+    value = (value << 8) | buffer[i];
+
+  return (apr_time_t)value;
+}
+
+/* Set *TM to the svn:date of REVISION in FS or to 0, if it has no valid
+ * date.  Use POOL for temporary allocations. */
+static svn_error_t *
+read_rev_date(apr_time_t *tm,
+              svn_fs_t *fs,
+              svn_revnum_t revision,
+              apr_pool_t *pool)
+{
+  svn_string_t *date_str;
+  svn_error_t *err;
+
+  SVN_ERR(svn_fs_revision_prop2(&date_str, fs, revision,
+                                SVN_PROP_REVISION_DATE, FALSE, pool, pool));
+
+  *tm = 0;
+  if (date_str)
+    {
+      err = svn_time_from_cstring(tm, date_str->data, pool);
+      if (err)
+        {
+          svn_error_clear(err);
+          *tm = 0;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *COUNT to the number of complete entries in the index FILE.
+ * Return SVN_ERR_MALFORMED_FILE if FILE is not a date index.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+read_entry_count(svn_revnum_t *count,
+                 apr_file_t *file,
+                 const char *path,
+                 apr_pool_t *pool)
+{
+  apr_finfo_t finfo;
+  char magic[DATE_INDEX_MAGIC_LEN];
+  apr_off_t offset = 0;
+  svn_boolean_t eof;
+  apr_size_t len = 0;
+
+  SVN_ERR(svn_io_file_info_get(&finfo, APR_FINFO_SIZE, file, pool));
+  if (finfo.size >= DATE_INDEX_MAGIC_LEN)
+    {
+      SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+      SVN_ERR(svn_io_file_read_full2(file, magic, sizeof(magic), &len, &eof,
+                                     pool));
+    }
+
+  if (   finfo.size < DATE_INDEX_MAGIC_LEN
+      || len != sizeof(magic)
+      || memcmp(magic, DATE_INDEX_MAGIC, sizeof(magic)))
+    return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                             _("'%s' is not a valid revision date index"),
+                             svn_dirent_local_style(path, pool));
+
+  *count = (svn_revnum_t)((finfo.size - DATE_INDEX_MAGIC_LEN)
+                          / DATE_INDEX_ENTRY_SIZE);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__date_index_update(svn_repos_t *repos,
+                             svn_revnum_t revision,
+                             apr_pool_t *scratch_pool)
+{
+  const char *path = date_index_path(repos, scratch_pool);
+  apr_file_t *file;
+  svn_revnum_t count, first, rev;
+  unsigned char *buffer;
+  apr_off_t offset;
+  svn_error_t *err;
+
+  /* Only maintain the index if it has been created. */
+  err = svn_io_file_open(&file, path, APR_READ | APR_WRITE | APR_BINARY,
+                         APR_OS_DEFAULT, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  /* Serialize writers from different processes.  Writers within the
+   * same process may still race but they would write the same data. */
+  SVN_ERR(svn_io_lock_open_file(file, TRUE, FALSE, scratch_pool));
+  SVN_ERR(read_entry_count(&count, file, path, scratch_pool));
+
+  /* Fill any gap before REVISION but give up if it is too large. */
+  first = MIN(revision, count);
+  if (revision - first >= DATE_INDEX_MAX_CATCHUP)
+    return svn_error_trace(svn_io_file_close(file, scratch_pool));
+
+  SVN_ERR(svn_fs_refresh_revision_props(repos->fs, scratch_pool));
+  buffer = apr_palloc(scratch_pool,
+                      (revision - first + 1) * DATE_INDEX_ENTRY_SIZE);
+  for (rev = first; rev <= revision; ++rev)
+    {
+      apr_time_t tm;
+
+      SVN_ERR(read_rev_date(&tm, repos->fs, rev, scratch_pool));
+      encode_entry(buffer + (rev - first) * DATE_INDEX_ENTRY_SIZE, tm);
+    }
+
+  offset = entry_offset(first);
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, buffer,
+                                 (revision - first + 1)
+                                   * DATE_INDEX_ENTRY_SIZE,
+                                 NULL, scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+svn_error_t *
+svn_repos__date_index_rebuild(svn_repos_t *repos,
+                              svn_cancel_func_t cancel_func,
+                              void *cancel_baton,
+                              apr_pool_t *scratch_pool)
+{
+  svn_revnum_t youngest, rev;
+  unsigned char *buffer;
+  apr_size_t size;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, repos->fs, scratch_pool));
+  SVN_ERR(svn_fs_refresh_revision_props(repos->fs, scratch_pool));
+
+  size = (apr_size_t)entry_offset(youngest + 1);
+  buffer = apr_palloc(scratch_pool, size);
+  memcpy(buffer, DATE_INDEX_MAGIC, DATE_INDEX_MAGIC_LEN);
+
+  for (rev = 0; rev <= youngest; ++rev)
+    {
+      apr_time_t tm;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(read_rev_date(&tm, repos->fs, rev, iterpool));
+      encode_entry(buffer + entry_offset(rev), tm);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Replace any existing index atomically. */
+  return svn_error_trace(svn_io_write_atomic2(
+                           date_index_path(repos, scratch_pool),
+                           buffer, size,
+                           svn_dirent_join(repos->db_path, "fs-type",
+                                           scratch_pool),
+                           FALSE, scratch_pool));
+}
+
+svn_error_t *
+svn_repos__date_index_lookup(svn_revnum_t *revision,
+                             svn_revnum_t *last_indexed,
+                             svn_repos_t *repos,
+                             svn_revnum_t youngest,
+                             apr_time_t tm,
+                             apr_pool_t *scratch_pool)
+{
+  const char *path = date_index_path(repos, scratch_pool);
+  apr_file_t *file;
+  svn_revnum_t count, low, high;
+  const unsigned char *data = NULL;
+  svn_error_t *err;
+
+  *revision = SVN_INVALID_REVNUM;
+  *last_indexed = SVN_INVALID_REVNUM;
+
+  err = svn_io_file_open(&file, path, APR_READ | APR_BINARY,
+                         APR_OS_DEFAULT, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(read_entry_count(&count, file, path, scratch_pool));
+  count = MIN(count, youngest + 1);
+  if (count == 0)
+    return svn_error_trace(svn_io_file_close(file, scratch_pool));
+
+#if APR_HAS_MMAP
+  {
+    apr_mmap_t *mm;
+
+    /* Map the whole index such that the search below won't need any
+     * further I/O.  Simply fall back to reading if that fails. */
+    if (apr_mmap_create(&mm, file, 0, (apr_size_t)entry_offset(count),
+                        APR_MMAP_READ, scratch_pool) == APR_SUCCESS)
+      data = (const unsigned char *)mm->mm + DATE_INDEX_MAGIC_LEN;
+  }
+#endif /* APR_HAS_MMAP */
+
+  /* Find the last revision in the index that is not younger than TM.
+   * Like svn_repos_dated_revision, default to 0. */
+  low = 0;
+  high = count - 1;
+  while (low < high)
+    {
+      svn_revnum_t mid = low + (high - low + 1) / 2;
+      apr_time_t mid_time;
+
+      if (data)
+        {
+          mid_time = decode_entry(data + mid * DATE_INDEX_ENTRY_SIZE);
+        }
+      else
+        {
+          unsigned char buffer[DATE_INDEX_ENTRY_SIZE];
+          apr_off_t offset = entry_offset(mid);
+
+          SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+          SVN_ERR(svn_io_file_read_full2(file, buffer, sizeof(buffer),
+                                         NULL, NULL, scratch_pool));
+          mid_time = decode_entry(buffer);
+        }
+
+      if (mid_time <= tm)
+        low = mid;
+      else
+        high = mid - 1;
+    }
+
+  *revision = low;
+  *last_indexed = count - 1;
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
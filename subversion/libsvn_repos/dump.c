@@ -44,6 +44,8 @@
 #include "private/svn_sorts_private.h"
 #include "private/svn_utf_private.h"
 #include "private/svn_cache.h"
+#include "private/svn_task.h"
+#include "private/svn_mutex.h"
 
 #define ARE_VALID_COPY_ARGS(p,r) ((p) && SVN_IS_VALID_REVNUM(r))
 
@@ -2440,8 +2442,11 @@ report_error(svn_revnum_t revision,
     }
 }
 
-svn_error_t *
-svn_repos_verify_fs3(svn_repos_t *repos,
+/* Implement svn_repos_verify_fs4 for a single job with the revision
+ * range START_REV to END_REV already validated.  All other parameters
+ * are the same as for svn_repos_verify_fs4. */
+static svn_error_t *
+verify_fs_sequential(svn_fs_t *fs,
                      svn_revnum_t start_rev,
                      svn_revnum_t end_rev,
                      svn_boolean_t check_normalization,
@@ -2454,8 +2459,6 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                      void *cancel_baton,
                      apr_pool_t *pool)
 {
-  svn_fs_t *fs = svn_repos_fs(repos);
-  svn_revnum_t youngest;
   svn_revnum_t rev;
   apr_pool_t *iterpool = svn_pool_create(pool);
   svn_repos_notify_t *notify;
@@ -2463,31 +2466,6 @@ svn_repos_verify_fs3(svn_repos_t *repos,
   struct verify_fs_notify_func_baton_t *verify_notify_baton = NULL;
   svn_error_t *err;
 
-  /* Make sure we catch up on the latest revprop changes.  This is the only
-   * time we will refresh the revprop data in this query. */
-  SVN_ERR(svn_fs_refresh_revision_props(fs, pool));
-
-  /* Determine the current youngest revision of the filesystem. */
-  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
-
-  /* Use default vals if necessary. */
-  if (! SVN_IS_VALID_REVNUM(start_rev))
-    start_rev = 0;
-  if (! SVN_IS_VALID_REVNUM(end_rev))
-    end_rev = youngest;
-
-  /* Validate the revisions. */
-  if (start_rev > end_rev)
-    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
-                             _("Start revision %ld"
-                               " is greater than end revision %ld"),
-                             start_rev, end_rev);
-  if (end_rev > youngest)
-    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
-                             _("End revision %ld is invalid "
-                               "(youngest revision is %ld)"),
-                             end_rev, youngest);
-
   /* Create a notify object that we can reuse within the loop and a
      forwarding structure for notifications from inside svn_fs_verify(). */
   if (notify_func)
@@ -2546,6 +2524,474 @@ svn_repos_verify_fs3(svn_repos_t *repos,
           }
       }
 
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Shard size to assume for parallel verification if the backend does not
+ * report one. */
+#define VERIFY_DEFAULT_SHARD_SIZE 1000
+
+/* Number of revisions to verify per task in parallel mode.  Every task
+ * opens its own file system instance, so don't make this too small. */
+#define VERIFY_REVISIONS_PER_TASK 16
+
+/* Outcome of the verification of a single revision or, for metadata
+ * checks, of a revision range. */
+typedef struct verify_result_t
+{
+  /* The revision verified or SVN_INVALID_REVNUM for metadata checks. */
+  svn_revnum_t revision;
+
+  /* Notifications issued during the verification, in order.
+   * Array of svn_repos_notify_t *. */
+  apr_array_header_t *notifications;
+
+  /* Verification failure or SVN_NO_ERROR. */
+  svn_error_t *err;
+} verify_result_t;
+
+/* A task in parallel verification mode. */
+typedef struct verify_task_t
+{
+  /* Open the file system at FS_PATH with FS_CONFIG. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+
+  /* Revision range to verify in this task. */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+
+  /* If set, verify the backend-specific metadata for the range instead
+   * of the revision contents. */
+  svn_boolean_t metadata;
+
+  /* Parameters as passed to verify_one_revision. */
+  svn_revnum_t first_rev;
+  svn_boolean_t check_normalization;
+
+  /* Whether to record notifications. */
+  svn_boolean_t notify;
+
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} verify_task_t;
+
+/* Baton for serialized_cancel_func. */
+typedef struct serialized_cancel_baton_t
+{
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+  svn_mutex__t *mutex;
+} serialized_cancel_baton_t;
+
+/* Implements svn_cancel_func_t.  Call the cancellation function in the
+ * serialized_cancel_baton_t given as BATON such that callers don't have
+ * to expect concurrent invocations. */
+static svn_error_t *
+serialized_cancel_func(void *baton)
+{
+  serialized_cancel_baton_t *b = baton;
+  SVN_MUTEX__WITH_LOCK(b->mutex, b->cancel_func(b->cancel_baton));
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for the output function of the verification task queue. */
+typedef struct verify_output_baton_t
+{
+  svn_repos_notify_func_t notify_func;
+  void *notify_baton;
+  svn_repos_verify_callback_t verify_callback;
+  void *verify_baton;
+} verify_output_baton_t;
+
+/* Implements svn_repos_notify_func_t.  Append a copy of NOTIFY to the
+ * verify_result_t given as BATON. */
+static void
+record_notification(void *baton,
+                    const svn_repos_notify_t *notify,
+                    apr_pool_t *scratch_pool)
+{
+  verify_result_t *result = baton;
+  apr_pool_t *pool = result->notifications->pool;
+  svn_repos_notify_t *copy = apr_pmemdup(pool, notify, sizeof(*notify));
+
+  copy->warning_str = apr_pstrdup(pool, notify->warning_str);
+  copy->path = apr_pstrdup(pool, notify->path);
+
+  APR_ARRAY_PUSH(result->notifications, svn_repos_notify_t *) = copy;
+}
+
+/* Implements svn_fs_warning_callback_t.  Verification reports all
+ * problems as errors. */
+static void
+ignore_fs_warning(void *baton,
+                  svn_error_t *err)
+{
+}
+
+/* Return a new verify_result_t for REVISION, allocated in RESULT_POOL,
+ * and append it to RESULTS. */
+static verify_result_t *
+add_verify_result(apr_array_header_t *results,
+                  svn_revnum_t revision,
+                  apr_pool_t *result_pool)
+{
+  verify_result_t *result = apr_pcalloc(result_pool, sizeof(*result));
+  result->revision = revision;
+  result->notifications = apr_array_make(result_pool, 0,
+                                         sizeof(svn_repos_notify_t *));
+
+  APR_ARRAY_PUSH(results, verify_result_t *) = result;
+  return result;
+}
+
+/* Implements svn_task__process_func_t.  Run the verify_task_t given as
+ * BATON and return an array of verify_result_t * in *RESULT. */
+static svn_error_t *
+verify_task_process(void **result,
+                    void *baton,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  verify_task_t *task = baton;
+  apr_array_header_t *results
+    = apr_array_make(result_pool, 1, sizeof(verify_result_t *));
+
+  if (task->metadata)
+    {
+      verify_result_t *rev_result
+        = add_verify_result(results, SVN_INVALID_REVNUM, result_pool);
+      struct verify_fs_notify_func_baton_t notify_baton;
+
+      notify_baton.notify_func = record_notification;
+      notify_baton.notify_baton = rev_result;
+      notify_baton.notify
+        = svn_repos_notify_create(svn_repos_notify_verify_rev_structure,
+                                  scratch_pool);
+
+      rev_result->err = svn_fs_verify(task->fs_path, task->fs_config,
+                                      task->start_rev, task->end_rev,
+                                      task->notify ? verify_fs_notify_func
+                                                   : NULL,
+                                      &notify_baton,
+                                      task->cancel_func, task->cancel_baton,
+                                      scratch_pool);
+    }
+  else
+    {
+      svn_fs_t *fs;
+      svn_revnum_t rev;
+      apr_pool_t *iterpool;
+      svn_error_t *err = svn_fs_open2(&fs, task->fs_path, task->fs_config,
+                                      scratch_pool, scratch_pool);
+
+      /* Report the failure like any other verification failure such
+       * that it does not abort the whole run in keep-going mode. */
+      if (err)
+        {
+          verify_result_t *rev_result
+            = add_verify_result(results, task->start_rev, result_pool);
+          rev_result->err
+            = svn_error_quick_wrapf(err,
+                                    _("Can't open the repository to verify "
+                                      "revisions %ld to %ld"),
+                                    task->start_rev, task->end_rev);
+
+          *result = results;
+          return SVN_NO_ERROR;
+        }
+
+      iterpool = svn_pool_create(scratch_pool);
+      svn_fs_set_warning_func(fs, ignore_fs_warning, NULL);
+
+      for (rev = task->start_rev; rev <= task->end_rev; ++rev)
+        {
+          verify_result_t *rev_result
+            = add_verify_result(results, rev, result_pool);
+
+          svn_pool_clear(iterpool);
+          rev_result->err = verify_one_revision(fs, rev,
+                                                task->notify
+                                                  ? record_notification
+                                                  : NULL,
+                                                rev_result,
+                                                task->first_rev,
+                                                task->check_normalization,
+                                                task->cancel_func,
+                                                task->cancel_baton,
+                                                iterpool);
+
+          /* No point in continuing. */
+          if (   rev_result->err
+              && rev_result->err->apr_err == SVN_ERR_CANCELLED)
+            break;
+        }
+
+      svn_pool_destroy(iterpool);
+    }
+
+  *result = results;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Report the array of
+ * verify_result_t * given as RESULT to the callbacks in the
+ * verify_output_baton_t given as BATON. */
+static svn_error_t *
+verify_task_output(void *result,
+                   void *baton,
+                   apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *results = result;
+  verify_output_baton_t *output = baton;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i, k;
+
+  for (i = 0; i < results->nelts; ++i)
+    {
+      verify_result_t *rev_result = APR_ARRAY_IDX(results, i,
+                                                  verify_result_t *);
+
+      /* Once we are about to bail out, just clean up. */
+      if (err)
+        {
+          svn_error_clear(rev_result->err);
+          continue;
+        }
+
+      if (output->notify_func)
+        for (k = 0; k < rev_result->notifications->nelts; ++k)
+          output->notify_func(output->notify_baton,
+                              APR_ARRAY_IDX(rev_result->notifications, k,
+                                            svn_repos_notify_t *),
+                              scratch_pool);
+
+      if (rev_result->err && rev_result->err->apr_err == SVN_ERR_CANCELLED)
+        {
+          err = rev_result->err;
+        }
+      else if (rev_result->err)
+        {
+          err = report_error(rev_result->revision, rev_result->err,
+                             output->verify_callback, output->verify_baton,
+                             scratch_pool);
+        }
+      else if (   output->notify_func
+               && SVN_IS_VALID_REVNUM(rev_result->revision))
+        {
+          /* Tell the caller that we're done with this revision. */
+          svn_repos_notify_t *notify
+            = svn_repos_notify_create(svn_repos_notify_verify_rev_end,
+                                      scratch_pool);
+          notify->revision = rev_result->revision;
+          output->notify_func(output->notify_baton, notify, scratch_pool);
+        }
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Add a verify_task_t for the range START_REV to END_REV to QUEUE.
+ * METADATA selects the kind of verification.  The other parameters are
+ * the same as for svn_repos_verify_fs4. */
+static svn_error_t *
+add_verify_task(svn_task__queue_t *queue,
+                svn_fs_t *fs,
+                svn_revnum_t start_rev,
+                svn_revnum_t end_rev,
+                svn_boolean_t metadata,
+                svn_revnum_t first_rev,
+                svn_boolean_t check_normalization,
+                svn_boolean_t notify,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton)
+{
+  apr_pool_t *task_pool = svn_task__queue_task_pool(queue);
+  verify_task_t *task = apr_pcalloc(task_pool, sizeof(*task));
+
+  /* Give every task its own copy such that no data is shared. */
+  task->fs_path = svn_fs_path(fs, task_pool);
+  task->fs_config = svn_fs_config(fs, task_pool);
+  task->start_rev = start_rev;
+  task->end_rev = end_rev;
+  task->metadata = metadata;
+  task->first_rev = first_rev;
+  task->check_normalization = check_normalization;
+  task->notify = notify;
+  task->cancel_func = cancel_func;
+  task->cancel_baton = cancel_baton;
+
+  return svn_error_trace(svn_task__queue_add(queue, task, task_pool));
+}
+
+/* Implement svn_repos_verify_fs4 for JOBS > 1 with the revision range
+ * START_REV to END_REV already validated.  Verify the metadata one
+ * shard per task, then the revision contents in blocks of
+ * VERIFY_REVISIONS_PER_TASK.  All other parameters are the same as for
+ * svn_repos_verify_fs4. */
+static svn_error_t *
+verify_fs_parallel(svn_fs_t *fs,
+                   svn_revnum_t start_rev,
+                   svn_revnum_t end_rev,
+                   svn_boolean_t check_normalization,
+                   svn_boolean_t metadata_only,
+                   int jobs,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_repos_verify_callback_t verify_callback,
+                   void *verify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *scratch_pool)
+{
+  svn_task__queue_t *queue;
+  verify_output_baton_t output;
+  serialized_cancel_baton_t cancel;
+  const svn_fs_info_placeholder_t *info;
+  svn_revnum_t shard_size = VERIFY_DEFAULT_SHARD_SIZE;
+  svn_revnum_t rev, next_rev;
+
+  /* Metadata checks are most efficient for whole shards.  BDB does not
+     support concurrent access from within the same process very well,
+     so verify it sequentially. */
+  SVN_ERR(svn_fs_info(&info, fs, scratch_pool, scratch_pool));
+  if (strcmp(info->fs_type, SVN_FS_TYPE_BDB) == 0)
+    return svn_error_trace(verify_fs_sequential(fs, start_rev, end_rev,
+                                                check_normalization,
+                                                metadata_only,
+                                                notify_func, notify_baton,
+                                                verify_callback,
+                                                verify_baton,
+                                                cancel_func, cancel_baton,
+                                                scratch_pool));
+  else if (strcmp(info->fs_type, SVN_FS_TYPE_FSFS) == 0)
+    {
+      const svn_fs_fsfs_info_t *fsfs_info = (const void *)info;
+      if (fsfs_info->shard_size > 0)
+        shard_size = fsfs_info->shard_size;
+    }
+  else if (strcmp(info->fs_type, SVN_FS_TYPE_FSX) == 0)
+    {
+      const svn_fs_fsx_info_t *fsx_info = (const void *)info;
+      if (fsx_info->shard_size > 0)
+        shard_size = fsx_info->shard_size;
+    }
+
+  output.notify_func = notify_func;
+  output.notify_baton = notify_baton;
+  output.verify_callback = verify_callback;
+  output.verify_baton = verify_baton;
+
+  /* All tasks poll for cancellation but the caller's function needs not
+   * be thread-safe. */
+  if (cancel_func)
+    {
+      cancel.cancel_func = cancel_func;
+      cancel.cancel_baton = cancel_baton;
+      SVN_ERR(svn_mutex__init(&cancel.mutex, TRUE, scratch_pool));
+
+      cancel_func = serialized_cancel_func;
+      cancel_baton = &cancel;
+    }
+
+  SVN_ERR(svn_task__queue_create(&queue, jobs, 2 * jobs,
+                                 verify_task_process, verify_task_output,
+                                 &output, scratch_pool));
+
+  /* Verify global metadata and backend-specific data first. */
+  for (rev = start_rev; rev <= end_rev; rev = next_rev)
+    {
+      next_rev = (rev / shard_size + 1) * shard_size;
+      SVN_ERR(add_verify_task(queue, fs, rev, MIN(next_rev - 1, end_rev),
+                              TRUE, start_rev, check_normalization,
+                              notify_func != NULL,
+                              cancel_func, cancel_baton));
+    }
+
+  SVN_ERR(svn_task__queue_finish(queue));
+
+  if (!metadata_only)
+    {
+      for (rev = start_rev; rev <= end_rev; rev = next_rev)
+        {
+          next_rev = rev + VERIFY_REVISIONS_PER_TASK;
+          SVN_ERR(add_verify_task(queue, fs, rev, MIN(next_rev - 1, end_rev),
+                                  FALSE, start_rev, check_normalization,
+                                  notify_func != NULL,
+                                  cancel_func, cancel_baton));
+        }
+
+      SVN_ERR(svn_task__queue_finish(queue));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos_verify_fs4(svn_repos_t *repos,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     svn_boolean_t check_normalization,
+                     svn_boolean_t metadata_only,
+                     int jobs,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_repos_verify_callback_t verify_callback,
+                     void *verify_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *pool)
+{
+  svn_fs_t *fs = svn_repos_fs(repos);
+  svn_revnum_t youngest;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_repos_notify_t *notify;
+
+  /* Make sure we catch up on the latest revprop changes.  This is the only
+   * time we will refresh the revprop data in this query. */
+  SVN_ERR(svn_fs_refresh_revision_props(fs, pool));
+
+  /* Determine the current youngest revision of the filesystem. */
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+
+  /* Use default vals if necessary. */
+  if (! SVN_IS_VALID_REVNUM(start_rev))
+    start_rev = 0;
+  if (! SVN_IS_VALID_REVNUM(end_rev))
+    end_rev = youngest;
+
+  /* Validate the revisions. */
+  if (start_rev > end_rev)
+    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
+                             _("Start revision %ld"
+                               " is greater than end revision %ld"),
+                             start_rev, end_rev);
+  if (end_rev > youngest)
+    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
+                             _("End revision %ld is invalid "
+                               "(youngest revision is %ld)"),
+                             end_rev, youngest);
+
+  if (jobs > 1)
+    {
+      SVN_ERR(verify_fs_parallel(fs, start_rev, end_rev,
+                                 check_normalization, metadata_only, jobs,
+                                 notify_func, notify_baton,
+                                 verify_callback, verify_baton,
+                                 cancel_func, cancel_baton, iterpool));
+    }
+  else
+    {
+      SVN_ERR(verify_fs_sequential(fs, start_rev, end_rev,
+                                   check_normalization, metadata_only,
+                                   notify_func, notify_baton,
+                                   verify_callback, verify_baton,
+                                   cancel_func, cancel_baton, iterpool));
+    }
+
   /* We're done. */
   if (notify_func)
     {
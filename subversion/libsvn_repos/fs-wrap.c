@@ -111,6 +111,11 @@ svn_repos_fs_commit_txn(const char **conflict_p,
       return err;
     }
 
+  /* The indexes are only an optimization.  Don't fail the commit if we
+     can't update them. */
+  svn_error_clear(svn_repos__date_index_update(repos, *new_rev, pool));
+  svn_error_clear(svn_repos__log_index_update(repos, *new_rev, pool));
+
   /* Run post-commit hooks. */
   if ((err2 = svn_repos__hooks_post_commit(repos, hooks_env,
                                            *new_rev, txn_name, pool)))
@@ -439,6 +444,9 @@ svn_repos_fs_change_rev_prop4(svn_repos_t *repos,
       SVN_ERR(svn_fs_change_rev_prop2(repos->fs, rev, name,
                                       &old_value, new_value, pool));
 
+      if (strcmp(name, SVN_PROP_REVISION_DATE) == 0)
+        svn_error_clear(svn_repos__date_index_update(repos, rev, pool));
+
       if (use_post_revprop_change_hook)
         SVN_ERR(svn_repos__hooks_post_revprop_change(repos, hooks_env, rev,
                                                      author, name, old_value,
@@ -1045,10 +1053,11 @@ svn_repos_fs_pack2(svn_repos_t *repos,
   pnb.notify_func = notify_func;
   pnb.notify_baton = notify_baton;
 
-  return svn_fs_pack(repos->db_path,
-                     notify_func ? pack_notify_func : NULL,
-                     notify_func ? &pnb : NULL,
-                     cancel_func, cancel_baton, pool);
+  return svn_fs_pack2(repos->db_path,
+                      svn_fs_config(repos->fs, pool),
+                      notify_func ? pack_notify_func : NULL,
+                      notify_func ? &pnb : NULL,
+                      cancel_func, cancel_baton, pool);
 }
 
 svn_error_t *
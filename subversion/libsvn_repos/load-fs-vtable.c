@@ -1118,6 +1118,13 @@ close_revision(void *baton)
         return svn_error_trace(err);
     }
 
+  /* The indexes are only an optimization.  Don't fail the load if we
+     can't update them. */
+  svn_error_clear(svn_repos__date_index_update(pb->repos, committed_rev,
+                                               rb->pool));
+  svn_error_clear(svn_repos__log_index_update(pb->repos, committed_rev,
+                                              rb->pool));
+
   /* Run post-commit hook, if so commanded.  */
   if (pb->use_post_commit_hook)
     {
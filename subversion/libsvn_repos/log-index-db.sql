@@ -0,0 +1,117 @@
+/* log-index-db.sql -- schema of the repository's log index
+ *   This is intended for use with SQLite 3
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+-- STMT_CREATE_SCHEMA
+/* The repository that has been indexed and the youngest revision that
+   has been fully indexed.  There is at most one row with ID 1. */
+CREATE TABLE meta (
+  id INTEGER NOT NULL PRIMARY KEY,
+  uuid TEXT NOT NULL,
+  youngest INTEGER NOT NULL
+  );
+
+/* Lists PATH for every REVISION in which PATH itself or any node below
+   it got changed.  The root directory is not being listed since it
+   changes in every revision. */
+CREATE TABLE path_revs (
+  path TEXT NOT NULL,
+  revision INTEGER NOT NULL,
+  PRIMARY KEY (path, revision)
+  );
+
+/* Every addition or replacement of PATH in REVISION along with its
+   copy source, if any. */
+CREATE TABLE path_adds (
+  path TEXT NOT NULL,
+  revision INTEGER NOT NULL,
+  copyfrom_path TEXT,
+  copyfrom_rev INTEGER,
+  PRIMARY KEY (path, revision)
+  );
+
+/* The mergeinfo that got removed from and added to PATH in REVISION,
+   in svn:mergeinfo syntax.  Revisions without mergeinfo changes have no
+   rows. */
+CREATE TABLE mergeinfo_changes (
+  revision INTEGER NOT NULL,
+  path TEXT NOT NULL,
+  deleted TEXT NOT NULL,
+  added TEXT NOT NULL,
+  PRIMARY KEY (revision, path)
+  );
+
+PRAGMA USER_VERSION = 2;
+
+-- STMT_GET_META
+SELECT uuid, youngest
+FROM meta
+WHERE id = 1
+
+-- STMT_SET_META
+INSERT OR REPLACE INTO meta (id, uuid, youngest)
+VALUES (1, ?1, ?2)
+
+-- STMT_CLEAR_PATH_REVS
+DELETE FROM path_revs
+
+-- STMT_CLEAR_PATH_ADDS
+DELETE FROM path_adds
+
+-- STMT_CLEAR_MERGEINFO_CHANGES
+DELETE FROM mergeinfo_changes
+
+-- STMT_INSERT_PATH_REV
+INSERT OR IGNORE INTO path_revs (path, revision)
+VALUES (?1, ?2)
+
+-- STMT_INSERT_PATH_ADD
+INSERT OR REPLACE INTO path_adds (path, revision, copyfrom_path, copyfrom_rev)
+VALUES (?1, ?2, ?3, ?4)
+
+-- STMT_GET_PREV_PATH_REV
+SELECT revision
+FROM path_revs
+WHERE path = ?1 AND revision <= ?2
+ORDER BY revision DESC
+LIMIT 1
+
+-- STMT_GET_PREV_PATH_ADD
+SELECT revision
+FROM path_adds
+WHERE path = ?1 AND revision <= ?2
+ORDER BY revision DESC
+LIMIT 1
+
+-- STMT_GET_PATH_ADD
+SELECT copyfrom_path, copyfrom_rev
+FROM path_adds
+WHERE path = ?1 AND revision = ?2
+
+-- STMT_INSERT_MERGEINFO_CHANGE
+INSERT OR REPLACE INTO mergeinfo_changes (revision, path, deleted, added)
+VALUES (?1, ?2, ?3, ?4)
+
+-- STMT_GET_MERGEINFO_CHANGES
+SELECT path, deleted, added
+FROM mergeinfo_changes
+WHERE revision = ?1
@@ -0,0 +1,656 @@
+/* log-index.c --- maintain and query the changed-paths index
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* The log index is an SQLite database in the repository's db directory.
+ * For every path, it lists the revisions in which that path or any of its
+ * sub-paths got changed.  Additions, replacements and copies are being
+ * recorded separately.  This is enough to reconstruct the history of any
+ * path without having to walk the filesystem's node history.
+ *
+ * The index also keeps the parsed mergeinfo changes of every revision
+ * such that merge tracking queries need not re-read and re-parse the
+ * svn:mergeinfo properties.
+ *
+ * Since revision contents are immutable, the index is exact for all
+ * revisions up to its youngest indexed revision.  Younger revisions are
+ * simply not covered and callers must fall back to the filesystem.
+ */
+
+#include <string.h>
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_fs.h"
+#include "svn_mergeinfo.h"
+#include "svn_repos.h"
+#include "repos.h"
+#include "svn_private_config.h"
+
+#include "private/svn_fspath.h"
+#include "private/svn_sqlite.h"
+#include "private/svn_subr_private.h"
+
+#include "log-index-db.h"
+
+LOG_INDEX_DB_SQL_DECLARE_STATEMENTS(statements);
+
+
+
+/* Name of the index database within the db directory. */
+#define LOG_INDEX_DB_NAME "log-index.db"
+
+/* Schema version of the index database. */
+#define LOG_INDEX_SCHEMA_FORMAT 2
+
+/* Do not let a commit add more than this many missing revisions to the
+ * index.  Larger gaps need an explicit rebuild. */
+#define LOG_INDEX_MAX_CATCHUP 1000
+
+/* Number of revisions to index per SQLite transaction during rebuilds. */
+#define LOG_INDEX_BATCH_SIZE 1000
+
+struct svn_repos__log_index_t
+{
+  /* The index database. */
+  svn_sqlite__db_t *sdb;
+
+  /* Youngest revision covered by the index. */
+  svn_revnum_t youngest;
+};
+
+/* Return the path of the log index database in REPOS, allocated in
+ * POOL. */
+static const char *
+log_index_path(svn_repos_t *repos,
+               apr_pool_t *pool)
+{
+  return svn_dirent_join(repos->db_path, LOG_INDEX_DB_NAME, pool);
+}
+
+/* Open the log index database of REPOS in MODE and return it in *SDB.
+ * If the database does not exist or uses an unknown schema, set *SDB to
+ * NULL, unless MODE is svn_sqlite__mode_rwcreate.  In that case, create
+ * the database and its schema as necessary, replacing databases with any
+ * other schema.  Allocate the database in RESULT_POOL and use SCRATCH_POOL
+ * for temporary allocations. */
+static svn_error_t *
+open_db(svn_sqlite__db_t **sdb,
+        svn_repos_t *repos,
+        svn_sqlite__mode_t mode,
+        apr_pool_t *result_pool,
+        apr_pool_t *scratch_pool)
+{
+  const char *db_path = log_index_path(repos, scratch_pool);
+  svn_node_kind_t kind;
+  int version;
+
+  *sdb = NULL;
+
+  SVN_ERR(svn_io_check_path(db_path, &kind, scratch_pool));
+  if (kind == svn_node_none)
+    {
+      if (mode != svn_sqlite__mode_rwcreate)
+        return SVN_NO_ERROR;
+
+#ifndef WIN32
+      {
+        /* Extend the permissions of the repository to the new database
+           instead of simply defaulting to umask. */
+        svn_error_t *err = svn_io_file_create_empty(db_path, scratch_pool);
+
+        if (err && !APR_STATUS_IS_EEXIST(err->apr_err))
+          return svn_error_trace(err);
+        else if (err)
+          svn_error_clear(err);
+        else
+          SVN_ERR(svn_io_copy_perms(svn_dirent_join(repos->db_path,
+                                                    "fs-type",
+                                                    scratch_pool),
+                                    db_path, scratch_pool));
+      }
+#endif
+    }
+
+  SVN_ERR(svn_sqlite__open(sdb, db_path, mode, statements, 0, NULL, 0,
+                           result_pool, scratch_pool));
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version, *sdb,
+                                                        scratch_pool),
+                        *sdb);
+
+  if (version <= 0 && mode == svn_sqlite__mode_rwcreate)
+    {
+      SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(*sdb,
+                                                        STMT_CREATE_SCHEMA),
+                            *sdb);
+    }
+  else if (version != LOG_INDEX_SCHEMA_FORMAT)
+    {
+      /* Not ours to use. */
+      SVN_ERR(svn_sqlite__close(*sdb));
+      *sdb = NULL;
+
+      /* But we may start over. */
+      if (mode == svn_sqlite__mode_rwcreate)
+        {
+          SVN_ERR(svn_io_remove_file2(db_path, FALSE, scratch_pool));
+          return svn_error_trace(open_db(sdb, repos, mode, result_pool,
+                                         scratch_pool));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *UUID and *YOUNGEST to the repository UUID and the youngest revision
+ * recorded in SDB.  If there is no such information, set them to NULL and
+ * SVN_INVALID_REVNUM, respectively.  Allocate *UUID in RESULT_POOL. */
+static svn_error_t *
+read_meta(const char **uuid,
+          svn_revnum_t *youngest,
+          svn_sqlite__db_t *sdb,
+          apr_pool_t *result_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  *uuid = NULL;
+  *youngest = SVN_INVALID_REVNUM;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_GET_META));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  if (have_row)
+    {
+      *uuid = svn_sqlite__column_text(stmt, 0, result_pool);
+      *youngest = svn_sqlite__column_revnum(stmt, 1);
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Record UUID and YOUNGEST in SDB. */
+static svn_error_t *
+write_meta(svn_sqlite__db_t *sdb,
+           const char *uuid,
+           svn_revnum_t youngest)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  /* Use an explicit -1 instead of NULL for "no revision". */
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SET_META));
+  SVN_ERR(svn_sqlite__bindf(stmt, "sL", uuid, (apr_int64_t)youngest));
+
+  return svn_error_trace(svn_sqlite__step_done(stmt));
+}
+
+/* Add the mergeinfo changes of REVISION in FS to SDB.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+index_mergeinfo_changes(svn_sqlite__db_t *sdb,
+                        svn_fs_t *fs,
+                        svn_revnum_t revision,
+                        apr_pool_t *scratch_pool)
+{
+  svn_mergeinfo_catalog_t deleted_catalog, added_catalog;
+  apr_hash_index_t *hi;
+  svn_error_t *err;
+
+  err = svn_repos__fs_mergeinfo_changed(&deleted_catalog, &added_catalog,
+                                        fs, revision,
+                                        scratch_pool, scratch_pool);
+  if (err && err->apr_err == SVN_ERR_MERGEINFO_PARSE_ERROR)
+    {
+      /* Log treats invalid mergeinfo as no mergeinfo change at all
+         (issue #3896).  So do we. */
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  for (hi = apr_hash_first(scratch_pool, added_catalog);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const char *path = apr_hash_this_key(hi);
+      svn_mergeinfo_t added = apr_hash_this_val(hi);
+      svn_mergeinfo_t deleted = svn_hash_gets(deleted_catalog, path);
+      svn_string_t *added_str, *deleted_str;
+      svn_sqlite__stmt_t *stmt;
+
+      SVN_ERR(svn_mergeinfo_to_string(&deleted_str, deleted, scratch_pool));
+      SVN_ERR(svn_mergeinfo_to_string(&added_str, added, scratch_pool));
+
+      SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                        STMT_INSERT_MERGEINFO_CHANGE));
+      SVN_ERR(svn_sqlite__bindf(stmt, "rsss", revision, path,
+                                deleted_str->data, added_str->data));
+      SVN_ERR(svn_sqlite__step_done(stmt));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Add the changed paths and mergeinfo changes of REVISION in FS to SDB.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+index_revision(svn_sqlite__db_t *sdb,
+               svn_fs_t *fs,
+               svn_revnum_t revision,
+               apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *root;
+  svn_fs_path_change_iterator_t *iterator;
+  svn_fs_path_change3_t *change;
+  svn_sqlite__stmt_t *stmt;
+  apr_hash_t *touched = apr_hash_make(scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, revision, scratch_pool));
+  SVN_ERR(svn_fs_paths_changed3(&iterator, root, scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_path_change_get(&change, iterator));
+
+  while (change)
+    {
+      const char *path = svn_fspath__canonicalize(change->path.data,
+                                                  scratch_pool);
+
+      svn_pool_clear(iterpool);
+
+      if (   change->change_kind == svn_fs_path_change_add
+          || change->change_kind == svn_fs_path_change_replace)
+        {
+          svn_revnum_t copyfrom_rev = change->copyfrom_rev;
+          const char *copyfrom_path = change->copyfrom_path;
+
+          if (! change->copyfrom_known)
+            SVN_ERR(svn_fs_copied_from(&copyfrom_rev, &copyfrom_path,
+                                       root, path, iterpool));
+
+          if (copyfrom_path && SVN_IS_VALID_REVNUM(copyfrom_rev))
+            copyfrom_path = svn_fspath__canonicalize(copyfrom_path,
+                                                     iterpool);
+          else
+            copyfrom_path = NULL;
+
+          SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                            STMT_INSERT_PATH_ADD));
+          SVN_ERR(svn_sqlite__bindf(stmt, "srsr", path, revision,
+                                    copyfrom_path,
+                                    copyfrom_path ? copyfrom_rev
+                                                  : SVN_INVALID_REVNUM));
+          SVN_ERR(svn_sqlite__step_done(stmt));
+        }
+
+      /* Record PATH and all its parents unless already done so. */
+      while (   ! svn_fspath__is_root(path, strlen(path))
+             && ! svn_hash_gets(touched, path))
+        {
+          svn_hash_sets(touched, path, path);
+
+          SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                            STMT_INSERT_PATH_REV));
+          SVN_ERR(svn_sqlite__bindf(stmt, "sr", path, revision));
+          SVN_ERR(svn_sqlite__step_done(stmt));
+
+          path = svn_fspath__dirname(path, scratch_pool);
+        }
+
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+    }
+
+  svn_pool_destroy(iterpool);
+  return svn_error_trace(index_mergeinfo_changes(sdb, fs, revision,
+                                                 scratch_pool));
+}
+
+/* Add revisions FIRST to LAST in FS to SDB and record LAST as the youngest
+ * indexed revision of the repository with UUID.  Call CANCEL_FUNC with
+ * CANCEL_BATON between revisions.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+index_revisions(svn_sqlite__db_t *sdb,
+                svn_fs_t *fs,
+                const char *uuid,
+                svn_revnum_t first,
+                svn_revnum_t last,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t revision;
+
+  for (revision = first; revision <= last; ++revision)
+    {
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(index_revision(sdb, fs, revision, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return svn_error_trace(write_meta(sdb, uuid, last));
+}
+
+/* Body of svn_repos__log_index_update, to be run within an SQLite
+ * transaction on SDB. */
+static svn_error_t *
+update_index(svn_sqlite__db_t *sdb,
+             svn_repos_t *repos,
+             svn_revnum_t revision,
+             apr_pool_t *scratch_pool)
+{
+  const char *uuid, *index_uuid;
+  svn_revnum_t youngest;
+
+  SVN_ERR(svn_fs_get_uuid(repos->fs, &uuid, scratch_pool));
+  SVN_ERR(read_meta(&index_uuid, &youngest, sdb, scratch_pool));
+
+  /* Leave foreign or incomplete indexes alone.  So we do if there is
+     nothing to do or too much. */
+  if (   ! index_uuid
+      || strcmp(uuid, index_uuid)
+      || ! SVN_IS_VALID_REVNUM(youngest)
+      || revision <= youngest
+      || revision - youngest > LOG_INDEX_MAX_CATCHUP)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(index_revisions(sdb, repos->fs, uuid,
+                                         youngest + 1, revision,
+                                         NULL, NULL, scratch_pool));
+}
+
+svn_error_t *
+svn_repos__log_index_update(svn_repos_t *repos,
+                            svn_revnum_t revision,
+                            apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+
+  /* Only maintain the index if it has been created. */
+  SVN_ERR(open_db(&sdb, repos, svn_sqlite__mode_readwrite,
+                  scratch_pool, scratch_pool));
+  if (! sdb)
+    return SVN_NO_ERROR;
+
+  /* Concurrent commits will serialize on the write lock. */
+  SVN_SQLITE__WITH_IMMEDIATE_TXN(update_index(sdb, repos, revision,
+                                              scratch_pool),
+                                 sdb);
+
+  return svn_error_trace(svn_sqlite__close(sdb));
+}
+
+/* Remove all contents from SDB and mark it as not covering any revision
+ * of the repository with UUID. */
+static svn_error_t *
+clear_index(svn_sqlite__db_t *sdb,
+            const char *uuid)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_CLEAR_PATH_REVS));
+  SVN_ERR(svn_sqlite__step_done(stmt));
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_CLEAR_PATH_ADDS));
+  SVN_ERR(svn_sqlite__step_done(stmt));
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                    STMT_CLEAR_MERGEINFO_CHANGES));
+  SVN_ERR(svn_sqlite__step_done(stmt));
+
+  return svn_error_trace(write_meta(sdb, uuid, SVN_INVALID_REVNUM));
+}
+
+svn_error_t *
+svn_repos__log_index_rebuild(svn_repos_t *repos,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+  const char *uuid;
+  svn_revnum_t youngest, first;
+
+  SVN_ERR(svn_fs_get_uuid(repos->fs, &uuid, scratch_pool));
+  SVN_ERR(svn_fs_youngest_rev(&youngest, repos->fs, scratch_pool));
+  SVN_ERR(open_db(&sdb, repos, svn_sqlite__mode_rwcreate,
+                  scratch_pool, scratch_pool));
+
+  SVN_SQLITE__WITH_TXN(clear_index(sdb, uuid), sdb);
+
+  /* Index in batches such that commits won't be blocked for too long. */
+  for (first = 0; first <= youngest; first += LOG_INDEX_BATCH_SIZE)
+    {
+      svn_revnum_t last = MIN(first + LOG_INDEX_BATCH_SIZE - 1, youngest);
+
+      SVN_SQLITE__WITH_TXN(index_revisions(sdb, repos->fs, uuid,
+                                           first, last,
+                                           cancel_func, cancel_baton,
+                                           scratch_pool),
+                           sdb);
+    }
+
+  return svn_error_trace(svn_sqlite__close(sdb));
+}
+
+svn_error_t *
+svn_repos__log_index_open(svn_repos__log_index_t **index,
+                          svn_repos_t *repos,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+  const char *uuid, *index_uuid;
+  svn_revnum_t youngest;
+
+  *index = NULL;
+
+  SVN_ERR(open_db(&sdb, repos, svn_sqlite__mode_readonly,
+                  result_pool, scratch_pool));
+  if (! sdb)
+    return SVN_NO_ERROR;
+
+  /* Only use indexes that actually belong to this repository. */
+  SVN_ERR(svn_fs_get_uuid(repos->fs, &uuid, scratch_pool));
+  SVN_SQLITE__ERR_CLOSE(read_meta(&index_uuid, &youngest, sdb,
+                                  scratch_pool),
+                        sdb);
+
+  if (   ! index_uuid
+      || strcmp(uuid, index_uuid)
+      || ! SVN_IS_VALID_REVNUM(youngest))
+    return svn_error_trace(svn_sqlite__close(sdb));
+
+  *index = apr_pcalloc(result_pool, sizeof(**index));
+  (*index)->sdb = sdb;
+  (*index)->youngest = youngest;
+
+  return SVN_NO_ERROR;
+}
+
+svn_revnum_t
+svn_repos__log_index_youngest(svn_repos__log_index_t *index)
+{
+  return index->youngest;
+}
+
+/* Set *REVISION to the youngest revision not younger than MAX_REV in
+ * which PATH is listed in INDEX by statement STMT_IDX.  Set it to
+ * SVN_INVALID_REVNUM if there is no such revision. */
+static svn_error_t *
+get_prev_revision(svn_revnum_t *revision,
+                  svn_repos__log_index_t *index,
+                  int stmt_idx,
+                  const char *path,
+                  svn_revnum_t max_rev)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb, stmt_idx));
+  SVN_ERR(svn_sqlite__bindf(stmt, "sr", path, max_rev));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  *revision = have_row ? svn_sqlite__column_revnum(stmt, 0)
+                       : SVN_INVALID_REVNUM;
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+svn_error_t *
+svn_repos__log_index_prev(svn_revnum_t *revision,
+                          svn_repos__log_index_t *index,
+                          const char *path,
+                          svn_revnum_t max_rev,
+                          apr_pool_t *scratch_pool)
+{
+  svn_revnum_t rev;
+
+  *revision = SVN_INVALID_REVNUM;
+  if (! SVN_IS_VALID_REVNUM(max_rev))
+    return SVN_NO_ERROR;
+
+  /* The root gets changed in every revision. */
+  if (svn_fspath__is_root(path, strlen(path)))
+    {
+      *revision = max_rev;
+      return SVN_NO_ERROR;
+    }
+
+  /* Changes to PATH or below. */
+  SVN_ERR(get_prev_revision(revision, index, STMT_GET_PREV_PATH_REV, path,
+                            max_rev));
+
+  /* PATH may also have been added implicitly by adding or copying one of
+     its parents. */
+  for (path = svn_fspath__dirname(path, scratch_pool);
+       ! svn_fspath__is_root(path, strlen(path));
+       path = svn_fspath__dirname(path, scratch_pool))
+    {
+      SVN_ERR(get_prev_revision(&rev, index, STMT_GET_PREV_PATH_ADD, path,
+                                max_rev));
+      if (SVN_IS_VALID_REVNUM(rev) && rev > *revision)
+        *revision = rev;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__log_index_get_add(svn_boolean_t *added,
+                             const char **copyfrom_path,
+                             svn_revnum_t *copyfrom_rev,
+                             svn_repos__log_index_t *index,
+                             const char *path,
+                             svn_revnum_t revision,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  const char *parent;
+
+  *added = FALSE;
+  *copyfrom_path = NULL;
+  *copyfrom_rev = SVN_INVALID_REVNUM;
+
+  /* The deepest addition determines where PATH came from. */
+  for (parent = path;
+       ! svn_fspath__is_root(parent, strlen(parent));
+       parent = svn_fspath__dirname(parent, scratch_pool))
+    {
+      svn_sqlite__stmt_t *stmt;
+      svn_boolean_t have_row;
+
+      SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                        STMT_GET_PATH_ADD));
+      SVN_ERR(svn_sqlite__bindf(stmt, "sr", parent, revision));
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+      if (have_row)
+        {
+          const char *source = svn_sqlite__column_text(stmt, 0,
+                                                       scratch_pool);
+
+          *added = TRUE;
+          if (source)
+            {
+              *copyfrom_path
+                = svn_fspath__join(source,
+                                   svn_fspath__skip_ancestor(parent, path),
+                                   result_pool);
+              *copyfrom_rev = svn_sqlite__column_revnum(stmt, 1);
+            }
+        }
+
+      SVN_ERR(svn_sqlite__reset(stmt));
+      if (*added)
+        break;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__log_index_get_mergeinfo_changes(
+  svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+  svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+  svn_repos__log_index_t *index,
+  svn_revnum_t revision,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  *deleted_mergeinfo_catalog = svn_hash__make(result_pool);
+  *added_mergeinfo_catalog = svn_hash__make(result_pool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, index->sdb,
+                                    STMT_GET_MERGEINFO_CHANGES));
+  SVN_ERR(svn_sqlite__bindf(stmt, "r", revision));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row)
+    {
+      const char *path = svn_sqlite__column_text(stmt, 0, result_pool);
+      svn_mergeinfo_t deleted, added;
+      svn_error_t *err;
+
+      err = svn_mergeinfo_parse(&deleted,
+                                svn_sqlite__column_text(stmt, 1, NULL),
+                                result_pool);
+      if (! err)
+        err = svn_mergeinfo_parse(&added,
+                                  svn_sqlite__column_text(stmt, 2, NULL),
+                                  result_pool);
+      if (err)
+        return svn_error_compose_create(err, svn_sqlite__reset(stmt));
+
+      svn_hash_sets(*deleted_mergeinfo_catalog, path, deleted);
+      svn_hash_sets(*added_mergeinfo_catalog, path, added);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
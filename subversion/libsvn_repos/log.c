@@ -56,6 +56,9 @@ typedef struct log_callbacks_t
   void *revision_receiver_baton;
   svn_repos_authz_func_t authz_read_func;
   void *authz_read_baton;
+
+  /* The changed-paths index of the repository or NULL. */
+  svn_repos__log_index_t *log_index;
 } log_callbacks_t;
 
 
@@ -429,8 +432,100 @@ struct path_info
   svn_fs_history_t *hist;
   apr_pool_t *newpool;
   apr_pool_t *oldpool;
+
+  /* If not NULL, follow the history of this path using the changed-paths
+     index instead of the filesystem's node history.  In that case, the
+     following fields describe where to continue the walk. */
+  svn_repos__log_index_t *log_index;
+
+  /* Set if the last reported revision is where this path got added.  If
+     it has been copied, these are the copy source to continue with. */
+  svn_boolean_t added;
+  svn_stringbuf_t *copyfrom_path;
+  svn_revnum_t copyfrom_rev;
 };
 
+/* Like get_history() but use INFO->LOG_INDEX to find the next location.
+ * The copy semantics are the same as for svn_fs_history_prev2().
+ */
+static svn_error_t *
+get_indexed_history(struct path_info *info,
+                    svn_fs_t *fs,
+                    svn_boolean_t strict,
+                    svn_repos_authz_func_t authz_read_func,
+                    void *authz_read_baton,
+                    svn_revnum_t start,
+                    apr_pool_t *scratch_pool)
+{
+  svn_revnum_t max_rev;
+  const char *copyfrom_path;
+
+  if (info->first_time)
+    {
+      /* The initial location itself may have been changed. */
+      info->first_time = FALSE;
+      max_rev = info->history_rev;
+    }
+  else if (info->added)
+    {
+      /* We reported the addition of this path.  Continue with its copy
+         source, if any and if we shall cross copies. */
+      if (strict || ! SVN_IS_VALID_REVNUM(info->copyfrom_rev))
+        {
+          info->done = TRUE;
+          return SVN_NO_ERROR;
+        }
+
+      svn_stringbuf_set(info->path, info->copyfrom_path->data);
+      max_rev = info->copyfrom_rev;
+    }
+  else
+    {
+      max_rev = info->history_rev - 1;
+    }
+
+  SVN_ERR(svn_repos__log_index_prev(&info->history_rev, info->log_index,
+                                    info->path->data, max_rev,
+                                    scratch_pool));
+
+  /* If this history item predates our START revision then
+     don't fetch any more for this path. */
+  if (! SVN_IS_VALID_REVNUM(info->history_rev)
+      || info->history_rev < start)
+    {
+      info->done = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  /* Remember whether we reached the start of this line of history. */
+  SVN_ERR(svn_repos__log_index_get_add(&info->added, &copyfrom_path,
+                                       &info->copyfrom_rev,
+                                       info->log_index, info->path->data,
+                                       info->history_rev,
+                                       scratch_pool, scratch_pool));
+  if (copyfrom_path)
+    svn_stringbuf_set(info->copyfrom_path, copyfrom_path);
+
+  /* Is the history item readable?  If not, done with path. */
+  if (authz_read_func)
+    {
+      svn_boolean_t readable;
+      svn_fs_root_t *history_root;
+
+      SVN_ERR(svn_fs_revision_root(&history_root, fs,
+                                   info->history_rev,
+                                   scratch_pool));
+      SVN_ERR(authz_read_func(&readable, history_root,
+                              info->path->data,
+                              authz_read_baton,
+                              scratch_pool));
+      if (! readable)
+        info->done = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Advance to the next history for the path.
  *
  * If INFO->HIST is not NULL we do this using that existing history object,
@@ -462,6 +557,12 @@ get_history(struct path_info *info,
   apr_pool_t *subpool;
   const char *path;
 
+  if (info->log_index)
+    return svn_error_trace(get_indexed_history(info, fs, strict,
+                                               authz_read_func,
+                                               authz_read_baton, start,
+                                               scratch_pool));
+
   if (info->hist)
     {
       subpool = info->newpool;
@@ -609,18 +710,14 @@ next_history_rev(const apr_array_header_t *histories)
   return next_rev;
 }
 
-/* Set *DELETED_MERGEINFO_CATALOG and *ADDED_MERGEINFO_CATALOG to
-   catalogs describing how mergeinfo values on paths (which are the
-   keys of those catalogs) were changed in REV. */
-/* ### TODO: This would make a *great*, useful public function,
-   ### svn_repos_fs_mergeinfo_changed()!  -- cmpilato  */
-static svn_error_t *
-fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
-                     svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
-                     svn_fs_t *fs,
-                     svn_revnum_t rev,
-                     apr_pool_t *result_pool,
-                     apr_pool_t *scratch_pool)
+svn_error_t *
+svn_repos__fs_mergeinfo_changed(
+  svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+  svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+  svn_fs_t *fs,
+  svn_revnum_t rev,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool)
 {
   svn_fs_root_t *root;
   apr_pool_t *iterpool, *iterator_pool;
@@ -877,11 +974,14 @@ fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
 
 /* Determine what (if any) mergeinfo for PATHS was modified in
    revision REV, returning the differences for added mergeinfo in
-   *ADDED_MERGEINFO and deleted mergeinfo in *DELETED_MERGEINFO. */
+   *ADDED_MERGEINFO and deleted mergeinfo in *DELETED_MERGEINFO.
+   If LOG_INDEX is not NULL and covers REV, take the per-path
+   mergeinfo changes from there. */
 static svn_error_t *
 get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
                                svn_mergeinfo_t *deleted_mergeinfo,
                                svn_fs_t *fs,
+                               svn_repos__log_index_t *log_index,
                                const apr_array_header_t *paths,
                                svn_revnum_t rev,
                                apr_pool_t *result_pool,
@@ -907,10 +1007,15 @@ get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
     return SVN_NO_ERROR;
 
   /* Fetch the mergeinfo changes for REV. */
-  err = fs_mergeinfo_changed(&deleted_mergeinfo_catalog,
-                             &added_mergeinfo_catalog,
-                             fs, rev,
-                             scratch_pool, scratch_pool);
+  if (log_index && rev <= svn_repos__log_index_youngest(log_index))
+    err = svn_repos__log_index_get_mergeinfo_changes(
+            &deleted_mergeinfo_catalog, &added_mergeinfo_catalog,
+            log_index, rev, scratch_pool, scratch_pool);
+  else
+    err = svn_repos__fs_mergeinfo_changed(&deleted_mergeinfo_catalog,
+                                          &added_mergeinfo_catalog,
+                                          fs, rev,
+                                          scratch_pool, scratch_pool);
   if (err)
     {
       if (err->apr_err == SVN_ERR_MERGEINFO_PARSE_ERROR)
@@ -1401,6 +1506,7 @@ get_path_histories(apr_array_header_t **histories,
                    svn_boolean_t ignore_missing_locations,
                    svn_repos_authz_func_t authz_read_func,
                    void *authz_read_baton,
+                   svn_repos__log_index_t *log_index,
                    apr_pool_t *pool)
 {
   svn_fs_root_t *root;
@@ -1442,8 +1548,43 @@ get_path_histories(apr_array_header_t **histories,
       info->done = FALSE;
       info->history_rev = hist_end;
       info->first_time = TRUE;
+      info->log_index = NULL;
+      info->added = FALSE;
+      info->copyfrom_path = NULL;
+      info->copyfrom_rev = SVN_INVALID_REVNUM;
+
+      /* Use the changed-paths index if it covers all of our history.
+         The root changes in every revision, so there is no need for it. */
+      if (log_index
+          && hist_end <= svn_repos__log_index_youngest(log_index)
+          && ! svn_fspath__is_root(this_path, strlen(this_path))
+          && ! svn_path_is_empty(this_path))
+        {
+          svn_fs_history_t *hist;
 
-      if (i < MAX_OPEN_HISTORIES)
+          /* Bogus locations shall fail just as they do without index. */
+          err = svn_fs_node_history2(&hist, root, this_path, iterpool,
+                                     iterpool);
+          if (err
+              && ignore_missing_locations
+              && (err->apr_err == SVN_ERR_FS_NOT_FOUND ||
+                  err->apr_err == SVN_ERR_FS_NOT_DIRECTORY ||
+                  err->apr_err == SVN_ERR_FS_NO_SUCH_REVISION))
+            {
+              svn_error_clear(err);
+              continue;
+            }
+          SVN_ERR(err);
+
+          svn_stringbuf_set(info->path,
+                            svn_fspath__canonicalize(this_path, iterpool));
+          info->log_index = log_index;
+          info->copyfrom_path = svn_stringbuf_create_empty(pool);
+          info->hist = NULL;
+          info->oldpool = NULL;
+          info->newpool = NULL;
+        }
+      else if (i < MAX_OPEN_HISTORIES)
         {
           err = svn_fs_node_history2(&info->hist, root, this_path, pool,
                                      iterpool);
@@ -2015,7 +2156,8 @@ do_logs(svn_fs_t *fs,
   SVN_ERR(get_path_histories(&histories, fs, paths, hist_start, hist_end,
                              strict_node_history, ignore_missing_locations,
                              callbacks->authz_read_func,
-                             callbacks->authz_read_baton, pool));
+                             callbacks->authz_read_baton,
+                             callbacks->log_index, pool));
 
   /* Loop through all the revisions in the range and add any
      where a path was changed to the array, or if they wanted
@@ -2075,7 +2217,9 @@ do_logs(svn_fs_t *fs,
                 }
               SVN_ERR(get_combined_mergeinfo_changes(&added_mergeinfo,
                                                      &deleted_mergeinfo,
-                                                     fs, cur_paths,
+                                                     fs,
+                                                     callbacks->log_index,
+                                                     cur_paths,
                                                      current,
                                                      iterpool, iterpool));
               has_children = (apr_hash_count(added_mergeinfo) > 0
@@ -2325,6 +2469,7 @@ svn_repos_get_logs5(svn_repos_t *repos,
   svn_boolean_t descending_order;
   svn_mergeinfo_t paths_history_mergeinfo = NULL;
   log_callbacks_t callbacks;
+  svn_error_t *err;
 
   callbacks.path_change_receiver = path_change_receiver;
   callbacks.path_change_receiver_baton = path_change_receiver_baton;
@@ -2332,6 +2477,7 @@ svn_repos_get_logs5(svn_repos_t *repos,
   callbacks.revision_receiver_baton = revision_receiver_baton;
   callbacks.authz_read_func = authz_read_func;
   callbacks.authz_read_baton = authz_read_baton;
+  callbacks.log_index = NULL;
 
   if (revprops)
     {
@@ -2443,6 +2589,18 @@ svn_repos_get_logs5(svn_repos_t *repos,
       return SVN_NO_ERROR;
     }
 
+  /* Walking the node histories can be slow for paths that rarely change
+     and so is recomputing mergeinfo changes.  Use the log index instead,
+     if there is one. */
+  err = svn_repos__log_index_open(&callbacks.log_index, repos,
+                                  scratch_pool, scratch_pool);
+  if (err)
+    {
+      /* The index is only an optimization.  Do without it. */
+      svn_error_clear(err);
+      callbacks.log_index = NULL;
+    }
+
   /* If we are including merged revisions, then create mergeinfo that
      represents all of PATHS' history between START and END.  We will use
      this later to squelch duplicate log revisions that might exist in
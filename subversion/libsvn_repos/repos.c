@@ -1197,6 +1197,10 @@ svn_repos_create(svn_repos_t **repos_p,
                                            result_pool)));
     }
 
+  /* Start with empty indexes such that all commits get recorded. */
+  SVN_ERR(svn_repos__date_index_rebuild(repos, NULL, NULL, scratch_pool));
+  SVN_ERR(svn_repos__log_index_rebuild(repos, NULL, NULL, scratch_pool));
+
   /* This repository is ready.  Stamp it with a format number. */
   SVN_ERR(svn_io_write_version_file
           (svn_dirent_join(path, SVN_REPOS__FORMAT, scratch_pool),
@@ -1720,6 +1724,21 @@ svn_repos_recover4(const char *path,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_repos__rebuild_indexes(svn_repos_t *repos,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_repos__date_index_rebuild(repos, cancel_func, cancel_baton,
+                                        scratch_pool));
+  SVN_ERR(svn_repos__log_index_rebuild(repos, cancel_func, cancel_baton,
+                                       scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+
 struct freeze_baton_t {
   const apr_array_header_t *paths;
   int counter;
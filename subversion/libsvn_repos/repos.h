@@ -387,6 +387,138 @@ svn_repos__prev_location(svn_revnum_t *appeared_rev,
                          const char *path,
                          apr_pool_t *pool);
 
+/* Set *DELETED_MERGEINFO_CATALOG and *ADDED_MERGEINFO_CATALOG to
+   catalogs describing how mergeinfo values on paths (which are the
+   keys of those catalogs) were changed in REV of FS.  Allocate the
+   result in RESULT_POOL and use SCRATCH_POOL for temporary allocations.
+   Return SVN_ERR_MERGEINFO_PARSE_ERROR if REV contains invalid
+   mergeinfo. */
+svn_error_t *
+svn_repos__fs_mergeinfo_changed(
+  svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+  svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+  svn_fs_t *fs,
+  svn_revnum_t rev,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool);
+
+
+/*** Revision date index ***/
+
+/* Record the svn:date of REVISION in the date index of REPOS, adding the
+   entries of any older revisions that are still missing from the index.
+   If the index does not exist or too many entries are missing, leave it
+   untouched.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__date_index_update(svn_repos_t *repos,
+                             svn_revnum_t revision,
+                             apr_pool_t *scratch_pool);
+
+/* Create the date index of REPOS, replacing any existing one, with entries
+   for all revisions up to HEAD.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_repos__date_index_rebuild(svn_repos_t *repos,
+                              svn_cancel_func_t cancel_func,
+                              void *cancel_baton,
+                              apr_pool_t *scratch_pool);
+
+/* Look up the youngest revision not younger than TM in the date index of
+   REPOS, ignoring any entries beyond YOUNGEST, and return it in *REVISION.
+   Return 0 if all revisions are younger than TM.  Set *LAST_INDEXED to the
+   youngest revision covered by the index.
+
+   The result is only a hint and must be verified by the caller.  If there
+   is no index, set both values to SVN_INVALID_REVNUM.  Use SCRATCH_POOL
+   for temporary allocations. */
+svn_error_t *
+svn_repos__date_index_lookup(svn_revnum_t *revision,
+                             svn_revnum_t *last_indexed,
+                             svn_repos_t *repos,
+                             svn_revnum_t youngest,
+                             apr_time_t tm,
+                             apr_pool_t *scratch_pool);
+
+
+/*** Log index ***/
+
+/* An open log index.  It lists the changed paths and the mergeinfo
+   changes of every revision it covers. */
+typedef struct svn_repos__log_index_t svn_repos__log_index_t;
+
+/* Add the changes of all revisions up to REVISION to the log index
+   of REPOS that are still missing from it.  If the index does not exist
+   or too many revisions are missing, leave it untouched.  Use SCRATCH_POOL
+   for temporary allocations. */
+svn_error_t *
+svn_repos__log_index_update(svn_repos_t *repos,
+                            svn_revnum_t revision,
+                            apr_pool_t *scratch_pool);
+
+/* Create the log index of REPOS, replacing the contents of any existing
+   one, with the changes of all revisions up to HEAD.  Use SCRATCH_POOL
+   for temporary allocations. */
+svn_error_t *
+svn_repos__log_index_rebuild(svn_repos_t *repos,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *scratch_pool);
+
+/* Open the log index of REPOS for reading and return it in *INDEX.  Set
+   *INDEX to NULL if there is no usable index.  The index will be closed
+   when RESULT_POOL gets cleaned up.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_repos__log_index_open(svn_repos__log_index_t **index,
+                          svn_repos_t *repos,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/* Return the youngest revision covered by INDEX. */
+svn_revnum_t
+svn_repos__log_index_youngest(svn_repos__log_index_t *index);
+
+/* Set *REVISION to the youngest revision not younger than MAX_REV in which
+   the node at fspath PATH got changed, according to INDEX.  This includes
+   the implicit addition of PATH through one of its parents.  If there is
+   no such revision, set *REVISION to SVN_INVALID_REVNUM.  Use SCRATCH_POOL
+   for temporary allocations. */
+svn_error_t *
+svn_repos__log_index_prev(svn_revnum_t *revision,
+                          svn_repos__log_index_t *index,
+                          const char *path,
+                          svn_revnum_t max_rev,
+                          apr_pool_t *scratch_pool);
+
+/* Set *ADDED to TRUE if fspath PATH or one of its parents got added or
+   replaced in REVISION, according to INDEX.  If that was a copy, return
+   the location PATH has been copied from in *COPYFROM_PATH, allocated in
+   RESULT_POOL, and *COPYFROM_REV.  Otherwise, set them to NULL and
+   SVN_INVALID_REVNUM, respectively.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_repos__log_index_get_add(svn_boolean_t *added,
+                             const char **copyfrom_path,
+                             svn_revnum_t *copyfrom_rev,
+                             svn_repos__log_index_t *index,
+                             const char *path,
+                             svn_revnum_t revision,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
+/* Like svn_repos__fs_mergeinfo_changed but read the mergeinfo changes
+   of REVISION from INDEX instead of the filesystem.  REVISION must be
+   covered by INDEX.  Revisions with invalid mergeinfo are reported as
+   having no mergeinfo changes. */
+svn_error_t *
+svn_repos__log_index_get_mergeinfo_changes(
+  svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+  svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+  svn_repos__log_index_t *index,
+  svn_revnum_t revision,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
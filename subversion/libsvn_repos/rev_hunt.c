@@ -76,20 +76,23 @@ get_time(apr_time_t *tm,
 }
 
 
-svn_error_t *
-svn_repos_dated_revision(svn_revnum_t *revision,
-                         svn_repos_t *repos,
-                         apr_time_t tm,
-                         apr_pool_t *pool)
+/* Binary-search the revisions REV_FIRST to REV_LATEST in FS for the
+ * youngest revision not younger than TM and return it in *REVISION.
+ * Return REV_FIRST if all revisions in that range are younger than TM.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+find_dated_revision(svn_revnum_t *revision,
+                    svn_fs_t *fs,
+                    apr_time_t tm,
+                    svn_revnum_t rev_first,
+                    svn_revnum_t rev_latest,
+                    apr_pool_t *pool)
 {
-  svn_revnum_t rev_mid, rev_top, rev_bot, rev_latest;
+  svn_revnum_t rev_mid, rev_top, rev_bot;
   apr_time_t this_time;
-  svn_fs_t *fs = repos->fs;
 
   /* Initialize top and bottom values of binary search. */
-  SVN_ERR(svn_fs_youngest_rev(&rev_latest, fs, pool));
-  SVN_ERR(svn_fs_refresh_revision_props(fs, pool));
-  rev_bot = 0;
+  rev_bot = rev_first;
   rev_top = rev_latest;
 
   while (rev_bot <= rev_top)
@@ -101,9 +104,9 @@ svn_repos_dated_revision(svn_revnum_t *revision,
         {
           apr_time_t previous_time;
 
-          if ((rev_mid - 1) < 0)
+          if ((rev_mid - 1) < rev_first)
             {
-              *revision = 0;
+              *revision = rev_first;
               break;
             }
 
@@ -150,6 +153,64 @@ svn_repos_dated_revision(svn_revnum_t *revision,
 }
 
 
+svn_error_t *
+svn_repos_dated_revision(svn_revnum_t *revision,
+                         svn_repos_t *repos,
+                         apr_time_t tm,
+                         apr_pool_t *pool)
+{
+  svn_revnum_t rev_latest, rev_hint, rev_indexed;
+  apr_time_t this_time;
+  svn_fs_t *fs = repos->fs;
+  svn_error_t *err;
+
+  SVN_ERR(svn_fs_youngest_rev(&rev_latest, fs, pool));
+  SVN_ERR(svn_fs_refresh_revision_props(fs, pool));
+
+  /* Ask the date index for a candidate.  It may be missing or out of
+     date, so we only trust it after checking the actual dates. */
+  err = svn_repos__date_index_lookup(&rev_hint, &rev_indexed, repos,
+                                     rev_latest, tm, pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      rev_hint = SVN_INVALID_REVNUM;
+    }
+
+  if (SVN_IS_VALID_REVNUM(rev_hint))
+    {
+      svn_boolean_t valid = TRUE;
+
+      if (rev_hint > 0)
+        {
+          SVN_ERR(get_time(&this_time, fs, rev_hint, pool));
+          valid = this_time <= tm;
+        }
+
+      if (valid && rev_hint < rev_indexed)
+        {
+          /* The next revision must be younger than TM. */
+          SVN_ERR(get_time(&this_time, fs, rev_hint + 1, pool));
+          if (this_time > tm)
+            {
+              *revision = rev_hint;
+              return SVN_NO_ERROR;
+            }
+        }
+      else if (valid)
+        {
+          /* Only revisions not covered by the index can be younger. */
+          return svn_error_trace(find_dated_revision(revision, fs, tm,
+                                                     rev_hint, rev_latest,
+                                                     pool));
+        }
+    }
+
+  return svn_error_trace(find_dated_revision(revision, fs, tm, 0, rev_latest,
+                                             pool));
+}
+
+
 svn_error_t *
 svn_repos_get_committed_info(svn_revnum_t *committed_rev,
                              const char **committed_date,
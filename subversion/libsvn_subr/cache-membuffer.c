@@ -23,10 +23,23 @@
 
 #include <assert.h>
 #include <apr_md5.h>
+#include <apr_strings.h>
 #include <apr_thread_rwlock.h>
+#include <apr_time.h>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "svn_pools.h"
 #include "svn_checksum.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
 #include "svn_private_config.h"
 #include "svn_hash.h"
 #include "svn_string.h"
@@ -129,6 +142,23 @@
  * to scale well despite that bottleneck, we simply segment the cache into
  * a number of independent caches (segments). Items will be multiplexed based
  * on their hash key.
+ *
+ * Where supported, simple lookups don't even take the segment's read lock.
+ * Instead, every write access increments a sequence counter upon entering
+ * and upon leaving the write lock.  Readers record the counter, copy the
+ * data and then check whether the counter is still the same.  If it is
+ * not, a writer may have interfered and the lookup gets repeated under the
+ * read lock.  Because the data will only be modified while holding the
+ * write lock, lookups that succeed this way are always consistent.
+ *
+ * Where supported, the cache may also be placed in a named shared memory
+ * region such that all processes on the same host share the same cache
+ * content, e.g. the worker processes of svnserve or httpd.  Everything
+ * within that region is addressed by offsets and indexes and every
+ * segment is guarded by a process-shared, robust mutex.  If a process
+ * dies while holding a segment lock, the next one to acquire it will
+ * simply clear that segment.  Key prefixes are not pooled for shared
+ * caches because prefix indexes are only valid within a single process.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -146,6 +176,45 @@
 #  define USE_SIMPLE_MUTEX 0
 #endif
 
+/* Optimistic, lock-free lookups require the compiler to provide memory
+ * ordering primitives.  With a simple mutex, there is no distinction
+ * between readers and writers.  In debug mode, the lookups need to verify
+ * the entry tags, which is not supported on the optimistic code path.
+ */
+#if APR_HAS_THREADS && !USE_SIMPLE_MUTEX \
+    && !defined(SVN_DEBUG_CACHE_MEMBUFFER) \
+    && (defined(__clang__) \
+        || (defined(__GNUC__) \
+            && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))))
+#  define USE_OPTIMISTIC_READS 1
+#else
+#  define USE_OPTIMISTIC_READS 0
+#endif
+
+/* Optimistic reads copy the serialized item into a stack buffer of this
+ * size and only allocate the final copy once the read has been validated.
+ * Larger items take the locked path, where the copy cannot fail and its
+ * costs dwarf those of the lock anyway.
+ */
+#define OPTIMISTIC_READ_BUFFER_SIZE 0x1000
+
+/* Caches in shared memory require POSIX shared memory objects as well as
+ * process-shared, robust mutexes.  The latter have been introduced with
+ * POSIX.1-2008.  Robust mutexes allow us to detect processes that died
+ * while holding a segment lock and to recover from that situation.
+ */
+#if APR_HAS_THREADS && !defined(WIN32) \
+    && defined(_POSIX_VERSION) && _POSIX_VERSION >= 200809L \
+    && defined(_POSIX_THREAD_PROCESS_SHARED) \
+    && _POSIX_THREAD_PROCESS_SHARED > 0 \
+    && defined(_POSIX_SHARED_MEMORY_OBJECTS) \
+    && _POSIX_SHARED_MEMORY_OBJECTS > 0
+#  include <pthread.h>
+#  define USE_SHARED_MEMORY 1
+#else
+#  define USE_SHARED_MEMORY 0
+#endif
+
 /* For more efficient copy operations, let's align all data items properly.
  * Since we can't portably align pointers, this is rather the item size
  * granularity which ensures *relative* alignment within the cache - still
@@ -197,6 +266,27 @@
  */
 #define MAX_ITEM_SIZE ((apr_uint32_t)(0 - ITEM_ALIGNMENT))
 
+/* Number of rows, i.e. independent hash functions, in the count-min
+ * frequency sketch used by the TinyLFU admission policy.
+ */
+#define SKETCH_DEPTH 4
+
+/* Frequency sketch counters saturate at this value.  Small counters are
+ * sufficient to tell frequently used keys from rarely used ones.
+ */
+#define SKETCH_MAX_COUNT 15
+
+/* Halve all frequency sketch counters after this many accesses per entry
+ * that the cache segment can hold.  This lets the sketch forget keys that
+ * used to be popular.
+ */
+#define SKETCH_SAMPLE_FACTOR 10
+
+/* Size in bytes of a frequency sketch with WIDTH counters per row.
+ */
+#define SKETCH_SIZE(width) \
+  (SKETCH_DEPTH * (apr_uint64_t)(width) * sizeof(svn_atomic_t))
+
 /* We use this structure to identify cache entries. There cannot be two
  * entries with the same entry key. However unlikely, though, two different
  * full keys (see full_key_t) may have the same entry key.  That is a
@@ -692,39 +782,13 @@ typedef struct cache_level_t
 
 } cache_level_t;
 
-/* The cache header structure.
+/* The part of a cache segment's header that gets modified during cache
+ * operation.  For caches in shared memory, this lives in the shared memory
+ * region as well and all processes attached to it access the same data.
+ * Therefore, it must not contain any pointers.
  */
-struct svn_membuffer_t
+typedef struct segment_state_t
 {
-  /* Number of cache segments. Must be a power of 2.
-     Please note that this structure represents only one such segment
-     and that all segments must / will report the same values here. */
-  apr_uint32_t segment_count;
-
-  /* Collection of prefixes shared among all instances accessing the
-   * same membuffer cache backend.  If a prefix is contained in this
-   * pool then all cache instances using an equal prefix must actually
-   * use the one stored in this pool. */
-  prefix_pool_t *prefix_pool;
-
-  /* The dictionary, GROUP_SIZE * (group_count + spare_group_count)
-   * entries long.  Never NULL.
-   */
-  entry_group_t *directory;
-
-  /* Flag array with group_count / GROUP_INIT_GRANULARITY _bit_ elements.
-   * Allows for efficiently marking groups as "not initialized".
-   */
-  unsigned char *group_initialized;
-
-  /* Size of dictionary in groups. Must be > 0.
-   */
-  apr_uint32_t group_count;
-
-  /* Total number of spare groups.
-   */
-  apr_uint32_t spare_group_count;
-
   /* First recycleable spare group.
    */
   apr_uint32_t first_spare_group;
@@ -735,19 +799,10 @@ struct svn_membuffer_t
    */
   apr_uint32_t max_spare_used;
 
-  /* Pointer to the data buffer, data_size bytes long. Never NULL.
-   */
-  unsigned char *data;
-
   /* Total number of data buffer bytes in use.
    */
   apr_uint64_t data_used;
 
-  /* Largest entry size that we would accept.  For total cache sizes
-   * less than 4TB (sic!), this is determined by the total cache size.
-   */
-  apr_uint64_t max_entry_size;
-
   /* The cache levels, organized as sub-buffers.  Since entries in the
    * DIRECTORY use offsets in DATA for addressing, a cache lookup does
    * not need to know the cache level of a specific item.  Cache levels
@@ -796,6 +851,101 @@ struct svn_membuffer_t
    */
   apr_uint64_t total_hits;
 
+  /* Total number of entries removed to make room for new ones.
+   * Purely statistical information that may be used for profiling only.
+   */
+  apr_uint64_t total_evictions;
+
+  /* Total number of entries that were not admitted to the cache or were
+   * not promoted from L1 to L2.
+   * Purely statistical information that may be used for profiling only.
+   */
+  apr_uint64_t total_rejections;
+
+  /* Number of accesses recorded in the frequency sketch since it has
+   * last been aged.  Readers update it atomically.
+   */
+  volatile svn_atomic_t sketch_additions;
+
+#if USE_OPTIMISTIC_READS
+  /* Sequence counter for optimistic reads.  It is odd while a writer
+   * modifies this segment and gets incremented upon entering and leaving
+   * the write lock.  Must only be modified while holding the write lock.
+   */
+  apr_uint32_t write_sequence;
+#endif
+
+#if USE_SHARED_MEMORY
+  /* Process-shared, robust lock serializing all access to this segment.
+   * Only used if the cache resides in shared memory.
+   */
+  pthread_mutex_t shared_lock;
+#endif
+} segment_state_t;
+
+/* The cache header structure.
+ */
+struct svn_membuffer_t
+{
+  /* Number of cache segments. Must be a power of 2.
+     Please note that this structure represents only one such segment
+     and that all segments must / will report the same values here. */
+  apr_uint32_t segment_count;
+
+  /* Collection of prefixes shared among all instances accessing the
+   * same membuffer cache backend.  If a prefix is contained in this
+   * pool then all cache instances using an equal prefix must actually
+   * use the one stored in this pool. */
+  prefix_pool_t *prefix_pool;
+
+  /* The dictionary, GROUP_SIZE * (group_count + spare_group_count)
+   * entries long.  Never NULL.
+   */
+  entry_group_t *directory;
+
+  /* Flag array with group_count / GROUP_INIT_GRANULARITY _bit_ elements.
+   * Allows for efficiently marking groups as "not initialized".
+   */
+  unsigned char *group_initialized;
+
+  /* Size of dictionary in groups. Must be > 0.
+   */
+  apr_uint32_t group_count;
+
+  /* Total number of spare groups.
+   */
+  apr_uint32_t spare_group_count;
+
+  /* Pointer to the data buffer, data_size bytes long. Never NULL.
+   */
+  unsigned char *data;
+
+  /* Largest entry size that we would accept.  For total cache sizes
+   * less than 4TB (sic!), this is determined by the total cache size.
+   */
+  apr_uint64_t max_entry_size;
+
+  /* Admission and eviction policy to use.
+   */
+  svn_cache__membuffer_policy_t policy;
+
+  /* Count-min sketch of the access frequencies of all keys mapping to
+   * this segment, SKETCH_DEPTH rows of SKETCH_WIDTH counters each.  Only
+   * maintained for svn_cache__membuffer_policy_tinylfu.  Readers update
+   * the counters while holding only the read lock or no lock at all, so
+   * all accesses must be atomic.  Lost updates are harmless, though.
+   */
+  volatile svn_atomic_t *sketch;
+
+  /* Number of counters per sketch row.  Must be a power of 2.
+   */
+  apr_uint32_t sketch_width;
+
+  /* Everything that changes while the cache is being used.  Never NULL.
+   * For shared caches, this points into the shared memory region.
+   */
+  segment_state_t *state;
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   /* A lock for intra-process synchronization to the cache, or NULL if
    * the cache's creator doesn't feel the cache needs to be
@@ -813,6 +963,13 @@ struct svn_membuffer_t
   svn_boolean_t allow_blocking_writes;
 #endif
 
+#if USE_SHARED_MEMORY
+  /* If set, the cache resides in shared memory and this is the lock in
+   * STATE to use instead of LOCK.  NULL for process-local caches.
+   */
+  pthread_mutex_t *shared_lock;
+#endif
+
   /* A write lock counter, must be either 0 or 1.
    * This one is only used in debug assertions to verify that you used
    * the correct multi-threading settings. */
@@ -823,11 +980,137 @@ struct svn_membuffer_t
  */
 #define ALIGN_VALUE(value) (((value) + ITEM_ALIGNMENT-1) & -ITEM_ALIGNMENT)
 
+/* Signal optimistic readers that CACHE is about to get modified.
+ * The caller must hold the write lock.
+ */
+static APR_INLINE void
+begin_modification(svn_membuffer_t *cache)
+{
+#if USE_OPTIMISTIC_READS
+  __atomic_store_n(&cache->state->write_sequence,
+                   cache->state->write_sequence + 1,
+                   __ATOMIC_RELAXED);
+
+  /* Don't let any modification become visible before the counter. */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+/* Signal optimistic readers that all modifications to CACHE are complete.
+ * The caller must hold the write lock.
+ */
+static APR_INLINE void
+end_modification(svn_membuffer_t *cache)
+{
+#if USE_OPTIMISTIC_READS
+  __atomic_store_n(&cache->state->write_sequence,
+                   cache->state->write_sequence + 1,
+                   __ATOMIC_RELEASE);
+#endif
+}
+
+/* Reset the state of SEGMENT to "empty".  Since all groups will be marked
+ * as "not initialized", the contents of the directory does not matter.
+ * The caller must hold the write lock.
+ */
+static void
+reset_segment(svn_membuffer_t *segment)
+{
+  /* Length of the group_initialized array in bytes.
+     See also svn_cache__membuffer_cache_create(). */
+  apr_size_t group_init_size
+    = 1 + (segment->group_count + segment->spare_group_count)
+            / (8 * GROUP_INIT_GRANULARITY);
+  apr_size_t i;
+
+  /* Mark all groups as "not initialized", which implies "empty". */
+  segment->state->first_spare_group = NO_INDEX;
+  segment->state->max_spare_used = 0;
+
+  memset(segment->group_initialized, 0, group_init_size);
+
+  /* Unlink L1 contents. */
+  segment->state->l1.first = NO_INDEX;
+  segment->state->l1.last = NO_INDEX;
+  segment->state->l1.next = NO_INDEX;
+  segment->state->l1.current_data = segment->state->l1.start_offset;
+
+  /* Unlink L2 contents. */
+  segment->state->l2.first = NO_INDEX;
+  segment->state->l2.last = NO_INDEX;
+  segment->state->l2.next = NO_INDEX;
+  segment->state->l2.current_data = segment->state->l2.start_offset;
+
+  /* Reset content counters. */
+  segment->state->data_used = 0;
+  segment->state->used_entries = 0;
+
+  /* Forget the access history. */
+  for (i = 0; i < SKETCH_DEPTH * (apr_size_t)segment->sketch_width; ++i)
+    {
+      svn_atomic_t count = svn_atomic_read(&segment->sketch[i]);
+      svn_atomic_cas(&segment->sketch[i], 0, count);
+    }
+
+  svn_atomic_set(&segment->state->sketch_additions, 0);
+}
+
+#if USE_SHARED_MEMORY
+/* Acquire the process-shared lock of the shared memory CACHE.  If BLOCKING
+ * is not set and the lock is currently being held, set *SUCCESS to FALSE
+ * and return immediately.
+ *
+ * If the previous owner of the lock died while holding it, the segment
+ * contents may be inconsistent.  In that case, reset the segment.
+ */
+static svn_error_t *
+lock_shared_cache(svn_membuffer_t *cache,
+                  svn_boolean_t blocking,
+                  svn_boolean_t *success)
+{
+  int rc = blocking ? pthread_mutex_lock(cache->shared_lock)
+                    : pthread_mutex_trylock(cache->shared_lock);
+
+  if (rc == EBUSY && !blocking)
+    {
+      *success = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  if (rc == EOWNERDEAD)
+    {
+      /* Optimistic readers must not accept anything while we reset the
+       * segment.  The sequence counter is still odd if the previous owner
+       * died while modifying the segment. */
+#if USE_OPTIMISTIC_READS
+      if ((cache->state->write_sequence & 1) == 0)
+        begin_modification(cache);
+#endif
+
+      reset_segment(cache);
+      end_modification(cache);
+
+      rc = pthread_mutex_consistent(cache->shared_lock);
+    }
+
+  if (rc)
+    return svn_error_wrap_apr(APR_FROM_OS_ERROR(rc),
+                              _("Can't lock cache mutex"));
+
+  return SVN_NO_ERROR;
+}
+#endif
+
 /* If locking is supported for CACHE, acquire a read lock for it.
  */
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
+#if USE_SHARED_MEMORY
+  if (cache->shared_lock)
+    return svn_error_trace(lock_shared_cache(cache, TRUE, NULL));
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -851,6 +1134,13 @@ read_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
+#if USE_SHARED_MEMORY
+  if (cache->shared_lock)
+    return svn_error_trace(lock_shared_cache(cache,
+                                             cache->allow_blocking_writes,
+                                             success));
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -888,13 +1178,20 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
+#if USE_SHARED_MEMORY
+  if (cache->shared_lock)
+    return svn_error_trace(lock_shared_cache(cache, TRUE, NULL));
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
-  apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
-  if (status)
-    return svn_error_wrap_apr(status,
-                              _("Can't write-lock cache mutex"));
+  {
+    apr_status_t status = apr_thread_rwlock_wrlock(cache->lock);
+    if (status)
+      return svn_error_wrap_apr(status,
+                                _("Can't write-lock cache mutex"));
+  }
 
   return SVN_NO_ERROR;
 #else
@@ -908,6 +1205,21 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
+#if USE_SHARED_MEMORY
+  if (cache->shared_lock)
+    {
+      int rc = pthread_mutex_unlock(cache->shared_lock);
+      if (err)
+        return err;
+
+      if (rc)
+        return svn_error_wrap_apr(APR_FROM_OS_ERROR(rc),
+                                  _("Can't unlock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__unlock(cache->lock, err);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -927,6 +1239,17 @@ unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 #endif
 }
 
+/* If locking is supported for CACHE, release the current lock
+ * (read or write) after all modifications to CACHE are complete.
+ * Return ERR upon success.
+ */
+static svn_error_t *
+unlock_modified_cache(svn_membuffer_t *cache, svn_error_t *err)
+{
+  end_modification(cache);
+  return unlock_cache(cache, err);
+}
+
 /* If supported, guard the execution of EXPR with a read lock to CACHE.
  * The macro has been modeled after SVN_MUTEX__WITH_LOCK.
  */
@@ -959,7 +1282,8 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  begin_modification(cache);                                    \
+  SVN_ERR(unlock_modified_cache(cache, (expr)));                \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -1017,17 +1341,18 @@ allocate_spare_group(svn_membuffer_t *cache)
   entry_group_t *group = NULL;
 
   /* is there some ready-to-use group? */
-  if (cache->first_spare_group != NO_INDEX)
+  if (cache->state->first_spare_group != NO_INDEX)
     {
-      group = &cache->directory[cache->first_spare_group];
-      cache->first_spare_group = group->header.next;
+      group = &cache->directory[cache->state->first_spare_group];
+      cache->state->first_spare_group = group->header.next;
     }
 
   /* any so far untouched spares available? */
-  else if (cache->max_spare_used < cache->spare_group_count)
+  else if (cache->state->max_spare_used < cache->spare_group_count)
     {
-      apr_uint32_t group_index = cache->group_count + cache->max_spare_used;
-      ++cache->max_spare_used;
+      apr_uint32_t group_index
+        = cache->group_count + cache->state->max_spare_used;
+      ++cache->state->max_spare_used;
 
       if (!is_group_initialized(cache, group_index))
         initialize_group(cache, group_index);
@@ -1056,8 +1381,8 @@ free_spare_group(svn_membuffer_t *cache,
   group->header.previous = NO_INDEX;
 
   /* add to chain of spares */
-  group->header.next = cache->first_spare_group;
-  cache->first_spare_group = (apr_uint32_t) (group - cache->directory);
+  group->header.next = cache->state->first_spare_group;
+  cache->state->first_spare_group = (apr_uint32_t) (group - cache->directory);
 }
 
 /* Follow the group chain from GROUP in CACHE to its end and return the last
@@ -1114,8 +1439,8 @@ get_index(svn_membuffer_t *cache, entry_t *entry)
 static cache_level_t *
 get_cache_level(svn_membuffer_t *cache, entry_t *entry)
 {
-  return entry->offset < cache->l1.size ? &cache->l1
-                                        : &cache->l2;
+  return entry->offset < cache->state->l1.size ? &cache->state->l1
+                                        : &cache->state->l2;
 }
 
 /* Insert ENTRY to the chain of items that belong to LEVEL in CACHE.  IDX
@@ -1219,8 +1544,8 @@ drop_entry(svn_membuffer_t *cache, entry_t *entry)
 
   /* update global cache usage counters
    */
-  cache->used_entries--;
-  cache->data_used -= entry->size;
+  cache->state->used_entries--;
+  cache->state->data_used -= entry->size;
 
   /* extend the insertion window, if the entry happens to border it
    */
@@ -1289,6 +1614,16 @@ drop_entry(svn_membuffer_t *cache, entry_t *entry)
     free_spare_group(cache, last_group);
 }
 
+/* Remove the used ENTRY from the CACHE to make room for new data.
+ * Same as drop_entry() but counts as an eviction.
+ */
+static void
+evict_entry(svn_membuffer_t *cache, entry_t *entry)
+{
+  cache->state->total_evictions++;
+  drop_entry(cache, entry);
+}
+
 /* Insert ENTRY into the chain of used dictionary entries. The entry's
  * offset and size members must already have been initialized. Also,
  * the offset must match the beginning of the insertion window.
@@ -1312,8 +1647,8 @@ insert_entry(svn_membuffer_t *cache, entry_t *entry)
 
   /* update usage counters
    */
-  cache->used_entries++;
-  cache->data_used += entry->size;
+  cache->state->used_entries++;
+  cache->state->data_used += entry->size;
   entry->hit_count = 0;
   group->header.used++;
 
@@ -1365,6 +1700,99 @@ let_entry_age(svn_membuffer_t *cache, entry_t *entry)
     }
 }
 
+/* Return the index of the counter for KEY in row ROW of the frequency
+ * sketch in CACHE.
+ */
+static APR_INLINE apr_size_t
+get_sketch_index(svn_membuffer_t *cache,
+                 const entry_key_t *key,
+                 int row)
+{
+  /* Fingerprints are already well-distributed hash values.  Mix them
+   * with a different odd multiplier per row to get independent hashes. */
+  static const apr_uint64_t factors[SKETCH_DEPTH]
+    = { APR_UINT64_C(0x9e3779b97f4a7c15), APR_UINT64_C(0xc2b2ae3d27d4eb4f),
+        APR_UINT64_C(0x165667b19e3779f9), APR_UINT64_C(0xff51afd7ed558ccd) };
+
+  apr_uint64_t hash = key->fingerprint[0]
+                    ^ (key->fingerprint[1] * factors[row])
+                    ^ key->prefix_idx;
+  hash *= factors[row];
+
+  return row * (apr_size_t)cache->sketch_width
+       + (apr_size_t)((hash >> 32) & (cache->sketch_width - 1));
+}
+
+/* Record an access to KEY in the frequency sketch of CACHE, if the
+ * current policy needs that information.  The caller may hold the read
+ * lock only.  Increments lost due to concurrent access are harmless.
+ */
+static APR_INLINE void
+record_access(svn_membuffer_t *cache,
+              const entry_key_t *key)
+{
+  int row;
+  if (cache->policy != svn_cache__membuffer_policy_tinylfu)
+    return;
+
+  for (row = 0; row < SKETCH_DEPTH; ++row)
+    {
+      volatile svn_atomic_t *counter
+        = &cache->sketch[get_sketch_index(cache, key, row)];
+      svn_atomic_t count = svn_atomic_read(counter);
+
+      if (count < SKETCH_MAX_COUNT)
+        svn_atomic_cas(counter, count + 1, count);
+    }
+
+  svn_atomic_inc(&cache->state->sketch_additions);
+}
+
+/* Return the estimated number of recent accesses to KEY in CACHE.
+ */
+static apr_uint32_t
+estimate_frequency(svn_membuffer_t *cache,
+                   const entry_key_t *key)
+{
+  apr_uint32_t result = SKETCH_MAX_COUNT;
+  int row;
+
+  for (row = 0; row < SKETCH_DEPTH; ++row)
+    result = MIN(result,
+                 svn_atomic_read(&cache->sketch[get_sketch_index(cache, key,
+                                                                 row)]));
+
+  return result;
+}
+
+/* Halve all counters in the frequency sketch of CACHE once enough accesses
+ * have been recorded.  The caller must hold the write lock.  Optimistic
+ * readers may still update the counters concurrently.
+ */
+static void
+age_sketch(svn_membuffer_t *cache)
+{
+  apr_size_t i;
+  apr_size_t count = SKETCH_DEPTH * (apr_size_t)cache->sketch_width;
+  apr_uint64_t limit
+    = MIN((apr_uint64_t)cache->group_count * GROUP_SIZE
+            * SKETCH_SAMPLE_FACTOR,
+          APR_UINT32_MAX / 2);
+
+  if (svn_atomic_read(&cache->state->sketch_additions) < limit)
+    return;
+
+  for (i = 0; i < count; ++i)
+    {
+      /* If this races with an increment, we simply skip aging this
+       * counter for this round. */
+      svn_atomic_t value = svn_atomic_read(&cache->sketch[i]);
+      svn_atomic_cas(&cache->sketch[i], value / 2, value);
+    }
+
+  svn_atomic_set(&cache->state->sketch_additions, 0);
+}
+
 /* Return whether the keys in LHS and RHS match.
  */
 static svn_boolean_t
@@ -1522,7 +1950,7 @@ find_entry(svn_membuffer_t *cache,
 
               cache_level_t *level
                 = get_cache_level(cache, &to_shrink->entries[i]);
-              if (   (level != entry_level && entry_level == &cache->l1)
+              if (   (level != entry_level && entry_level == &cache->state->l1)
                   || (entry->hit_count > to_shrink->entries[i].hit_count))
                 {
                   entry_level = level;
@@ -1538,7 +1966,7 @@ find_entry(svn_membuffer_t *cache,
             if (entry != &to_shrink->entries[i])
               let_entry_age(cache, &to_shrink->entries[i]);
 
-          drop_entry(cache, entry);
+          evict_entry(cache, entry);
         }
 
       /* initialize entry for the new key
@@ -1550,20 +1978,123 @@ find_entry(svn_membuffer_t *cache,
   return entry;
 }
 
-/* Move a surviving ENTRY from just behind the insertion window to
- * its beginning and move the insertion window up accordingly.
+#if USE_OPTIMISTIC_READS
+
+/* Start an optimistic, i.e. lock-free, read from CACHE and return the
+ * sequence number to pass to end_optimistic_read.  Reads from CACHE
+ * following this call will not be reordered before it.
  */
-static void
-move_entry(svn_membuffer_t *cache, entry_t *entry)
+static APR_INLINE apr_uint32_t
+begin_optimistic_read(svn_membuffer_t *cache)
 {
-  apr_size_t size = ALIGN_VALUE(entry->size);
-  cache_level_t *level = get_cache_level(cache, entry);
-
-  /* This entry survived this cleansing run. Reset half of its
-   * hit count so that its removal gets more likely in the next
-   * run unless someone read / hit this entry in the meantime.
-   */
-  let_entry_age(cache, entry);
+  return __atomic_load_n(&cache->state->write_sequence, __ATOMIC_ACQUIRE);
+}
+
+/* Return TRUE if CACHE has not been modified since begin_optimistic_read
+ * returned SEQUENCE, i.e. if all data read from CACHE in the meantime is
+ * consistent.
+ */
+static APR_INLINE svn_boolean_t
+end_optimistic_read(svn_membuffer_t *cache, apr_uint32_t sequence)
+{
+  /* Don't let any of the data reads be reordered behind the check. */
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+  return (sequence & 1) == 0
+      && __atomic_load_n(&cache->state->write_sequence, __ATOMIC_RELAXED)
+         == sequence;
+}
+
+/* Lock-free variant of find_entry with FIND_EMPTY being FALSE.  Return
+ * the entry in group GROUP_INDEX of CACHE that matches TO_FIND as well as
+ * its data *OFFSET and *SIZE.  Return NULL if there is no such entry.
+ *
+ * Since writers may modify CACHE at any time, the result is only valid if
+ * end_optimistic_read succeeds afterwards.  However, inconsistent index
+ * data will never cause this function to access memory outside CACHE's
+ * directory and data buffers.
+ */
+static entry_t *
+find_entry_optimistic(svn_membuffer_t *cache,
+                      apr_uint32_t group_index,
+                      const full_key_t *to_find,
+                      apr_uint64_t *offset,
+                      apr_size_t *size)
+{
+  apr_uint32_t group_count = cache->group_count + cache->spare_group_count;
+  apr_uint64_t data_size = cache->state->l1.size + cache->state->l2.size;
+  apr_size_t key_len = to_find->entry_key.key_len;
+  entry_group_t *group = &cache->directory[group_index];
+  entry_t *entry = NULL;
+  apr_size_t i, chain_length;
+
+  if (! is_group_initialized(cache, group_index))
+    return NULL;
+
+  /* Chains can't be longer than MAX_GROUP_CHAIN_LENGTH but torn reads
+   * might make them look circular. */
+  for (chain_length = 0;
+       entry == NULL && chain_length < MAX_GROUP_CHAIN_LENGTH;
+       ++chain_length)
+    {
+      apr_uint32_t used = __atomic_load_n(&group->header.used,
+                                          __ATOMIC_RELAXED);
+      apr_uint32_t next = __atomic_load_n(&group->header.next,
+                                          __ATOMIC_RELAXED);
+
+      for (i = 0; i < MIN(used, GROUP_SIZE); ++i)
+        if (entry_keys_match(&group->entries[i].key, &to_find->entry_key))
+          {
+            entry = &group->entries[i];
+            break;
+          }
+
+      if (entry == NULL)
+        {
+          if (next >= group_count)
+            return NULL;
+
+          group = &cache->directory[next];
+        }
+    }
+
+  if (entry == NULL)
+    return NULL;
+
+  /* Make sure we stay within the data buffer. */
+  *offset = __atomic_load_n(&entry->offset, __ATOMIC_RELAXED);
+  *size = __atomic_load_n(&entry->size, __ATOMIC_RELAXED);
+  if (   *size < key_len
+      || *size > cache->max_entry_size
+      || *offset > data_size
+      || ALIGN_VALUE(*size) > data_size - *offset)
+    return NULL;
+
+  /* Compare the full key, if necessary.  As in find_entry, a key conflict
+   * means that the item is not cached. */
+  if (key_len && memcmp(to_find->full_key.data, cache->data + *offset,
+                        key_len) != 0)
+    return NULL;
+
+  return entry;
+}
+
+#endif /* USE_OPTIMISTIC_READS */
+
+/* Move a surviving ENTRY from just behind the insertion window to
+ * its beginning and move the insertion window up accordingly.
+ */
+static void
+move_entry(svn_membuffer_t *cache, entry_t *entry)
+{
+  apr_size_t size = ALIGN_VALUE(entry->size);
+  cache_level_t *level = get_cache_level(cache, entry);
+
+  /* This entry survived this cleansing run. Reset half of its
+   * hit count so that its removal gets more likely in the next
+   * run unless someone read / hit this entry in the meantime.
+   */
+  let_entry_age(cache, entry);
 
   /* Move the entry to the start of the empty / insertion section
    * (if it isn't there already). Size-aligned moves are legal
@@ -1597,24 +2128,24 @@ promote_entry(svn_membuffer_t *cache, entry_t *entry)
 {
   apr_uint32_t idx = get_index(cache, entry);
   apr_size_t size = ALIGN_VALUE(entry->size);
-  assert(get_cache_level(cache, entry) == &cache->l1);
-  assert(idx == cache->l1.next);
+  assert(get_cache_level(cache, entry) == &cache->state->l1);
+  assert(idx == cache->state->l1.next);
 
   /* copy item from the current location in L1 to the start of L2's
    * insertion window */
-  memmove(cache->data + cache->l2.current_data,
+  memmove(cache->data + cache->state->l2.current_data,
           cache->data + entry->offset,
           size);
-  entry->offset = cache->l2.current_data;
+  entry->offset = cache->state->l2.current_data;
 
   /* The insertion position is now directly behind this entry.
    */
-  cache->l2.current_data += size;
+  cache->state->l2.current_data += size;
 
   /* remove ENTRY from chain of L1 entries and put it into L2
    */
-  unchain_entry(cache, &cache->l1, entry, idx);
-  chain_entry(cache, &cache->l2, entry, idx);
+  unchain_entry(cache, &cache->state->l1, entry, idx);
+  chain_entry(cache, &cache->state->l2, entry, idx);
 }
 
 /* This function implements the cache insertion / eviction strategy for L2.
@@ -1650,6 +2181,12 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
   apr_uint64_t drop_hits_limit = (to_fit_in->hit_count + 1)
                                * (apr_uint64_t)to_fit_in->priority;
 
+  /* recent access frequency of the new entry (TinyLFU only) */
+  apr_uint32_t frequency
+    = cache->policy == svn_cache__membuffer_policy_tinylfu
+    ? estimate_frequency(cache, &to_fit_in->key)
+    : 0;
+
   /* This loop will eventually terminate because every cache entry
    * would get dropped eventually:
    *
@@ -1664,13 +2201,13 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
     {
       /* first offset behind the insertion window
        */
-      apr_uint64_t end = cache->l2.next == NO_INDEX
-                       ? cache->l2.start_offset + cache->l2.size
-                       : get_entry(cache, cache->l2.next)->offset;
+      apr_uint64_t end = cache->state->l2.next == NO_INDEX
+                       ? cache->state->l2.start_offset + cache->state->l2.size
+                       : get_entry(cache, cache->state->l2.next)->offset;
 
       /* leave function as soon as the insertion window is large enough
        */
-      if (end - cache->l2.current_data >= to_fit_in->size)
+      if (end - cache->state->l2.current_data >= to_fit_in->size)
         return TRUE;
 
       /* Don't be too eager to cache data.  If a lot of data has been moved
@@ -1689,20 +2226,20 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
 
       /* try to enlarge the insertion window
        */
-      if (cache->l2.next == NO_INDEX)
+      if (cache->state->l2.next == NO_INDEX)
         {
           /* We reached the end of the data buffer; restart at the beginning.
            * Due to the randomized nature of our LFU implementation, very
            * large data items may require multiple passes. Therefore, SIZE
            * should be restricted to significantly less than data_size.
            */
-          cache->l2.current_data = cache->l2.start_offset;
-          cache->l2.next = cache->l2.first;
+          cache->state->l2.current_data = cache->state->l2.start_offset;
+          cache->state->l2.next = cache->state->l2.first;
         }
       else
         {
           svn_boolean_t keep;
-          entry = get_entry(cache, cache->l2.next);
+          entry = get_entry(cache, cache->state->l2.next);
 
           if (to_fit_in->priority < SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY)
             {
@@ -1722,6 +2259,24 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
                */
               keep = FALSE;
             }
+          else if (   cache->policy == svn_cache__membuffer_policy_tinylfu
+                   && to_fit_in->priority == entry->priority)
+            {
+              /* Only admit the new entry if it has been requested more
+               * often than the entry it replaces.  Entries that are being
+               * read only once, e.g. during a large export, will never
+               * replace entries that are being used over and over again.
+               */
+              if (estimate_frequency(cache, &entry->key) >= frequency)
+                {
+                  /* Let the victim age and move on, such that the next
+                   * candidate does not get compared with it again. */
+                  move_entry(cache, entry);
+                  return FALSE;
+                }
+
+              keep = FALSE;
+            }
           else
             {
               /* If the existing data is the same prio as the incoming data,
@@ -1755,7 +2310,7 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
               if (entry->priority > SVN_CACHE__MEMBUFFER_LOW_PRIORITY)
                 drop_hits += entry->hit_count * (apr_uint64_t)entry->priority;
 
-              drop_entry(cache, entry);
+              evict_entry(cache, entry);
             }
         }
     }
@@ -1777,7 +2332,7 @@ static svn_boolean_t
 ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
 {
   /* Guarantees that the while loop will terminate. */
-  if (size > cache->l1.size)
+  if (size > cache->state->l1.size)
     return FALSE;
 
   /* This loop will eventually terminate because every cache entry
@@ -1787,28 +2342,28 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
     {
       /* first offset behind the insertion window
        */
-      apr_uint32_t entry_index = cache->l1.next;
+      apr_uint32_t entry_index = cache->state->l1.next;
       entry_t *entry = get_entry(cache, entry_index);
-      apr_uint64_t end = cache->l1.next == NO_INDEX
-                       ? cache->l1.start_offset + cache->l1.size
+      apr_uint64_t end = cache->state->l1.next == NO_INDEX
+                       ? cache->state->l1.start_offset + cache->state->l1.size
                        : entry->offset;
 
       /* leave function as soon as the insertion window is large enough
        */
-      if (end - cache->l1.current_data >= size)
+      if (end - cache->state->l1.current_data >= size)
         return TRUE;
 
       /* Enlarge the insertion window
        */
-      if (cache->l1.next == NO_INDEX)
+      if (cache->state->l1.next == NO_INDEX)
         {
           /* We reached the end of the data buffer; restart at the beginning.
            * Due to the randomized nature of our LFU implementation, very
            * large data items may require multiple passes. Therefore, SIZE
            * should be restricted to significantly less than data_size.
            */
-          cache->l1.current_data = cache->l1.start_offset;
-          cache->l1.next = cache->l1.first;
+          cache->state->l1.current_data = cache->state->l1.start_offset;
+          cache->state->l1.next = cache->state->l1.first;
         }
       else
         {
@@ -1818,12 +2373,17 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
           svn_boolean_t keep = ensure_data_insertable_l2(cache, entry);
 
           /* We might have touched the group that contains ENTRY. Recheck. */
-          if (entry_index == cache->l1.next)
+          if (entry_index == cache->state->l1.next)
             {
               if (keep)
-                promote_entry(cache, entry);
+                {
+                  promote_entry(cache, entry);
+                }
               else
-                drop_entry(cache, entry);
+                {
+                  cache->state->total_rejections++;
+                  drop_entry(cache, entry);
+                }
             }
         }
     }
@@ -1832,30 +2392,281 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
    * right answer. */
 }
 
-svn_error_t *
-svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
-                                  apr_size_t total_size,
-                                  apr_size_t directory_size,
-                                  apr_size_t segment_count,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t allow_blocking_writes,
-                                  apr_pool_t *pool)
+#if USE_SHARED_MEMORY
+
+/* Value of shared_header_t.magic.  Change it whenever the layout of the
+ * shared memory region changes in incompatible ways. */
+#define SHARED_CACHE_MAGIC 0x53564d33
+
+/* Alignment of the various sections within the shared memory region.
+ * Using the group size keeps the directory groups within memory pages. */
+#define SHARED_ALIGN(value) \
+  (((value) + GROUP_BLOCK_SIZE - 1) & ~(apr_uint64_t)(GROUP_BLOCK_SIZE - 1))
+
+/* Maximum time in microseconds to wait for another process to finish the
+ * initialization of a shared memory cache. */
+#define SHARED_INIT_TIMEOUT (5 * APR_USEC_PER_SEC)
+
+/* Header at the beginning of a shared memory region containing a
+ * membuffer cache.  It is followed by SEGMENT_COUNT instances of
+ * segment_state_t and then by the directory, the group initialization
+ * flags and the data buffer of each segment, in that order.
+ */
+typedef struct shared_header_t
+{
+  /* Set to TRUE by the creator of the region once all segment states
+   * and locks have been initialized. */
+  volatile svn_atomic_t ready;
+
+  /* Must be SHARED_CACHE_MAGIC. */
+  apr_uint32_t magic;
+
+  /* Size of the various structures in the region.  Used to detect
+   * regions created by incompatible builds. */
+  apr_uint32_t header_size;
+  apr_uint32_t state_size;
+  apr_uint32_t group_size;
+
+  /* Geometry of the cache.  Must match for all processes. */
+  apr_uint32_t segment_count;
+  apr_uint32_t group_count;
+  apr_uint32_t spare_group_count;
+  apr_uint64_t data_size;
+} shared_header_t;
+
+/* Set *OBJECT_NAME to the name of the POSIX shared memory object for the
+ * shared cache NAME.  Allocate the result in RESULT_POOL. */
+static svn_error_t *
+shared_object_name(const char **object_name,
+                   const char *name,
+                   apr_pool_t *result_pool)
+{
+  const char *base_name = *name == '/' ? name + 1 : name;
+
+  if (*base_name == '\0' || strchr(base_name, '/'))
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Invalid shared memory cache name '%s'"),
+                             name);
+
+  *object_name = apr_pstrcat(result_pool, "/", base_name, SVN_VA_NULL);
+  return SVN_NO_ERROR;
+}
+
+/* Baton type for unmap_shared_region. */
+typedef struct shared_mapping_t
+{
+  /* Start address of the mapping. */
+  void *region;
+
+  /* Size of the mapping in bytes. */
+  size_t size;
+} shared_mapping_t;
+
+/* Pool cleanup function unmapping the shared_mapping_t in DATA. */
+static apr_status_t
+unmap_shared_region(void *data)
+{
+  shared_mapping_t *mapping = data;
+  munmap(mapping->region, mapping->size);
+
+  return APR_SUCCESS;
+}
+
+/* Map the shared memory cache NAME of REGION_SIZE bytes into our address
+ * space and return the region in *HEADER.  If no such cache exists, create
+ * it, set *CREATED and leave the initialization to the caller.  Otherwise,
+ * wait for its creator to finish the initialization.  Unmap the region
+ * when POOL gets cleaned up.
+ */
+static svn_error_t *
+map_shared_region(shared_header_t **header,
+                  svn_boolean_t *created,
+                  const char *name,
+                  apr_uint64_t region_size,
+                  apr_pool_t *pool)
+{
+  const char *object_name;
+  struct stat info;
+  shared_mapping_t *mapping;
+  void *region;
+  int fd;
+  apr_time_t deadline = apr_time_now() + SHARED_INIT_TIMEOUT;
+
+  SVN_ERR(shared_object_name(&object_name, name, pool));
+  if (region_size != (size_t)region_size)
+    return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+  /* Exactly one process will be able to create the object. */
+  *created = FALSE;
+  fd = shm_open(object_name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd >= 0)
+    {
+      /* The new object is empty, i.e. all pages are zero.  Since zero
+       * means "not initialized" for the directory groups, all we need to
+       * initialize are the header and the segment states. */
+      if (ftruncate(fd, (off_t)region_size))
+        {
+          apr_status_t status = APR_FROM_OS_ERROR(errno);
+          close(fd);
+          shm_unlink(object_name);
+          return svn_error_wrap_apr(status,
+                                    _("Can't create shared memory cache "
+                                      "'%s'"), name);
+        }
+
+      *created = TRUE;
+    }
+  else if (errno == EEXIST)
+    {
+      fd = shm_open(object_name, O_RDWR, 0);
+      if (fd < 0)
+        return svn_error_wrap_apr(APR_FROM_OS_ERROR(errno),
+                                  _("Can't open shared memory cache '%s'"),
+                                  name);
+
+      /* The creator may not have set the size, yet. */
+      do
+        {
+          if (fstat(fd, &info))
+            {
+              apr_status_t status = APR_FROM_OS_ERROR(errno);
+              close(fd);
+              return svn_error_wrap_apr(status,
+                                        _("Can't open shared memory cache "
+                                          "'%s'"), name);
+            }
+
+          if (info.st_size == 0)
+            apr_sleep(1000);
+        }
+      while (info.st_size == 0 && apr_time_now() < deadline);
+
+      if ((apr_uint64_t)info.st_size != region_size)
+        {
+          close(fd);
+          return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                   _("Shared memory cache '%s' has a "
+                                     "different size"), name);
+        }
+    }
+  else
+    {
+      return svn_error_wrap_apr(APR_FROM_OS_ERROR(errno),
+                                _("Can't create shared memory cache '%s'"),
+                                name);
+    }
+
+  region = mmap(NULL, (size_t)region_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (region == MAP_FAILED)
+    {
+      apr_status_t status = APR_FROM_OS_ERROR(errno);
+      if (*created)
+        shm_unlink(object_name);
+
+      return svn_error_wrap_apr(status,
+                                _("Can't map shared memory cache '%s'"),
+                                name);
+    }
+
+  *header = region;
+
+  mapping = apr_palloc(pool, sizeof(*mapping));
+  mapping->region = region;
+  mapping->size = (size_t)region_size;
+  apr_pool_cleanup_register(pool, mapping, unmap_shared_region,
+                            apr_pool_cleanup_null);
+
+  /* Wait for the creator to finish the initialization.  If it died while
+   * doing so, remove the object such that the next attempt will start
+   * over with a new one. */
+  if (!*created)
+    {
+      while (!svn_atomic_read(&(*header)->ready))
+        {
+          if (apr_time_now() >= deadline)
+            {
+              shm_unlink(object_name);
+              return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                       _("Shared memory cache '%s' has "
+                                         "not been initialized"), name);
+            }
+
+          apr_sleep(1000);
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Initialize the process-shared, robust lock in STATE. */
+static svn_error_t *
+init_shared_lock(segment_state_t *state)
+{
+  pthread_mutexattr_t attr;
+  int rc = pthread_mutexattr_init(&attr);
+
+  if (!rc)
+    rc = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  if (!rc)
+    rc = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  if (!rc)
+    rc = pthread_mutex_init(&state->shared_lock, &attr);
+
+  pthread_mutexattr_destroy(&attr);
+  if (rc)
+    return svn_error_wrap_apr(APR_FROM_OS_ERROR(rc),
+                              _("Can't create cache mutex"));
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* USE_SHARED_MEMORY */
+
+/* Implement svn_cache__membuffer_cache_create and
+ * svn_cache__membuffer_cache_create_shared.  If SHARED_NAME is not NULL,
+ * place the cache in the shared memory region of that name.
+ */
+static svn_error_t *
+membuffer_cache_create(svn_membuffer_t **cache,
+                       apr_size_t total_size,
+                       apr_size_t directory_size,
+                       apr_size_t segment_count,
+                       svn_boolean_t thread_safe,
+                       svn_boolean_t allow_blocking_writes,
+                       const char *shared_name,
+                       apr_pool_t *pool)
 {
   svn_membuffer_t *c;
   prefix_pool_t *prefix_pool;
+  segment_state_t *states;
+  svn_boolean_t initialize = TRUE;
 
   apr_uint32_t seg;
   apr_uint32_t group_count;
   apr_uint32_t main_group_count;
   apr_uint32_t spare_group_count;
   apr_uint32_t group_init_size;
+  apr_uint32_t sketch_width;
+  apr_uint64_t sketch_entries;
   apr_uint64_t data_size;
   apr_uint64_t max_entry_size;
 
+#if USE_SHARED_MEMORY
+  shared_header_t *header = NULL;
+  apr_uint64_t segment_offset = 0;
+  apr_uint64_t segment_size = 0;
+#endif
+
   /* Allocate 1% of the cache capacity to the prefix string pool.
+   * Prefix indexes are process-specific, so don't use them for
+   * shared caches.
    */
-  SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100, thread_safe,
-                             pool));
+  SVN_ERR(prefix_pool_create(&prefix_pool,
+                             shared_name ? 0 : total_size / 100,
+                             thread_safe, pool));
   total_size -= total_size / 100;
 
   /* Limit the total size (only relevant if we can address > 4GB)
@@ -1963,6 +2774,55 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   assert(spare_group_count > 0 && main_group_count > 0);
 
   group_init_size = 1 + group_count / (8 * GROUP_INIT_GRANULARITY);
+
+  /* The frequency sketch has about one counter per cache entry. */
+  sketch_entries = (apr_uint64_t)main_group_count * GROUP_SIZE / SKETCH_DEPTH;
+  sketch_width = 16;
+  while (sketch_width < sketch_entries && sketch_width < APR_UINT32_MAX / 2)
+    sketch_width *= 2;
+
+#if USE_SHARED_MEMORY
+  if (shared_name)
+    {
+      /* Map or create the shared memory region.  It contains the segment
+       * states followed by the directory, the initialization flags and
+       * the data buffer of each segment. */
+      segment_offset = SHARED_ALIGN(sizeof(*header)
+                                    + segment_count * sizeof(*states));
+      segment_size = SHARED_ALIGN(group_count * sizeof(entry_group_t))
+                   + SHARED_ALIGN(group_init_size)
+                   + SHARED_ALIGN(SKETCH_SIZE(sketch_width))
+                   + SHARED_ALIGN(ALIGN_VALUE(data_size));
+
+      SVN_ERR(map_shared_region(&header, &initialize, shared_name,
+                                segment_offset
+                                  + segment_count * segment_size,
+                                pool));
+
+      /* Some other process already initialized the region.  Make sure
+       * it uses the same layout as we do. */
+      if (   !initialize
+          && (   header->magic != SHARED_CACHE_MAGIC
+              || header->header_size != sizeof(*header)
+              || header->state_size != sizeof(*states)
+              || header->group_size != sizeof(entry_group_t)
+              || header->segment_count != segment_count
+              || header->group_count != main_group_count
+              || header->spare_group_count != spare_group_count
+              || header->data_size != data_size))
+        return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                 _("Shared memory cache '%s' has a "
+                                   "different size or format"),
+                                 shared_name);
+
+      states = (segment_state_t *)(header + 1);
+    }
+  else
+#endif
+    {
+      states = apr_palloc(pool, segment_count * sizeof(*states));
+    }
+
   for (seg = 0; seg < segment_count; ++seg)
     {
       /* allocate buffers and initialize cache members
@@ -1972,57 +2832,102 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
 
       c[seg].group_count = main_group_count;
       c[seg].spare_group_count = spare_group_count;
-      c[seg].first_spare_group = NO_INDEX;
-      c[seg].max_spare_used = 0;
-
-      /* Allocate but don't clear / zero the directory because it would add
-         significantly to the server start-up time if the caches are large.
-         Group initialization will take care of that in stead. */
-      c[seg].directory = apr_palloc(pool,
-                                    group_count * sizeof(entry_group_t));
-
-      /* Allocate and initialize directory entries as "not initialized",
-         hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
-
-      /* Allocate 1/4th of the data buffer to L1
-       */
-      c[seg].l1.first = NO_INDEX;
-      c[seg].l1.last = NO_INDEX;
-      c[seg].l1.next = NO_INDEX;
-      c[seg].l1.start_offset = 0;
-      c[seg].l1.size = ALIGN_VALUE(data_size / 4);
-      c[seg].l1.current_data = 0;
-
-      /* The remaining 3/4th will be used as L2
-       */
-      c[seg].l2.first = NO_INDEX;
-      c[seg].l2.last = NO_INDEX;
-      c[seg].l2.next = NO_INDEX;
-      c[seg].l2.start_offset = c[seg].l1.size;
-      c[seg].l2.size = ALIGN_VALUE(data_size) - c[seg].l1.size;
-      c[seg].l2.current_data = c[seg].l2.start_offset;
-
-      /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
-      c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
-      c[seg].data_used = 0;
       c[seg].max_entry_size = max_entry_size;
+      c[seg].policy = svn_cache__membuffer_policy_default;
+      c[seg].sketch_width = sketch_width;
+      c[seg].state = &states[seg];
 
-      c[seg].used_entries = 0;
-      c[seg].total_reads = 0;
-      c[seg].total_writes = 0;
-      c[seg].total_hits = 0;
+#if USE_SHARED_MEMORY
+      c[seg].shared_lock = NULL;
+      if (header)
+        {
+          /* Everything has already been allocated in the shared memory
+           * region and zero-initialized by the OS.  Hence, all groups are
+           * "not initialized", i.e. unused. */
+          unsigned char *base = (unsigned char *)header
+                              + segment_offset + seg * segment_size;
+
+          c[seg].directory = (entry_group_t *)base;
+          base += SHARED_ALIGN(group_count * sizeof(entry_group_t));
+          c[seg].group_initialized = base;
+          base += SHARED_ALIGN(group_init_size);
+          c[seg].sketch = base;
+          base += SHARED_ALIGN(SKETCH_SIZE(sketch_width));
+          c[seg].data = base;
+
+          c[seg].shared_lock = &states[seg].shared_lock;
+          if (initialize)
+            SVN_ERR(init_shared_lock(&states[seg]));
+        }
+      else
+#endif
+        {
+          /* Allocate but don't clear / zero the directory because it would
+             add significantly to the server start-up time if the caches
+             are large. Group initialization will take care of that in
+             stead. */
+          c[seg].directory = apr_palloc(pool,
+                                        group_count * sizeof(entry_group_t));
+
+          /* Allocate and initialize directory entries as "not initialized",
+             hence "unused" */
+          c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+
+          /* No accesses have been recorded, yet. */
+          c[seg].sketch = apr_pcalloc(pool, SKETCH_SIZE(sketch_width));
+
+          /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
+          c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
+        }
 
       /* were allocations successful?
        * If not, initialize a minimal cache structure.
        */
-      if (c[seg].data == NULL || c[seg].directory == NULL)
+      if (   c[seg].data == NULL || c[seg].directory == NULL
+          || c[seg].sketch == NULL)
         {
           /* We are OOM. There is no need to proceed with "half a cache".
            */
           return svn_error_wrap_apr(APR_ENOMEM, "OOM");
         }
 
+      if (initialize)
+        {
+          c[seg].state->first_spare_group = NO_INDEX;
+          c[seg].state->max_spare_used = 0;
+
+          /* Allocate 1/4th of the data buffer to L1
+           */
+          c[seg].state->l1.first = NO_INDEX;
+          c[seg].state->l1.last = NO_INDEX;
+          c[seg].state->l1.next = NO_INDEX;
+          c[seg].state->l1.start_offset = 0;
+          c[seg].state->l1.size = ALIGN_VALUE(data_size / 4);
+          c[seg].state->l1.current_data = 0;
+
+          /* The remaining 3/4th will be used as L2
+           */
+          c[seg].state->l2.first = NO_INDEX;
+          c[seg].state->l2.last = NO_INDEX;
+          c[seg].state->l2.next = NO_INDEX;
+          c[seg].state->l2.start_offset = c[seg].state->l1.size;
+          c[seg].state->l2.size = ALIGN_VALUE(data_size)
+                                - c[seg].state->l1.size;
+          c[seg].state->l2.current_data = c[seg].state->l2.start_offset;
+
+          c[seg].state->data_used = 0;
+          c[seg].state->used_entries = 0;
+          c[seg].state->total_reads = 0;
+          c[seg].state->total_writes = 0;
+          c[seg].state->total_hits = 0;
+          c[seg].state->total_evictions = 0;
+          c[seg].state->total_rejections = 0;
+          c[seg].state->sketch_additions = 0;
+#if USE_OPTIMISTIC_READS
+          c[seg].state->write_sequence = 0;
+#endif
+        }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
       /* A lock for intra-process synchronization to the cache, or NULL if
        * the cache's creator doesn't feel the cache needs to be
@@ -2030,9 +2935,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
        */
       SVN_ERR(svn_mutex__init(&c[seg].lock, thread_safe, pool));
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
-      /* Same for read-write lock. */
+      /* Same for read-write lock.  Shared caches use SHARED_LOCK instead. */
       c[seg].lock = NULL;
-      if (thread_safe)
+      if (thread_safe && !shared_name)
         {
           apr_status_t status =
               apr_thread_rwlock_create(&(c[seg].lock), pool);
@@ -2048,24 +2953,107 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].write_lock_count = 0;
     }
 
+#if USE_SHARED_MEMORY
+  /* Publish the new region to other processes. */
+  if (header && initialize)
+    {
+      header->magic = SHARED_CACHE_MAGIC;
+      header->header_size = sizeof(*header);
+      header->state_size = sizeof(*states);
+      header->group_size = sizeof(entry_group_t);
+      header->segment_count = (apr_uint32_t)segment_count;
+      header->group_count = main_group_count;
+      header->spare_group_count = spare_group_count;
+      header->data_size = data_size;
+
+      svn_atomic_cas(&header->ready, TRUE, FALSE);
+    }
+#endif
+
   /* done here
    */
   *cache = c;
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
+                                  apr_size_t total_size,
+                                  apr_size_t directory_size,
+                                  apr_size_t segment_count,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t allow_blocking_writes,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count,
+                                                thread_safe,
+                                                allow_blocking_writes,
+                                                NULL, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         const char *name,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *pool)
+{
+#if USE_SHARED_MEMORY
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count,
+                                                TRUE,
+                                                allow_blocking_writes,
+                                                name, pool));
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Shared memory caches are not supported "
+                            "on this platform"));
+#endif
+}
+
+void
+svn_cache__membuffer_set_policy(svn_membuffer_t *cache,
+                                svn_cache__membuffer_policy_t policy)
+{
+  apr_uint32_t seg;
+  apr_uint32_t segment_count = cache->segment_count;
+
+  for (seg = 0; seg < segment_count; ++seg)
+    cache[seg].policy = policy;
+}
+
+svn_error_t *
+svn_cache__membuffer_remove_shared(const char *name,
+                                   apr_pool_t *scratch_pool)
+{
+#if USE_SHARED_MEMORY
+  const char *object_name;
+  SVN_ERR(shared_object_name(&object_name, name, scratch_pool));
+
+  if (shm_unlink(object_name) && errno != ENOENT)
+    return svn_error_wrap_apr(APR_FROM_OS_ERROR(errno),
+                              _("Can't remove shared memory cache '%s'"),
+                              name);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Shared memory caches are not supported "
+                            "on this platform"));
+#endif
+}
+
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache)
 {
   apr_size_t seg;
   apr_size_t segment_count = cache->segment_count;
 
-  /* Length of the group_initialized array in bytes.
-     See also svn_cache__membuffer_cache_create(). */
-  apr_size_t group_init_size
-    = 1 + (cache->group_count + cache->spare_group_count)
-            / (8 * GROUP_INIT_GRANULARITY);
-
   /* Clear segment by segment.  This implies that other thread may read
      and write to other segments after we cleared them and before the
      last segment is done.
@@ -2078,31 +3066,13 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
     {
       /* Unconditionally acquire the write lock. */
       SVN_ERR(force_write_lock_cache(&cache[seg]));
+      begin_modification(&cache[seg]);
 
       /* Mark all groups as "not initialized", which implies "empty". */
-      cache[seg].first_spare_group = NO_INDEX;
-      cache[seg].max_spare_used = 0;
-
-      memset(cache[seg].group_initialized, 0, group_init_size);
-
-      /* Unlink L1 contents. */
-      cache[seg].l1.first = NO_INDEX;
-      cache[seg].l1.last = NO_INDEX;
-      cache[seg].l1.next = NO_INDEX;
-      cache[seg].l1.current_data = cache[seg].l1.start_offset;
-
-      /* Unlink L2 contents. */
-      cache[seg].l2.first = NO_INDEX;
-      cache[seg].l2.last = NO_INDEX;
-      cache[seg].l2.next = NO_INDEX;
-      cache[seg].l2.current_data = cache[seg].l2.start_offset;
-
-      /* Reset content counters. */
-      cache[seg].data_used = 0;
-      cache[seg].used_entries = 0;
+      reset_segment(&cache[seg]);
 
       /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+      SVN_ERR(unlock_modified_cache(&cache[seg], SVN_NO_ERROR));
     }
 
   /* done here */
@@ -2143,12 +3113,13 @@ entry_exists(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
-/* Given the SIZE and PRIORITY of a new item, return the cache level
+/* Given the KEY, SIZE and PRIORITY of a new item, return the cache level
    (L1 or L2) in fragment CACHE that this item shall be inserted into.
    If we can't find nor make enough room for the item, return NULL.
  */
 static cache_level_t *
 select_level(svn_membuffer_t *cache,
+             const entry_key_t *key,
              apr_size_t size,
              apr_uint32_t priority)
 {
@@ -2156,20 +3127,21 @@ select_level(svn_membuffer_t *cache,
     {
       /* Small items go into L1. */
       return ensure_data_insertable_l1(cache, size)
-           ? &cache->l1
+           ? &cache->state->l1
            : NULL;
     }
-  else if (   cache->l2.size >= size
+  else if (   cache->state->l2.size >= size
            && MAX_ITEM_SIZE >= size
            && priority > SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY)
     {
       /* Large but important items go into L2. */
       entry_t dummy_entry = { { { 0 } } };
+      dummy_entry.key = *key;
       dummy_entry.priority = priority;
       dummy_entry.size = size;
 
       return ensure_data_insertable_l2(cache, &dummy_entry)
-           ? &cache->l2
+           ? &cache->state->l2
            : NULL;
     }
 
@@ -2209,6 +3181,10 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
    * membuffer in single-threaded mode. */
   assert(0 == svn_atomic_inc(&cache->write_lock_count));
 
+  /* Let the access frequencies decay over time. */
+  if (cache->policy == svn_cache__membuffer_policy_tinylfu)
+    age_sketch(cache);
+
   /* Quick check make sure arithmetics will work further down the road. */
   size = item_size + to_find->entry_key.key_len;
   if (size < item_size)
@@ -2227,7 +3203,7 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
        * lest we run into trouble with 32 bit underflow *not* treated as a
        * negative value.
        */
-      cache->data_used += (apr_uint64_t)size - entry->size;
+      cache->state->data_used += (apr_uint64_t)size - entry->size;
       entry->size = size;
       entry->priority = priority;
 
@@ -2247,7 +3223,7 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
         memcpy(cache->data + entry->offset + entry->key.key_len, buffer,
                item_size);
 
-      cache->total_writes++;
+      cache->state->total_writes++;
 
       /* Putting the decrement into an assert() to make it disappear
        * in production code. */
@@ -2257,7 +3233,8 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
 
   /* if necessary, enlarge the insertion window.
    */
-  level = buffer ? select_level(cache, size, priority) : NULL;
+  level = buffer ? select_level(cache, &to_find->entry_key, size, priority)
+                 : NULL;
   if (level)
     {
       /* Remove old data for this key, if that exists.
@@ -2291,10 +3268,14 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
         memcpy(cache->data + entry->offset + entry->key.key_len, buffer,
                item_size);
 
-      cache->total_writes++;
+      cache->state->total_writes++;
     }
   else
     {
+      /* Count items that we could have stored but didn't. */
+      if (buffer)
+        cache->state->total_rejections++;
+
       /* if there is already an entry for this key, drop it.
        * Since ensure_data_insertable may have removed entries from
        * ENTRY's group, re-do the lookup.
@@ -2355,6 +3336,288 @@ membuffer_cache_set(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* Magic bytes at the start of every cache snapshot file.
+ */
+#define SNAPSHOT_MAGIC "SVN-MBS1"
+
+/* Value of snapshot_header_t.byte_order in native byte order.  Entry
+ * fingerprints depend on it.
+ */
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+/* Header of a cache snapshot file.  It is followed by any number of
+ * entries.
+ */
+typedef struct snapshot_header_t
+{
+  /* Must be SNAPSHOT_MAGIC. */
+  char magic[8];
+
+  /* SNAPSHOT_BYTE_ORDER as written by the creator. */
+  apr_uint32_t byte_order;
+
+  /* Size of snapshot_entry_t as used by the creator. */
+  apr_uint32_t entry_size;
+} snapshot_header_t;
+
+/* Header of a single cache entry within a snapshot file.  It is followed
+ * by PREFIX_LEN bytes of shared key prefix and SIZE bytes of entry data,
+ * i.e. the full key (if any) followed by the serialized item.
+ */
+typedef struct snapshot_entry_t
+{
+  /* Fingerprint of the entry key.  It does not depend on the process. */
+  apr_uint64_t fingerprint[2];
+
+  /* Length of the full key at the start of the entry data.  0 if the
+   * entry uses the shared prefix following this header. */
+  apr_uint64_t key_len;
+
+  /* Size of the entry data. */
+  apr_uint64_t size;
+
+  /* Length of the shared key prefix.  0 if KEY_LEN is not. */
+  apr_uint32_t prefix_len;
+
+  /* Cache priority of the entry. */
+  apr_uint32_t priority;
+
+  /* FNV-1a checksum over the prefix and the entry data. */
+  apr_uint32_t checksum;
+
+  /* Unused.  Always 0. */
+  apr_uint32_t padding;
+} snapshot_entry_t;
+
+/* Write all entries in LEVEL of the cache SEGMENT to STREAM.  Use CONTEXT
+ * for the checksum calculation.  The caller must hold a lock on SEGMENT.
+ */
+static svn_error_t *
+save_cache_level(svn_membuffer_t *segment,
+                 cache_level_t *level,
+                 svn_stream_t *stream,
+                 svn_fnv1a_32__context_t *context)
+{
+  apr_uint32_t idx = level->first;
+  while (idx != NO_INDEX)
+    {
+      entry_t *entry = get_entry(segment, idx);
+      const char *prefix = "";
+      snapshot_entry_t header = { { 0 } };
+      apr_size_t len;
+
+      /* Short keys are identified by the index of their shared prefix.
+       * Those indexes are specific to this process, so store the prefix
+       * itself instead. */
+      if (entry->key.key_len == 0)
+        prefix = segment->prefix_pool->values[entry->key.prefix_idx];
+
+      header.fingerprint[0] = entry->key.fingerprint[0];
+      header.fingerprint[1] = entry->key.fingerprint[1];
+      header.key_len = entry->key.key_len;
+      header.size = entry->size;
+      header.prefix_len = (apr_uint32_t)strlen(prefix);
+      header.priority = entry->priority;
+
+      svn_fnv1a_32__context_reset(context);
+      svn_fnv1a_32__update(context, prefix, header.prefix_len);
+      svn_fnv1a_32__update(context, segment->data + entry->offset,
+                           entry->size);
+      header.checksum = svn_fnv1a_32__finalize(context);
+
+      len = sizeof(header);
+      SVN_ERR(svn_stream_write(stream, (const char *)&header, &len));
+      len = header.prefix_len;
+      SVN_ERR(svn_stream_write(stream, prefix, &len));
+      len = entry->size;
+      SVN_ERR(svn_stream_write(stream,
+                               (const char *)segment->data + entry->offset,
+                               &len));
+
+      idx = entry->next;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Write all entries of the cache SEGMENT to STREAM.  Use CONTEXT for the
+ * checksum calculation.  The caller must hold a lock on SEGMENT.
+ */
+static svn_error_t *
+save_segment(svn_membuffer_t *segment,
+             svn_stream_t *stream,
+             svn_fnv1a_32__context_t *context)
+{
+  SVN_ERR(save_cache_level(segment, &segment->state->l1, stream, context));
+  SVN_ERR(save_cache_level(segment, &segment->state->l2, stream, context));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_save(svn_membuffer_t *cache,
+                          const char *path,
+                          apr_pool_t *scratch_pool)
+{
+  apr_uint32_t seg;
+  svn_stream_t *stream;
+  const char *temp_path;
+  snapshot_header_t header = { { 0 } };
+  apr_size_t len = sizeof(header);
+  svn_fnv1a_32__context_t *context
+    = svn_fnv1a_32__context_create(scratch_pool);
+
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.byte_order = SNAPSHOT_BYTE_ORDER;
+  header.entry_size = sizeof(snapshot_entry_t);
+
+  /* Write to a temporary file first such that readers will never see
+   * an incomplete snapshot. */
+  SVN_ERR(svn_stream_open_unique(&stream, &temp_path,
+                                 svn_dirent_dirname(path, scratch_pool),
+                                 svn_io_file_del_on_pool_cleanup,
+                                 scratch_pool, scratch_pool));
+  SVN_ERR(svn_stream_write(stream, (const char *)&header, &len));
+
+  /* Segment by segment.  Writers will only be blocked for one segment
+   * at a time. */
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    WITH_READ_LOCK(&cache[seg],
+                   save_segment(&cache[seg], stream, context));
+
+  SVN_ERR(svn_stream_close(stream));
+  SVN_ERR(svn_io_file_rename2(temp_path, path, FALSE, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_load(svn_membuffer_t *cache,
+                          const char *path,
+                          apr_pool_t *scratch_pool)
+{
+#ifndef SVN_DEBUG_CACHE_MEMBUFFER
+  svn_stream_t *stream;
+  snapshot_header_t header;
+  apr_size_t len = sizeof(header);
+  svn_membuf_t buffer;
+  svn_fnv1a_32__context_t *context
+    = svn_fnv1a_32__context_create(scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_stream_open_readonly(&stream, path, scratch_pool,
+                                   scratch_pool));
+
+  /* Silently ignore snapshots that we can't use. */
+  SVN_ERR(svn_stream_read_full(stream, (char *)&header, &len));
+  if (   len != sizeof(header)
+      || memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic))
+      || header.byte_order != SNAPSHOT_BYTE_ORDER
+      || header.entry_size != sizeof(snapshot_entry_t))
+    return svn_error_trace(svn_stream_close(stream));
+
+  svn_membuf__create(&buffer, 0, scratch_pool);
+  while (TRUE)
+    {
+      snapshot_entry_t entry;
+      full_key_t full_key;
+      const full_key_t *key = &full_key;
+      apr_size_t key_len;
+      svn_membuffer_t *segment = cache;
+      apr_uint32_t group_index;
+      char *prefix;
+      char *data;
+
+      svn_pool_clear(iterpool);
+
+      /* Stop at the end of the file and at truncated entries. */
+      len = sizeof(entry);
+      SVN_ERR(svn_stream_read_full(stream, (char *)&entry, &len));
+      if (len != sizeof(entry))
+        break;
+
+      /* Every entry either has a full key or a shared prefix.  Stop at
+       * the first implausible entry because we can't know where the
+       * next one starts. */
+      if (   entry.size > MAX_ITEM_SIZE
+          || entry.key_len > entry.size
+          || (entry.key_len == 0) == (entry.prefix_len == 0)
+          || entry.prefix_len > MAX_ITEM_SIZE
+          || entry.padding)
+        break;
+
+      svn_membuf__ensure(&buffer, entry.prefix_len + 1 + entry.size);
+      prefix = buffer.data;
+      data = prefix + entry.prefix_len + 1;
+
+      len = entry.prefix_len;
+      SVN_ERR(svn_stream_read_full(stream, prefix, &len));
+      if (len != entry.prefix_len)
+        break;
+      prefix[len] = '\0';
+
+      len = (apr_size_t)entry.size;
+      SVN_ERR(svn_stream_read_full(stream, data, &len));
+      if (len != entry.size)
+        break;
+
+      /* Skip corrupted entries. */
+      svn_fnv1a_32__context_reset(context);
+      svn_fnv1a_32__update(context, prefix, entry.prefix_len);
+      svn_fnv1a_32__update(context, data, len);
+      if (svn_fnv1a_32__finalize(context) != entry.checksum)
+        continue;
+
+      key_len = (apr_size_t)entry.key_len;
+      full_key.entry_key.fingerprint[0] = entry.fingerprint[0];
+      full_key.entry_key.fingerprint[1] = entry.fingerprint[1];
+      full_key.entry_key.key_len = key_len;
+      full_key.full_key.data = data;
+      full_key.full_key.size = key_len;
+
+      /* Map the prefix to its index in this process.  If the prefix pool
+       * is exhausted, we can't cache this entry. */
+      if (entry.prefix_len)
+        {
+          SVN_ERR(prefix_pool_get(&full_key.entry_key.prefix_idx,
+                                  cache->prefix_pool, prefix));
+          if (full_key.entry_key.prefix_idx == NO_INDEX)
+            continue;
+        }
+      else
+        {
+          full_key.entry_key.prefix_idx = NO_INDEX;
+        }
+
+      group_index = get_group_index(&segment, &key->entry_key);
+      WITH_WRITE_LOCK(segment,
+                      membuffer_cache_set_internal(segment,
+                                                   key,
+                                                   group_index,
+                                                   data + key_len,
+                                                   len - key_len,
+                                                   entry.priority,
+                                                   iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  SVN_ERR(svn_stream_close(stream));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Count a lookup of KEY within CACHE.
+ */
+static APR_INLINE void
+count_read(svn_membuffer_t *cache, const entry_key_t *key)
+{
+  /* That one is for stats only. */
+  cache->state->total_reads++;
+
+  record_access(cache, key);
+}
+
 /* Count a hit in ENTRY within CACHE.
  */
 static void
@@ -2367,7 +3630,7 @@ increment_hit_counters(svn_membuffer_t *cache, entry_t *entry)
   svn_atomic_inc(&entry->hit_count);
 
   /* That one is for stats only. */
-  cache->total_hits++;
+  cache->state->total_hits++;
 }
 
 /* Look for the cache entry in group GROUP_INDEX of CACHE, identified
@@ -2394,7 +3657,7 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   /* The actual cache data access needs to sync'ed
    */
   entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
+  count_read(cache, &to_find->entry_key);
   if (entry == NULL)
     {
       /* no such entry found.
@@ -2433,6 +3696,73 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* Lock-free variant of membuffer_cache_get_internal.  Return FALSE if
+ * that failed due to concurrent modifications to CACHE or because the
+ * item is too large to be read optimistically.  In that case, the caller
+ * must repeat the lookup under the read lock.  RESULT_POOL will only be
+ * used if we return TRUE.
+ */
+static svn_boolean_t
+membuffer_cache_get_optimistic(svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               apr_pool_t *result_pool)
+{
+#if USE_OPTIMISTIC_READS
+  apr_uint32_t sequence = begin_optimistic_read(cache);
+  apr_size_t key_len = to_find->entry_key.key_len;
+  entry_t *entry;
+  apr_uint64_t offset;
+  apr_size_t size;
+  apr_size_t copy_size = 0;
+  char copy[OPTIMISTIC_READ_BUFFER_SIZE];
+
+  /* Don't bother if a writer is currently active. */
+  if (sequence & 1)
+    return FALSE;
+
+  /* Copy into scratch memory first.  The data may be torn and must not
+   * end up in RESULT_POOL, which may be long-lived, unless validated. */
+  entry = find_entry_optimistic(cache, group_index, to_find, &offset, &size);
+  if (entry)
+    {
+      copy_size = ALIGN_VALUE(size) - key_len;
+      if (copy_size > sizeof(copy))
+        return FALSE;
+
+      memcpy(copy, cache->data + offset + key_len, copy_size);
+    }
+
+  if (!end_optimistic_read(cache, sequence))
+    return FALSE;
+
+  if (entry == NULL)
+    {
+      *buffer = NULL;
+      *item_size = 0;
+    }
+  else
+    {
+      *buffer = apr_pmemdup(result_pool, copy, copy_size);
+      *item_size = size - key_len;
+    }
+
+  /* Update hit statistics.  Even if ENTRY has been replaced in the
+   * meantime, the hit counter is still a valid memory location and
+   * we don't care too much about hit counter precision.
+   */
+  count_read(cache, &to_find->entry_key);
+  if (entry)
+    increment_hit_counters(cache, entry);
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
 /* Look for the *ITEM identified by KEY. If no item has been stored
  * for KEY, *ITEM will be NULL. Otherwise, the DESERIALIZER is called
  * to re-construct the proper object from the serialized data.
@@ -2453,14 +3783,16 @@ membuffer_cache_get(svn_membuffer_t *cache,
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_get_internal(cache,
-                                              group_index,
-                                              key,
-                                              &buffer,
-                                              &size,
-                                              DEBUG_CACHE_MEMBUFFER_TAG
-                                              result_pool));
+  if (!membuffer_cache_get_optimistic(cache, group_index, key, &buffer,
+                                      &size, result_pool))
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_get_internal(cache,
+                                                group_index,
+                                                key,
+                                                &buffer,
+                                                &size,
+                                                DEBUG_CACHE_MEMBUFFER_TAG
+                                                result_pool));
 
   /* re-construct the original data object from its serialized form.
    */
@@ -2502,6 +3834,41 @@ membuffer_cache_has_key_internal(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
+/* Lock-free variant of membuffer_cache_has_key_internal.  Return FALSE
+ * if that failed due to concurrent modifications to CACHE.  In that case,
+ * the caller must repeat the lookup under the read lock.
+ */
+static svn_boolean_t
+membuffer_cache_has_key_optimistic(svn_membuffer_t *cache,
+                                   apr_uint32_t group_index,
+                                   const full_key_t *to_find,
+                                   svn_boolean_t *found)
+{
+#if USE_OPTIMISTIC_READS
+  apr_uint32_t sequence = begin_optimistic_read(cache);
+  entry_t *entry;
+  apr_uint64_t offset;
+  apr_size_t size;
+
+  /* Don't bother if a writer is currently active. */
+  if (sequence & 1)
+    return FALSE;
+
+  entry = find_entry_optimistic(cache, group_index, to_find, &offset, &size);
+  if (!end_optimistic_read(cache, sequence))
+    return FALSE;
+
+  /* See membuffer_cache_has_key_internal for why we count this as a hit. */
+  *found = entry != NULL;
+  if (entry)
+    increment_hit_counters(cache, entry);
+
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
 /* Look for an entry identified by KEY.  If no item has been stored
  * for KEY, *FOUND will be set to FALSE and TRUE otherwise.
  */
@@ -2515,13 +3882,14 @@ membuffer_cache_has_key(svn_membuffer_t *cache,
   /* find the entry group that will hold the key.
    */
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
-  cache->total_reads++;
+  count_read(cache, &key->entry_key);
 
-  WITH_READ_LOCK(cache,
-                 membuffer_cache_has_key_internal(cache,
-                                                  group_index,
-                                                  key,
-                                                  found));
+  if (!membuffer_cache_has_key_optimistic(cache, group_index, key, found))
+    WITH_READ_LOCK(cache,
+                   membuffer_cache_has_key_internal(cache,
+                                                    group_index,
+                                                    key,
+                                                    found));
 
   return SVN_NO_ERROR;
 }
@@ -2549,7 +3917,7 @@ membuffer_cache_get_partial_internal(svn_membuffer_t *cache,
                                      apr_pool_t *result_pool)
 {
   entry_t *entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
+  count_read(cache, &to_find->entry_key);
   if (entry == NULL)
     {
       *item = NULL;
@@ -2632,7 +4000,7 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
   /* cache item lookup
    */
   entry_t *entry = find_entry(cache, group_index, to_find, FALSE);
-  cache->total_reads++;
+  count_read(cache, &to_find->entry_key);
 
   /* this function is a no-op if the item is not in cache
    */
@@ -2647,7 +4015,7 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
       apr_size_t item_size = entry->size - key_len;
 
       increment_hit_counters(cache, entry);
-      cache->total_writes++;
+      cache->state->total_writes++;
 
 #ifdef SVN_DEBUG_CACHE_MEMBUFFER
 
@@ -2697,7 +4065,7 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
                    */
                   entry = find_entry(cache, group_index, to_find, TRUE);
                   entry->size = item_size + key_len;
-                  entry->offset = cache->l1.current_data;
+                  entry->offset = cache->state->l1.current_data;
 
                   if (key_len)
                     memcpy(cache->data + entry->offset,
@@ -3110,7 +4478,7 @@ svn_membuffer_cache_is_cachable(void *cache_void, apr_size_t size)
    */
   svn_membuffer_cache_t *cache = cache_void;
   return cache->priority > SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY
-       ? cache->membuffer->l2.size >= size && MAX_ITEM_SIZE >= size
+       ? cache->membuffer->state->l2.size >= size && MAX_ITEM_SIZE >= size
        : size <= cache->membuffer->max_entry_size;
 }
 
@@ -3124,14 +4492,18 @@ svn_membuffer_get_segment_info(svn_membuffer_t *segment,
 {
   apr_uint32_t i;
 
-  info->data_size += segment->l1.size + segment->l2.size;
-  info->used_size += segment->data_used;
-  info->total_size += segment->l1.size + segment->l2.size +
-      segment->group_count * GROUP_SIZE * sizeof(entry_t);
+  info->data_size += segment->state->l1.size + segment->state->l2.size;
+  info->used_size += segment->state->data_used;
+  info->total_size += segment->state->l1.size + segment->state->l2.size +
+      segment->group_count * GROUP_SIZE * sizeof(entry_t) +
+      SKETCH_SIZE(segment->sketch_width);
 
-  info->used_entries += segment->used_entries;
+  info->used_entries += segment->state->used_entries;
   info->total_entries += segment->group_count * GROUP_SIZE;
 
+  info->evictions += segment->state->total_evictions;
+  info->rejections += segment->state->total_rejections;
+
   if (include_histogram)
     for (i = 0; i < segment->group_count; ++i)
       if (is_group_initialized(segment, i))
@@ -3448,9 +4820,9 @@ static svn_error_t *
 svn_membuffer_get_global_segment_info(svn_membuffer_t *segment,
                                       svn_cache__info_t *info)
 {
-  info->gets += segment->total_reads;
-  info->sets += segment->total_writes;
-  info->hits += segment->total_hits;
+  info->gets += segment->state->total_reads;
+  info->sets += segment->state->total_writes;
+  info->hits += segment->state->total_hits;
 
   WITH_READ_LOCK(segment,
                   svn_membuffer_get_segment_info(segment, info, TRUE));
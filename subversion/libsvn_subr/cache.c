@@ -296,6 +296,8 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             "sets    : %" APR_UINT64_T_FMT
                             " (%5.2f%% of misses)\n"
                             "failures: %" APR_UINT64_T_FMT "\n"
+                            "evicted : %" APR_UINT64_T_FMT
+                            ", %" APR_UINT64_T_FMT " rejected\n"
                             "used    : %" APR_UINT64_T_FMT " MB (%5.2f%%)"
                             " of %" APR_UINT64_T_FMT " MB data cache"
                             " / %" APR_UINT64_T_FMT " MB total cache memory\n"
@@ -308,6 +310,7 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             info->hits, hit_rate,
                             info->sets, write_rate,
                             info->failures,
+                            info->evictions, info->rejections,
 
                             info->used_size / _1MB, data_usage_rate,
                             info->data_size / _1MB,
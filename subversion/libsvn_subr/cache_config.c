@@ -28,6 +28,7 @@
 
 #include "svn_pools.h"
 #include "svn_sorts.h"
+#include "svn_private_config.h"
 
 /* The cache settings as a process-wide singleton.
  */
@@ -64,6 +65,28 @@ static svn_cache_config_t cache_settings =
 #endif
 };
 
+/* Name of the shared memory region to place the global membuffer cache
+ * in.  NULL for a process-local cache. */
+static const char *shared_cache_name = NULL;
+
+/* Admission and eviction policy of the global membuffer cache. */
+static svn_cache__membuffer_policy_t membuffer_policy
+  = svn_cache__membuffer_policy_default;
+
+/* Path of the snapshot file to initialize the global membuffer cache
+ * from and to save it to.  NULL if not configured. */
+static const char *snapshot_path = NULL;
+
+/* The process-global membuffer cache and its initialization state.
+ * See svn_cache__get_global_membuffer_cache(). */
+static svn_membuffer_t *global_cache = NULL;
+static svn_atomic_t global_cache_initialized = 0;
+
+/* Why the global membuffer cache could not be placed in the configured
+ * shared memory region.  SVN_NO_ERROR if there was no such problem.
+ * See svn_cache__init_global_membuffer_cache(). */
+static svn_error_t *shared_cache_error = SVN_NO_ERROR;
+
 /* Get the current FSFS cache configuration. */
 const svn_cache_config_t *
 svn_cache_config_get(void)
@@ -120,14 +143,41 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
         return SVN_NO_ERROR;
       apr_allocator_owner_set(allocator, pool);
 
-      err = svn_cache__membuffer_cache_create(
-          &cache,
-          (apr_size_t)cache_size,
-          (apr_size_t)(cache_size / 5),
-          0,
-          ! svn_cache_config_get()->single_threaded,
-          FALSE,
-          pool);
+      /* Try the shared cache first.  If that fails, e.g. because another
+       * process created the shared cache with a different size, we still
+       * want to have a cache.  Keep the error for the server to report.
+       */
+      err = SVN_NO_ERROR;
+      if (shared_cache_name)
+        {
+          err = svn_cache__membuffer_cache_create_shared(
+              &cache,
+              shared_cache_name,
+              (apr_size_t)cache_size,
+              (apr_size_t)(cache_size / 5),
+              0,
+              FALSE,
+              pool);
+          if (err)
+            {
+              shared_cache_error = svn_error_quick_wrapf(err,
+                                     _("Can't use shared memory cache '%s', "
+                                       "using a process-local cache instead"),
+                                     shared_cache_name);
+              svn_pool_clear(pool);
+              cache = NULL;
+            }
+        }
+
+      if (cache == NULL)
+        err = svn_cache__membuffer_cache_create(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            ! svn_cache_config_get()->single_threaded,
+            FALSE,
+            pool);
 
       /* Some error occurred. Most likely it's an OOM error but we don't
        * really care. Simply release all cache memory and disable caching
@@ -143,6 +193,18 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
           return svn_error_trace(err);
         }
 
+      svn_cache__membuffer_set_policy(cache, membuffer_policy);
+
+      /* Warm up the new cache.  It is still perfectly usable if that
+       * fails, so ignore errors. */
+      if (snapshot_path)
+        {
+          apr_pool_t *scratch_pool = svn_pool_create(NULL);
+          svn_error_clear(svn_cache__membuffer_load(cache, snapshot_path,
+                                                    scratch_pool));
+          svn_pool_destroy(scratch_pool);
+        }
+
       /* done */
       *cache_p = cache;
     }
@@ -158,11 +220,9 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
 svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void)
 {
-  static svn_membuffer_t *cache = NULL;
-  static svn_atomic_t initialized = 0;
-
   svn_error_t *err
-    = svn_atomic__init_once(&initialized, initialize_cache, &cache, NULL);
+    = svn_atomic__init_once(&global_cache_initialized, initialize_cache,
+                            &global_cache, NULL);
   if (err)
     {
       /* no caches today ... */
@@ -170,7 +230,35 @@ svn_cache__get_global_membuffer_cache(void)
       return NULL;
     }
 
-  return cache;
+  return global_cache;
+}
+
+svn_error_t *
+svn_cache__init_global_membuffer_cache(void)
+{
+  svn_error_t *err
+    = svn_atomic__init_once(&global_cache_initialized, initialize_cache,
+                            &global_cache, NULL);
+  if (err)
+    return svn_error_trace(err);
+
+  /* The error object is shared by all callers; hand out copies. */
+  return shared_cache_error ? svn_error_dup(shared_cache_error)
+                            : SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__save_global_membuffer_cache(apr_pool_t *scratch_pool)
+{
+  /* Don't create the cache just to overwrite the snapshot with nothing. */
+  if (   snapshot_path == NULL
+      || svn_atomic_read(&global_cache_initialized) == 0
+      || svn_cache__get_global_membuffer_cache() == NULL)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(svn_cache__membuffer_save(global_cache,
+                                                   snapshot_path,
+                                                   scratch_pool));
 }
 
 void
@@ -179,3 +267,21 @@ svn_cache_config_set(const svn_cache_config_t *settings)
   cache_settings = *settings;
 }
 
+void
+svn_cache__config_set_shared_name(const char *name)
+{
+  shared_cache_name = name;
+}
+
+
+void
+svn_cache__config_set_snapshot_path(const char *path)
+{
+  snapshot_path = path;
+}
+
+void
+svn_cache__config_set_policy(svn_cache__membuffer_policy_t policy)
+{
+  membuffer_policy = policy;
+}
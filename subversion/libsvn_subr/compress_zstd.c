@@ -0,0 +1,228 @@
+/*
+ * compress_zstd.c:  Zstandard data compression routines
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "private/svn_subr_private.h"
+
+#include "svn_private_config.h"
+
+#ifdef SVN_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+svn_boolean_t
+svn__zstd_available(void)
+{
+#ifdef SVN_HAVE_ZSTD
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+#ifdef SVN_HAVE_ZSTD
+
+/* Return an error with code CODE for the zstd result RESULT. */
+static svn_error_t *
+zstd_error(apr_status_t code, size_t result)
+{
+  return svn_error_create(code, NULL, ZSTD_getErrorName(result));
+}
+
+#endif
+
+svn_error_t *
+svn__compress_zstd(const void *data, apr_size_t len,
+                   svn_stringbuf_t *out,
+                   int level,
+                   const svn_string_t *dict)
+{
+#ifdef SVN_HAVE_ZSTD
+  apr_size_t hdrlen;
+  unsigned char buf[SVN__MAX_ENCODED_UINT_LEN];
+  unsigned char *p;
+  size_t compressed_data_len;
+  size_t max_compressed_data_len;
+  ZSTD_CCtx *cctx;
+
+  if (level < 1)
+    level = 1;
+  else if (level > ZSTD_maxCLevel())
+    level = ZSTD_maxCLevel();
+
+  p = svn__encode_uint(buf, (apr_uint64_t)len);
+  hdrlen = p - buf;
+  max_compressed_data_len = ZSTD_compressBound(len);
+  svn_stringbuf_setempty(out);
+  svn_stringbuf_ensure(out, max_compressed_data_len + hdrlen);
+  svn_stringbuf_appendbytes(out, (const char *)buf, hdrlen);
+
+  cctx = ZSTD_createCCtx();
+  if (cctx == NULL)
+    return svn_error_create(SVN_ERR_ZSTD_COMPRESSION_FAILED, NULL, NULL);
+
+  if (dict)
+    compressed_data_len = ZSTD_compress_usingDict(cctx,
+                                                  out->data + out->len,
+                                                  max_compressed_data_len,
+                                                  data, len,
+                                                  dict->data, dict->len,
+                                                  level);
+  else
+    compressed_data_len = ZSTD_compressCCtx(cctx,
+                                            out->data + out->len,
+                                            max_compressed_data_len,
+                                            data, len, level);
+  ZSTD_freeCCtx(cctx);
+
+  if (ZSTD_isError(compressed_data_len))
+    return zstd_error(SVN_ERR_ZSTD_COMPRESSION_FAILED, compressed_data_len);
+
+  if (compressed_data_len >= len)
+    {
+      /* Compression didn't help :(, just append the original text */
+      svn_stringbuf_appendbytes(out, data, len);
+    }
+  else
+    {
+      out->len += compressed_data_len;
+      out->data[out->len] = 0;
+    }
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Zstandard compression is not supported "
+                            "by this build"));
+#endif
+}
+
+svn_error_t *
+svn__decompress_zstd(const void *data, apr_size_t len,
+                     svn_stringbuf_t *out,
+                     apr_size_t limit,
+                     const svn_string_t *dict)
+{
+#ifdef SVN_HAVE_ZSTD
+  apr_size_t hdrlen;
+  apr_size_t compressed_data_len;
+  apr_size_t decompressed_data_len;
+  apr_uint64_t u64;
+  const unsigned char *p = data;
+  size_t rv;
+
+  /* First thing in the string is the original length.  */
+  p = svn__decode_uint(&u64, p, p + len);
+  if (p == NULL)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Decompression of compressed data failed: "
+                              "no size"));
+  if (u64 > limit)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Decompression of compressed data failed: "
+                              "size too large"));
+  decompressed_data_len = (apr_size_t)u64;
+  hdrlen = p - (const unsigned char *)data;
+  compressed_data_len = len - hdrlen;
+
+  svn_stringbuf_setempty(out);
+  svn_stringbuf_ensure(out, decompressed_data_len);
+
+  if (compressed_data_len == decompressed_data_len)
+    {
+      /* Data is in the original, uncompressed form. */
+      memcpy(out->data, p, decompressed_data_len);
+    }
+  else
+    {
+      ZSTD_DCtx *dctx;
+      unsigned dict_id = ZSTD_getDictID_fromFrame(p, compressed_data_len);
+
+      /* Fail with a clear message instead of a generic zstd error if the
+         data was compressed with a dictionary we have not been given.
+         Frames compressed with a raw content dictionary have no ID, so
+         we cannot check those. */
+      if (dict_id && (!dict || ZSTD_getDictID_fromDict(dict->data, dict->len)
+                                 != dict_id))
+        return svn_error_createf(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA,
+                                 NULL,
+                                 _("Compressed data requires zstd "
+                                   "dictionary %u"), dict_id);
+
+      dctx = ZSTD_createDCtx();
+      if (dctx == NULL)
+        return svn_error_create(SVN_ERR_ZSTD_DECOMPRESSION_FAILED, NULL, NULL);
+
+      if (dict)
+        rv = ZSTD_decompress_usingDict(dctx, out->data, decompressed_data_len,
+                                       p, compressed_data_len,
+                                       dict->data, dict->len);
+      else
+        rv = ZSTD_decompressDCtx(dctx, out->data, decompressed_data_len,
+                                 p, compressed_data_len);
+      ZSTD_freeDCtx(dctx);
+
+      if (ZSTD_isError(rv))
+        return zstd_error(SVN_ERR_ZSTD_DECOMPRESSION_FAILED, rv);
+
+      if (rv != decompressed_data_len)
+        return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA,
+                                NULL,
+                                _("Size of uncompressed data "
+                                  "does not match stored original length"));
+    }
+
+  out->data[decompressed_data_len] = 0;
+  out->len = decompressed_data_len;
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Zstandard compression is not supported "
+                            "by this build"));
+#endif
+}
+
+const char *
+svn_zstd__compiled_version(void)
+{
+#ifdef SVN_HAVE_ZSTD
+  static const char zstd_version_str[] = ZSTD_VERSION_STRING;
+
+  return zstd_version_str;
+#else
+  return NULL;
+#endif
+}
+
+const char *
+svn_zstd__runtime_version(void)
+{
+#ifdef SVN_HAVE_ZSTD
+  return ZSTD_versionString();
+#else
+  return NULL;
+#endif
+}
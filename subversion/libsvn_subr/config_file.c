@@ -1169,6 +1169,10 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "###   http-bulk-updates          Whether to request bulk update"    NL
         "###                              responses or to fetch each file"   NL
         "###                              in an individual request. "        NL
+        "###   svn-max-connections        Maximum number of parallel server" NL
+        "###                              connections to use for fetching"   NL
+        "###                              file contents over svn://.  Not"   NL
+        "###                              used for svn+ssh:// unless set."   NL
         "###   store-passwords            Specifies whether passwords used"  NL
         "###                              to authenticate against a"         NL
         "###                              Subversion server may be cached"   NL
@@ -1552,6 +1556,28 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### returning an error.  The default is 10000, i.e. 10 seconds."    NL
         "### Longer values may be useful when exclusive locking is enabled." NL
         "# busy-timeout = 10000"                                             NL
+        "### Set to true to let checkout, update and switch use an SQLite"   NL
+        "### write-ahead log instead of a rollback journal while they run."  NL
+        "### This saves file operations, e.g. on network file systems.  It"  NL
+        "### only has an effect together with exclusive locking."            NL
+        "# write-ahead-log = false"                                          NL
+        "### Set the number of threads used for the I/O intensive parts of"  NL
+        "### working copy operations, e.g. reading directories and comparing"NL
+        "### file contents while scanning for local modifications or"        NL
+        "### writing working files during checkout and update.  Set to 1 to" NL
+        "### do all the work in the calling thread.  The default is 4."      NL
+        "# worker-threads = 4"                                               NL
+        "### Set to the path of a directory that several working copies on"  NL
+        "### the same file system should share their pristine texts in."     NL
+        "### Pristine texts that are already present there are installed as" NL
+        "### hard links instead of new files.  'svn cleanup"                 NL
+        "### --vacuum-pristines' removes those no working copy uses anymore."NL
+        "### Before a working copy first links to a text, it checks that the"NL
+        "### file is read-only and matches its checksum.  Users who own the" NL
+        "### files in that directory can still change the texts of all"      NL
+        "### working copies linking to them, so only share it between users" NL
+        "### that trust each other."                                         NL
+        "# shared-pristine-store ="                                          NL
         ;
 
       err = svn_io_file_open(&f, path,
@@ -884,6 +884,8 @@ svn_io_copy_file(const char *src,
   apr_file_t *from_file, *to_file;
   apr_status_t apr_err;
   const char *dst_tmp;
+  svn_filesize_t size;
+  apr_off_t copied;
   svn_error_t *err;
 
   /* ### NOTE: sometimes src == dst. In this case, because we copy to a
@@ -914,16 +916,20 @@ svn_io_copy_file(const char *src,
                                    svn_dirent_dirname(dst, pool),
                                    svn_io_file_del_none, pool, pool));
 
-  apr_err = copy_contents(from_file, to_file, pool);
+  /* Let the OS copy the data without reading it into user space, if it
+     can.  Whatever it didn't copy will be handled by copy_contents(). */
+  err = svn_io_file_size_get(&size, from_file, pool);
+  if (!err)
+    err = svn_io__file_copy_range(&copied, to_file, from_file, size, pool);
 
-  if (apr_err)
+  if (!err)
     {
-      err = svn_error_wrap_apr(apr_err, _("Can't copy '%s' to '%s'"),
-                               svn_dirent_local_style(src, pool),
-                               svn_dirent_local_style(dst_tmp, pool));
+      apr_err = copy_contents(from_file, to_file, pool);
+      if (apr_err)
+        err = svn_error_wrap_apr(apr_err, _("Can't copy '%s' to '%s'"),
+                                 svn_dirent_local_style(src, pool),
+                                 svn_dirent_local_style(dst_tmp, pool));
     }
-   else
-     err = NULL;
 
   err = svn_error_compose_create(err,
                                  svn_io_file_close(from_file, pool));
@@ -2424,6 +2430,20 @@ svn_io_file_lock2(const char *lock_file,
   return svn_io_lock_open_file(lockfile_handle, exclusive, nonblocking, pool);
 }
 
+void
+svn_io__file_prefetch(apr_file_t *file,
+                      apr_off_t offset,
+                      apr_off_t length)
+{
+#ifdef HAVE_POSIX_FADVISE
+  apr_os_file_t fd;
+
+  /* Failures are harmless; the data will simply be read on demand. */
+  if (apr_os_file_get(&fd, file) == APR_SUCCESS)
+    (void)posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+#endif
+}
+
 svn_error_t *
 svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool)
@@ -3786,6 +3806,129 @@ svn_io_file_get_offset(apr_off_t *offset_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_io__file_copy_range(apr_off_t *copied,
+                        apr_file_t *dest,
+                        apr_file_t *source,
+                        apr_off_t size,
+                        apr_pool_t *scratch_pool)
+{
+  *copied = 0;
+
+#ifdef HAVE_COPY_FILE_RANGE
+  {
+    apr_os_file_t source_fd, dest_fd;
+    apr_off_t source_offset, dest_offset;
+
+    /* The underlying file descriptors must reflect all buffered data.
+       Getting the offsets will flush DEST for us. */
+    SVN_ERR(svn_io_file_get_offset(&source_offset, source, scratch_pool));
+    SVN_ERR(svn_io_file_get_offset(&dest_offset, dest, scratch_pool));
+    if (   apr_os_file_get(&source_fd, source)
+        || apr_os_file_get(&dest_fd, dest))
+      return SVN_NO_ERROR;
+
+    while (*copied < size)
+      {
+        off_t source_pos = source_offset + *copied;
+        off_t dest_pos = dest_offset + *copied;
+        apr_off_t remaining = size - *copied;
+        ssize_t count = copy_file_range(source_fd, &source_pos,
+                                        dest_fd, &dest_pos,
+                                        remaining > APR_SIZE_MAX / 2
+                                          ? APR_SIZE_MAX / 2
+                                          : (apr_size_t)remaining,
+                                        0);
+        if (count < 0)
+          {
+            apr_status_t status = apr_get_os_error();
+            if (APR_STATUS_IS_EINTR(status))
+              continue;
+
+            /* Not supported by the kernel or between these file systems?
+               Let the caller fall back to ordinary copies. */
+            if (   APR_STATUS_IS_ENOTIMPL(status)
+                || status == APR_FROM_OS_ERROR(ENOSYS)
+                || status == APR_FROM_OS_ERROR(EXDEV)
+                || status == APR_FROM_OS_ERROR(EINVAL)
+                || status == APR_FROM_OS_ERROR(EOPNOTSUPP))
+              break;
+
+            return do_io_file_wrapper_cleanup(source, status,
+                                              N_("Can't copy file '%s'"),
+                                              N_("Can't copy stream"),
+                                              scratch_pool);
+          }
+
+        /* Premature EOF.  Let the caller report it. */
+        if (count == 0)
+          break;
+
+        *copied += count;
+      }
+
+    /* Position both files behind the data we just copied. */
+    source_offset += *copied;
+    dest_offset += *copied;
+    SVN_ERR(svn_io_file_seek(source, APR_SET, &source_offset, scratch_pool));
+    SVN_ERR(svn_io_file_seek(dest, APR_SET, &dest_offset, scratch_pool));
+  }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_io__create_hardlink(const char *link_path,
+                        const char *existing_path,
+                        apr_pool_t *scratch_pool)
+{
+  const char *link_path_apr, *existing_path_apr;
+  apr_status_t status;
+
+  SVN_ERR(cstring_from_utf8(&link_path_apr, link_path, scratch_pool));
+  SVN_ERR(cstring_from_utf8(&existing_path_apr, existing_path,
+                            scratch_pool));
+
+#if defined(WIN32)
+  {
+    const WCHAR *link_path_w, *existing_path_w;
+
+    SVN_ERR(svn_io__utf8_to_unicode_longpath(&link_path_w, link_path_apr,
+                                             scratch_pool));
+    SVN_ERR(svn_io__utf8_to_unicode_longpath(&existing_path_w,
+                                             existing_path_apr,
+                                             scratch_pool));
+    if (CreateHardLinkW(link_path_w, existing_path_w, NULL))
+      status = APR_SUCCESS;
+    else
+      status = apr_get_os_error();
+  }
+#elif defined(SVN_ON_POSIX)
+  {
+    int rv;
+
+    do {
+      rv = link(existing_path_apr, link_path_apr);
+    } while (rv == -1 && APR_STATUS_IS_EINTR(apr_get_os_error()));
+
+    status = rv == -1 ? apr_get_os_error() : APR_SUCCESS;
+  }
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Hard links are not supported on this "
+                            "platform"));
+#endif
+
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create hard link '%s' to '%s'"),
+                              svn_dirent_local_style(link_path, scratch_pool),
+                              svn_dirent_local_style(existing_path,
+                                                     scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_io_file_read(apr_file_t *file, void *buf,
                  apr_size_t *nbytes, apr_pool_t *pool)
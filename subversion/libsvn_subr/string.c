@@ -37,6 +37,10 @@
 
 #include "svn_private_config.h"
 
+#ifdef SVN__HAVE_SSE2
+#  include <emmintrin.h>
+#endif
+
 
 
 /* Allocate the space for a memory buffer from POOL.
@@ -1508,6 +1512,21 @@ svn_cstring__match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#ifdef SVN__HAVE_SSE2
+
+  /* SSE2 loads don't require alignment.  Compare 16 bytes at once and
+   * let the loops below find the exact position of the first mismatch.
+   */
+  for (; max_len - pos >= sizeof(__m128i); pos += sizeof(__m128i))
+    {
+      __m128i lhs = _mm_loadu_si128((const __m128i *)(a + pos));
+      __m128i rhs = _mm_loadu_si128((const __m128i *)(b + pos));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) != 0xffff)
+        break;
+    }
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
@@ -1536,6 +1555,23 @@ svn_cstring__reverse_match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#ifdef SVN__HAVE_SSE2
+
+  /* Same as in svn_cstring__match_length: Skip over matching 16 byte
+   * chunks and let the loops below find the exact mismatch position.
+   */
+  for (pos = sizeof(__m128i); pos <= max_len; pos += sizeof(__m128i))
+    {
+      __m128i lhs = _mm_loadu_si128((const __m128i *)(a - pos));
+      __m128i rhs = _mm_loadu_si128((const __m128i *)(b - pos));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) != 0xffff)
+        break;
+    }
+
+  pos -= sizeof(__m128i);
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
@@ -1544,7 +1580,7 @@ svn_cstring__reverse_match_length(const char *a,
    * because A and B will probably have different alignment. So, skipping
    * the first few chars until alignment is reached is not an option.
    */
-  for (pos = sizeof(apr_size_t); pos <= max_len; pos += sizeof(apr_size_t))
+  for (pos += sizeof(apr_size_t); pos <= max_len; pos += sizeof(apr_size_t))
     if (*(const apr_size_t*)(a - pos) != *(const apr_size_t*)(b - pos))
       break;
 
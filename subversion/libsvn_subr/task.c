@@ -0,0 +1,513 @@
+/*
+ * task.c :  ordered execution of independent tasks on worker threads
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_thread_pool.h>
+#include <apr_thread_cond.h>
+
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_task.h"
+
+#include "svn_private_config.h"
+
+/* Handy macro to check APR function results and turning them into
+ * svn_error_t upon failure. */
+#define WRAP_APR_ERR(x,msg)                     \
+  {                                             \
+    apr_status_t status_ = (x);                 \
+    if (status_)                                \
+      return svn_error_wrap_apr(status_, msg);  \
+  }
+
+/* A single entry in the task queue.  It gets allocated in its own POOL.
+ */
+typedef struct task_t
+{
+  /* The queue that this task belongs to. */
+  svn_task__queue_t *queue;
+
+  /* Parameter to pass to the queue's process function. */
+  void *baton;
+
+  /* Output of the process function. */
+  void *result;
+
+  /* Error returned by the process function. */
+  svn_error_t *error;
+
+  /* Root pool containing this structure as well as BATON and RESULT. */
+  apr_pool_t *pool;
+
+  /* Set once the process function returned.  Only access this while
+   * holding the queue's mutex. */
+  svn_boolean_t done;
+
+  /* Next task in order of addition.  NULL for the last one.  Only modify
+   * this while holding the queue's mutex. */
+  struct task_t *next;
+} task_t;
+
+/* The actual queue structure. */
+struct svn_task__queue_t
+{
+  /* Callbacks as passed to svn_task__queue_create. */
+  svn_task__process_func_t process_func;
+  svn_task__output_func_t output_func;
+  void *output_baton;
+
+  /* If set, use the worker threads.  Process synchronously otherwise. */
+  svn_boolean_t concurrent;
+
+  /* Maximum number of tasks being processed at the same time. */
+  int thread_count;
+
+  /* Maximum number of tasks in flight when returning to the caller. */
+  int max_pending;
+
+  /* Tasks whose results have not been output, yet, in order of addition.
+   * Either both are NULL or both are not NULL. */
+  task_t *first;
+  task_t *last;
+
+  /* Number of entries in the FIRST ... LAST list. */
+  int pending;
+
+  /* First task in the FIRST ... LAST list that has not been handed to a
+   * worker, yet.  All tasks following it have not been started either.
+   * Only access this while holding the mutex. */
+  task_t *unstarted;
+
+  /* Number of workers currently processing tasks of this queue.  Never
+   * exceeds THREAD_COUNT.  Only access this while holding the mutex. */
+  int running;
+
+  /* Set once we returned an error to the caller. */
+  svn_boolean_t failed;
+
+  /* Synchronization objects for the task completion flags. */
+  svn_mutex__t *mutex;
+#if APR_HAS_THREADS
+  apr_thread_cond_t *cond;
+#endif
+
+  /* Scratch pool to use with the output function. */
+  apr_pool_t *scratch_pool;
+};
+
+/* Data structures for concurrent execution are only available if
+ * we have threading support.
+ */
+#if APR_HAS_THREADS
+
+/* Number of microseconds that an unused thread remains in the pool before
+ * being terminated.
+ */
+#define THREADPOOL_THREAD_IDLE_LIMIT 1000000
+
+/* Maximum number of threads in THREAD_POOL, i.e. number of tasks that we
+ * can execute concurrently throughout the process. */
+#define MAX_THREADS 64
+
+/* Thread pool to execute the tasks of all queues. */
+static apr_thread_pool_t *thread_pool = NULL;
+
+#endif
+
+/* Keep track on whether we already created the THREAD_POOL . */
+static svn_atomic_t thread_pool_initialized = FALSE;
+
+#if APR_HAS_THREADS
+
+/* Destructor function that implicitly cleans up any running threads
+   in the TRHEAD_POOL *once*.
+
+   Must be run as a pre-cleanup hook.
+ */
+static apr_status_t
+thread_pool_pre_cleanup(void *data)
+{
+  apr_thread_pool_t *tp = thread_pool;
+  if (!thread_pool)
+    return APR_SUCCESS;
+
+  thread_pool = NULL;
+  thread_pool_initialized = FALSE;
+
+  return apr_thread_pool_destroy(tp);
+}
+
+#endif
+
+/* Create the global THREAD_POOL.  Implements svn_atomic__err_init_func_t.
+ */
+static svn_error_t *
+create_thread_pool(void *baton,
+                   apr_pool_t *unused_pool)
+{
+#if APR_HAS_THREADS
+  /* The thread-pool must be allocated from a thread-safe pool that lives
+     as long as the process does. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  WRAP_APR_ERR(apr_thread_pool_create(&thread_pool, 0, MAX_THREADS, pool),
+               _("Can't create task thread pool"));
+
+  /* Work around an APR bug:  The cleanup must happen in the pre-cleanup
+     hook instead of the normal cleanup hook.  Otherwise, the sub-pools
+     containing the thread objects would already be invalid. */
+  apr_pool_pre_cleanup_register(pool, NULL, thread_pool_pre_cleanup);
+
+  /* let idle threads linger for a while in case more requests are
+     coming in */
+  apr_thread_pool_idle_wait_set(thread_pool, THREADPOOL_THREAD_IDLE_LIMIT);
+
+  /* don't queue requests unless we reached the worker thread limit */
+  apr_thread_pool_threshold_set(thread_pool, 0);
+
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Run the process function of QUEUE on TASK. */
+static void
+process(task_t *task)
+{
+  apr_pool_t *scratch_pool = svn_pool_create(task->pool);
+  task->error = task->queue->process_func(&task->result, task->baton,
+                                          task->pool, scratch_pool);
+  svn_pool_destroy(scratch_pool);
+}
+
+/* Set the completion flag of TASK and wake up any waiting thread.
+ * If NEXT is not NULL, the caller is a worker that just finished TASK.
+ * Hand it the next unstarted task of the queue in *NEXT or, if there is
+ * none, set *NEXT to NULL and retire the worker. */
+static svn_error_t *
+signal_done(task_t **next,
+            task_t *task)
+{
+  svn_task__queue_t *queue = task->queue;
+
+  if (next)
+    *next = NULL;
+
+  SVN_ERR(svn_mutex__lock(queue->mutex));
+  task->done = TRUE;
+
+  if (next)
+    {
+      *next = queue->unstarted;
+      if (*next)
+        queue->unstarted = (*next)->next;
+      else
+        --queue->running;
+    }
+
+#if APR_HAS_THREADS
+  if (queue->concurrent)
+    {
+      apr_status_t status = apr_thread_cond_broadcast(queue->cond);
+      if (status)
+        return svn_mutex__unlock(queue->mutex,
+                                 svn_error_wrap_apr(status,
+                                    _("Can't broadcast condition variable")));
+    }
+#endif
+
+  return svn_error_trace(svn_mutex__unlock(queue->mutex, SVN_NO_ERROR));
+}
+
+#if APR_HAS_THREADS
+
+/* Thread-pool function processing the task_t given by DATA.  Continue
+ * with the queue's unstarted tasks until there are none left, such that
+ * the queue never occupies more than its THREAD_COUNT workers. */
+static void * APR_THREAD_FUNC
+process_task(apr_thread_t *tid,
+             void *data)
+{
+  task_t *task = data;
+  while (task)
+    {
+      process(task);
+
+      /* As soon as this returns, the main thread may have released TASK.
+         There is no way to report this error to anyone and the main
+         thread will probably deadlock anyway. */
+      svn_error_clear(signal_done(&task, task));
+    }
+
+  return NULL;
+}
+
+#endif
+
+/* Wait until the first task in QUEUE has been processed. */
+static svn_error_t *
+wait_for_first(svn_task__queue_t *queue)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  SVN_ERR(svn_mutex__lock(queue->mutex));
+
+#if APR_HAS_THREADS
+  /* This loop implicitly handles spurious wake-ups. */
+  while (!queue->first->done && !err)
+    {
+      apr_status_t status = apr_thread_cond_wait(queue->cond,
+                                                 svn_mutex__get(queue->mutex));
+      if (status)
+        err = svn_error_wrap_apr(status, _("Can't wait for task completion"));
+    }
+#endif
+
+  return svn_error_trace(svn_mutex__unlock(queue->mutex, err));
+}
+
+/* Set *DONE to TRUE, if the first task in QUEUE has been processed. */
+static svn_error_t *
+is_first_done(svn_boolean_t *done,
+              svn_task__queue_t *queue)
+{
+  SVN_MUTEX__WITH_LOCK(queue->mutex, (*done = queue->first->done,
+                                      SVN_NO_ERROR));
+  return SVN_NO_ERROR;
+}
+
+/* Remove the first, already processed task from QUEUE, pass its result to
+ * the output function and release the task. */
+static svn_error_t *
+output_first(svn_task__queue_t *queue)
+{
+  task_t *task = queue->first;
+  svn_error_t *err = task->error;
+
+  queue->first = task->next;
+  if (queue->first == NULL)
+    queue->last = NULL;
+  --queue->pending;
+
+  if (!err)
+    {
+      svn_pool_clear(queue->scratch_pool);
+      err = queue->output_func(task->result, queue->output_baton,
+                               queue->scratch_pool);
+    }
+
+  svn_pool_destroy(task->pool);
+  if (err)
+    queue->failed = TRUE;
+
+  return svn_error_trace(err);
+}
+
+/* Pool cleanup function waiting for all tasks of the svn_task__queue_t
+ * in DATA to complete.  Discard their results. */
+static apr_status_t
+queue_cleanup(void *data)
+{
+  svn_task__queue_t *queue = data;
+  task_t *task;
+
+  /* Don't start any further tasks. */
+  svn_error_clear(svn_mutex__lock(queue->mutex));
+  for (task = queue->unstarted; task; task = task->next)
+    task->done = TRUE;
+
+  queue->unstarted = NULL;
+  svn_error_clear(svn_mutex__unlock(queue->mutex, SVN_NO_ERROR));
+
+  while (queue->first)
+    {
+      task_t *task = queue->first;
+
+      svn_error_clear(wait_for_first(queue));
+      queue->first = task->next;
+
+      svn_error_clear(task->error);
+      svn_pool_destroy(task->pool);
+    }
+
+  queue->last = NULL;
+  queue->pending = 0;
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+svn_task__queue_create(svn_task__queue_t **queue,
+                       int thread_count,
+                       int max_pending,
+                       svn_task__process_func_t process_func,
+                       svn_task__output_func_t output_func,
+                       void *output_baton,
+                       apr_pool_t *result_pool)
+{
+  svn_task__queue_t *result = apr_pcalloc(result_pool, sizeof(*result));
+
+  result->process_func = process_func;
+  result->output_func = output_func;
+  result->output_baton = output_baton;
+  result->thread_count = thread_count;
+  result->max_pending = MAX(max_pending, thread_count);
+  result->scratch_pool = svn_pool_create(result_pool);
+
+#if APR_HAS_THREADS
+  result->concurrent = thread_count > 1;
+  if (result->concurrent)
+    {
+      SVN_ERR(svn_atomic__init_once(&thread_pool_initialized,
+                                    create_thread_pool, NULL, result_pool));
+      WRAP_APR_ERR(apr_thread_cond_create(&result->cond, result_pool),
+                   _("Can't create condition variable"));
+    }
+#endif
+
+  SVN_ERR(svn_mutex__init(&result->mutex, result->concurrent, result_pool));
+
+  /* Register this after creating the synchronization objects such that
+     our cleanup will run before theirs. */
+  apr_pool_cleanup_register(result_pool, result, queue_cleanup,
+                            apr_pool_cleanup_null);
+
+  *queue = result;
+  return SVN_NO_ERROR;
+}
+
+apr_pool_t *
+svn_task__queue_task_pool(svn_task__queue_t *queue)
+{
+  /* Root pools may safely be used in a different thread than the one
+   * that created them. */
+  return svn_pool_create(NULL);
+}
+
+svn_error_t *
+svn_task__queue_add(svn_task__queue_t *queue,
+                    void *baton,
+                    apr_pool_t *task_pool)
+{
+  task_t *task = apr_pcalloc(task_pool, sizeof(*task));
+
+  SVN_ERR_ASSERT(!queue->failed);
+
+  task->queue = queue;
+  task->baton = baton;
+  task->pool = task_pool;
+
+#if APR_HAS_THREADS
+  if (queue->concurrent)
+    {
+      svn_boolean_t start;
+      apr_status_t status;
+
+      /* Forgot to call svn_task__queue_create() or cleaned up the
+       * owning pool too early? */
+      SVN_ERR_ASSERT(thread_pool);
+
+      /* Start a new worker if the queue has not used up its share, yet.
+       * Otherwise, one of the running workers will pick up TASK. */
+      SVN_ERR(svn_mutex__lock(queue->mutex));
+      if (queue->last)
+        queue->last->next = task;
+      else
+        queue->first = task;
+
+      queue->last = task;
+      start = queue->running < queue->thread_count;
+      if (start)
+        ++queue->running;
+      else if (!queue->unstarted)
+        queue->unstarted = task;
+      SVN_ERR(svn_mutex__unlock(queue->mutex, SVN_NO_ERROR));
+
+      ++queue->pending;
+
+      /* If we can't hand the task to a worker thread, simply process it
+       * ourselves. */
+      if (start)
+        {
+          status = apr_thread_pool_push(thread_pool, process_task, task,
+                                        APR_THREAD_TASK_PRIORITY_NORMAL,
+                                        queue);
+          if (status)
+            {
+              SVN_MUTEX__WITH_LOCK(queue->mutex,
+                                   (--queue->running, SVN_NO_ERROR));
+              process(task);
+              SVN_ERR(signal_done(NULL, task));
+            }
+        }
+    }
+  else
+#endif
+    {
+      if (queue->last)
+        queue->last->next = task;
+      else
+        queue->first = task;
+
+      queue->last = task;
+      ++queue->pending;
+
+      process(task);
+      task->done = TRUE;
+    }
+
+  /* Pass on all results that are available in order.  Block if there are
+   * too many tasks in flight. */
+  while (queue->first)
+    {
+      svn_boolean_t done;
+      SVN_ERR(is_first_done(&done, queue));
+
+      if (!done)
+        {
+          if (queue->pending <= queue->max_pending)
+            break;
+
+          SVN_ERR(wait_for_first(queue));
+        }
+
+      SVN_ERR(output_first(queue));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_task__queue_finish(svn_task__queue_t *queue)
+{
+  SVN_ERR_ASSERT(!queue->failed);
+
+  while (queue->first)
+    {
+      SVN_ERR(wait_for_first(queue));
+      SVN_ERR(output_first(queue));
+    }
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,499 @@
+/*
+ * changes.c :  the change journal of a file system watcher
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_pools.h>
+#include <apr_file_io.h>
+#include <apr_strings.h>
+#include <apr_time.h>
+
+#include "svn_types.h"
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+
+#include "wc.h"
+#include "adm_files.h"
+#include "changes.h"
+
+#include "svn_private_config.h"
+
+#define SDB_FILE  "wc.db"
+
+/* Header lines of the journal and of the baseline file. */
+#define JOURNAL_HEADER "SVN-WC-CHANGES 1 "
+#define BASELINE_HEADER "SVN-WC-CHANGES-BASE 1"
+
+/* Basename prefix of the sync cookies in the SVN_WC__ADM_TMP directory. */
+#define SYNC_COOKIE_PREFIX "changes-sync"
+
+/* Give up on the watcher if it did not confirm our sync cookie within this
+   time.  While waiting, check the journal after the first interval and
+   then double it up to the maximum interval.  The watcher usually
+   confirms within a few milliseconds. */
+#define SYNC_TIMEOUT (apr_time_from_sec(1))
+#define SYNC_POLL_MIN_INTERVAL (apr_time_from_msec(1))
+#define SYNC_POLL_MAX_INTERVAL (apr_time_from_msec(64))
+
+/* Read the journal in chunks of this size. */
+#define JOURNAL_CHUNK_SIZE 0x10000
+
+struct svn_wc__changes_t
+{
+  /* The working copy that the journal belongs to. */
+  const char *wcroot_abspath;
+
+  /* The state to store in the next baseline: the journal's generation,
+     the offset just behind the sync confirmation and the wc.db state, all
+     as of the start of this status walk. */
+  const char *generation;
+  apr_off_t offset;
+  const char *db_state;
+
+  /* Whether the previous baseline is usable.  Only then will the
+     following hashes be filled. */
+  svn_boolean_t baseline_valid;
+
+  /* const char *relpath -> "" for the directories whose entries did not
+     match the wc.db during the previous walk. */
+  apr_hash_t *irregular_dirs;
+
+  /* const char *relpath -> "" for the directories that had entries
+     changed since the previous walk. */
+  apr_hash_t *changed_dirs;
+
+  /* const char *relpath -> "" for directory entries that have been
+     changed since the previous walk.  If any of these is a directory,
+     its whole sub-tree may have changed. */
+  apr_hash_t *changed_trees;
+
+  /* const char *relpath -> "" for the directories found to not match the
+     wc.db during this walk. */
+  apr_hash_t *found_irregular;
+
+  /* Allocate the contents of the hashes in here. */
+  apr_pool_t *pool;
+};
+
+/* Set *STATE to a string describing the current state of the wc.db in
+   WCROOT_ABSPATH, allocated in RESULT_POOL.  Any write to the database
+   will change it.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_db_state(const char **state,
+             const char *wcroot_abspath,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  const char *db_abspath = svn_wc__adm_child(wcroot_abspath, SDB_FILE,
+                                             scratch_pool);
+  const char *wal_abspath = apr_pstrcat(scratch_pool, db_abspath, "-wal",
+                                        SVN_VA_NULL);
+  const svn_io_dirent2_t *db_dirent;
+  const svn_io_dirent2_t *wal_dirent;
+
+  SVN_ERR(svn_io_stat_dirent2(&db_dirent, db_abspath, FALSE, FALSE,
+                              scratch_pool, scratch_pool));
+  SVN_ERR(svn_io_stat_dirent2(&wal_dirent, wal_abspath, FALSE, TRUE,
+                              scratch_pool, scratch_pool));
+
+  *state = apr_psprintf(result_pool,
+                        "%" SVN_FILESIZE_T_FMT " %" APR_TIME_T_FMT
+                        " %" SVN_FILESIZE_T_FMT " %" APR_TIME_T_FMT,
+                        db_dirent->filesize, db_dirent->mtime,
+                        wal_dirent->filesize, wal_dirent->mtime);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the next LF terminated line from *DATA, which ends at END, and
+   advance *DATA behind it.  Return NULL if there is no complete line. */
+static const char *
+next_line(char **data,
+          const char *end)
+{
+  char *line = *data;
+  char *eol = memchr(line, '\n', end - line);
+
+  if (!eol)
+    return NULL;
+
+  *eol = '\0';
+  *data = eol + 1;
+
+  return line;
+}
+
+/* Return TRUE if JOURNAL is being maintained by a watcher, i.e. if it is
+   locked.  Use SCRATCH_POOL for temporary allocations. */
+static svn_boolean_t
+watcher_is_live(apr_file_t *journal,
+                apr_pool_t *scratch_pool)
+{
+  apr_pool_t *lock_pool = svn_pool_create(scratch_pool);
+  svn_error_t *err = svn_io_lock_open_file(journal, FALSE, TRUE, lock_pool);
+  svn_boolean_t live = FALSE;
+
+  if (err)
+    {
+      live = APR_STATUS_IS_EAGAIN(err->apr_err)
+          || APR_STATUS_IS_EACCES(err->apr_err);
+      svn_error_clear(err);
+    }
+  else
+    svn_error_clear(svn_io_unlock_open_file(journal, lock_pool));
+
+  svn_pool_destroy(lock_pool);
+
+  return live;
+}
+
+/* Add the change of directory entry RELPATH to CHANGES. */
+static void
+add_change(svn_wc__changes_t *changes,
+           const char *relpath)
+{
+  /* Be safe with malformed input: that tells us nothing. */
+  if (!svn_relpath_is_canonical(relpath))
+    relpath = "";
+
+  relpath = apr_pstrdup(changes->pool, relpath);
+  svn_hash_sets(changes->changed_trees, relpath, "");
+  if (*relpath)
+    svn_hash_sets(changes->changed_dirs,
+                  svn_relpath_dirname(relpath, changes->pool), "");
+}
+
+/* Read the complete lines in JOURNAL from CHANGES->OFFSET onwards, add
+   the changes to CHANGES if COLLECT is set and advance CHANGES->OFFSET
+   behind the lines.  Stop right after the sync confirmation for COOKIE
+   and set *SYNCED in that case.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+read_journal(svn_boolean_t *synced,
+             svn_wc__changes_t *changes,
+             apr_file_t *journal,
+             const char *cookie,
+             svn_boolean_t collect,
+             apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buffer = svn_stringbuf_create_ensure(JOURNAL_CHUNK_SIZE,
+                                                        scratch_pool);
+  apr_off_t offset = changes->offset;
+  svn_boolean_t eof = FALSE;
+
+  *synced = FALSE;
+  SVN_ERR(svn_io_file_seek(journal, APR_SET, &offset, scratch_pool));
+
+  while (!eof && !*synced)
+    {
+      apr_size_t bytes_read;
+      char *data;
+      const char *end;
+      const char *line;
+
+      svn_stringbuf_ensure(buffer, buffer->len + JOURNAL_CHUNK_SIZE);
+      SVN_ERR(svn_io_file_read_full2(journal, buffer->data + buffer->len,
+                                     JOURNAL_CHUNK_SIZE, &bytes_read, &eof,
+                                     scratch_pool));
+      buffer->len += bytes_read;
+      buffer->data[buffer->len] = '\0';
+
+      data = buffer->data;
+      end = buffer->data + buffer->len;
+      while (!*synced && (line = next_line(&data, end)))
+        {
+          if (collect && line[0] == 'c' && line[1] == ' ')
+            add_change(changes, line + 2);
+          else if (line[0] == 's' && line[1] == ' '
+                   && strcmp(line + 2, cookie) == 0)
+            *synced = TRUE;
+        }
+
+      /* Keep the incomplete last line for the next round. */
+      changes->offset += data - buffer->data;
+      svn_stringbuf_remove(buffer, 0, data - buffer->data);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the baseline stored by the previous walk in CHANGES and set
+   CHANGES->BASELINE_VALID and CHANGES->OFFSET accordingly.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_baseline(svn_wc__changes_t *changes,
+              apr_pool_t *scratch_pool)
+{
+  const char *path = svn_wc__adm_child(changes->wcroot_abspath,
+                                       SVN_WC__ADM_CHANGES_BASE,
+                                       scratch_pool);
+  svn_stringbuf_t *contents;
+  svn_error_t *err;
+  char *data;
+  const char *end;
+  const char *line;
+  apr_int64_t offset;
+
+  err = svn_stringbuf_from_file2(&contents, path, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  data = contents->data;
+  end = contents->data + contents->len;
+
+  /* Header, generation, journal offset and wc.db state must match. */
+  line = next_line(&data, end);
+  if (!line || strcmp(line, BASELINE_HEADER) != 0)
+    return SVN_NO_ERROR;
+
+  line = next_line(&data, end);
+  if (!line || strcmp(line, changes->generation) != 0)
+    return SVN_NO_ERROR;
+
+  line = next_line(&data, end);
+  if (!line)
+    return SVN_NO_ERROR;
+  err = svn_cstring_atoi64(&offset, line);
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  line = next_line(&data, end);
+  if (!line || strcmp(line, changes->db_state) != 0)
+    return SVN_NO_ERROR;
+
+  while ((line = next_line(&data, end)))
+    {
+      if (line[0] != 'i' || line[1] != ' '
+          || !svn_relpath_is_canonical(line + 2))
+        return SVN_NO_ERROR;
+
+      svn_hash_sets(changes->irregular_dirs,
+                    apr_pstrdup(changes->pool, line + 2), "");
+    }
+
+  changes->offset = (apr_off_t)offset;
+  changes->baseline_valid = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__changes_open(svn_wc__changes_t **changes,
+                     svn_wc__db_t *db,
+                     const char *local_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  svn_wc__changes_t *result;
+  const char *wcroot_abspath;
+  const char *journal_abspath;
+  const char *cookie_abspath;
+  const char *cookie;
+  apr_file_t *journal;
+  svn_stringbuf_t *header;
+  svn_boolean_t eof;
+  svn_boolean_t synced = FALSE;
+  apr_time_t deadline;
+  apr_interval_time_t interval = SYNC_POLL_MIN_INTERVAL;
+  svn_error_t *err;
+
+  *changes = NULL;
+
+  SVN_ERR(svn_wc__db_get_wcroot(&wcroot_abspath, db, local_abspath,
+                                scratch_pool, scratch_pool));
+  journal_abspath = svn_wc__adm_child(wcroot_abspath, SVN_WC__ADM_CHANGES,
+                                      scratch_pool);
+
+  /* No journal is the usual case. */
+  err = svn_io_file_open(&journal, journal_abspath, APR_READ,
+                         APR_OS_DEFAULT, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  if (!watcher_is_live(journal, scratch_pool))
+    return svn_error_trace(svn_io_file_close(journal, scratch_pool));
+
+  SVN_ERR(svn_io_file_readline(journal, &header, NULL, &eof, APR_SIZE_MAX,
+                               scratch_pool, scratch_pool));
+  if (eof || strncmp(header->data, JOURNAL_HEADER,
+                     sizeof(JOURNAL_HEADER) - 1) != 0)
+    return svn_error_trace(svn_io_file_close(journal, scratch_pool));
+
+  result = apr_pcalloc(result_pool, sizeof(*result));
+  result->pool = result_pool;
+  result->wcroot_abspath = apr_pstrdup(result_pool, wcroot_abspath);
+  result->generation = apr_pstrdup(result_pool,
+                                   header->data + sizeof(JOURNAL_HEADER) - 1);
+  result->offset = header->len + 1;
+  result->irregular_dirs = apr_hash_make(result_pool);
+  result->changed_dirs = apr_hash_make(result_pool);
+  result->changed_trees = apr_hash_make(result_pool);
+  result->found_irregular = apr_hash_make(result_pool);
+
+  SVN_ERR(get_db_state(&result->db_state, wcroot_abspath,
+                       result_pool, scratch_pool));
+  SVN_ERR(read_baseline(result, scratch_pool));
+
+  /* Make the watcher write all changes that happened up to now. */
+  err = svn_io_open_uniquely_named(NULL, &cookie_abspath,
+                                   svn_wc__adm_child(wcroot_abspath,
+                                                     SVN_WC__ADM_TMP,
+                                                     scratch_pool),
+                                   SYNC_COOKIE_PREFIX, ".tmp",
+                                   svn_io_file_del_none,
+                                   scratch_pool, scratch_pool);
+  if (err)
+    {
+      /* E.g. a read-only working copy.  Just don't use the journal. */
+      svn_error_clear(err);
+      return svn_error_trace(svn_io_file_close(journal, scratch_pool));
+    }
+
+  cookie = svn_dirent_basename(cookie_abspath, NULL);
+  deadline = apr_time_now() + SYNC_TIMEOUT;
+  while (TRUE)
+    {
+      err = read_journal(&synced, result, journal, cookie,
+                         result->baseline_valid, scratch_pool);
+      if (err || synced || apr_time_now() + interval > deadline)
+        break;
+
+      /* Give up right away if the watcher died or replaced the journal,
+         which releases its lock on the one we opened. */
+      if (!watcher_is_live(journal, scratch_pool))
+        break;
+
+      apr_sleep(interval);
+      interval = MIN(2 * interval, SYNC_POLL_MAX_INTERVAL);
+    }
+
+  /* The journal is complete up to the sync confirmation only if the
+     watcher is still running.  Otherwise, it may have died before
+     catching up with all changes. */
+  if (!err && synced && watcher_is_live(journal, scratch_pool))
+    *changes = result;
+
+  err = svn_error_compose_create(err,
+                                 svn_io_remove_file2(cookie_abspath, TRUE,
+                                                     scratch_pool));
+  err = svn_error_compose_create(err, svn_io_file_close(journal,
+                                                        scratch_pool));
+  if (err)
+    *changes = NULL;
+
+  return svn_error_trace(err);
+}
+
+svn_boolean_t
+svn_wc__changes_dir_unchanged(svn_wc__changes_t *changes,
+                              const char *local_abspath,
+                              apr_pool_t *scratch_pool)
+{
+  const char *relpath;
+
+  if (!changes->baseline_valid)
+    return FALSE;
+
+  relpath = svn_dirent_skip_ancestor(changes->wcroot_abspath, local_abspath);
+  if (!relpath)
+    return FALSE;
+
+  if (svn_hash_gets(changes->irregular_dirs, relpath)
+      || svn_hash_gets(changes->changed_dirs, relpath))
+    return FALSE;
+
+  /* Has anything above us been replaced? */
+  while (TRUE)
+    {
+      if (svn_hash_gets(changes->changed_trees, relpath))
+        return FALSE;
+
+      if (!*relpath)
+        break;
+
+      relpath = svn_relpath_dirname(relpath, scratch_pool);
+    }
+
+  return TRUE;
+}
+
+void
+svn_wc__changes_mark_irregular(svn_wc__changes_t *changes,
+                               const char *local_abspath)
+{
+  const char *relpath = svn_dirent_skip_ancestor(changes->wcroot_abspath,
+                                                 local_abspath);
+
+  if (relpath)
+    svn_hash_sets(changes->found_irregular,
+                  apr_pstrdup(changes->pool, relpath), "");
+}
+
+svn_error_t *
+svn_wc__changes_save(svn_wc__changes_t *changes,
+                     const char *walk_root_abspath,
+                     apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *contents;
+  apr_hash_index_t *hi;
+
+  if (strcmp(walk_root_abspath, changes->wcroot_abspath) != 0)
+    return SVN_NO_ERROR;
+
+  contents = svn_stringbuf_createf(scratch_pool,
+                                   "%s\n%s\n%" APR_OFF_T_FMT "\n%s\n",
+                                   BASELINE_HEADER, changes->generation,
+                                   changes->offset, changes->db_state);
+
+  for (hi = apr_hash_first(scratch_pool, changes->found_irregular);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      svn_stringbuf_appendcstr(contents, "i ");
+      svn_stringbuf_appendcstr(contents, apr_hash_this_key(hi));
+      svn_stringbuf_appendbyte(contents, '\n');
+    }
+
+  return svn_error_trace(
+           svn_io_write_atomic2(svn_wc__adm_child(changes->wcroot_abspath,
+                                                  SVN_WC__ADM_CHANGES_BASE,
+                                                  scratch_pool),
+                                contents->data, contents->len,
+                                NULL, FALSE, scratch_pool));
+}
@@ -0,0 +1,118 @@
+/*
+ * changes.h: the change journal of a file system watcher
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* A file system watcher process, e.g. tools/client-side/svn-wc-watch,
+ * may record all changes to the working copy tree in a journal next to
+ * the wc.db.  The local status walk uses it to skip reading directories
+ * whose entries are known to still match the wc.db.
+ *
+ * The journal is the file SVN_WC__ADM_CHANGES in the administrative area
+ * of the working copy root.  It consists of LF terminated lines:
+ *
+ *   SVN-WC-CHANGES 1 <generation>
+ *   c <relpath>
+ *   s <name>
+ *
+ * The header line comes first.  A "c" line reports that the directory
+ * entry RELPATH has been added, removed or changed; if it is a directory,
+ * anything below it may have changed as well.  An "s" line confirms that
+ * the watcher has seen the creation of the sync cookie NAME within the
+ * SVN_WC__ADM_TMP directory and written all changes that happened before.
+ *
+ * The watcher holds an exclusive lock on the journal for as long as it
+ * keeps it up to date.  Whenever it loses track of changes, it replaces
+ * the journal with a new one using a different GENERATION.
+ *
+ * After every status walk over the whole working copy, we store the
+ * generation, the position in the journal at which the walk started, the
+ * state of the wc.db and the list of directories whose entries did not
+ * match the wc.db in SVN_WC__ADM_CHANGES_BASE.  The next walk only needs
+ * to read the directories listed there, those reported in the journal
+ * since that position and their parents - as long as the generation and
+ * the wc.db are still the same.
+ */
+
+#ifndef SVN_WC_CHANGES_H
+#define SVN_WC_CHANGES_H
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+
+#include "wc_db.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+
+/* The change journal state of a single status walk. */
+typedef struct svn_wc__changes_t svn_wc__changes_t;
+
+/* Open the change journal for the working copy containing LOCAL_ABSPATH
+ * in DB, wait for the watcher to catch up with all changes made so far and
+ * return the result in *CHANGES.  If there is no journal or no watcher is
+ * maintaining it, set *CHANGES to NULL.
+ *
+ * Allocate *CHANGES in RESULT_POOL and use SCRATCH_POOL for temporary
+ * allocations.
+ */
+svn_error_t *
+svn_wc__changes_open(svn_wc__changes_t **changes,
+                     svn_wc__db_t *db,
+                     const char *local_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool);
+
+/* Return TRUE if the entries of the directory LOCAL_ABSPATH are known to
+ * still match the wc.db according to CHANGES.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+svn_boolean_t
+svn_wc__changes_dir_unchanged(svn_wc__changes_t *changes,
+                              const char *local_abspath,
+                              apr_pool_t *scratch_pool);
+
+/* Record in CHANGES that the status walk found the entries of directory
+ * LOCAL_ABSPATH to not match the wc.db.
+ */
+void
+svn_wc__changes_mark_irregular(svn_wc__changes_t *changes,
+                               const char *local_abspath);
+
+/* Store the outcome of the status walk recorded in CHANGES for the next
+ * walk.  That walk must have been started at WALK_ROOT_ABSPATH with
+ * infinite depth and must have checked for text modifications.  Do
+ * nothing unless WALK_ROOT_ABSPATH is the working copy root.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_wc__changes_save(svn_wc__changes_t *changes,
+                     const char *walk_root_abspath,
+                     apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_WC_CHANGES_H */
@@ -1900,6 +1900,10 @@ svn_wc__conflict_invoke_resolver(svn_wc__db_t *db,
   const svn_wc_conflict_version_t *left_version = NULL;
   const svn_wc_conflict_version_t *right_version = NULL;
 
+  /* Resolvers may look at the working copy through a different context,
+     so commit anything that is still being batched. */
+  SVN_ERR(svn_wc__db_flush_batch(db, local_abspath, scratch_pool));
+
   SVN_ERR(svn_wc__conflict_read_info(&operation, &locations,
                                      &text_conflicted, &prop_conflicted,
                                      &tree_conflicted,
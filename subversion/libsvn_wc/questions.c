@@ -82,64 +82,33 @@
  * (of VERSIONED_FILE_SIZE bytes) differs from PRISTINE_STREAM (of
  * PRISTINE_SIZE bytes), else to FALSE if not.
  *
- * If EXACT_COMPARISON is FALSE, translate VERSIONED_FILE_ABSPATH's EOL
- * style and keywords to repository-normal form according to its properties,
- * and compare the result with PRISTINE_STREAM.  If EXACT_COMPARISON is
- * TRUE, translate PRISTINE_STREAM's EOL style and keywords to working-copy
- * form according to VERSIONED_FILE_ABSPATH's properties, and compare the
- * result with VERSIONED_FILE_ABSPATH.
+ * NEED_TRANSLATION, EOL_STYLE, EOL_STR, KEYWORDS and SPECIAL describe the
+ * translation of VERSIONED_FILE_ABSPATH as returned by
+ * svn_wc__get_translate_info(); EXACT_COMPARISON selects its direction as
+ * described for compare_and_verify().
  *
- * HAS_PROPS should be TRUE if the file had properties when it was not
- * modified, otherwise FALSE.
- *
- * PROPS_MOD should be TRUE if the file's properties have been changed,
- * otherwise FALSE.
+ * This does not access the wc.db and may therefore be called from any
+ * thread that exclusively owns PRISTINE_STREAM and SCRATCH_POOL.
  *
  * PRISTINE_STREAM will be closed before a successful return.
- *
- * DB is a wc_db; use SCRATCH_POOL for temporary allocation.
  */
 static svn_error_t *
-compare_and_verify(svn_boolean_t *modified_p,
-                   svn_wc__db_t *db,
+compare_translated(svn_boolean_t *modified_p,
                    const char *versioned_file_abspath,
                    svn_filesize_t versioned_file_size,
                    svn_stream_t *pristine_stream,
                    svn_filesize_t pristine_size,
-                   svn_boolean_t has_props,
-                   svn_boolean_t props_mod,
+                   svn_boolean_t need_translation,
+                   svn_subst_eol_style_t eol_style,
+                   const char *eol_str,
+                   apr_hash_t *keywords,
+                   svn_boolean_t special,
                    svn_boolean_t exact_comparison,
                    apr_pool_t *scratch_pool)
 {
   svn_boolean_t same;
-  svn_subst_eol_style_t eol_style;
-  const char *eol_str;
-  apr_hash_t *keywords;
-  svn_boolean_t special = FALSE;
-  svn_boolean_t need_translation;
   svn_stream_t *v_stream; /* versioned_file */
 
-  SVN_ERR_ASSERT(svn_dirent_is_absolute(versioned_file_abspath));
-
-  if (props_mod)
-    has_props = TRUE; /* Maybe it didn't have properties; but it has now */
-
-  if (has_props)
-    {
-      SVN_ERR(svn_wc__get_translate_info(&eol_style, &eol_str,
-                                         &keywords,
-                                         &special,
-                                         db, versioned_file_abspath, NULL,
-                                         !exact_comparison,
-                                         scratch_pool, scratch_pool));
-
-      need_translation = svn_subst_translation_required(eol_style, eol_str,
-                                                        keywords, special,
-                                                        TRUE);
-    }
-  else
-    need_translation = FALSE;
-
   if (! need_translation
       && (versioned_file_size != pristine_size))
     {
@@ -206,6 +175,100 @@ compare_and_verify(svn_boolean_t *modified_p,
   return SVN_NO_ERROR;
 }
 
+/* Set *MODIFIED_P to TRUE if (after translation) VERSIONED_FILE_ABSPATH
+ * (of VERSIONED_FILE_SIZE bytes) differs from PRISTINE_STREAM (of
+ * PRISTINE_SIZE bytes), else to FALSE if not.
+ *
+ * If EXACT_COMPARISON is FALSE, translate VERSIONED_FILE_ABSPATH's EOL
+ * style and keywords to repository-normal form according to its properties,
+ * and compare the result with PRISTINE_STREAM.  If EXACT_COMPARISON is
+ * TRUE, translate PRISTINE_STREAM's EOL style and keywords to working-copy
+ * form according to VERSIONED_FILE_ABSPATH's properties, and compare the
+ * result with VERSIONED_FILE_ABSPATH.
+ *
+ * HAS_PROPS should be TRUE if the file had properties when it was not
+ * modified, otherwise FALSE.
+ *
+ * PROPS_MOD should be TRUE if the file's properties have been changed,
+ * otherwise FALSE.
+ *
+ * PRISTINE_STREAM will be closed before a successful return.
+ *
+ * DB is a wc_db; use SCRATCH_POOL for temporary allocation.
+ */
+static svn_error_t *
+compare_and_verify(svn_boolean_t *modified_p,
+                   svn_wc__db_t *db,
+                   const char *versioned_file_abspath,
+                   svn_filesize_t versioned_file_size,
+                   svn_stream_t *pristine_stream,
+                   svn_filesize_t pristine_size,
+                   svn_boolean_t has_props,
+                   svn_boolean_t props_mod,
+                   svn_boolean_t exact_comparison,
+                   apr_pool_t *scratch_pool)
+{
+  svn_subst_eol_style_t eol_style = svn_subst_eol_style_none;
+  const char *eol_str = NULL;
+  apr_hash_t *keywords = NULL;
+  svn_boolean_t special = FALSE;
+  svn_boolean_t need_translation;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(versioned_file_abspath));
+
+  if (props_mod)
+    has_props = TRUE; /* Maybe it didn't have properties; but it has now */
+
+  if (has_props)
+    {
+      SVN_ERR(svn_wc__get_translate_info(&eol_style, &eol_str,
+                                         &keywords,
+                                         &special,
+                                         db, versioned_file_abspath, NULL,
+                                         !exact_comparison,
+                                         scratch_pool, scratch_pool));
+
+      need_translation = svn_subst_translation_required(eol_style, eol_str,
+                                                        keywords, special,
+                                                        TRUE);
+    }
+  else
+    need_translation = FALSE;
+
+  return svn_error_trace(compare_translated(modified_p,
+                                            versioned_file_abspath,
+                                            versioned_file_size,
+                                            pristine_stream, pristine_size,
+                                            need_translation,
+                                            eol_style, eol_str, keywords,
+                                            special, exact_comparison,
+                                            scratch_pool));
+}
+
+/* Having found LOCAL_ABSPATH in DB to be unmodified by comparing its
+ * contents, update its recorded FILESIZE and MTIME if we own a write lock.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+repair_timestamp(svn_wc__db_t *db,
+                 const char *local_abspath,
+                 svn_filesize_t filesize,
+                 apr_time_t mtime,
+                 apr_pool_t *scratch_pool)
+{
+  svn_boolean_t own_lock;
+
+  /* The timestamp is missing or "broken" so "repair" it if we can. */
+  SVN_ERR(svn_wc__db_wclock_owns_lock(&own_lock, db, local_abspath, FALSE,
+                                      scratch_pool));
+  if (own_lock)
+    SVN_ERR(svn_wc__db_global_record_fileinfo(db, local_abspath,
+                                              filesize, mtime,
+                                              scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
                                  svn_wc__db_t *db,
@@ -325,19 +388,157 @@ svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
   }
 
   if (!*modified_p)
+    SVN_ERR(repair_timestamp(db, local_abspath, dirent->filesize,
+                             dirent->mtime, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* A text modification check prepared by
+   svn_wc__internal_file_modified_prepare(). */
+struct svn_wc__text_check_t
+{
+  /* The working file and the size and timestamp recorded for it. */
+  const char *local_abspath;
+  svn_filesize_t recorded_size;
+  apr_time_t recorded_mod_time;
+
+  /* The opened pristine and its size. */
+  svn_stream_t *pristine_stream;
+  svn_filesize_t pristine_size;
+
+  /* How to translate the working file into normal form. */
+  svn_boolean_t need_translation;
+  svn_subst_eol_style_t eol_style;
+  const char *eol_str;
+  apr_hash_t *keywords;
+  svn_boolean_t special;
+};
+
+svn_error_t *
+svn_wc__internal_file_modified_prepare(svn_wc__text_check_t **check,
+                                       svn_wc__db_t *db,
+                                       const char *local_abspath,
+                                       apr_pool_t *result_pool,
+                                       apr_pool_t *scratch_pool)
+{
+  svn_wc__text_check_t *result;
+  svn_wc__db_status_t status;
+  svn_node_kind_t kind;
+  const svn_checksum_t *checksum;
+  svn_boolean_t has_props;
+  svn_boolean_t props_mod;
+
+  result = apr_pcalloc(result_pool, sizeof(*result));
+  SVN_ERR(svn_wc__db_read_info(&status, &kind, NULL, NULL, NULL, NULL, NULL,
+                               NULL, NULL, NULL, &checksum, NULL, NULL, NULL,
+                               NULL, NULL, NULL,
+                               &result->recorded_size,
+                               &result->recorded_mod_time,
+                               NULL, NULL, NULL, &has_props, &props_mod,
+                               NULL, NULL, NULL,
+                               db, local_abspath,
+                               scratch_pool, scratch_pool));
+
+  /* Leave the nodes without a pristine to compare with to
+     svn_wc__internal_file_modified_p(). */
+  if (!checksum
+      || (kind != svn_node_file)
+      || ((status != svn_wc__db_status_normal)
+          && (status != svn_wc__db_status_added)))
     {
-      svn_boolean_t own_lock;
+      *check = NULL;
+      return SVN_NO_ERROR;
+    }
 
-      /* The timestamp is missing or "broken" so "repair" it if we can. */
-      SVN_ERR(svn_wc__db_wclock_owns_lock(&own_lock, db, local_abspath, FALSE,
-                                          scratch_pool));
-      if (own_lock)
-        SVN_ERR(svn_wc__db_global_record_fileinfo(db, local_abspath,
-                                                  dirent->filesize,
-                                                  dirent->mtime,
-                                                  scratch_pool));
+  result->local_abspath = apr_pstrdup(result_pool, local_abspath);
+  result->eol_style = svn_subst_eol_style_none;
+
+  if (has_props || props_mod)
+    {
+      SVN_ERR(svn_wc__get_translate_info(&result->eol_style,
+                                         &result->eol_str,
+                                         &result->keywords,
+                                         &result->special,
+                                         db, local_abspath, NULL,
+                                         TRUE /* for_normalization */,
+                                         result_pool, scratch_pool));
+
+      result->need_translation
+        = svn_subst_translation_required(result->eol_style, result->eol_str,
+                                         result->keywords, result->special,
+                                         TRUE);
     }
 
+  SVN_ERR(svn_wc__db_pristine_read(&result->pristine_stream,
+                                   &result->pristine_size,
+                                   db, local_abspath, checksum,
+                                   result_pool, scratch_pool));
+
+  *check = result;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__internal_file_modified_run(svn_wc__text_check_result_t *result,
+                                   const svn_wc__text_check_t *check,
+                                   apr_pool_t *scratch_pool)
+{
+  const svn_io_dirent2_t *dirent;
+  svn_error_t *err;
+
+  result->modified = FALSE;
+  result->compared = FALSE;
+
+  SVN_ERR(svn_io_stat_dirent2(&dirent, check->local_abspath, FALSE, TRUE,
+                              scratch_pool, scratch_pool));
+
+  result->filesize = dirent->filesize;
+  result->mtime = dirent->mtime;
+
+  /* There is no file on disk, so the text is missing, not modified. */
+  if (dirent->kind != svn_node_file)
+    return svn_error_trace(svn_stream_close(check->pristine_stream));
+
+  /* Apply the same heuristic as svn_wc__internal_file_modified_p(). */
+  if ((check->recorded_size == SVN_INVALID_FILESIZE
+       || dirent->filesize == check->recorded_size)
+      && check->recorded_mod_time == dirent->mtime)
+    return svn_error_trace(svn_stream_close(check->pristine_stream));
+
+  err = compare_translated(&result->modified,
+                           check->local_abspath, dirent->filesize,
+                           check->pristine_stream, check->pristine_size,
+                           check->need_translation,
+                           check->eol_style, check->eol_str,
+                           check->keywords, check->special,
+                           FALSE /* exact_comparison */,
+                           scratch_pool);
+
+  /* We already opened the pristine file, so we know that the access
+     denied applies to the working copy path */
+  if (err && APR_STATUS_IS_EACCES(err->apr_err))
+    return svn_error_create(SVN_ERR_WC_PATH_ACCESS_DENIED, err, NULL);
+  else
+    SVN_ERR(err);
+
+  result->compared = TRUE;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__internal_file_modified_finish(svn_boolean_t *modified_p,
+                                      svn_wc__db_t *db,
+                                      const char *local_abspath,
+                                      const svn_wc__text_check_result_t *result,
+                                      apr_pool_t *scratch_pool)
+{
+  *modified_p = result->modified;
+
+  if (result->compared && !result->modified)
+    SVN_ERR(repair_timestamp(db, local_abspath, result->filesize,
+                             result->mtime, scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
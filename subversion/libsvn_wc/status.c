@@ -46,11 +46,13 @@
 
 #include "wc.h"
 #include "props.h"
+#include "changes.h"
 
 #include "private/svn_sorts_private.h"
 #include "private/svn_wc_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_editor.h"
+#include "private/svn_task.h"
 
 
 /* The file internal variant of svn_wc_status3_t, with slightly more
@@ -75,6 +77,70 @@ typedef struct svn_wc__internal_status_t
 } svn_wc__internal_status_t;
 
 
+/*** Concurrent read-ahead for the local status walk.
+
+   The status callbacks must be invoked in depth-first order and the wc.db
+   may only be used from a single thread.  The expensive part of the walk
+   on a cold cache is the file system access, though: reading directories,
+   stat'ing every node and comparing file contents.
+
+   So, before get_dir_status() reports the children of a directory, it
+   queues the listings of the sub-directories that it will descend into
+   and the text comparisons of files that don't match their recorded size
+   and timestamp.  These are processed by worker threads while the walker
+   waits.  Everything that needs the wc.db is read up-front by the walker
+   itself.  The results are then picked up while reporting the children
+   in their usual order.
+
+   Failed read-ahead tasks are simply dropped.  The regular code path will
+   then run into the same error at the time it would have without any
+   read-ahead. */
+typedef struct status_readahead_t
+{
+  /* Processes the read-ahead tasks; see readahead_process(). */
+  svn_task__queue_t *queue;
+
+  /* const char *local_abspath -> apr_hash_t *dirents, for directories
+     whose entries have been read ahead. */
+  apr_hash_t *dirents;
+
+  /* const char *local_abspath -> svn_wc__text_check_result_t *, for files
+     whose text modification status has been determined ahead. */
+  apr_hash_t *text_checks;
+} status_readahead_t;
+
+/* A single read-ahead task. */
+typedef struct readahead_task_t
+{
+  /* The node to read. */
+  const char *local_abspath;
+
+  /* The prepared text comparison for LOCAL_ABSPATH.  If this is NULL,
+     read the entries of directory LOCAL_ABSPATH instead. */
+  svn_wc__text_check_t *check;
+
+  /* Passed through to svn_io_get_dirents3(). */
+  svn_boolean_t only_check_type;
+
+  /* Where to allocate the result.  This is only to be used in the
+     walker's thread, i.e. by readahead_output(). */
+  apr_pool_t *result_pool;
+} readahead_task_t;
+
+/* The result of a readahead_task_t. */
+typedef struct readahead_result_t
+{
+  /* The task that produced this result. */
+  readahead_task_t *task;
+
+  /* If FALSE, processing failed and the result is to be ignored. */
+  svn_boolean_t valid;
+
+  /* The directory entries or the outcome of the text comparison. */
+  apr_hash_t *dirents;
+  svn_wc__text_check_result_t text_check;
+} readahead_result_t;
+
 /*** Baton used for walking the local status */
 struct walk_status_baton
 {
@@ -100,6 +166,14 @@ struct walk_status_baton
 
   /* Repository locks, if set. */
   apr_hash_t *repos_locks;
+
+  /*** Concurrency ***/
+  /* If not NULL, read directories and compare texts ahead of time. */
+  status_readahead_t *readahead;
+
+  /*** Change journal ***/
+  /* If not NULL, the changes reported by a file system watcher. */
+  svn_wc__changes_t *changes;
 };
 
 /*** Editor batons ***/
@@ -333,6 +407,10 @@ internal_status(svn_wc__internal_status_t **status,
    returned to reflect that assumption. If CHECK_WORKING_COPY is FALSE,
    do not adjust the result for missing working copy files.
 
+   If TEXT_CHECK is not NULL, it is the outcome of an earlier check for
+   text modifications of LOCAL_ABSPATH, which will then be used instead
+   of comparing the file contents again.
+
    The status struct's repos_lock field will be set to REPOS_LOCK.
 */
 static svn_error_t *
@@ -347,6 +425,7 @@ assemble_status(svn_wc__internal_status_t **status,
                 svn_boolean_t get_all,
                 svn_boolean_t ignore_text_mods,
                 svn_boolean_t check_working_copy,
+                const svn_wc__text_check_result_t *text_check,
                 const svn_lock_t *repos_lock,
                 apr_pool_t *result_pool,
                 apr_pool_t *scratch_pool)
@@ -468,6 +547,11 @@ assemble_status(svn_wc__internal_status_t **status,
                      && info->recorded_size == dirent->filesize
                      && info->recorded_time == dirent->mtime))
             text_modified_p = FALSE;
+          else if (text_check)
+            SVN_ERR(svn_wc__internal_file_modified_finish(&text_modified_p,
+                                                          db, local_abspath,
+                                                          text_check,
+                                                          scratch_pool));
           else
             {
               svn_error_t *err;
@@ -803,6 +887,7 @@ send_status_structure(const struct walk_status_baton *wb,
 {
   svn_wc__internal_status_t *statstruct;
   const svn_lock_t *repos_lock = NULL;
+  const svn_wc__text_check_result_t *text_check = NULL;
 
   /* Check for a repository lock. */
   if (wb->repos_locks)
@@ -826,12 +911,16 @@ send_status_structure(const struct walk_status_baton *wb,
         }
     }
 
+  if (wb->readahead)
+    text_check = svn_hash_gets(wb->readahead->text_checks, local_abspath);
+
   SVN_ERR(assemble_status(&statstruct, wb->db, local_abspath,
                           parent_repos_root_url, parent_repos_relpath,
                           parent_repos_uuid,
                           info, dirent, get_all,
                           wb->ignore_text_mods, wb->check_working_copy,
-                          repos_lock, scratch_pool, scratch_pool));
+                          text_check, repos_lock,
+                          scratch_pool, scratch_pool));
 
   if (statstruct && status_func)
     return svn_error_trace((*status_func)(status_baton, local_abspath,
@@ -1188,6 +1277,320 @@ one_child_status(const struct walk_status_baton *wb,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_task__process_func_t for readahead_task_t batons. */
+static svn_error_t *
+readahead_process(void **result,
+                  void *baton,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  readahead_task_t *task = baton;
+  readahead_result_t *task_result = apr_pcalloc(result_pool,
+                                                sizeof(*task_result));
+  svn_error_t *err;
+
+  if (task->check)
+    err = svn_wc__internal_file_modified_run(&task_result->text_check,
+                                             task->check, scratch_pool);
+  else
+    err = svn_io_get_dirents3(&task_result->dirents, task->local_abspath,
+                              task->only_check_type,
+                              result_pool, scratch_pool);
+
+  /* The walk will run into the same error again when it gets there. */
+  task_result->task = task;
+  task_result->valid = (err == SVN_NO_ERROR);
+  svn_error_clear(err);
+
+  *result = task_result;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.  Copy the readahead_result_t RESULT
+   into its task's result pool and add it to the status_readahead_t
+   OUTPUT_BATON. */
+static svn_error_t *
+readahead_output(void *result,
+                 void *output_baton,
+                 apr_pool_t *scratch_pool)
+{
+  readahead_result_t *task_result = result;
+  readahead_task_t *task = task_result->task;
+  status_readahead_t *readahead = output_baton;
+  apr_pool_t *pool = task->result_pool;
+  const char *key;
+
+  if (!task_result->valid)
+    return SVN_NO_ERROR;
+
+  key = apr_pstrdup(pool, task->local_abspath);
+  if (task->check)
+    {
+      svn_hash_sets(readahead->text_checks, key,
+                    apr_pmemdup(pool, &task_result->text_check,
+                                sizeof(task_result->text_check)));
+    }
+  else
+    {
+      apr_hash_t *dirents = apr_hash_make(pool);
+      apr_hash_index_t *hi;
+
+      for (hi = apr_hash_first(scratch_pool, task_result->dirents);
+           hi;
+           hi = apr_hash_next(hi))
+        svn_hash_sets(dirents, apr_pstrdup(pool, apr_hash_this_key(hi)),
+                      svn_io_dirent2_dup(apr_hash_this_val(hi), pool));
+
+      svn_hash_sets(readahead->dirents, key, dirents);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read ahead for the children of directory LOCAL_ABSPATH as described for
+   status_readahead_t and wait for all of it to complete.  SORTED_CHILDREN,
+   DIRENTS, NODES and DEPTH are the respective variables of
+   get_dir_status().
+
+   Set *PATHS to the list of child paths that have been queued, such that
+   the caller can remove their results from WB->READAHEAD later on.
+   Allocate *PATHS and the results in RESULT_POOL.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+read_ahead(apr_array_header_t **paths,
+           const struct walk_status_baton *wb,
+           const char *local_abspath,
+           const apr_array_header_t *sorted_children,
+           apr_hash_t *dirents,
+           apr_hash_t *nodes,
+           svn_depth_t depth,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
+{
+  svn_task__queue_t *queue = wb->readahead->queue;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  *paths = apr_array_make(result_pool, 0, sizeof(const char *));
+  for (i = 0; i < sorted_children->nelts; i++)
+    {
+      const svn_sort__item_t *item = &APR_ARRAY_IDX(sorted_children, i,
+                                                    svn_sort__item_t);
+      const svn_io_dirent2_t *dirent;
+      const struct svn_wc__db_info_t *info;
+      svn_boolean_t read_dir = FALSE;
+      svn_boolean_t check_text = FALSE;
+      const char *child_abspath;
+      readahead_task_t *task;
+      apr_pool_t *task_pool;
+
+      dirent = apr_hash_get(dirents, item->key, item->klen);
+      info = apr_hash_get(nodes, item->key, item->klen);
+      if (!info || !dirent || dirent->special
+          || info->status == svn_wc__db_status_not_present
+          || info->status == svn_wc__db_status_excluded
+          || info->status == svn_wc__db_status_server_excluded)
+        continue;
+
+      /* Mirror the conditions under which one_child_status() descends
+         and under which assemble_status() compares file contents. */
+      if (info->kind == svn_node_dir)
+        read_dir = (depth == svn_depth_infinity
+                    && info->has_descendants
+                    && dirent->kind == svn_node_dir);
+      else if (info->kind == svn_node_file)
+        check_text = (!wb->ignore_text_mods
+                      && !info->special
+                      && info->has_checksum
+                      && dirent->kind == svn_node_file
+                      && (info->recorded_size == SVN_INVALID_FILESIZE
+                          || info->recorded_time == 0
+                          || info->recorded_size != dirent->filesize
+                          || info->recorded_time != dirent->mtime));
+
+      if (!read_dir && !check_text)
+        continue;
+
+      svn_pool_clear(iterpool);
+      child_abspath = svn_dirent_join(local_abspath, item->key, result_pool);
+
+      /* Directories known to be unchanged will not be read at all. */
+      if (read_dir && wb->changes
+          && svn_wc__changes_dir_unchanged(wb->changes, child_abspath,
+                                           iterpool))
+        continue;
+
+      task_pool = svn_task__queue_task_pool(queue);
+      task = apr_pcalloc(task_pool, sizeof(*task));
+      task->local_abspath = apr_pstrdup(task_pool, child_abspath);
+      task->only_check_type = wb->ignore_text_mods;
+      task->result_pool = result_pool;
+
+      if (check_text)
+        {
+          svn_error_t *err;
+
+          /* Leave anything unusual to the regular code path. */
+          err = svn_wc__internal_file_modified_prepare(&task->check, wb->db,
+                                                       child_abspath,
+                                                       task_pool, iterpool);
+          if (err || !task->check)
+            {
+              svn_error_clear(err);
+              svn_pool_destroy(task_pool);
+              continue;
+            }
+        }
+
+      APR_ARRAY_PUSH(*paths, const char *) = child_abspath;
+      SVN_ERR(svn_task__queue_add(queue, task, task_pool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_task__queue_finish(queue));
+}
+
+/* Set *DIRENTS to the entries of directory LOCAL_ABSPATH as needed by
+   get_dir_status() for WB.  Allocate them in RESULT_POOL and use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_dirents(apr_hash_t **dirents,
+             const struct walk_status_baton *wb,
+             const char *local_abspath,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+
+  if (wb->readahead
+      && (*dirents = svn_hash_gets(wb->readahead->dirents, local_abspath)))
+    {
+      /* Our parent has already read them for us. */
+      svn_hash_sets(wb->readahead->dirents, local_abspath, NULL);
+      return SVN_NO_ERROR;
+    }
+
+  if (!wb->check_working_copy)
+    {
+      *dirents = apr_hash_make(result_pool);
+      return SVN_NO_ERROR;
+    }
+
+  err = svn_io_get_dirents3(dirents, local_abspath,
+                            wb->ignore_text_mods /* only_check_type*/,
+                            result_pool, scratch_pool);
+  if (err
+      && (APR_STATUS_IS_ENOENT(err->apr_err)
+          || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+    {
+      svn_error_clear(err);
+      *dirents = apr_hash_make(result_pool);
+    }
+  else
+    SVN_ERR(err);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the directory entries that we expect on disk according to NODES,
+   as returned by svn_wc__db_read_children_info(): the kind of every node
+   that should be present and, unless ONLY_CHECK_TYPE is set, the recorded
+   size and timestamp of files.  This is the same information that
+   svn_io_get_dirents3() provides if nothing has been modified.
+
+   Return NULL if NODES don't fully describe the expected entries, e.g.
+   because a timestamp has not been recorded.  Allocate the result in
+   RESULT_POOL. */
+static apr_hash_t *
+expected_dirents(apr_hash_t *nodes,
+                 svn_boolean_t only_check_type,
+                 apr_pool_t *result_pool)
+{
+  apr_hash_t *dirents = apr_hash_make(result_pool);
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(result_pool, nodes); hi; hi = apr_hash_next(hi))
+    {
+      const struct svn_wc__db_info_t *info = apr_hash_this_val(hi);
+      svn_io_dirent2_t *dirent;
+
+      if (info->status == svn_wc__db_status_not_present
+          || info->status == svn_wc__db_status_excluded
+          || info->status == svn_wc__db_status_server_excluded
+          || info->status == svn_wc__db_status_deleted)
+        continue;
+
+      dirent = svn_io_dirent2_create(result_pool);
+      if (info->kind == svn_node_dir)
+        {
+          dirent->kind = svn_node_dir;
+        }
+      else if (info->kind == svn_node_file
+               && info->recorded_size != SVN_INVALID_FILESIZE
+               && info->recorded_time != 0)
+        {
+          dirent->kind = svn_node_file;
+          dirent->special = info->special;
+          if (!only_check_type)
+            {
+              dirent->filesize = info->recorded_size;
+              dirent->mtime = info->recorded_time;
+            }
+        }
+      else
+        return NULL;
+
+      apr_hash_set(dirents, apr_hash_this_key(hi), apr_hash_this_key_len(hi),
+                   dirent);
+    }
+
+  return dirents;
+}
+
+/* Return TRUE if DIRENTS, as read from disk, are exactly what
+   expected_dirents() derives from NODES, i.e. if the status walk would
+   report the same for both.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_boolean_t
+dirents_match_nodes(apr_hash_t *dirents,
+                    apr_hash_t *nodes,
+                    apr_pool_t *scratch_pool)
+{
+  apr_hash_t *expected = expected_dirents(nodes, FALSE, scratch_pool);
+  apr_hash_index_t *hi;
+  unsigned int count = 0;
+
+  if (!expected)
+    return FALSE;
+
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+      const svn_io_dirent2_t *expected_dirent;
+
+      /* The walk never reports the administrative area. */
+      if (svn_wc_is_adm_dir(name, scratch_pool))
+        continue;
+
+      expected_dirent = svn_hash_gets(expected, name);
+      if (!expected_dirent
+          || dirent->kind != expected_dirent->kind
+          || dirent->special != expected_dirent->special)
+        return FALSE;
+
+      if (dirent->kind == svn_node_file
+          && (dirent->filesize != expected_dirent->filesize
+              || dirent->mtime != expected_dirent->mtime))
+        return FALSE;
+
+      count++;
+    }
+
+  return count == apr_hash_count(expected);
+}
+
 /* Send svn_wc_status3_t * structures for the directory LOCAL_ABSPATH and
    for all its child nodes (according to DEPTH) through STATUS_FUNC /
    STATUS_BATON.
@@ -1233,8 +1636,8 @@ get_dir_status(const struct walk_status_baton *wb,
   apr_hash_t *dirents, *nodes, *conflicts, *all_children;
   apr_array_header_t *sorted_children;
   apr_array_header_t *collected_ignore_patterns = NULL;
+  apr_array_header_t *readahead_paths = NULL;
   apr_pool_t *iterpool;
-  svn_error_t *err;
   int i;
 
   if (cancel_func)
@@ -1245,24 +1648,6 @@ get_dir_status(const struct walk_status_baton *wb,
 
   iterpool = svn_pool_create(scratch_pool);
 
-  if (wb->check_working_copy)
-    {
-      err = svn_io_get_dirents3(&dirents, local_abspath,
-                                wb->ignore_text_mods /* only_check_type*/,
-                                scratch_pool, iterpool);
-      if (err
-          && (APR_STATUS_IS_ENOENT(err->apr_err)
-              || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
-        {
-          svn_error_clear(err);
-          dirents = apr_hash_make(scratch_pool);
-        }
-      else
-        SVN_ERR(err);
-    }
-  else
-    dirents = apr_hash_make(scratch_pool);
-
   if (!dir_info)
     SVN_ERR(svn_wc__db_read_single_info(&dir_info, wb->db, local_abspath,
                                         !wb->check_working_copy,
@@ -1283,6 +1668,23 @@ get_dir_status(const struct walk_status_baton *wb,
                                         !wb->check_working_copy,
                                         scratch_pool, iterpool));
 
+  /* If nothing changed on disk since the entries of this directory have
+     last been found to match NODES, we don't need to read them. */
+  dirents = NULL;
+  if (wb->changes
+      && svn_wc__changes_dir_unchanged(wb->changes, local_abspath, iterpool))
+    dirents = expected_dirents(nodes, wb->ignore_text_mods, scratch_pool);
+
+  if (!dirents)
+    {
+      SVN_ERR(read_dirents(&dirents, wb, local_abspath,
+                           scratch_pool, iterpool));
+
+      if (wb->changes && !wb->ignore_text_mods
+          && !dirents_match_nodes(dirents, nodes, iterpool))
+        svn_wc__changes_mark_irregular(wb->changes, local_abspath);
+    }
+
   all_children = apr_hash_overlay(scratch_pool, nodes, dirents);
   if (apr_hash_count(conflicts) > 0)
     all_children = apr_hash_overlay(scratch_pool, conflicts, all_children);
@@ -1340,6 +1742,11 @@ get_dir_status(const struct walk_status_baton *wb,
   sorted_children = svn_sort__hash(all_children,
                                    svn_sort_compare_items_lexically,
                                    scratch_pool);
+
+  if (wb->readahead && wb->check_working_copy)
+    SVN_ERR(read_ahead(&readahead_paths, wb, local_abspath, sorted_children,
+                       dirents, nodes, depth, scratch_pool, iterpool));
+
   for (i = 0; i < sorted_children->nelts; i++)
     {
       const void *key;
@@ -1381,6 +1788,16 @@ get_dir_status(const struct walk_status_baton *wb,
                                iterpool));
     }
 
+  /* Forget the read-ahead results that we did not use. */
+  for (i = 0; readahead_paths && i < readahead_paths->nelts; i++)
+    {
+      const char *child_abspath = APR_ARRAY_IDX(readahead_paths, i,
+                                                const char *);
+
+      svn_hash_sets(wb->readahead->dirents, child_abspath, NULL);
+      svn_hash_sets(wb->readahead->text_checks, child_abspath, NULL);
+    }
+
   /* Destroy our subpools. */
   svn_pool_destroy(iterpool);
 
@@ -2513,6 +2930,8 @@ svn_wc__get_status_editor(const svn_delta_editor_t **editor,
   eb->wb.check_working_copy = check_working_copy;
   eb->wb.repos_locks      = NULL;
   eb->wb.repos_root       = NULL;
+  eb->wb.readahead        = NULL;
+  eb->wb.changes          = NULL;
 
   SVN_ERR(svn_wc__db_externals_defined_below(&eb->wb.externals,
                                              wc_ctx->db, eb->target_abspath,
@@ -2637,6 +3056,7 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
   const svn_io_dirent2_t *dirent;
   const struct svn_wc__db_info_t *info;
   svn_error_t *err;
+  int threads = svn_wc__db_get_worker_threads(db);
 
   wb.db = db;
   wb.target_abspath = local_abspath;
@@ -2644,6 +3064,19 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
   wb.check_working_copy = TRUE;
   wb.repos_root = NULL;
   wb.repos_locks = NULL;
+  wb.readahead = NULL;
+  wb.changes = NULL;
+
+  if (threads > 1)
+    {
+      wb.readahead = apr_pcalloc(scratch_pool, sizeof(*wb.readahead));
+      wb.readahead->dirents = apr_hash_make(scratch_pool);
+      wb.readahead->text_checks = apr_hash_make(scratch_pool);
+      SVN_ERR(svn_task__queue_create(&wb.readahead->queue, threads,
+                                     4 * threads,
+                                     readahead_process, readahead_output,
+                                     wb.readahead, scratch_pool));
+    }
 
   /* Use the caller-provided ignore patterns if provided; the build-time
      configured defaults otherwise. */
@@ -2690,6 +3123,11 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
       && info->status != svn_wc__db_status_excluded
       && info->status != svn_wc__db_status_server_excluded)
     {
+      /* Like saving it below, using the journal is merely an optimization.
+         Just read everything if it can't be used. */
+      svn_error_clear(svn_wc__changes_open(&wb.changes, db, local_abspath,
+                                           scratch_pool, scratch_pool));
+
       SVN_ERR(get_dir_status(&wb,
                              local_abspath,
                              FALSE /* skip_root */,
@@ -2703,6 +3141,13 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
                              status_func, status_baton,
                              cancel_func, cancel_baton,
                              scratch_pool));
+
+      /* Let the next walk skip what we found unchanged.  Don't fail
+         e.g. in read-only working copies. */
+      if (wb.changes && !ignore_text_mods
+          && (depth == svn_depth_infinity || depth == svn_depth_unknown))
+        svn_error_clear(svn_wc__changes_save(wb.changes, local_abspath,
+                                             scratch_pool));
     }
   else
     {
@@ -2900,6 +3345,7 @@ internal_status(svn_wc__internal_status_t **status,
                                          dirent,
                                          TRUE /* get_all */,
                                          FALSE, check_working_copy,
+                                         NULL /* text_check */,
                                          NULL /* repos_lock */,
                                          result_pool, scratch_pool));
 }
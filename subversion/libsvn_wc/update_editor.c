@@ -196,6 +196,9 @@ struct edit_baton
   /* Was the root actually opened (was this a non-empty edit)? */
   svn_boolean_t root_opened;
 
+  /* Are we batching our changes to the wc.db? */
+  svn_boolean_t batching;
+
   /* Was the update-target deleted?  This is a special situation. */
   svn_boolean_t target_deleted;
 
@@ -481,6 +484,12 @@ cleanup_edit_baton(void *edit_baton)
                        NULL /* cancel_func */, NULL /* cancel_baton */,
                        pool);
 
+  if (eb->batching)
+    err = svn_error_compose_create(err,
+                                   svn_wc__db_end_batch(eb->db,
+                                                        eb->wcroot_abspath,
+                                                        pool));
+
   if (err)
     {
       apr_status_t apr_err = err->apr_err;
@@ -1169,6 +1178,11 @@ open_root(void *edit_baton,
      edit run. */
   eb->root_opened = TRUE;
 
+  /* Commit our many small changes to the wc.db in a few large
+     transactions.  Running the work queue commits what it relies on. */
+  SVN_ERR(svn_wc__db_begin_batch(eb->db, eb->wcroot_abspath, pool));
+  eb->batching = TRUE;
+
   SVN_ERR(make_dir_baton(&db, NULL, eb, NULL, FALSE, pool));
   *dir_baton = db;
 
@@ -2187,9 +2201,14 @@ add_directory(const char *path,
                                      scratch_pool));
 
   /* Make sure there is a real directory at LOCAL_ABSPATH, unless we are just
-     updating the DB */
+     updating the DB.  Commit the node first, such that a crash can't leave
+     behind a directory that the wc.db doesn't know about. */
   if (!db->shadowed)
-    SVN_ERR(svn_wc__ensure_directory(db->local_abspath, scratch_pool));
+    {
+      SVN_ERR(svn_wc__db_flush_batch(eb->db, db->local_abspath,
+                                     scratch_pool));
+      SVN_ERR(svn_wc__ensure_directory(db->local_abspath, scratch_pool));
+    }
 
   if (tree_conflict != NULL)
     {
@@ -4734,6 +4753,7 @@ close_edit(void *edit_baton,
 {
   struct edit_baton *eb = edit_baton;
   apr_pool_t *scratch_pool = eb->pool;
+  svn_error_t *err;
 
   /* The editor didn't even open the root; we have to take care of
      some cleanup stuffs. */
@@ -4782,7 +4802,6 @@ close_edit(void *edit_baton,
       if (*eb->target_basename != '\0')
         {
           svn_wc__db_status_t status;
-          svn_error_t *err;
 
           /* Note: we are fetching information about the *target*, not anchor.
              There is no guarantee that the target has a BASE node.
@@ -4849,9 +4868,19 @@ close_edit(void *edit_baton,
      cleanup at the end of this function. */
   apr_pool_cleanup_kill(eb->pool, eb, cleanup_edit_baton);
 
-  SVN_ERR(svn_wc__wq_run(eb->db, eb->wcroot_abspath,
-                         eb->cancel_func, eb->cancel_baton,
-                         eb->pool));
+  err = svn_wc__wq_run(eb->db, eb->wcroot_abspath,
+                       eb->cancel_func, eb->cancel_baton,
+                       eb->pool);
+
+  if (eb->batching)
+    {
+      eb->batching = FALSE;
+      err = svn_error_compose_create(err,
+                                     svn_wc__db_end_batch(eb->db,
+                                                          eb->wcroot_abspath,
+                                                          eb->pool));
+    }
+  SVN_ERR(err);
 
   /* The edit is over, free its pool.
      ### No, this is wrong.  Who says this editor/baton won't be used
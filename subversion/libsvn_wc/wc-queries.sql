@@ -880,6 +880,9 @@ INSERT INTO work_queue (work) VALUES (?1)
 -- STMT_SELECT_WORK_ITEM
 SELECT id, work FROM work_queue ORDER BY id LIMIT 1
 
+-- STMT_SELECT_WORK_ITEMS
+SELECT id, work FROM work_queue ORDER BY id LIMIT ?1
+
 -- STMT_DELETE_WORK_ITEM
 DELETE FROM work_queue WHERE id = ?1
 
@@ -1302,6 +1305,12 @@ PRAGMA locking_mode = exclusive;
    exclusive-locking is mostly used on remote file systems. */
 PRAGMA journal_mode = DELETE
 
+-- STMT_PRAGMA_JOURNAL_MODE_WAL
+PRAGMA journal_mode = WAL
+
+-- STMT_PRAGMA_JOURNAL_MODE_DELETE
+PRAGMA journal_mode = DELETE
+
 -- STMT_FIND_REPOS_PATH_IN_WC
 SELECT local_relpath FROM nodes_current
   WHERE wc_id = ?1 AND repos_path = ?2
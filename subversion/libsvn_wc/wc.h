@@ -290,6 +290,8 @@ struct svn_wc_traversal_info_t
 #define SVN_WC__ADM_PRISTINE            "pristine"
 #define SVN_WC__ADM_NONEXISTENT_PATH    "nonexistent-path"
 #define SVN_WC__ADM_EXPERIMENTAL        "experimental"
+#define SVN_WC__ADM_CHANGES             "changes"
+#define SVN_WC__ADM_CHANGES_BASE        "changes-base"
 
 /* The basename of the ".prej" file, if a directory ever has property
    conflicts.  This .prej file will appear *within* the conflicted
@@ -350,6 +352,59 @@ svn_wc__internal_file_modified_p(svn_boolean_t *modified_p,
                                  svn_boolean_t exact_comparison,
                                  apr_pool_t *scratch_pool);
 
+/* The steps of svn_wc__internal_file_modified_p() with EXACT_COMPARISON
+ * set to FALSE, split up such that the expensive part can be run outside
+ * of the thread that owns the wc.db handle.
+ *
+ * svn_wc__internal_file_modified_prepare() reads everything needed to
+ * check LOCAL_ABSPATH from DB, opens its pristine and returns that state
+ * in *CHECK, allocated in RESULT_POOL.  If LOCAL_ABSPATH has no pristine
+ * to compare with, set *CHECK to NULL; call
+ * svn_wc__internal_file_modified_p() for those.
+ *
+ * svn_wc__internal_file_modified_run() stats the working file and, if
+ * necessary, compares it with the pristine.  It does not access the wc.db
+ * and may be called from any thread that exclusively owns the pool CHECK
+ * was allocated in.  Set *RESULT accordingly.  The pristine stream will
+ * be closed upon successful return.
+ *
+ * svn_wc__internal_file_modified_finish() sets *MODIFIED_P from RESULT
+ * and does the timestamp repair for LOCAL_ABSPATH in DB.
+ */
+typedef struct svn_wc__text_check_t svn_wc__text_check_t;
+
+typedef struct svn_wc__text_check_result_t
+{
+  /* Whether the working file is modified. */
+  svn_boolean_t modified;
+
+  /* Whether the contents had to be compared to find that out. */
+  svn_boolean_t compared;
+
+  /* Size and timestamp of the working file. */
+  svn_filesize_t filesize;
+  apr_time_t mtime;
+} svn_wc__text_check_result_t;
+
+svn_error_t *
+svn_wc__internal_file_modified_prepare(svn_wc__text_check_t **check,
+                                       svn_wc__db_t *db,
+                                       const char *local_abspath,
+                                       apr_pool_t *result_pool,
+                                       apr_pool_t *scratch_pool);
+
+svn_error_t *
+svn_wc__internal_file_modified_run(svn_wc__text_check_result_t *result,
+                                   const svn_wc__text_check_t *check,
+                                   apr_pool_t *scratch_pool);
+
+svn_error_t *
+svn_wc__internal_file_modified_finish(svn_boolean_t *modified_p,
+                                      svn_wc__db_t *db,
+                                      const char *local_abspath,
+                                      const svn_wc__text_check_result_t *result,
+                                      apr_pool_t *scratch_pool);
+
 
 /* Prepare to merge a file content change into the working copy.
 
@@ -13564,21 +13564,76 @@ wq_record(svn_wc__db_wcroot_t *wcroot,
   return SVN_NO_ERROR;
 }
 
+/* The body of svn_wc__db_wq_record_and_fetch_batch().
+ */
+static svn_error_t *
+wq_fetch_batch(apr_array_header_t **ids,
+               apr_array_header_t **work_items,
+               svn_wc__db_wcroot_t *wcroot,
+               const apr_array_header_t *completed_ids,
+               int max_items,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  int i;
+
+  *ids = apr_array_make(result_pool, max_items, sizeof(apr_uint64_t));
+  *work_items = apr_array_make(result_pool, max_items, sizeof(svn_skel_t *));
+
+  for (i = 0; i < completed_ids->nelts; i++)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                        STMT_DELETE_WORK_ITEM));
+      SVN_ERR(svn_sqlite__bind_int64(stmt, 1,
+                                     APR_ARRAY_IDX(completed_ids, i,
+                                                   apr_uint64_t)));
+
+      SVN_ERR(svn_sqlite__step_done(stmt));
+    }
+
+  if (max_items <= 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_WORK_ITEMS));
+  SVN_ERR(svn_sqlite__bind_int(stmt, 1, max_items));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row)
+    {
+      apr_size_t len;
+      const void *val;
+
+      APR_ARRAY_PUSH(*ids, apr_uint64_t) = svn_sqlite__column_int64(stmt, 0);
+
+      val = svn_sqlite__column_blob(stmt, 1, &len, result_pool);
+      APR_ARRAY_PUSH(*work_items, svn_skel_t *) = svn_skel__parse(val, len,
+                                                                  result_pool);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
 svn_error_t *
-svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
-                                    svn_skel_t **work_item,
-                                    svn_wc__db_t *db,
-                                    const char *wri_abspath,
-                                    apr_uint64_t completed_id,
-                                    apr_hash_t *record_map,
-                                    apr_pool_t *result_pool,
-                                    apr_pool_t *scratch_pool)
+svn_wc__db_wq_record_and_fetch_batch(apr_array_header_t **ids,
+                                     apr_array_header_t **work_items,
+                                     svn_wc__db_t *db,
+                                     const char *wri_abspath,
+                                     const apr_array_header_t *completed_ids,
+                                     apr_hash_t *record_map,
+                                     int max_items,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool)
 {
   svn_wc__db_wcroot_t *wcroot;
   const char *local_relpath;
 
-  SVN_ERR_ASSERT(id != NULL);
-  SVN_ERR_ASSERT(work_item != NULL);
+  SVN_ERR_ASSERT(ids != NULL);
+  SVN_ERR_ASSERT(work_items != NULL);
   SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
 
   SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
@@ -13587,10 +13642,11 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
 
   SVN_WC__DB_WITH_TXN(
     svn_error_compose_create(
-            wq_fetch_next(id, work_item,
-                          wcroot, local_relpath, completed_id,
-                          result_pool, scratch_pool),
-            wq_record(wcroot, record_map, scratch_pool)),
+            wq_fetch_batch(ids, work_items,
+                           wcroot, completed_ids, max_items,
+                           result_pool, scratch_pool),
+            record_map ? wq_record(wcroot, record_map, scratch_pool)
+                       : SVN_NO_ERROR),
     wcroot);
 
   return SVN_NO_ERROR;
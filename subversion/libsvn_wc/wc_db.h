@@ -268,6 +268,61 @@ svn_wc__db_open(svn_wc__db_t **db,
 svn_error_t *
 svn_wc__db_close(svn_wc__db_t *db);
 
+/* Return the number of threads that users of DB may employ for I/O
+   intensive work which does not access DB itself, as configured by the
+   SVN_CONFIG_OPTION_WC_WORKER_THREADS option.  */
+int
+svn_wc__db_get_worker_threads(svn_wc__db_t *db);
+
+
+/* Begin to batch the changes made through DB to the working copy containing
+   WRI_ABSPATH.  Until the matching svn_wc__db_end_batch() call, these
+   changes accumulate in a single SQLite transaction instead of being
+   committed one by one.  Calls may be nested.
+
+   Nothing outside of the wc.db may depend on changes that have not been
+   committed yet, as a crash would roll them back.  Therefore, call
+   svn_wc__db_flush_batch() e.g. before creating a directory on disk that
+   the batch has added.  svn_wc__wq_run() flushes the batch before running
+   any work items.
+
+   The batch holds SQLite's 'RESERVED' lock from beginning to end and
+   takes it out again right after every flush.  Other writers to the
+   wc.db fail with SQLITE_BUSY in the meantime.  Usually the caller's
+   working copy write lock keeps them away anyway.  Readers see the
+   batched changes only after they have been committed.  The size of a
+   batch is not limited otherwise.  The update editor runs the work queue
+   for every directory it closes, so one batch holds about one
+   directory's worth of changes.  These stay in the SQLite page cache and
+   spill into the journal when the cache is full.
+
+   If the SVN_CONFIG_OPTION_SQLITE_WAL option is enabled and DB uses
+   exclusive locking, switch the working copy database to write-ahead
+   logging until the batch ends.  Use SCRATCH_POOL for temporary
+   allocations.  */
+svn_error_t *
+svn_wc__db_begin_batch(svn_wc__db_t *db,
+                       const char *wri_abspath,
+                       apr_pool_t *scratch_pool);
+
+/* Commit the changes batched for the working copy containing WRI_ABSPATH
+   in DB so far and continue batching.  Do nothing if no batch is in
+   progress.  Use SCRATCH_POOL for temporary allocations.  */
+svn_error_t *
+svn_wc__db_flush_batch(svn_wc__db_t *db,
+                       const char *wri_abspath,
+                       apr_pool_t *scratch_pool);
+
+/* End the batch started by the matching svn_wc__db_begin_batch() call for
+   the working copy containing WRI_ABSPATH in DB.  If it is the outermost
+   one, commit the batched changes.  Closing DB does the same for all
+   batches that have not been ended.  Use SCRATCH_POOL for temporary
+   allocations.  */
+svn_error_t *
+svn_wc__db_end_batch(svn_wc__db_t *db,
+                     const char *wri_abspath,
+                     apr_pool_t *scratch_pool);
+
 
 /* Initialize the SDB for LOCAL_ABSPATH, which should be a working copy path.
 
@@ -972,7 +1027,12 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
 /* Install the file created via svn_wc__db_pristine_prepare_install() into
    the pristine data store, to be identified by the SHA-1 checksum of its
-   contents, SHA1_CHECKSUM, and whose MD-5 checksum is MD5_CHECKSUM. */
+   contents, SHA1_CHECKSUM, and whose MD-5 checksum is MD5_CHECKSUM.
+
+   If DB uses a shared pristine store (see the
+   SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE option) that already has this
+   text, link to it instead of keeping the new file; otherwise add the new
+   file to that store as well. */
 svn_error_t *
 svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
                             const svn_checksum_t *sha1_checksum,
@@ -1040,7 +1100,9 @@ svn_wc__db_pristine_remove(svn_wc__db_t *db,
                            apr_pool_t *scratch_pool);
 
 
-/* Remove all unreferenced pristines in the WC of WRI_ABSPATH in DB. */
+/* Remove all unreferenced pristines in the WC of WRI_ABSPATH in DB.  If
+   DB uses a shared pristine store, also remove the texts from it that no
+   working copy links to anymore. */
 svn_error_t *
 svn_wc__db_pristine_cleanup(svn_wc__db_t *db,
                             const char *wri_abspath,
@@ -3016,17 +3078,29 @@ svn_wc__db_wq_fetch_next(apr_uint64_t *id,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool);
 
-/* Special variant of svn_wc__db_wq_fetch_next(), which in the same transaction
-   also records timestamps and sizes for one or more nodes */
+/* Variant of svn_wc__db_wq_fetch_next() that handles several work items
+   at once.  In a single transaction, mark the work items whose identifiers
+   (apr_uint64_t) are listed in COMPLETED_IDS as completed, record the
+   timestamps and sizes in RECORD_MAP (const char *local_abspath ->
+   svn_io_dirent2_t *) unless it is NULL and fetch up to MAX_ITEMS of the
+   next work items that need to be completed.
+
+   Set *IDS to the identifiers (apr_uint64_t) and *WORK_ITEMS to the data
+   (svn_skel_t *) of the fetched items, in the order they were queued.
+   Both arrays are empty if there are no more work items or MAX_ITEMS is 0.
+
+   RESULT_POOL will be used to allocate *IDS and *WORK_ITEMS, and
+   SCRATCH_POOL will be used for all temporary allocations.  */
 svn_error_t *
-svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
-                                    svn_skel_t **work_item,
-                                    svn_wc__db_t *db,
-                                    const char *wri_abspath,
-                                    apr_uint64_t completed_id,
-                                    apr_hash_t *record_map,
-                                    apr_pool_t *result_pool,
-                                    apr_pool_t *scratch_pool);
+svn_wc__db_wq_record_and_fetch_batch(apr_array_header_t **ids,
+                                     apr_array_header_t **work_items,
+                                     svn_wc__db_t *db,
+                                     const char *wri_abspath,
+                                     const apr_array_header_t *completed_ids,
+                                     apr_hash_t *record_map,
+                                     int max_items,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool);
 
 
 /* @} */
@@ -25,6 +25,8 @@
 
 #define SVN_WC__I_AM_WC_DB
 
+#include <string.h>
+
 #include "svn_pools.h"
 #include "svn_io.h"
 #include "svn_dirent_uri.h"
@@ -42,6 +44,42 @@
 
 
 
+/* Returns in PRISTINE_ABSPATH a new string allocated from RESULT_POOL,
+   holding the local absolute path to the file location that is dedicated
+   to hold CHECKSUM's pristine file within the pristine store directory
+   STORE_ABSPATH.  The returned path does not necessarily currently exist.
+
+   Any other allocations are made in SCRATCH_POOL. */
+static svn_error_t *
+get_pristine_fname_in_store(const char **pristine_abspath,
+                            const char *store_abspath,
+                            const svn_checksum_t *sha1_checksum,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  const char *hexdigest = svn_checksum_to_cstring(sha1_checksum, scratch_pool);
+  char subdir[3];
+
+  /* We should have a valid checksum and (thus) a valid digest. */
+  SVN_ERR_ASSERT(hexdigest != NULL);
+
+  /* Get the first two characters of the digest, for the subdir. */
+  subdir[0] = hexdigest[0];
+  subdir[1] = hexdigest[1];
+  subdir[2] = '\0';
+
+  hexdigest = apr_pstrcat(scratch_pool, hexdigest, PRISTINE_STORAGE_EXT,
+                          SVN_VA_NULL);
+
+  /* The file is located at STORE/XX/XXYYZZ...svn-base */
+  *pristine_abspath = svn_dirent_join_many(result_pool,
+                                           store_abspath,
+                                           subdir,
+                                           hexdigest,
+                                           SVN_VA_NULL);
+  return SVN_NO_ERROR;
+}
+
 /* Returns in PRISTINE_ABSPATH a new string allocated from RESULT_POOL,
    holding the local absolute path to the file location that is dedicated
    to hold CHECKSUM's pristine file, relating to the pristine store
@@ -57,8 +95,6 @@ get_pristine_fname(const char **pristine_abspath,
                    apr_pool_t *scratch_pool)
 {
   const char *base_dir_abspath;
-  const char *hexdigest = svn_checksum_to_cstring(sha1_checksum, scratch_pool);
-  char subdir[3];
 
   /* ### code is in transition. make sure we have the proper data.  */
   SVN_ERR_ASSERT(pristine_abspath != NULL);
@@ -72,24 +108,12 @@ get_pristine_fname(const char **pristine_abspath,
                                           PRISTINE_STORAGE_RELPATH,
                                           SVN_VA_NULL);
 
-  /* We should have a valid checksum and (thus) a valid digest. */
-  SVN_ERR_ASSERT(hexdigest != NULL);
-
-  /* Get the first two characters of the digest, for the subdir. */
-  subdir[0] = hexdigest[0];
-  subdir[1] = hexdigest[1];
-  subdir[2] = '\0';
-
-  hexdigest = apr_pstrcat(scratch_pool, hexdigest, PRISTINE_STORAGE_EXT,
-                          SVN_VA_NULL);
-
   /* The file is located at DIR/.svn/pristine/XX/XXYYZZ...svn-base */
-  *pristine_abspath = svn_dirent_join_many(result_pool,
-                                           base_dir_abspath,
-                                           subdir,
-                                           hexdigest,
-                                           SVN_VA_NULL);
-  return SVN_NO_ERROR;
+  return svn_error_trace(get_pristine_fname_in_store(pristine_abspath,
+                                                     base_dir_abspath,
+                                                     sha1_checksum,
+                                                     result_pool,
+                                                     scratch_pool));
 }
 
 
@@ -268,10 +292,125 @@ pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
                               PRISTINE_TEMPDIR_RELPATH, SVN_VA_NULL);
 }
 
+/* Try to install the pristine text at PRISTINE_ABSPATH as a hard link to
+ * SHARED_PRISTINE_ABSPATH in the shared pristine store, if that holds the
+ * text of SIZE bytes with the checksum SHA1_CHECKSUM.  Set *LINKED to TRUE
+ * if that worked; otherwise leave PRISTINE_ABSPATH as it was.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+link_from_shared_store(svn_boolean_t *linked,
+                       const char *pristine_abspath,
+                       const char *shared_pristine_abspath,
+                       apr_off_t size,
+                       const svn_checksum_t *sha1_checksum,
+                       apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  svn_checksum_t *checksum;
+  svn_error_t *err;
+
+  *linked = FALSE;
+
+  /* Other users of the store may have put the file there.  Whoever can
+   * write to it can change the pristine text of every working copy that
+   * links to it.  So only link to read-only plain files whose contents
+   * match their name.  Their owners must still be trusted, as they may
+   * make them writable again; see SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE.
+   */
+  err = svn_io_stat(&finfo, shared_pristine_abspath,
+                    APR_FINFO_SIZE | APR_FINFO_TYPE | APR_FINFO_PROT,
+                    scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  if (finfo.filetype != APR_REG || finfo.size != size)
+    return SVN_NO_ERROR;
+  if ((finfo.valid & APR_FINFO_PROT)
+      && (finfo.protection & (APR_UWRITE | APR_GWRITE | APR_WWRITE)))
+    return SVN_NO_ERROR;
+
+  err = svn_io_file_checksum2(&checksum, shared_pristine_abspath,
+                              svn_checksum_sha1, scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  if (!svn_checksum_match(checksum, sha1_checksum))
+    return SVN_NO_ERROR;
+
+  err = svn_io__create_hardlink(pristine_abspath, shared_pristine_abspath,
+                                scratch_pool);
+  if (err && APR_STATUS_IS_EEXIST(err->apr_err))
+    {
+      /* An orphan file, as in pristine_install_txn(). */
+      svn_error_clear(err);
+      SVN_ERR(svn_io_remove_file2(pristine_abspath, TRUE, scratch_pool));
+      err = svn_io__create_hardlink(pristine_abspath, shared_pristine_abspath,
+                                    scratch_pool);
+    }
+  else if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      /* We may not have the subdir for this text yet. */
+      svn_error_clear(err);
+      SVN_ERR(svn_io_make_dir_recursively(
+                svn_dirent_dirname(pristine_abspath, scratch_pool),
+                scratch_pool));
+      err = svn_io__create_hardlink(pristine_abspath, shared_pristine_abspath,
+                                    scratch_pool);
+    }
+
+  /* Different file systems, too many links, a concurrent cleanup of the
+   * shared store, ...  We simply install our own copy then. */
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  *linked = TRUE;
+  return SVN_NO_ERROR;
+}
+
+/* Make the pristine text at PRISTINE_ABSPATH available to other working
+ * copies by linking it as SHARED_PRISTINE_ABSPATH into the shared pristine
+ * store.  This is only an optimization, so ignore all failures, e.g. when
+ * another working copy has just added the same text.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+static void
+add_to_shared_store(const char *pristine_abspath,
+                    const char *shared_pristine_abspath,
+                    apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+
+  err = svn_io__create_hardlink(shared_pristine_abspath, pristine_abspath,
+                                scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      err = svn_io_make_dir_recursively(
+              svn_dirent_dirname(shared_pristine_abspath, scratch_pool),
+              scratch_pool);
+      if (!err)
+        err = svn_io__create_hardlink(shared_pristine_abspath,
+                                      pristine_abspath, scratch_pool);
+    }
+
+  svn_error_clear(err);
+}
+
 /* Install the pristine text described by BATON into the pristine store of
  * SDB.  If it is already stored then just delete the new file
  * BATON->tempfile_abspath.
  *
+ * If SHARED_PRISTINE_ABSPATH is not NULL, link the text from there, if
+ * the shared pristine store has it, or add it there otherwise.
+ *
  * This function expects to be executed inside a SQLite txn that has already
  * acquired a 'RESERVED' lock.
  *
@@ -287,6 +426,8 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
                      const svn_checksum_t *sha1_checksum,
                      /* The pristine text's MD-5 checksum. */
                      const svn_checksum_t *md5_checksum,
+                     /* The path for the file in the shared store, or NULL. */
+                     const char *shared_pristine_abspath,
                      apr_pool_t *scratch_pool)
 {
   svn_sqlite__stmt_t *stmt;
@@ -333,18 +474,40 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
    * an orphan file and it doesn't matter if we overwrite it.) */
   {
     apr_finfo_t finfo;
+    svn_boolean_t linked = FALSE;
+
     SVN_ERR(svn_stream__install_get_info(&finfo, install_stream,
                                          APR_FINFO_SIZE, scratch_pool));
-    SVN_ERR(svn_stream__install_stream(install_stream, pristine_abspath,
-                                       TRUE, scratch_pool));
+
+    if (shared_pristine_abspath)
+      SVN_ERR(link_from_shared_store(&linked, pristine_abspath,
+                                     shared_pristine_abspath, finfo.size,
+                                     sha1_checksum, scratch_pool));
+
+    if (linked)
+      {
+        SVN_ERR(svn_stream__install_delete(install_stream, scratch_pool));
+      }
+    else
+      {
+        SVN_ERR(svn_stream__install_stream(install_stream, pristine_abspath,
+                                           TRUE, scratch_pool));
+
+        /* Other working copies may link to the file, so it must not
+         * become writable through anyone's pristine store. */
+        SVN_ERR(svn_io_set_file_read_only(pristine_abspath, FALSE,
+                                          scratch_pool));
+
+        if (shared_pristine_abspath)
+          add_to_shared_store(pristine_abspath, shared_pristine_abspath,
+                              scratch_pool);
+      }
 
     SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_INSERT_PRISTINE));
     SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
     SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
     SVN_ERR(svn_sqlite__bind_int64(stmt, 3, finfo.size));
     SVN_ERR(svn_sqlite__insert(NULL, stmt));
-
-    SVN_ERR(svn_io_set_file_read_only(pristine_abspath, FALSE, scratch_pool));
   }
 
   return SVN_NO_ERROR;
@@ -354,6 +517,9 @@ struct svn_wc__db_install_data_t
 {
   svn_wc__db_wcroot_t *wcroot;
   svn_stream_t *inner_stream;
+
+  /* The directory of the shared pristine store, or NULL. */
+  const char *shared_store_abspath;
 };
 
 svn_error_t *
@@ -380,6 +546,7 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   *install_data = apr_pcalloc(result_pool, sizeof(**install_data));
   (*install_data)->wcroot = wcroot;
+  (*install_data)->shared_store_abspath = db->shared_pristine_abspath;
 
   SVN_ERR_W(svn_stream__create_for_install(stream,
                                            temp_dir_abspath,
@@ -406,6 +573,7 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
 {
   svn_wc__db_wcroot_t *wcroot = install_data->wcroot;
   const char *pristine_abspath;
+  const char *shared_pristine_abspath = NULL;
 
   SVN_ERR_ASSERT(sha1_checksum != NULL);
   SVN_ERR_ASSERT(sha1_checksum->kind == svn_checksum_sha1);
@@ -416,14 +584,30 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
                              sha1_checksum,
                              scratch_pool, scratch_pool));
 
+  if (install_data->shared_store_abspath)
+    SVN_ERR(get_pristine_fname_in_store(&shared_pristine_abspath,
+                                        install_data->shared_store_abspath,
+                                        sha1_checksum,
+                                        scratch_pool, scratch_pool));
+
   /* Ensure the SQL txn has at least a 'RESERVED' lock before we start looking
-   * at the disk, to ensure no concurrent pristine install/delete txn. */
-  SVN_SQLITE__WITH_IMMEDIATE_TXN(
-    pristine_install_txn(wcroot->sdb,
-                         install_data->inner_stream, pristine_abspath,
-                         sha1_checksum, md5_checksum,
-                         scratch_pool),
-    wcroot->sdb);
+   * at the disk, to ensure no concurrent pristine install/delete txn.  A
+   * batch already holds that lock, and an orphaned file is harmless if
+   * the batch never gets committed. */
+  if (wcroot->batch_level > 0)
+    SVN_SQLITE__WITH_LOCK(
+      pristine_install_txn(wcroot->sdb,
+                           install_data->inner_stream, pristine_abspath,
+                           sha1_checksum, md5_checksum,
+                           shared_pristine_abspath, scratch_pool),
+      wcroot->sdb);
+  else
+    SVN_SQLITE__WITH_IMMEDIATE_TXN(
+      pristine_install_txn(wcroot->sdb,
+                           install_data->inner_stream, pristine_abspath,
+                           sha1_checksum, md5_checksum,
+                           shared_pristine_abspath, scratch_pool),
+      wcroot->sdb);
 
   return SVN_NO_ERROR;
 }
@@ -745,11 +929,22 @@ pristine_remove_if_unreferenced(svn_wc__db_wcroot_t *wcroot,
                              sha1_checksum, scratch_pool, scratch_pool));
 
   /* Ensure the SQL txn has at least a 'RESERVED' lock before we start looking
-   * at the disk, to ensure no concurrent pristine install/delete txn. */
-  SVN_SQLITE__WITH_IMMEDIATE_TXN(
-    pristine_remove_if_unreferenced_txn(
-      wcroot->sdb, wcroot, sha1_checksum, pristine_abspath, scratch_pool),
-    wcroot->sdb);
+   * at the disk, to ensure no concurrent pristine install/delete txn.  A
+   * batch already holds that lock, but must commit the removal right away
+   * as the file is already gone. */
+  if (wcroot->batch_level > 0)
+    {
+      SVN_SQLITE__WITH_LOCK(
+        pristine_remove_if_unreferenced_txn(
+          wcroot->sdb, wcroot, sha1_checksum, pristine_abspath, scratch_pool),
+        wcroot->sdb);
+      SVN_ERR(svn_wc__db_wcroot_flush_batch(wcroot));
+    }
+  else
+    SVN_SQLITE__WITH_IMMEDIATE_TXN(
+      pristine_remove_if_unreferenced_txn(
+        wcroot->sdb, wcroot, sha1_checksum, pristine_abspath, scratch_pool),
+      wcroot->sdb);
 
   return SVN_NO_ERROR;
 }
@@ -863,6 +1058,83 @@ pristine_cleanup_wcroot(svn_wc__db_wcroot_t *wcroot,
       svn_error_compose_create(err, svn_sqlite__reset(stmt)));
 }
 
+/* Remove all pristine texts from the shared pristine store in
+ * STORE_ABSPATH that no working copy links to anymore.
+ *
+ * The link count of each file is its reference count.  If a working copy
+ * links to a file right after we found it unreferenced, it just keeps its
+ * own link; other working copies will add the text to the store again.
+ */
+static svn_error_t *
+shared_store_cleanup(const char *store_abspath,
+                     apr_pool_t *scratch_pool)
+{
+  apr_hash_t *subdirs;
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool;
+  svn_error_t *err;
+
+  err = svn_io_get_dirents3(&subdirs, store_abspath, TRUE,
+                            scratch_pool, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (hi = apr_hash_first(scratch_pool, subdirs); hi; hi = apr_hash_next(hi))
+    {
+      const char *subdir_abspath;
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+      apr_hash_t *files;
+      apr_hash_index_t *hi2;
+
+      if (dirent->kind != svn_node_dir)
+        continue;
+
+      svn_pool_clear(iterpool);
+
+      subdir_abspath = svn_dirent_join(store_abspath, apr_hash_this_key(hi),
+                                       iterpool);
+      SVN_ERR(svn_io_get_dirents3(&files, subdir_abspath, TRUE,
+                                  iterpool, iterpool));
+
+      for (hi2 = apr_hash_first(iterpool, files); hi2;
+           hi2 = apr_hash_next(hi2))
+        {
+          const char *name = apr_hash_this_key(hi2);
+          apr_size_t len = strlen(name);
+          const char *file_abspath;
+          apr_finfo_t finfo;
+
+          /* Skip anything but pristine texts, e.g. temporary files. */
+          dirent = apr_hash_this_val(hi2);
+          if (dirent->kind != svn_node_file
+              || len <= sizeof(PRISTINE_STORAGE_EXT) - 1
+              || strcmp(name + len - (sizeof(PRISTINE_STORAGE_EXT) - 1),
+                        PRISTINE_STORAGE_EXT))
+            continue;
+
+          file_abspath = svn_dirent_join(subdir_abspath, name, iterpool);
+          err = svn_io_stat(&finfo, file_abspath, APR_FINFO_NLINK, iterpool);
+          if (err)
+            {
+              /* Probably removed by a concurrent cleanup. */
+              svn_error_clear(err);
+              continue;
+            }
+
+          if ((finfo.valid & APR_FINFO_NLINK) && finfo.nlink == 1)
+            SVN_ERR(svn_io_remove_file2(file_abspath, TRUE, iterpool));
+        }
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_wc__db_pristine_cleanup(svn_wc__db_t *db,
                             const char *wri_abspath,
@@ -879,6 +1151,9 @@ svn_wc__db_pristine_cleanup(svn_wc__db_t *db,
 
   SVN_ERR(pristine_cleanup_wcroot(wcroot, scratch_pool));
 
+  if (db->shared_pristine_abspath)
+    SVN_ERR(shared_store_cleanup(db->shared_pristine_abspath, scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
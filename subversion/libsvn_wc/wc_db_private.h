@@ -33,6 +33,10 @@
 #include "wc_db.h"
 
 
+/* Default and upper limit for svn_wc__db_t.worker_threads. */
+#define SVN_WC__DEFAULT_WORKER_THREADS 4
+#define SVN_WC__MAX_WORKER_THREADS 64
+
 struct svn_wc__db_t {
   /* We need the config whenever we run into a new WC directory, in order
      to figure out where we should look for the corresponding datastore. */
@@ -49,9 +53,20 @@ struct svn_wc__db_t {
   /* Should we open Sqlite databases EXCLUSIVE */
   svn_boolean_t exclusive;
 
+  /* Should batches switch EXCLUSIVE databases to write-ahead logging */
+  svn_boolean_t wal;
+
   /* Busy timeout in ms., 0 for the libsvn_subr default. */
   apr_int32_t timeout;
 
+  /* Number of threads our users may employ for I/O intensive work that
+     does not access the database. */
+  int worker_threads;
+
+  /* Directory of the pristine store shared between working copies, or
+     NULL if there is none. */
+  const char *shared_pristine_abspath;
+
   /* Map a given working copy directory to its relevant data.
      const char *local_abspath -> svn_wc__db_wcroot_t *wcroot  */
   apr_hash_t *dir_data;
@@ -107,6 +122,12 @@ typedef struct svn_wc__db_wcroot_t {
      const char *local_abspath -> svn_wc_adm_access_t *adm_access */
   apr_hash_t *access_cache;
 
+  /* The number of nested svn_wc__db_begin_batch() calls.  While this is
+     not 0, an outer immediate transaction on SDB collects all changes.
+     BATCH_WAL is set if that batch switched SDB to write-ahead logging. */
+  int batch_level;
+  svn_boolean_t batch_wal;
+
 } svn_wc__db_wcroot_t;
 
 
@@ -148,6 +169,11 @@ svn_wc__db_wcroot_parse_local_abspath(svn_wc__db_wcroot_t **wcroot,
                                       apr_pool_t *result_pool,
                                       apr_pool_t *scratch_pool);
 
+/* Commit the changes batched in WCROOT so far and continue batching.
+   Do nothing if WCROOT has no batch in progress. */
+svn_error_t *
+svn_wc__db_wcroot_flush_batch(svn_wc__db_wcroot_t *wcroot);
+
 /* Return an error if the work queue in SDB is non-empty. */
 svn_error_t *
 svn_wc__db_verify_no_work(svn_sqlite__db_t *sdb);
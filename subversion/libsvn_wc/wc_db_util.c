@@ -143,7 +143,26 @@ svn_wc__db_util_open_db(svn_sqlite__db_t **sdb,
                            0, NULL, timeout, result_pool, scratch_pool));
 
   if (exclusive)
-    SVN_ERR(svn_sqlite__exec_statements(*sdb, STMT_PRAGMA_LOCKING_MODE));
+    {
+      SVN_ERR(svn_sqlite__exec_statements(*sdb, STMT_PRAGMA_LOCKING_MODE));
+    }
+  else if (smode != svn_sqlite__mode_readonly)
+    {
+      /* The journal mode is stored in the database.  A batch that could
+         not switch back from write-ahead logging, e.g. due to a crash,
+         leaves it behind.  Since we don't use exclusive locking, that
+         would require shared memory from now on.  If another connection
+         still uses the database, it can't be switched; a later open will
+         take care of that. */
+      svn_error_t *err
+        = svn_sqlite__exec_statements(*sdb, STMT_PRAGMA_JOURNAL_MODE_DELETE);
+
+      if (err && (err->apr_err == SVN_ERR_SQLITE_BUSY
+                  || err->apr_err == SVN_ERR_SQLITE_READONLY))
+        svn_error_clear(err);
+      else
+        SVN_ERR(err);
+    }
 
   SVN_ERR(svn_sqlite__create_scalar_function(*sdb, "relpath_depth", 1,
                                              TRUE /* deterministic */,
@@ -185,15 +185,41 @@ verify_db_cb(void *baton,
 }
 #endif
 
+/* Commit the changes batched in WCROOT and stop batching, regardless of
+   the number of nested svn_wc__db_begin_batch() calls. */
+static svn_error_t *
+end_batch(svn_wc__db_wcroot_t *wcroot)
+{
+  if (wcroot->batch_level > 0)
+    {
+      wcroot->batch_level = 0;
+      SVN_ERR(svn_sqlite__finish_transaction(wcroot->sdb, SVN_NO_ERROR));
+    }
+
+  /* The journal mode can only be changed outside of transactions. */
+  if (wcroot->batch_wal)
+    {
+      wcroot->batch_wal = FALSE;
+      SVN_ERR(svn_sqlite__exec_statements(wcroot->sdb,
+                                          STMT_PRAGMA_JOURNAL_MODE_DELETE));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* */
 static apr_status_t
 close_wcroot(void *data)
 {
   svn_wc__db_wcroot_t *wcroot = data;
-  svn_error_t *err;
+  svn_error_t *err = SVN_NO_ERROR;
 
   SVN_ERR_ASSERT_NO_RETURN(wcroot->sdb != NULL);
 
+  /* Closing the database would roll back what has not been committed. */
+  if (wcroot->batch_level > 0 || wcroot->batch_wal)
+    err = end_batch(wcroot);
+
 #if defined(VERIFY_ON_CLOSE) && defined(SVN_DEBUG)
   if (getenv("SVN_CMDLINE_VERIFY_SQL_AT_CLOSE"))
     {
@@ -206,7 +232,7 @@ close_wcroot(void *data)
     }
 #endif
 
-  err = svn_sqlite__close(wcroot->sdb);
+  err = svn_error_compose_create(err, svn_sqlite__close(wcroot->sdb));
   wcroot->sdb = NULL;
   if (err)
     {
@@ -232,6 +258,7 @@ svn_wc__db_open(svn_wc__db_t **db,
   (*db)->verify_format = !open_without_upgrade;
   (*db)->enforce_empty_wq = enforce_empty_wq;
   (*db)->dir_data = apr_hash_make(result_pool);
+  (*db)->worker_threads = SVN_WC__DEFAULT_WORKER_THREADS;
 
   (*db)->state_pool = result_pool;
 
@@ -241,6 +268,8 @@ svn_wc__db_open(svn_wc__db_t **db,
       svn_error_t *err;
       svn_boolean_t sqlite_exclusive = FALSE;
       apr_int64_t timeout;
+      apr_int64_t worker_threads;
+      const char *shared_pristine_path;
 
       err = svn_config_get_bool(config, &sqlite_exclusive,
                                 SVN_CONFIG_SECTION_WORKING_COPY,
@@ -253,6 +282,16 @@ svn_wc__db_open(svn_wc__db_t **db,
       else
         (*db)->exclusive = sqlite_exclusive;
 
+      err = svn_config_get_bool(config, &(*db)->wal,
+                                SVN_CONFIG_SECTION_WORKING_COPY,
+                                SVN_CONFIG_OPTION_SQLITE_WAL,
+                                FALSE);
+      if (err)
+        {
+          svn_error_clear(err);
+          (*db)->wal = FALSE;
+        }
+
       err = svn_config_get_int64(config, &timeout,
                                  SVN_CONFIG_SECTION_WORKING_COPY,
                                  SVN_CONFIG_OPTION_SQLITE_BUSY_TIMEOUT,
@@ -261,12 +300,150 @@ svn_wc__db_open(svn_wc__db_t **db,
         svn_error_clear(err);
       else
         (*db)->timeout = (apr_int32_t)timeout;
+
+      err = svn_config_get_int64(config, &worker_threads,
+                                 SVN_CONFIG_SECTION_WORKING_COPY,
+                                 SVN_CONFIG_OPTION_WC_WORKER_THREADS,
+                                 SVN_WC__DEFAULT_WORKER_THREADS);
+      if (err || worker_threads < 1
+          || worker_threads > SVN_WC__MAX_WORKER_THREADS)
+        svn_error_clear(err);
+      else
+        (*db)->worker_threads = (int)worker_threads;
+
+      svn_config_get(config, &shared_pristine_path,
+                     SVN_CONFIG_SECTION_WORKING_COPY,
+                     SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE, NULL);
+      if (shared_pristine_path && *shared_pristine_path)
+        {
+          err = svn_dirent_get_absolute(&(*db)->shared_pristine_abspath,
+                                        svn_dirent_internal_style(
+                                          shared_pristine_path,
+                                          scratch_pool),
+                                        result_pool);
+          if (err)
+            {
+              svn_error_clear(err);
+              (*db)->shared_pristine_abspath = NULL;
+            }
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+int
+svn_wc__db_get_worker_threads(svn_wc__db_t *db)
+{
+  return db->worker_threads;
+}
+
+
+svn_error_t *
+svn_wc__db_begin_batch(svn_wc__db_t *db,
+                       const char *wri_abspath,
+                       apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  if (wcroot->batch_level > 0)
+    {
+      wcroot->batch_level++;
+      return SVN_NO_ERROR;
+    }
+
+  /* Without exclusive locking, the write-ahead log would need shared
+     memory, which isn't available on network file systems.  The journal
+     mode can only be changed outside of transactions. */
+  if (db->wal && db->exclusive)
+    {
+      SVN_ERR(svn_sqlite__exec_statements(wcroot->sdb,
+                                          STMT_PRAGMA_JOURNAL_MODE_WAL));
+      wcroot->batch_wal = TRUE;
+    }
+
+  /* Take out the 'RESERVED' lock right away, like the pristine store
+     expects from the transactions it runs in. */
+  SVN_ERR(svn_sqlite__begin_immediate_transaction(wcroot->sdb));
+  wcroot->batch_level = 1;
+
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_wc__db_wcroot_flush_batch(svn_wc__db_wcroot_t *wcroot)
+{
+  svn_error_t *err;
+
+  if (wcroot->batch_level == 0)
+    return SVN_NO_ERROR;
+
+  err = svn_sqlite__finish_transaction(wcroot->sdb, SVN_NO_ERROR);
+  if (!err)
+    err = svn_sqlite__begin_immediate_transaction(wcroot->sdb);
+
+  if (err)
+    {
+      /* There is no transaction left to finish. */
+      wcroot->batch_level = 0;
+      return svn_error_compose_create(err, end_batch(wcroot));
     }
 
   return SVN_NO_ERROR;
 }
 
 
+svn_error_t *
+svn_wc__db_flush_batch(svn_wc__db_t *db,
+                       const char *wri_abspath,
+                       apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  return svn_error_trace(svn_wc__db_wcroot_flush_batch(wcroot));
+}
+
+
+svn_error_t *
+svn_wc__db_end_batch(svn_wc__db_t *db,
+                     const char *wri_abspath,
+                     apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  if (wcroot->batch_level > 1)
+    {
+      wcroot->batch_level--;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(end_batch(wcroot));
+}
+
+
 svn_error_t *
 svn_wc__db_close(svn_wc__db_t *db)
 {
@@ -377,6 +554,8 @@ svn_wc__db_pdh_create_wcroot(svn_wc__db_wcroot_t **wcroot,
   (*wcroot)->owned_locks = apr_array_make(result_pool, 8,
                                           sizeof(svn_wc__db_wclock_t));
   (*wcroot)->access_cache = apr_hash_make(result_pool);
+  (*wcroot)->batch_level = 0;
+  (*wcroot)->batch_wal = FALSE;
 
   /* SDB will be NULL for pre-NG working copies. We only need to run a
      cleanup when the SDB is present.  */
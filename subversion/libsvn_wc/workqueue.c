@@ -30,6 +30,7 @@
 #include "svn_subst.h"
 #include "svn_hash.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -39,7 +40,9 @@
 #include "translate.h"
 
 #include "private/svn_io_private.h"
+#include "private/svn_mutex.h"
 #include "private/svn_skel.h"
+#include "private/svn_task.h"
 
 
 /* Workqueue operation names.  */
@@ -61,6 +64,10 @@
 #define OP_TMP_SET_TEXT_CONFLICT_MARKERS "tmp-set-text-conflict-markers"
 #define OP_TMP_SET_PROPERTY_CONFLICT_MARKER "tmp-set-property-conflict-marker"
 
+/* The maximum number of work items to fetch at once.  Completing these
+   is recorded in a single transaction.  */
+#define MAX_BATCH_SIZE 256
+
 /* For work queue debugging. Generates output about its operation.  */
 /* #define SVN_DEBUG_WORK_QUEUE */
 
@@ -77,13 +84,18 @@ struct work_item_dispatch {
                        apr_pool_t *scratch_pool);
 };
 
-/* Forward definition */
+/* Forward definitions */
 static svn_error_t *
 get_and_record_fileinfo(work_item_baton_t *wqb,
                         const char *local_abspath,
                         svn_boolean_t ignore_enoent,
                         apr_pool_t *scratch_pool);
 
+static void
+record_fileinfo(work_item_baton_t *wqb,
+                const char *local_abspath,
+                const svn_io_dirent2_t *dirent);
+
 /* ------------------------------------------------------------------------ */
 /* OP_REMOVE_BASE  */
 
@@ -445,60 +457,83 @@ svn_wc__wq_build_postupgrade(svn_skel_t **work_item,
 
 /* OP_FILE_INSTALL */
 
-/* Process the OP_FILE_INSTALL work item WORK_ITEM.
- * See svn_wc__wq_build_file_install() which generates this work item.
- * Implements (struct work_item_dispatch).func. */
-static svn_error_t *
-run_file_install(work_item_baton_t *wqb,
-                 svn_wc__db_t *db,
-                 const svn_skel_t *work_item,
-                 const char *wri_abspath,
-                 svn_cancel_func_t cancel_func,
-                 void *cancel_baton,
-                 apr_pool_t *scratch_pool)
+/* Everything needed to install a working file from its source.
+   prepare_file_install() gathers it from the wc.db, so that
+   install_file() does not need to access the wc.db at all. */
+typedef struct file_install_t
 {
-  const svn_skel_t *arg1 = work_item->children->next;
-  const svn_skel_t *arg4 = arg1->next->next->next;
-  const char *local_relpath;
   const char *local_abspath;
-  svn_boolean_t use_commit_times;
-  svn_boolean_t record_fileinfo;
-  svn_boolean_t special;
-  svn_stream_t *src_stream;
+  const char *source_abspath;
+
+  /* Translation from the source's normal form to the working file. */
   svn_subst_eol_style_t style;
   const char *eol;
   apr_hash_t *keywords;
+  svn_boolean_t special;
+
+  /* Where to create the working file before moving it into place. */
   const char *temp_dir_abspath;
-  svn_stream_t *dst_stream;
+
+  /* Tweaks of the installed working file.  AFFECTED_TIME is 0 to leave
+     its timestamp alone. */
+  svn_boolean_t executable;
+  svn_boolean_t read_only;
+  apr_time_t affected_time;
+
+  /* Whether to record the size and timestamp of the working file. */
+  svn_boolean_t record_fileinfo;
+
+  /* Polled while copying the contents when installing in a worker
+     thread.  May be NULL. */
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} file_install_t;
+
+/* Set *INSTALL to the parameters of the OP_FILE_INSTALL work item
+   WORK_ITEM, allocated in RESULT_POOL.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+prepare_file_install(file_install_t **install,
+                     svn_wc__db_t *db,
+                     const svn_skel_t *work_item,
+                     const char *wri_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  const svn_skel_t *arg1 = work_item->children->next;
+  const svn_skel_t *arg4 = arg1->next->next->next;
+  file_install_t *result = apr_pcalloc(result_pool, sizeof(*result));
+  const char *local_relpath;
+  svn_boolean_t use_commit_times;
   apr_int64_t val;
   const char *wcroot_abspath;
-  const char *source_abspath;
   const svn_checksum_t *checksum;
   apr_hash_t *props;
   apr_time_t changed_date;
 
   local_relpath = apr_pstrmemdup(scratch_pool, arg1->data, arg1->len);
-  SVN_ERR(svn_wc__db_from_relpath(&local_abspath, db, wri_abspath,
-                                  local_relpath, scratch_pool, scratch_pool));
+  SVN_ERR(svn_wc__db_from_relpath(&result->local_abspath, db, wri_abspath,
+                                  local_relpath, result_pool, scratch_pool));
 
   SVN_ERR(svn_skel__parse_int(&val, arg1->next, scratch_pool));
   use_commit_times = (val != 0);
   SVN_ERR(svn_skel__parse_int(&val, arg1->next->next, scratch_pool));
-  record_fileinfo = (val != 0);
+  result->record_fileinfo = (val != 0);
 
   SVN_ERR(svn_wc__db_read_node_install_info(&wcroot_abspath,
                                             &checksum, &props,
                                             &changed_date,
-                                            db, local_abspath, wri_abspath,
+                                            db, result->local_abspath,
+                                            wri_abspath,
                                             scratch_pool, scratch_pool));
 
   if (arg4 != NULL)
     {
       /* Use the provided path for the source.  */
       local_relpath = apr_pstrmemdup(scratch_pool, arg4->data, arg4->len);
-      SVN_ERR(svn_wc__db_from_relpath(&source_abspath, db, wri_abspath,
-                                      local_relpath,
-                                      scratch_pool, scratch_pool));
+      SVN_ERR(svn_wc__db_from_relpath(&result->source_abspath, db,
+                                      wri_abspath, local_relpath,
+                                      result_pool, scratch_pool));
     }
   else if (! checksum)
     {
@@ -513,66 +548,121 @@ run_file_install(work_item_baton_t *wqb,
                                _("Can't install '%s' from pristine store, "
                                  "because no checksum is recorded for this "
                                  "file"),
-                               svn_dirent_local_style(local_abspath,
+                               svn_dirent_local_style(result->local_abspath,
                                                       scratch_pool));
     }
   else
     {
-      SVN_ERR(svn_wc__db_pristine_get_future_path(&source_abspath,
+      SVN_ERR(svn_wc__db_pristine_get_future_path(&result->source_abspath,
                                                   wcroot_abspath,
                                                   checksum,
-                                                  scratch_pool, scratch_pool));
+                                                  result_pool, scratch_pool));
     }
 
-  SVN_ERR(svn_stream_open_readonly(&src_stream, source_abspath,
-                                   scratch_pool, scratch_pool));
-
   /* Fetch all the translation bits.  */
-  SVN_ERR(svn_wc__get_translate_info(&style, &eol,
-                                     &keywords,
-                                     &special, db, local_abspath,
+  SVN_ERR(svn_wc__get_translate_info(&result->style, &result->eol,
+                                     &result->keywords,
+                                     &result->special,
+                                     db, result->local_abspath,
                                      props, FALSE,
-                                     scratch_pool, scratch_pool));
-  if (special)
+                                     result_pool, scratch_pool));
+
+  /* No need to set exec or read-only flags on special files.  */
+  if (result->special)
+    {
+      /* ### Shouldn't this record a timestamp and size, etc.? */
+      result->record_fileinfo = FALSE;
+      *install = result;
+      return SVN_NO_ERROR;
+    }
+
+  /* Where is the Right Place to put a temp file in this working copy?  */
+  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&result->temp_dir_abspath,
+                                         db, wcroot_abspath,
+                                         result_pool, scratch_pool));
+
+#ifndef WIN32
+  result->executable = (props && svn_hash_gets(props, SVN_PROP_EXECUTABLE));
+#endif
+
+  /* Note that this explicitly checks the pristine properties, to make sure
+     that when the lock is locally set (=modification) it is not read only */
+  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
+    {
+      svn_wc__db_status_t status;
+      svn_wc__db_lock_t *lock;
+      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL,
+                                   db, result->local_abspath,
+                                   scratch_pool, scratch_pool));
+
+      result->read_only = (!lock && status != svn_wc__db_status_added);
+    }
+
+  if (use_commit_times)
+    result->affected_time = changed_date;
+
+  *install = result;
+  return SVN_NO_ERROR;
+}
+
+/* Install the working file described by INSTALL.  If INSTALL->RECORD_FILEINFO
+   is set, return the size and timestamp of the new working file in *DIRENT,
+   allocated in RESULT_POOL; otherwise set it to NULL.  Use SCRATCH_POOL for
+   temporary allocations.
+
+   This does not access the wc.db, so it may run in a different thread. */
+static svn_error_t *
+install_file(const svn_io_dirent2_t **dirent,
+             const file_install_t *install,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  svn_stream_t *src_stream;
+  svn_stream_t *dst_stream;
+
+  *dirent = NULL;
+
+  SVN_ERR(svn_stream_open_readonly(&src_stream, install->source_abspath,
+                                   scratch_pool, scratch_pool));
+
+  if (install->special)
     {
       /* When this stream is closed, the resulting special file will
          atomically be created/moved into place at LOCAL_ABSPATH.  */
-      SVN_ERR(svn_subst_create_specialfile(&dst_stream, local_abspath,
+      SVN_ERR(svn_subst_create_specialfile(&dst_stream,
+                                           install->local_abspath,
                                            scratch_pool, scratch_pool));
 
       /* Copy the "repository normal" form of the special file into the
          special stream.  */
-      SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
-                               cancel_func, cancel_baton,
-                               scratch_pool));
-
-      /* No need to set exec or read-only flags on special files.  */
-
-      /* ### Shouldn't this record a timestamp and size, etc.? */
-      return SVN_NO_ERROR;
+      return svn_error_trace(svn_stream_copy3(src_stream, dst_stream,
+                                              cancel_func, cancel_baton,
+                                              scratch_pool));
     }
 
-  if (svn_subst_translation_required(style, eol, keywords,
+  if (svn_subst_translation_required(install->style, install->eol,
+                                     install->keywords,
                                      FALSE /* special */,
                                      TRUE /* force_eol_check */))
     {
       /* Wrap it in a translating (expanding) stream.  */
-      src_stream = svn_subst_stream_translated(src_stream, eol,
+      src_stream = svn_subst_stream_translated(src_stream, install->eol,
                                                TRUE /* repair */,
-                                               keywords,
+                                               install->keywords,
                                                TRUE /* expand */,
                                                scratch_pool);
     }
 
-  /* Where is the Right Place to put a temp file in this working copy?  */
-  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&temp_dir_abspath,
-                                         db, wcroot_abspath,
-                                         scratch_pool, scratch_pool));
-
   /* Translate to a temporary file. We don't want the user seeing a partial
      file, nor let them muck with it while we translate. We may also need to
      get its TRANSLATED_SIZE before the user can monkey it.  */
-  SVN_ERR(svn_stream__create_for_install(&dst_stream, temp_dir_abspath,
+  SVN_ERR(svn_stream__create_for_install(&dst_stream,
+                                         install->temp_dir_abspath,
                                          scratch_pool, scratch_pool));
 
   /* Copy from the source to the dest, translating as we go. This will also
@@ -585,48 +675,53 @@ run_file_install(work_item_baton_t *wqb,
   /* With a single db we might want to install files in a missing directory.
      Simply trying this scenario on error won't do any harm and at least
      one user reported this problem on IRC. */
-  SVN_ERR(svn_stream__install_stream(dst_stream, local_abspath,
+  SVN_ERR(svn_stream__install_stream(dst_stream, install->local_abspath,
                                      TRUE /* make_parents*/, scratch_pool));
 
   /* Tweak the on-disk file according to its properties.  */
-#ifndef WIN32
-  if (props && svn_hash_gets(props, SVN_PROP_EXECUTABLE))
-    SVN_ERR(svn_io_set_file_executable(local_abspath, TRUE, FALSE,
+  if (install->executable)
+    SVN_ERR(svn_io_set_file_executable(install->local_abspath, TRUE, FALSE,
                                        scratch_pool));
-#endif
 
-  /* Note that this explicitly checks the pristine properties, to make sure
-     that when the lock is locally set (=modification) it is not read only */
-  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
-    {
-      svn_wc__db_status_t status;
-      svn_wc__db_lock_t *lock;
-      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL,
-                                   db, local_abspath,
-                                   scratch_pool, scratch_pool));
-
-      if (!lock && status != svn_wc__db_status_added)
-        SVN_ERR(svn_io_set_file_read_only(local_abspath, FALSE, scratch_pool));
-    }
+  if (install->read_only)
+    SVN_ERR(svn_io_set_file_read_only(install->local_abspath, FALSE,
+                                      scratch_pool));
 
-  if (use_commit_times)
-    {
-      if (changed_date)
-        SVN_ERR(svn_io_set_file_affected_time(changed_date,
-                                              local_abspath,
-                                              scratch_pool));
-    }
+  if (install->affected_time)
+    SVN_ERR(svn_io_set_file_affected_time(install->affected_time,
+                                          install->local_abspath,
+                                          scratch_pool));
 
   /* ### this should happen before we rename the file into place.  */
-  if (record_fileinfo)
-    {
-      SVN_ERR(get_and_record_fileinfo(wqb, local_abspath,
-                                      FALSE /* ignore_enoent */,
-                                      scratch_pool));
-    }
+  if (install->record_fileinfo)
+    SVN_ERR(svn_io_stat_dirent2(dirent, install->local_abspath, FALSE, FALSE,
+                                result_pool, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Process the OP_FILE_INSTALL work item WORK_ITEM.
+ * See svn_wc__wq_build_file_install() which generates this work item.
+ * Implements (struct work_item_dispatch).func. */
+static svn_error_t *
+run_file_install(work_item_baton_t *wqb,
+                 svn_wc__db_t *db,
+                 const svn_skel_t *work_item,
+                 const char *wri_abspath,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  file_install_t *install;
+  const svn_io_dirent2_t *dirent;
+
+  SVN_ERR(prepare_file_install(&install, db, work_item, wri_abspath,
+                               scratch_pool, scratch_pool));
+  SVN_ERR(install_file(&dirent, install, cancel_func, cancel_baton,
+                       scratch_pool, scratch_pool));
+
+  if (dirent)
+    record_fileinfo(wqb, install->local_abspath, dirent);
 
   return SVN_NO_ERROR;
 }
@@ -1412,8 +1507,6 @@ struct work_item_baton_t
 {
   apr_pool_t *result_pool; /* Pool to allocate result in */
 
-  svn_boolean_t used; /* needs reset */
-
   apr_hash_t *record_map; /* const char * -> svn_io_dirent2_t map */
 };
 
@@ -1474,6 +1567,238 @@ dispatch_work_item(work_item_baton_t *wqb,
 }
 
 
+/* Return the number of work items at the start of WORK_ITEMS that install
+   different working files from the pristine store.  These don't depend on
+   each other, so they may run concurrently.  Use SCRATCH_POOL for
+   temporary allocations. */
+static int
+count_file_installs(const apr_array_header_t *work_items,
+                    apr_pool_t *scratch_pool)
+{
+  apr_hash_t *relpaths = apr_hash_make(scratch_pool);
+  int i;
+
+  for (i = 0; i < work_items->nelts; i++)
+    {
+      const svn_skel_t *work_item = APR_ARRAY_IDX(work_items, i,
+                                                  const svn_skel_t *);
+      const svn_skel_t *arg1;
+
+      if (!svn_skel__matches_atom(work_item->children, OP_FILE_INSTALL))
+        break;
+
+      /* Other sources may be the result of earlier work items. */
+      arg1 = work_item->children->next;
+      if (arg1->next->next->next != NULL)
+        break;
+
+      if (apr_hash_get(relpaths, arg1->data, arg1->len))
+        break;
+
+      apr_hash_set(relpaths, arg1->data, arg1->len, arg1);
+    }
+
+  return i;
+}
+
+/* The result of installing a file_install_t in a worker thread. */
+typedef struct install_result_t
+{
+  const char *local_abspath;
+  const svn_io_dirent2_t *dirent;
+  svn_error_t *err;
+} install_result_t;
+
+/* Baton for serialized_cancel_func(). */
+typedef struct serialized_cancel_baton_t
+{
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+  svn_mutex__t *mutex;
+} serialized_cancel_baton_t;
+
+/* Implements svn_cancel_func_t.  Call the cancellation function in the
+   serialized_cancel_baton_t given as BATON such that callers don't have
+   to expect concurrent calls from our worker threads. */
+static svn_error_t *
+serialized_cancel_func(void *baton)
+{
+  serialized_cancel_baton_t *b = baton;
+  SVN_MUTEX__WITH_LOCK(b->mutex, b->cancel_func(b->cancel_baton));
+
+  return SVN_NO_ERROR;
+}
+
+/* The output baton of run_file_installs(). */
+typedef struct install_batch_t
+{
+  work_item_baton_t *wqb;
+
+  /* The number of installations that completed before the first failure
+     and the error of that failure. */
+  int completed;
+  svn_error_t *err;
+} install_batch_t;
+
+/* Implements svn_task__process_func_t for file_install_t batons. */
+static svn_error_t *
+install_process(void **result,
+                void *baton,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  const file_install_t *install = baton;
+  install_result_t *install_result = apr_pcalloc(result_pool,
+                                                 sizeof(*install_result));
+
+  /* Don't fail the queue but let install_output() handle this, such that
+     the installations before this one still count as completed. */
+  install_result->local_abspath = install->local_abspath;
+  install_result->err = install_file(&install_result->dirent, install,
+                                     install->cancel_func,
+                                     install->cancel_baton,
+                                     result_pool, scratch_pool);
+
+  *result = install_result;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t for install_result_t results and
+   install_batch_t output batons. */
+static svn_error_t *
+install_output(void *result,
+               void *output_baton,
+               apr_pool_t *scratch_pool)
+{
+  install_result_t *install_result = result;
+  install_batch_t *batch = output_baton;
+
+  /* Anything after a failure will be run again later. */
+  if (batch->err)
+    {
+      svn_error_clear(install_result->err);
+    }
+  else if (install_result->err
+           && svn_error_find_cause(install_result->err, SVN_ERR_CANCELLED))
+    {
+      /* Not a failure of this work item. */
+      return svn_error_trace(install_result->err);
+    }
+  else if (install_result->err)
+    {
+      batch->err = install_result->err;
+    }
+  else
+    {
+      if (install_result->dirent)
+        record_fileinfo(batch->wqb, install_result->local_abspath,
+                        install_result->dirent);
+
+      batch->completed++;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Run the first COUNT of WORK_ITEMS, as determined by count_file_installs(),
+   using up to THREADS concurrent threads.  Accessing DB remains limited to
+   the calling thread.
+
+   Set *COMPLETED to the number of work items that succeeded before the
+   first one that failed, and *ITEM_ERR to the error of that one or to
+   SVN_NO_ERROR.  Return any other error, e.g. a cancellation, directly.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_file_installs(int *completed,
+                  svn_error_t **item_err,
+                  work_item_baton_t *wqb,
+                  svn_wc__db_t *db,
+                  const char *wri_abspath,
+                  const apr_array_header_t *work_items,
+                  int count,
+                  int threads,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  install_batch_t batch = { 0 };
+  serialized_cancel_baton_t cancel;
+  svn_task__queue_t *queue;
+  svn_error_t *prepare_err = SVN_NO_ERROR;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  batch.wqb = wqb;
+
+  /* The installations poll for cancellation from the worker threads. */
+  if (cancel_func)
+    {
+      cancel.cancel_func = cancel_func;
+      cancel.cancel_baton = cancel_baton;
+      SVN_ERR(svn_mutex__init(&cancel.mutex, TRUE, scratch_pool));
+
+      cancel_func = serialized_cancel_func;
+      cancel_baton = &cancel;
+    }
+
+  SVN_ERR(svn_task__queue_create(&queue, threads, 2 * threads,
+                                 install_process, install_output, &batch,
+                                 scratch_pool));
+
+  for (i = 0; i < count && !batch.err; i++)
+    {
+      const svn_skel_t *work_item = APR_ARRAY_IDX(work_items, i,
+                                                  const svn_skel_t *);
+      file_install_t *install;
+      apr_pool_t *task_pool;
+
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        {
+          err = cancel_func(cancel_baton);
+          if (err)
+            break;
+        }
+
+      task_pool = svn_task__queue_task_pool(queue);
+      prepare_err = prepare_file_install(&install, db, work_item,
+                                         wri_abspath, task_pool, iterpool);
+      if (prepare_err)
+        {
+          svn_pool_destroy(task_pool);
+          break;
+        }
+
+      install->cancel_func = cancel_func;
+      install->cancel_baton = cancel_baton;
+      err = svn_task__queue_add(queue, install, task_pool);
+      if (err)
+        break;
+    }
+  svn_pool_destroy(iterpool);
+
+  /* Wait for the installations in flight to learn which ones completed. */
+  if (!err)
+    err = svn_task__queue_finish(queue);
+
+  /* Failures are reported in the order of the work items. */
+  *completed = batch.completed;
+  if (batch.err)
+    {
+      svn_error_clear(prepare_err);
+      *item_err = batch.err;
+    }
+  else
+    {
+      *item_err = prepare_err;
+    }
+
+  return svn_error_trace(err);
+}
+
+
 svn_error_t *
 svn_wc__wq_run(svn_wc__db_t *db,
                const char *wri_abspath,
@@ -1482,10 +1807,17 @@ svn_wc__wq_run(svn_wc__db_t *db,
                apr_pool_t *scratch_pool)
 {
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
-  apr_uint64_t last_id = 0;
+  apr_array_header_t *completed_ids = apr_array_make(scratch_pool,
+                                                     MAX_BATCH_SIZE,
+                                                     sizeof(apr_uint64_t));
+  int threads = svn_wc__db_get_worker_threads(db);
+  int fetch_size = MAX_BATCH_SIZE;
   work_item_baton_t wib = { 0 };
   wib.result_pool = svn_pool_create(scratch_pool);
 
+  /* Don't run work items whose queueing might still be rolled back. */
+  SVN_ERR(svn_wc__db_flush_batch(db, wri_abspath, iterpool));
+
 #ifdef SVN_DEBUG_WORK_QUEUE
   SVN_DBG(("wq_run: wri='%s'\n", wri_abspath));
   {
@@ -1502,64 +1834,112 @@ svn_wc__wq_run(svn_wc__db_t *db,
 
   while (TRUE)
     {
-      apr_uint64_t id;
-      svn_skel_t *work_item;
+      apr_array_header_t *ids;
+      apr_array_header_t *work_items;
+      const svn_skel_t *next_item;
+      svn_error_t *item_err;
       svn_error_t *err;
+      int count;
+      int i;
 
       svn_pool_clear(iterpool);
 
-      if (! wib.used)
-        {
-          /* Make sure to do this *early* in the loop iteration. There may
-             be a LAST_ID that needs to be marked as completed, *before* we
-             start worrying about anything else.  */
-          SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db, wri_abspath,
-                                           last_id, iterpool, iterpool));
-        }
-      else
-        {
-          /* Make sure to do this *early* in the loop iteration. There may
-             be a LAST_ID that needs to be marked as completed, *before* we
-             start worrying about anything else.  */
-          SVN_ERR(svn_wc__db_wq_record_and_fetch_next(&id, &work_item,
-                                                      db, wri_abspath,
-                                                      last_id, wib.record_map,
-                                                      iterpool,
-                                                      wib.result_pool));
-
-          svn_pool_clear(wib.result_pool);
-          wib.record_map = NULL;
-          wib.used = FALSE;
-        }
+      /* Make sure to do this *early* in the loop iteration. There may
+         be COMPLETED_IDS that need to be marked as completed, *before* we
+         start worrying about anything else.  */
+      SVN_ERR(svn_wc__db_wq_record_and_fetch_batch(&ids, &work_items,
+                                                   db, wri_abspath,
+                                                   completed_ids,
+                                                   wib.record_map,
+                                                   fetch_size,
+                                                   iterpool,
+                                                   wib.result_pool));
+
+      apr_array_clear(completed_ids);
+      svn_pool_clear(wib.result_pool);
+      wib.record_map = NULL;
 
       /* Stop work queue processing, if requested. A future 'svn cleanup'
          should be able to continue the processing. Note that we may
-         have WORK_ITEM, but we'll just skip its processing for now.  */
+         have WORK_ITEMS, but we'll just skip their processing for now.  */
       if (cancel_func)
         SVN_ERR(cancel_func(cancel_baton));
 
-      /* If we have a WORK_ITEM, then process the sucker. Otherwise,
+      /* If we have WORK_ITEMS, then process the suckers. Otherwise,
          we're done.  */
-      if (work_item == NULL)
+      if (work_items->nelts == 0)
         break;
 
-      err = dispatch_work_item(&wib, db, wri_abspath, work_item,
-                               cancel_func, cancel_baton, iterpool);
-      if (err)
+      /* Consecutive file installations are independent of each other, so
+         run them concurrently and mark them completed all at once.
+         Anything else runs on its own, just like before.  */
+      count = count_file_installs(work_items, iterpool);
+      if (count > 1)
+        {
+          err = run_file_installs(&count, &item_err, &wib, db, wri_abspath,
+                                  work_items, count, threads,
+                                  cancel_func, cancel_baton, iterpool);
+        }
+      else
+        {
+          err = SVN_NO_ERROR;
+          item_err = dispatch_work_item(&wib, db, wri_abspath,
+                                        APR_ARRAY_IDX(work_items, 0,
+                                                      svn_skel_t *),
+                                        cancel_func, cancel_baton, iterpool);
+          count = item_err ? 0 : 1;
+        }
+
+      /* Only file installations run in batches.  Don't fetch and parse
+         more than the next item if that is something else, e.g. during
+         long runs of removals.  If we don't know the next item yet,
+         assume that it is like the last one.  */
+      next_item = APR_ARRAY_IDX(work_items,
+                                MIN(count, work_items->nelts - 1),
+                                const svn_skel_t *);
+      if (svn_skel__matches_atom(next_item->children, OP_FILE_INSTALL))
+        fetch_size = MAX_BATCH_SIZE;
+      else
+        fetch_size = 1;
+
+      /* The work items finished without error. Mark them completed
+         in the next loop.  */
+      for (i = 0; i < count; i++)
+        APR_ARRAY_PUSH(completed_ids, apr_uint64_t)
+          = APR_ARRAY_IDX(ids, i, apr_uint64_t);
+
+      if (item_err)
         {
+          const svn_skel_t *work_item = APR_ARRAY_IDX(work_items, count,
+                                                      svn_skel_t *);
           const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
 
-          return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
-                                   _("Failed to run the WC DB work queue "
-                                     "associated with '%s', work item %d %s"),
-                                   svn_dirent_local_style(wri_abspath,
-                                                          scratch_pool),
-                                   (int)id, skel);
+          err = svn_error_compose_create(
+                  svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, item_err,
+                                    _("Failed to run the WC DB work queue "
+                                      "associated with '%s', work item %d %s"),
+                                    svn_dirent_local_style(wri_abspath,
+                                                           scratch_pool),
+                                    (int)APR_ARRAY_IDX(ids, count,
+                                                       apr_uint64_t),
+                                    skel),
+                  err);
         }
 
-      /* The work item finished without error. Mark it completed
-         in the next loop.  */
-      last_id = id;
+      if (err)
+        {
+          /* Don't run the work items that did complete again.  */
+          if (completed_ids->nelts > 0)
+            err = svn_error_compose_create(
+                    err,
+                    svn_wc__db_wq_record_and_fetch_batch(&ids, &work_items,
+                                                         db, wri_abspath,
+                                                         completed_ids,
+                                                         wib.record_map, 0,
+                                                         iterpool,
+                                                         iterpool));
+          return svn_error_trace(err);
+        }
     }
 
   svn_pool_destroy(iterpool);
@@ -1624,18 +2004,26 @@ get_and_record_fileinfo(work_item_baton_t *wqb,
   const svn_io_dirent2_t *dirent;
 
   SVN_ERR(svn_io_stat_dirent2(&dirent, local_abspath, FALSE, ignore_enoent,
-                              wqb->result_pool, scratch_pool));
+                              scratch_pool, scratch_pool));
 
-  if (dirent->kind != svn_node_file)
-    return SVN_NO_ERROR;
+  record_fileinfo(wqb, local_abspath, dirent);
+
+  return SVN_NO_ERROR;
+}
 
-  wqb->used = TRUE;
+/* Remember to record the size and timestamp from DIRENT for the file
+   LOCAL_ABSPATH along with the completion of the current work item. */
+static void
+record_fileinfo(work_item_baton_t *wqb,
+                const char *local_abspath,
+                const svn_io_dirent2_t *dirent)
+{
+  if (dirent->kind != svn_node_file)
+    return;
 
   if (! wqb->record_map)
     wqb->record_map = apr_hash_make(wqb->result_pool);
 
   svn_hash_sets(wqb->record_map, apr_pstrdup(wqb->result_pool, local_abspath),
-                dirent);
-
-  return SVN_NO_ERROR;
+                svn_io_dirent2_dup(dirent, wqb->result_pool));
 }
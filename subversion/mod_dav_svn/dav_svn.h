@@ -344,6 +344,10 @@ dav_svn__get_nodeprop_cache_flag(request_rec *r);
  * request? */
 svn_boolean_t dav_svn__get_block_read_flag(request_rec *r);
 
+/* for the repository referred to by this request, how many threads may
+ * FSFS use to deltify a large file during a commit? */
+int dav_svn__get_delta_threads(request_rec *r);
+
 /* for the repository referred to by this request, are subrequests bypassed?
  * A function pointer if yes, NULL if not.
  */
@@ -26,6 +26,8 @@
 
 #include <apr_strings.h>
 #include <apr_hash.h>
+#include <apr_atomic.h>
+#include <apr_shm.h>
 
 #include <httpd.h>
 #include <http_config.h>
@@ -42,6 +44,7 @@
 #include "svn_dso.h"
 #include "mod_dav_svn.h"
 
+#include "private/svn_cache.h"
 #include "private/svn_fspath.h"
 #include "private/svn_subr_private.h"
 
@@ -107,6 +110,7 @@ typedef struct dir_conf_t {
   enum conf_flag revprop_cache;      /* whether to enable revprop caching */
   enum conf_flag nodeprop_cache;     /* whether to enable nodeprop caching */
   enum conf_flag block_read;         /* whether to enable block read mode */
+  int delta_threads;                 /* max. threads per commit delta; 0=unset */
   const char *hooks_env;             /* path to hook script env config file */
 } dir_conf_t;
 
@@ -120,6 +124,17 @@ extern module AP_MODULE_DECLARE_DATA dav_svn_module;
 /* The authz_svn provider for bypassing path authz. */
 static authz_svn__subreq_bypass_func_t pathauthz_bypass_func = NULL;
 
+/* Path of the membuffer cache snapshot file.  NULL if not configured. */
+static const char *cache_snapshot = NULL;
+
+/* Flag in anonymous shared memory, set by the first child process that
+ * saves the cache snapshot.  Created anew for every server generation.
+ * NULL if not available, in which case every child saves the snapshot. */
+static volatile apr_uint32_t *snapshot_saved = NULL;
+
+/* Name of the shared memory membuffer cache.  NULL if not configured. */
+static const char *cache_name = NULL;
+
 static int
 init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
 {
@@ -150,9 +165,87 @@ init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
   conf = ap_get_module_config(s->module_config, &dav_svn_module);
   svn_utf_initialize2(conf->use_utf8, p);
 
+  /* Read the cache snapshot only once, in the parent process.  All child
+   * processes inherit the warmed-up cache when they get forked. */
+  if (cache_snapshot)
+    {
+      apr_shm_t *shm;
+      apr_status_t status;
+
+      svn_cache__get_global_membuffer_cache();
+
+      status = apr_shm_create(&shm, sizeof(*snapshot_saved), NULL, p);
+      if (status)
+        {
+          ap_log_perror(APLOG_MARK, APLOG_WARNING, status, p,
+                        "mod_dav_svn: can't coordinate saving the cache "
+                        "snapshot; every process will save it");
+          snapshot_saved = NULL;
+        }
+      else
+        {
+          snapshot_saved = apr_shm_baseaddr_get(shm);
+          apr_atomic_set32(snapshot_saved, 0);
+        }
+    }
+
   return OK;
 }
 
+/* Pool cleanup function saving the membuffer cache contents to the
+ * configured snapshot file.  Only the first child process to shut down
+ * does so; the file gets replaced atomically.  DATA is unused. */
+static apr_status_t
+save_cache_snapshot(void *data)
+{
+  apr_pool_t *pool;
+  svn_error_t *serr;
+
+  if (snapshot_saved && apr_atomic_cas32(snapshot_saved, 1, 0) != 0)
+    return APR_SUCCESS;
+
+  pool = svn_pool_create(NULL);
+  serr = svn_cache__save_global_membuffer_cache(pool);
+
+  if (serr)
+    {
+      ap_log_error(APLOG_MARK, APLOG_WARNING, serr->apr_err, NULL,
+                   "mod_dav_svn: error saving the cache snapshot: '%s'",
+                   serr->message ? serr->message : "(no more info)");
+      svn_error_clear(serr);
+    }
+
+  svn_pool_destroy(pool);
+  return APR_SUCCESS;
+}
+
+/* Implements the child_init hook.  Report problems with the shared cache
+ * and arrange for the cache snapshot, if configured, to be saved upon
+ * process shutdown.  The parent process already loaded the snapshot. */
+static void
+init_child(apr_pool_t *p, server_rec *s)
+{
+  /* Don't let a misconfigured shared cache go unnoticed.  We can still
+   * serve requests with a process-local cache, though. */
+  if (cache_name)
+    {
+      svn_error_t *serr = svn_cache__init_global_membuffer_cache();
+      svn_error_t *e;
+
+      for (e = serr; e; e = e->child)
+        if (e->message)
+          ap_log_error(APLOG_MARK, APLOG_WARNING, e->apr_err, s,
+                       "mod_dav_svn: %s", e->message);
+      svn_error_clear(serr);
+    }
+
+  if (cache_snapshot)
+    {
+      apr_pool_cleanup_register(p, NULL, save_cache_snapshot,
+                                apr_pool_cleanup_null);
+    }
+}
+
 static svn_error_t *
 malfunction_handler(svn_boolean_t can_return,
                     const char *file, int line,
@@ -286,6 +379,7 @@ merge_dir_config(apr_pool_t *p, void *base, void *overrides)
   newconf->revprop_cache = INHERIT_VALUE(parent, child, revprop_cache);
   newconf->nodeprop_cache = INHERIT_VALUE(parent, child, nodeprop_cache);
   newconf->block_read = INHERIT_VALUE(parent, child, block_read);
+  newconf->delta_threads = INHERIT_VALUE(parent, child, delta_threads);
   newconf->root_dir = INHERIT_VALUE(parent, child, root_dir);
   newconf->hooks_env = INHERIT_VALUE(parent, child, hooks_env);
 
@@ -607,6 +701,28 @@ SVNBlockRead_cmd(cmd_parms *cmd, void *config, int arg)
   return NULL;
 }
 
+static const char *
+SVNDeltaThreads_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  dir_conf_t *conf = config;
+  int value = 0;
+  svn_error_t *err = svn_cstring_atoi(&value, arg1);
+  if (err)
+    {
+      svn_error_clear(err);
+      return "Invalid decimal number for the SVN delta thread count.";
+    }
+
+  if (value < 1)
+    return apr_psprintf(cmd->pool,
+                        "%d is not a valid delta thread count. "
+                        "It must be at least 1.", value);
+
+  conf->delta_threads = value;
+
+  return NULL;
+}
+
 static const char *
 SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -627,6 +743,46 @@ SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNInMemoryCacheName_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  /* The name must outlive configuration reloads. */
+  cache_name = apr_pstrdup(cmd->server->process->pool, arg1);
+  svn_cache__config_set_shared_name(cache_name);
+
+  return NULL;
+}
+
+static const char *
+SVNInMemoryCachePolicy_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  if (apr_strnatcasecmp("default", arg1) == 0)
+    svn_cache__config_set_policy(svn_cache__membuffer_policy_default);
+  else if (apr_strnatcasecmp("tinylfu", arg1) == 0)
+    svn_cache__config_set_policy(svn_cache__membuffer_policy_tinylfu);
+  else
+    return "Unrecognized value for SVNInMemoryCachePolicy directive";
+
+  return NULL;
+}
+
+static const char *
+SVNInMemoryCacheSnapshot_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  /* The path must outlive configuration reloads. */
+  apr_pool_t *pool = cmd->server->process->pool;
+  const char *path = ap_server_root_relative(pool, arg1);
+
+  if (!path)
+    return apr_pstrcat(cmd->pool, "Invalid cache snapshot path: ", arg1,
+                       SVN_VA_NULL);
+
+  cache_snapshot = svn_dirent_internal_style(path, pool);
+  svn_cache__config_set_snapshot_path(cache_snapshot);
+
+  return NULL;
+}
+
 static const char *
 SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -1030,6 +1186,17 @@ dav_svn__get_block_read_flag(request_rec *r)
   return get_conf_flag(conf->block_read, FALSE);
 }
 
+int
+dav_svn__get_delta_threads(request_rec *r)
+{
+  dir_conf_t *conf;
+
+  conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+
+  /* concurrent delta processing is disabled by default. */
+  return conf->delta_threads ? conf->delta_threads : 1;
+}
+
 int
 dav_svn__get_compression_level(request_rec *r)
 {
@@ -1385,6 +1552,13 @@ static const command_rec cmds[] =
                "caches (see SVNInMemoryCacheSize) have been configured."
                "(default is Off)."),
 
+  /* per directory/location */
+  AP_INIT_TAKE1("SVNDeltaThreads", SVNDeltaThreads_cmd, NULL,
+                ACCESS_CONF|RSRC_CONF,
+                "specifies the maximum number of threads that FSFS may use "
+                "to deltify and compress large files during a commit "
+                "(default is 1)."),
+
   /* per server */
   AP_INIT_TAKE1("SVNInMemoryCacheSize", SVNInMemoryCacheSize_cmd, NULL,
                 RSRC_CONF,
@@ -1392,6 +1566,26 @@ static const command_rec cmds[] =
                 "in-memory object cache (default value is 16384; 0 switches "
                 "to dynamically sized caches)."),
   /* per server */
+  AP_INIT_TAKE1("SVNInMemoryCacheName", SVNInMemoryCacheName_cmd, NULL,
+                RSRC_CONF,
+                "places Subversion's in-memory object cache into the named "
+                "shared memory region such that all httpd processes on this "
+                "host share it (default is a per-process cache)."),
+  /* per server */
+  AP_INIT_TAKE1("SVNInMemoryCachePolicy", SVNInMemoryCachePolicy_cmd, NULL,
+                RSRC_CONF,
+                "selects the admission policy of Subversion's in-memory "
+                "object cache: 'default' or 'tinylfu'.  The latter keeps "
+                "large scans from evicting frequently used data (default "
+                "is 'default')."),
+  /* per server */
+  AP_INIT_TAKE1("SVNInMemoryCacheSnapshot", SVNInMemoryCacheSnapshot_cmd,
+                NULL, RSRC_CONF,
+                "loads Subversion's in-memory object cache from the given "
+                "file when the server starts and saves it back when the "
+                "first worker process shuts down cleanly (default is to "
+                "start with an empty cache)."),
+  /* per server */
   AP_INIT_TAKE1("SVNCompressionLevel", SVNCompressionLevel_cmd, NULL,
                 RSRC_CONF,
                 "specifies the compression level used before sending file "
@@ -1432,6 +1626,7 @@ register_hooks(apr_pool_t *pconf)
 {
   ap_hook_pre_config(init_dso, NULL, NULL, APR_HOOK_REALLY_FIRST);
   ap_hook_post_config(init, NULL, NULL, APR_HOOK_MIDDLE);
+  ap_hook_child_init(init_child, NULL, NULL, APR_HOOK_MIDDLE);
 
   /* our provider */
   dav_register_provider(pconf, "svn", &provider);
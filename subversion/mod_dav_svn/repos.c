@@ -53,10 +53,12 @@
 #include "mod_dav_svn.h"
 #include "svn_ra.h"  /* for SVN_RA_CAPABILITY_* */
 #include "svn_dirent_uri.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_log.h"
 #include "private/svn_fspath.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_sorts_private.h"
+#include "private/svn_subr_private.h"
 
 #include "dav_svn.h"
 
@@ -1766,7 +1768,10 @@ static int sort_encoding_pref(const void *accept_rec1, const void *accept_rec2)
 
 static int get_svndiff_version(const struct accept_rec *rec)
 {
-  if (strcmp(rec->name, "svndiff2") == 0)
+  /* We can only send svndiff3 if we have been built with zstd. */
+  if (strcmp(rec->name, "svndiff3") == 0)
+    return svn__zstd_available() ? 3 : -1;
+  else if (strcmp(rec->name, "svndiff2") == 0)
     return 2;
   else if (strcmp(rec->name, "svndiff1") == 0)
     return 1;
@@ -2439,6 +2444,9 @@ get_resource(request_rec *r,
                     dav_svn__get_nodeprop_cache_flag(r) ? "1" :"0");
       svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ,
                     dav_svn__get_block_read_flag(r) ? "1" :"0");
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_DELTA_THREADS,
+                    apr_itoa(r->connection->pool,
+                             dav_svn__get_delta_threads(r)));
 
       /* Disallow BDB/event until issue 4157 is fixed. */
       if (!strcmp(ap_show_mpm(), "event"))
@@ -3901,6 +3909,64 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
       svn_stream_t *stream;
       char *block;
 
+      /* Without keywords substitution, a fulltext that is stored verbatim
+         in the repository can be handed to httpd as a file bucket.  The
+         core output filter will then use sendfile() or mmap() as
+         configured instead of copying the data through our buffers. */
+      if (!resource->info->keyword_subst)
+        {
+          apr_file_t *file;
+          apr_off_t offset;
+          svn_filesize_t length;
+
+          serr = svn_fs__file_contents_location(&file, &offset, &length,
+                                                resource->info->root.root,
+                                                resource->info->repos_path,
+                                                resource->pool,
+                                                resource->pool);
+          if (serr != NULL)
+            return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                        "could not prepare to read the file",
+                                        resource->pool);
+
+          /* We don't verify the data, so let the client do it. */
+          if (file)
+            {
+              svn_checksum_t *checksum;
+
+              serr = svn_fs_file_checksum(&checksum, svn_checksum_md5,
+                                          resource->info->root.root,
+                                          resource->info->repos_path,
+                                          FALSE, resource->pool);
+              if (serr != NULL)
+                return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                            "could not get the checksum",
+                                            resource->pool);
+              if (checksum)
+                apr_table_set(resource->info->r->headers_out,
+                              SVN_DAV_RESULT_FULLTEXT_MD5_HEADER,
+                              svn_checksum_to_cstring(checksum,
+                                                      resource->pool));
+
+              bb = apr_brigade_create(resource->pool,
+                                      dav_svn__output_get_bucket_alloc(output));
+              apr_brigade_insert_file(bb, file, offset, length,
+                                      resource->pool);
+              bkt = apr_bucket_eos_create(
+                      dav_svn__output_get_bucket_alloc(output));
+              APR_BRIGADE_INSERT_TAIL(bb, bkt);
+
+              serr = dav_svn__output_pass_brigade(output, bb);
+              apr_brigade_destroy(bb);
+              if (serr != NULL)
+                return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                            "Could not write data to filter.",
+                                            resource->pool);
+
+              return NULL;
+            }
+        }
+
       serr = svn_fs_file_contents(&stream,
                                   resource->info->root.root,
                                   resource->info->repos_path,
@@ -370,6 +370,11 @@ get_option(const dav_resource *resource,
                      apr_pstrdup(r->pool, capabilities[i].capability_name));
     }
 
+  /* svndiff3 also depends on how this server has been built. */
+  if (svn__zstd_available()
+      && (!master_version || svn_version__at_least(master_version, 1, 12, 0)))
+    apr_table_addn(r->headers_out, "DAV", SVN_DAV_NS_DAV_SVN_SVNDIFF3);
+
   return NULL;
 }
 
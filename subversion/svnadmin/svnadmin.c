@@ -45,6 +45,7 @@
 
 #include "private/svn_cmdline_private.h"
 #include "private/svn_opt_private.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_cmdline_private.h"
@@ -113,6 +114,7 @@ static svn_opt_subcommand_t
   subcommand_lslocks,
   subcommand_lstxns,
   subcommand_pack,
+  subcommand_rebuild_indexes,
   subcommand_recover,
   subcommand_rmlocks,
   subcommand_rmtxns,
@@ -155,7 +157,8 @@ enum svnadmin__cmdline_options_t
     svnadmin__normalize_props,
     svnadmin__exclude,
     svnadmin__include,
-    svnadmin__glob
+    svnadmin__glob,
+    svnadmin__jobs
   };
 
 /* Option codes and descriptions.
@@ -294,6 +297,13 @@ static const apr_getopt_option_t options_table[] =
         "                             Character '/' is not treated specially, so\n"
         "                             pattern /*/foo matches paths /a/foo and /a/b/foo.") },
 
+    {"jobs", svnadmin__jobs, 1,
+     N_("process up to ARG shards in parallel when packing\n"
+        "                             or verifying the repository, or deltify large\n"
+        "                             files with up to ARG threads when loading.\n"
+        "                             Default: 1.\n"
+        "                             [ignored for BDB repositories]")},
+
     {NULL}
   };
 
@@ -456,8 +466,11 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     svnadmin__use_pre_commit_hook, svnadmin__use_post_commit_hook,
     svnadmin__parent_dir, svnadmin__normalize_props,
     svnadmin__bypass_prop_validation, 'M',
-    svnadmin__no_flush_to_disk, 'F'},
-   {{'F', N_("read from file ARG instead of stdin")}} },
+    svnadmin__no_flush_to_disk, svnadmin__jobs, 'F'},
+   {{'F', N_("read from file ARG instead of stdin")},
+    {svnadmin__jobs, N_("deltify and compress large files with up to ARG\n"
+                        "                             threads.  Default: 1.\n"
+                        "                             [ignored for BDB repositories]")}} },
 
   {"load-revprops", subcommand_load_revprops, {0}, {N_(
     "usage: svnadmin load-revprops REPOS_PATH\n"
@@ -506,7 +519,18 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Possibly compact the repository into a more efficient storage model.\n"
     "This may not apply to all repositories, in which case, exit.\n"
    )},
-   {'q', 'M'} },
+   {'q', 'M', svnadmin__jobs} },
+
+  {"rebuild-indexes", subcommand_rebuild_indexes, {0}, {N_(
+    "usage: svnadmin rebuild-indexes REPOS_PATH\n"
+    "\n"), N_(
+    "Recreate the auxiliary lookup indexes of the repository, such as the\n"
+    "revision date index, from the revision data.  Run this after modifying\n"
+    "the repository by means other than svnadmin and the repository access\n"
+    "layer, or to enable the indexes for repositories created by older\n"
+    "versions of Subversion.\n"
+   )},
+   {0} },
 
   {"recover", subcommand_recover, {0}, {N_(
     "usage: svnadmin recover REPOS_PATH\n"
@@ -605,7 +629,8 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Verify the data stored in the repository.\n"
    )},
    {'t', 'r', 'q', svnadmin__keep_going, 'M',
-    svnadmin__check_normalization, svnadmin__metadata_only} },
+    svnadmin__check_normalization, svnadmin__metadata_only,
+    svnadmin__jobs} },
 
   { NULL, NULL, {0}, {NULL}, {0} }
 };
@@ -648,6 +673,7 @@ struct svnadmin_opt_state
   apr_array_header_t *exclude;                      /* --exclude */
   apr_array_header_t *include;                      /* --include */
   svn_boolean_t glob;                               /* --pattern */
+  int jobs;                                         /* --jobs */
 
   const char *config_dir;    /* Overriding Configuration Directory */
 };
@@ -677,6 +703,10 @@ open_repos(svn_repos_t **repos,
                            use_block_read ? "1" : "0");
   svn_hash_sets(fs_config, SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                            opt_state->no_flush_to_disk ? "1" : "0");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_PACK_THREADS,
+                           apr_itoa(pool, opt_state->jobs));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_DELTA_THREADS,
+                           apr_itoa(pool, opt_state->jobs));
 
   /* now, open the requested repository */
   SVN_ERR(svn_repos_open3(repos, path, fs_config, pool, pool));
@@ -990,7 +1020,7 @@ struct repos_verify_callback_baton
 };
 
 /* Implementation of svn_repos_verify_callback_t to handle errors coming
-   from svn_repos_verify_fs3(). */
+   from svn_repos_verify_fs4(). */
 static svn_error_t *
 repos_verify_callback(void *baton,
                       svn_revnum_t revision,
@@ -1847,6 +1877,23 @@ subcommand_lstxns(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 }
 
 
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_rebuild_indexes(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+
+  /* Expect no more arguments. */
+  SVN_ERR(parse_args(NULL, os, 0, 0, pool));
+
+  SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
+
+  return svn_error_trace(svn_repos__rebuild_indexes(repos, check_cancel, NULL,
+                                                    pool));
+}
+
+
 /* This implements `svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_recover(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -2247,9 +2294,10 @@ subcommand_verify(apr_getopt_t *os, void *baton, apr_pool_t *pool)
     apr_array_make(pool, 0, sizeof(struct verification_error *));
   verify_baton.result_pool = pool;
 
-  SVN_ERR(svn_repos_verify_fs3(repos, lower, upper,
+  SVN_ERR(svn_repos_verify_fs4(repos, lower, upper,
                                opt_state->check_normalization,
                                opt_state->metadata_only,
+                               opt_state->jobs,
                                !opt_state->quiet
                                  ? repos_notify_handler : NULL,
                                feedback_stream,
@@ -2888,6 +2936,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
   opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.jobs = 1;
 
   /* Parse options. */
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -3032,6 +3081,15 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnadmin__metadata_only:
         opt_state.metadata_only = TRUE;
         break;
+      case svnadmin__jobs:
+        err = svn_cstring_atoi(&opt_state.jobs, opt_arg);
+        if (err)
+          return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, err,
+                                  _("Non-numeric jobs argument given"));
+        if (opt_state.jobs <= 0)
+          return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                  _("Argument to --jobs must be positive"));
+        break;
       case svnadmin__fs_type:
         SVN_ERR(svn_utf_cstring_to_utf8(&opt_state.fs_type, opt_arg, pool));
         break;
@@ -3229,7 +3287,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_t settings = *svn_cache_config_get();
 
     settings.cache_size = opt_state.memory_cache_size;
-    settings.single_threaded = TRUE;
+    /* Parallel verification and packing access the caches from
+       multiple threads. */
+    settings.single_threaded = opt_state.jobs <= 1;
 
     svn_cache_config_set(&settings);
   }
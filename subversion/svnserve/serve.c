@@ -51,10 +51,13 @@
 #include "svn_mergeinfo.h"
 #include "svn_user.h"
 
+#include "private/svn_fs_private.h"
 #include "private/svn_log.h"
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_ra_svn_private.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_fspath.h"
+#include "private/svn_subr_private.h"
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>   /* For getpid() */
@@ -107,6 +110,11 @@ typedef struct authz_baton_t {
   svn_ra_svn_conn_t *conn;
 } authz_baton_t;
 
+typedef struct connection_cancel_baton_t {
+  svn_ra_svn_conn_t *conn;
+  apr_pool_t *pool;  /* Scratch pool, cleared on every check. */
+} connection_cancel_baton_t;
+
 /* svn_error_create() a new error, log_server_error() it, and
    return it. */
 static void
@@ -811,8 +819,11 @@ static svn_error_t *must_have_access(svn_ra_svn_conn_t *conn,
      authentication whether authz will work or not.  We force
      requiring a username because we need one to be able to check
      authz configuration again with a different user credentials than
-     the first time round. */
+     the first time round.  Pipelined commands cannot do that because
+     the client has already sent further commands; the client will
+     retry them without pipelining. */
   if (b->client_info->user == NULL
+      && !b->tagged
       && b->repository->auth_access >= req
       && (b->client_info->tunnel_user || b->repository->pwdb
           || b->repository->use_sasl))
@@ -1551,6 +1562,35 @@ commit(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Maximum size of the individual strings that write_file_range() sends.
+ * Clients buffer each string in memory, so we must not send the whole
+ * file as a single string. */
+#define FILE_RANGE_CHUNK_SIZE (256 * 1024)
+
+/* Send LENGTH bytes, starting at OFFSET in FILE, over CONN as the series
+ * of strings expected by get-file and get-files.  The terminating empty
+ * string is not written.  Use POOL for allocations. */
+static svn_error_t *
+write_file_range(svn_ra_svn_conn_t *conn,
+                 apr_pool_t *pool,
+                 apr_file_t *file,
+                 apr_off_t offset,
+                 svn_filesize_t length)
+{
+  while (length > 0)
+    {
+      apr_size_t chunk = length > FILE_RANGE_CHUNK_SIZE
+                       ? FILE_RANGE_CHUNK_SIZE
+                       : (apr_size_t)length;
+
+      SVN_ERR(svn_ra_svn__write_file_range(conn, pool, file, offset, chunk));
+      offset += chunk;
+      length -= chunk;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 get_file(svn_ra_svn_conn_t *conn,
          apr_pool_t *pool,
@@ -1562,6 +1602,9 @@ get_file(svn_ra_svn_conn_t *conn,
   svn_revnum_t rev;
   svn_fs_root_t *root;
   svn_stream_t *contents;
+  apr_file_t *contents_file = NULL;
+  apr_off_t contents_offset;
+  svn_filesize_t contents_length;
   apr_hash_t *props = NULL;
   apr_array_header_t *inherited_props;
   svn_string_t write_str;
@@ -1614,7 +1657,17 @@ get_file(svn_ra_svn_conn_t *conn,
                           &ab, root, full_path,
                           pool));
   if (want_contents)
-    SVN_CMD_ERR(svn_fs_file_contents(&contents, root, full_path, pool));
+    {
+      /* Plain fulltexts can be sent straight from the repository file.
+         The client checks them against the MD5 that we send first. */
+      SVN_CMD_ERR(svn_fs__file_contents_location(&contents_file,
+                                                 &contents_offset,
+                                                 &contents_length,
+                                                 root, full_path,
+                                                 pool, pool));
+      if (!contents_file)
+        SVN_CMD_ERR(svn_fs_file_contents(&contents, root, full_path, pool));
+    }
 
   /* Send successful command response with revision and props. */
   SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w((?c)r(!", "success",
@@ -1647,24 +1700,28 @@ get_file(svn_ra_svn_conn_t *conn,
   if (want_contents)
     {
       err = SVN_NO_ERROR;
-      while (1)
-        {
-          len = sizeof(buf);
-          err = svn_stream_read_full(contents, buf, &len);
-          if (err)
-            break;
-          if (len > 0)
-            {
-              write_str.data = buf;
-              write_str.len = len;
-              SVN_ERR(svn_ra_svn__write_string(conn, pool, &write_str));
-            }
-          if (len < sizeof(buf))
-            {
-              err = svn_stream_close(contents);
+      if (contents_file)
+        SVN_ERR(write_file_range(conn, pool, contents_file, contents_offset,
+                                 contents_length));
+      else
+        while (1)
+          {
+            len = sizeof(buf);
+            err = svn_stream_read_full(contents, buf, &len);
+            if (err)
               break;
-            }
-        }
+            if (len > 0)
+              {
+                write_str.data = buf;
+                write_str.len = len;
+                SVN_ERR(svn_ra_svn__write_string(conn, pool, &write_str));
+              }
+            if (len < sizeof(buf))
+              {
+                err = svn_stream_close(contents);
+                break;
+              }
+          }
       write_err = svn_ra_svn__write_cstring(conn, pool, "");
       if (write_err)
         {
@@ -1678,6 +1735,136 @@ get_file(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Send the contents of all files in the path list in PARAMS, one after
+ * the other, such that clients can fetch many files in one round trip. */
+static svn_error_t *
+get_files(svn_ra_svn_conn_t *conn,
+          apr_pool_t *pool,
+          svn_ra_svn__list_t *params,
+          void *baton)
+{
+  server_baton_t *b = baton;
+  svn_revnum_t rev;
+  svn_ra_svn__list_t *path_list;
+  const char **full_paths;
+  const char *denied_path = NULL;
+  svn_fs_root_t *root;
+  svn_stream_t *contents;
+  apr_file_t *contents_file;
+  apr_off_t contents_offset;
+  svn_filesize_t contents_length;
+  svn_string_t write_str;
+  char buf[4096];
+  apr_size_t len;
+  apr_pool_t *iterpool;
+  svn_error_t *err, *write_err;
+  int i;
+
+  /* Parse arguments. */
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)l", &rev, &path_list));
+
+  full_paths = apr_palloc(pool, path_list->nelts * sizeof(*full_paths));
+  for (i = 0; i < path_list->nelts; ++i)
+    {
+      svn_ra_svn__item_t *elt = &SVN_RA_SVN__LIST_ITEM(path_list, i);
+
+      if (elt->kind != SVN_RA_SVN_STRING)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                "Path field not a string");
+
+      full_paths[i]
+        = svn_fspath__join(b->repository->fs_path->data,
+                           svn_relpath_canonicalize(elt->u.string.data,
+                                                    pool),
+                           pool);
+      if (!denied_path
+          && !lookup_access(pool, b, svn_authz_read, full_paths[i], FALSE))
+        denied_path = full_paths[i];
+    }
+
+  /* Any authentication must happen before we start sending data. */
+  if (denied_path)
+    SVN_ERR(must_have_access(conn, pool, b, svn_authz_read, denied_path,
+                             FALSE));
+  else
+    SVN_ERR(trivial_auth_request(conn, pool, b));
+
+  SVN_ERR(log_command(b, conn, pool, "get-files r%ld (%d paths)",
+                      rev, path_list->nelts));
+
+  /* Send one "( path ) contents..." sequence per file. */
+  err = SVN_NO_ERROR;
+  if (!SVN_IS_VALID_REVNUM(rev))
+    err = svn_fs_youngest_rev(&rev, b->repository->fs, pool);
+  if (!err)
+    err = svn_fs_revision_root(&root, b->repository->fs, rev, pool);
+  iterpool = svn_pool_create(pool);
+  for (i = 0; !err && i < path_list->nelts; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      if (!lookup_access(iterpool, b, svn_authz_read, full_paths[i], FALSE))
+        {
+          err = error_create_and_log(SVN_ERR_RA_NOT_AUTHORIZED, NULL, NULL,
+                                     b);
+          break;
+        }
+
+      /* The update edit that the client requests these files for carries
+         their MD5 checksums. */
+      err = svn_fs__file_contents_location(&contents_file, &contents_offset,
+                                           &contents_length, root,
+                                           full_paths[i], iterpool, iterpool);
+      if (!err && !contents_file)
+        err = svn_fs_file_contents(&contents, root, full_paths[i], iterpool);
+      if (err)
+        break;
+
+      SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "(s)",
+                      &SVN_RA_SVN__LIST_ITEM(path_list, i).u.string));
+      if (contents_file)
+        SVN_ERR(write_file_range(conn, iterpool, contents_file,
+                                 contents_offset, contents_length));
+      else
+        while (1)
+          {
+            len = sizeof(buf);
+            err = svn_stream_read_full(contents, buf, &len);
+            if (err)
+              break;
+            if (len > 0)
+              {
+                write_str.data = buf;
+                write_str.len = len;
+                SVN_ERR(svn_ra_svn__write_string(conn, iterpool, &write_str));
+              }
+            if (len < sizeof(buf))
+              {
+                err = svn_stream_close(contents);
+                break;
+              }
+          }
+
+      write_err = svn_ra_svn__write_cstring(conn, iterpool, "");
+      if (write_err)
+        {
+          svn_error_clear(err);
+          return write_err;
+        }
+    }
+  svn_pool_destroy(iterpool);
+
+  write_err = svn_ra_svn__write_word(conn, pool, "done");
+  if (write_err)
+    {
+      svn_error_clear(err);
+      return write_err;
+    }
+  SVN_CMD_ERR(err);
+
+  return svn_error_trace(svn_ra_svn__write_cmd_response(conn, pool, ""));
+}
+
 /* Translate all the words in DIRENT_FIELDS_LIST into the flags in
  * DIRENT_FIELDS_P.  If DIRENT_FIELDS_LIST is NULL, set all flags. */
 static svn_error_t *
@@ -1921,15 +2108,17 @@ update(svn_ra_svn_conn_t *conn,
   svn_boolean_t recurse;
   svn_tristate_t send_copyfrom_args; /* Optional; default FALSE */
   svn_tristate_t ignore_ancestry; /* Optional; default FALSE */
+  svn_tristate_t send_texts; /* Optional; default TRUE */
   /* Default to unknown.  Old clients won't send depth, but we'll
      handle that by converting recurse if necessary. */
   svn_depth_t depth = svn_depth_unknown;
   svn_boolean_t is_checkout;
 
   /* Parse the arguments. */
-  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cb?w3?3", &rev, &target,
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cb?w3?33", &rev, &target,
                                   &recurse, &depth_word,
-                                  &send_copyfrom_args, &ignore_ancestry));
+                                  &send_copyfrom_args, &ignore_ancestry,
+                                  &send_texts));
   target = svn_relpath_canonicalize(target, pool);
 
   if (depth_word)
@@ -1945,7 +2134,8 @@ update(svn_ra_svn_conn_t *conn,
     SVN_CMD_ERR(svn_fs_youngest_rev(&rev, b->repository->fs, pool));
 
   SVN_ERR(accept_report(&is_checkout, NULL,
-                        conn, pool, b, rev, target, NULL, TRUE,
+                        conn, pool, b, rev, target, NULL,
+                        (send_texts != svn_tristate_false),
                         depth,
                         (send_copyfrom_args == svn_tristate_true),
                         (ignore_ancestry == svn_tristate_true)));
@@ -1983,11 +2173,13 @@ switch_cmd(svn_ra_svn_conn_t *conn,
   svn_depth_t depth = svn_depth_unknown;
   svn_tristate_t send_copyfrom_args; /* Optional; default FALSE */
   svn_tristate_t ignore_ancestry; /* Optional; default TRUE */
+  svn_tristate_t send_texts; /* Optional; default TRUE */
 
   /* Parse the arguments. */
-  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cbc?w?33", &rev, &target,
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cbc?w?333", &rev, &target,
                                   &recurse, &switch_url, &depth_word,
-                                  &send_copyfrom_args, &ignore_ancestry));
+                                  &send_copyfrom_args, &ignore_ancestry,
+                                  &send_texts));
   target = svn_relpath_canonicalize(target, pool);
   switch_url = svn_uri_canonicalize(switch_url, pool);
 
@@ -2014,7 +2206,8 @@ switch_cmd(svn_ra_svn_conn_t *conn,
   }
 
   return accept_report(NULL, NULL,
-                       conn, pool, b, rev, target, switch_path, TRUE,
+                       conn, pool, b, rev, target, switch_path,
+                       (send_texts != svn_tristate_false),
                        depth,
                        (send_copyfrom_args == svn_tristate_true),
                        (ignore_ancestry != svn_tristate_false));
@@ -2887,6 +3080,101 @@ get_file_revs(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Texts larger than this are not being blamed on the server.  Clients
+ * fall back to blaming the file revisions themselves. */
+#define BLAME_MAX_TEXT_SIZE (16 * 1024 * 1024)
+
+/* Implements svn_cancel_func_t.  Cancel once the client has closed the
+ * connection in the connection_cancel_baton_t BATON, such that we don't
+ * keep working for nobody. */
+static svn_error_t *
+connection_cancel_func(void *baton)
+{
+  connection_cancel_baton_t *cb = baton;
+  svn_boolean_t has_command, terminated;
+
+  svn_pool_clear(cb->pool);
+  SVN_ERR(svn_ra_svn__has_command(&has_command, &terminated, cb->conn,
+                                  cb->pool));
+  if (terminated)
+    return svn_error_create(SVN_ERR_CANCELLED, NULL,
+                            _("Client closed the connection"));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+get_blame(svn_ra_svn_conn_t *conn,
+          apr_pool_t *pool,
+          svn_ra_svn__list_t *params,
+          void *baton)
+{
+  server_baton_t *b = baton;
+  svn_error_t *err, *write_err;
+  svn_revnum_t start_rev, end_rev;
+  const char *path;
+  const char *full_path;
+  svn_boolean_t ignore_space_change, ignore_all_space, ignore_eol_style;
+  svn_diff_file_options_t *diff_options;
+  apr_array_header_t *chunks;
+  authz_baton_t ab;
+  connection_cancel_baton_t cb;
+  int i;
+
+  ab.server = b;
+  ab.conn = conn;
+  cb.conn = conn;
+  cb.pool = svn_pool_create(pool);
+
+  /* Parse arguments. */
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "c(?r)(?r)bbb",
+                                  &path, &start_rev, &end_rev,
+                                  &ignore_space_change, &ignore_all_space,
+                                  &ignore_eol_style));
+  path = svn_relpath_canonicalize(path, pool);
+  SVN_ERR(trivial_auth_request(conn, pool, b));
+  full_path = svn_fspath__join(b->repository->fs_path->data, path, pool);
+
+  diff_options = svn_diff_file_options_create(pool);
+  if (ignore_all_space)
+    diff_options->ignore_space = svn_diff_file_ignore_space_all;
+  else if (ignore_space_change)
+    diff_options->ignore_space = svn_diff_file_ignore_space_change;
+  diff_options->ignore_eol_style = ignore_eol_style;
+
+  SVN_ERR(log_command(b, conn, pool, "%s",
+                      svn_log__get_blame(full_path, start_rev, end_rev,
+                                         pool)));
+
+  /* The blame is being calculated completely before sending the first
+     chunk, so any error will be reported before the data. */
+  err = svn_repos__get_blame(&chunks, b->repository->repos, full_path,
+                             start_rev, end_rev, diff_options,
+                             BLAME_MAX_TEXT_SIZE,
+                             authz_check_access_cb_func(b), &ab,
+                             connection_cancel_func, &cb, pool, pool);
+  for (i = 0; !err && i < chunks->nelts; ++i)
+    {
+      const svn_repos__blame_chunk_t *chunk
+        = &APR_ARRAY_IDX(chunks, i, svn_repos__blame_chunk_t);
+
+      SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "(n(?r))",
+                                      (apr_uint64_t)chunk->start,
+                                      chunk->revision));
+    }
+
+  write_err = svn_ra_svn__write_word(conn, pool, "done");
+  if (write_err)
+    {
+      svn_error_clear(err);
+      return write_err;
+    }
+  SVN_CMD_ERR(err);
+  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 lock(svn_ra_svn_conn_t *conn,
      apr_pool_t *pool,
@@ -3686,6 +3974,72 @@ list(svn_ra_svn_conn_t *conn,
   return svn_error_trace(svn_ra_svn__write_cmd_response(conn, pool, ""));
 }
 
+/* The commands that clients may pipeline using the "tagged" command.
+ * These must not send anything but their auth request and a single
+ * command response. */
+static const svn_ra_svn__cmd_entry_t tagged_commands[] = {
+  { "rev-proplist",    rev_proplist },
+  { "rev-prop",        rev_prop },
+  { "get-dir",         get_dir },
+  { "check-path",      check_path },
+  { "stat",            stat_cmd },
+  { NULL }
+};
+
+/* Execute the command given in PARAMS and send its response wrapped in
+ * a list that starts with the tag given by the client.  This allows the
+ * client to send many commands without waiting for the responses and to
+ * match each response to its command. */
+static svn_error_t *
+tagged(svn_ra_svn_conn_t *conn,
+       apr_pool_t *pool,
+       svn_ra_svn__list_t *params,
+       void *baton)
+{
+  server_baton_t *b = baton;
+  apr_uint64_t tag;
+  const char *cmdname;
+  svn_ra_svn__list_t *cmd_params;
+  const svn_ra_svn__cmd_entry_t *command;
+  svn_error_t *err, *write_err;
+
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "nwl", &tag, &cmdname,
+                                  &cmd_params));
+
+  for (command = tagged_commands; command->cmdname; command++)
+    if (strcmp(command->cmdname, cmdname) == 0)
+      break;
+
+  SVN_ERR(svn_ra_svn__start_list(conn, pool));
+  SVN_ERR(svn_ra_svn__write_number(conn, pool, tag));
+
+  if (command->cmdname)
+    {
+      b->tagged = TRUE;
+      err = command->handler(conn, pool, cmd_params, b);
+      b->tagged = FALSE;
+    }
+  else
+    {
+      err = svn_error_createf(SVN_ERR_RA_SVN_UNKNOWN_CMD, NULL,
+                              _("Command '%s' cannot be tagged"), cmdname);
+      err = svn_error_create(SVN_ERR_RA_SVN_CMD_ERR, err, NULL);
+    }
+
+  /* Command errors become part of the tagged response. */
+  if (err && err->apr_err == SVN_ERR_RA_SVN_CMD_ERR)
+    {
+      write_err = svn_ra_svn__write_cmd_failure(
+                      conn, pool, svn_error_purge_tracing(err)->child);
+      svn_error_clear(err);
+      SVN_ERR(write_err);
+    }
+  else
+    SVN_ERR(err);
+
+  return svn_error_trace(svn_ra_svn__end_list(conn, pool));
+}
+
 static const svn_ra_svn__cmd_entry_t main_commands[] = {
   { "reparent",        reparent },
   { "get-latest-rev",  get_latest_rev },
@@ -3696,6 +4050,7 @@ static const svn_ra_svn__cmd_entry_t main_commands[] = {
   { "rev-prop",        rev_prop },
   { "commit",          commit },
   { "get-file",        get_file },
+  { "get-files",       get_files },
   { "get-dir",         get_dir },
   { "update",          update },
   { "switch",          switch_cmd },
@@ -3719,6 +4074,8 @@ static const svn_ra_svn__cmd_entry_t main_commands[] = {
   { "get-deleted-rev", get_deleted_rev },
   { "get-iprops",      get_inherited_props },
   { "list",            list },
+  { "get-blame",       get_blame },
+  { "tagged",          tagged },
   { NULL }
 };
 
@@ -4129,7 +4486,7 @@ construct_server_baton(server_baton_t **baton,
    * send an empty mechlist. */
   if (params->compression_level > 0)
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwwwww?w)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_SVNDIFF1,
@@ -4143,11 +4500,16 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_UPDATE_SKELETON,
+                                           SVN_RA_SVN_CAP_TAGGED_COMMANDS,
+                                           svn__zstd_available()
+                                             ? SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED
+                                             : NULL
                                            ));
   else
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwww)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_ABSENT_ENTRIES,
@@ -4159,7 +4521,9 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_UPDATE_SKELETON,
+                                           SVN_RA_SVN_CAP_TAGGED_COMMANDS
                                            ));
 
   /* Read client response, which we assume to be in version 2 format:
@@ -90,6 +90,8 @@ typedef struct server_baton_t {
                               May be NULL even if log_file is not. */
   svn_boolean_t read_only; /* Disallow write access (global flag) */
   svn_boolean_t vhost;     /* Use virtual-host-based path to repo. */
+  svn_boolean_t tagged;    /* Executing a pipelined "tagged" command; the
+                              client cannot take part in an auth exchange. */
   apr_pool_t *pool;
 } server_baton_t;
 
@@ -31,6 +31,7 @@
 #include <apr_signal.h>
 #include <apr_thread_proc.h>
 #include <apr_portable.h>
+#include <apr_poll.h>
 
 #include <locale.h>
 
@@ -55,8 +56,10 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_atomic.h"
+#include "private/svn_cache.h"
 #include "private/svn_mutex.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_ra_svn_private.h"
 
 #if APR_HAS_THREADS
 #    include <apr_thread_pool.h>
@@ -76,6 +79,8 @@
 enum connection_handling_mode {
   connection_mode_fork,   /* Create a process per connection */
   connection_mode_thread, /* Create a thread per connection */
+  connection_mode_event,  /* Wait for commands in an event loop and use
+                             threads only to process them */
   connection_mode_single  /* One connection at a time in this process */
 };
 
@@ -137,6 +142,11 @@ enum run_mode {
 #define THREADPOOL_MAX_SIZE 256
 #endif
 
+/* Maximum number of events to fetch from the poll set at once in event
+ * mode.  This does not limit the number of connections.
+ */
+#define EVENT_POLLSET_SIZE 1024
+
 /* Number of microseconds that an unused thread remains in the pool before
  * being terminated.
  *
@@ -222,6 +232,11 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_CACHE_NAME      277
+#define SVNSERVE_OPT_CACHE_SNAPSHOT  278
+#define SVNSERVE_OPT_CACHE_POLICY    279
+#define SVNSERVE_OPT_EVENT           280
+#define SVNSERVE_OPT_DELTA_THREADS   281
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -229,7 +244,7 @@ void winservice_notify_stop(void)
 #define ONLY_AVAILABLE_WITH_THEADS \
         "\n" \
         "                             "\
-        "[used only with --threads]"
+        "[used only with --threads or --event]"
 #else
 #define ONLY_AVAILABLE_WITH_THEADS ""
 #endif
@@ -297,6 +312,36 @@ static const apr_getopt_option_t svnserve__options[] =
         "0 switches to dynamically sized caches.\n"
         "                             "
         "[used for FSFS and FSX repositories only]")},
+    {"memory-cache-name", SVNSERVE_OPT_CACHE_NAME, 1,
+     N_("place the in-memory cache into the shared memory\n"
+        "                             "
+        "region ARG such that all svnserve processes on this\n"
+        "                             "
+        "host using the same name share the cache contents.\n"
+        "                             "
+        "Default is to use a per-process cache.\n"
+        "                             "
+        "[used for FSFS and FSX repositories only]")},
+    {"memory-cache-snapshot", SVNSERVE_OPT_CACHE_SNAPSHOT, 1,
+     N_("load the in-memory cache contents from file ARG\n"
+        "                             "
+        "at startup and save them there upon SIGTERM or\n"
+        "                             "
+        "SIGINT.  Forked workers only save their data if\n"
+        "                             "
+        "--memory-cache-name is used as well.  Remove the\n"
+        "                             "
+        "file when replacing a repository.\n"
+        "                             "
+        "[used for FSFS and FSX repositories only]")},
+    {"memory-cache-policy", SVNSERVE_OPT_CACHE_POLICY, 1,
+     N_("select the in-memory cache admission policy.\n"
+        "                             "
+        "ARG may be 'default' or 'tinylfu'.  The latter keeps\n"
+        "                             "
+        "large scans from evicting frequently used data.\n"
+        "                             "
+        "[used for FSFS and FSX repositories only]")},
     {"cache-txdeltas", SVNSERVE_OPT_CACHE_TXDELTAS, 1,
      N_("enable or disable caching of deltas between older\n"
         "                             "
@@ -341,6 +386,14 @@ static const apr_getopt_option_t svnserve__options[] =
         "Default is no.\n"
         "                             "
         "[used for FSFS repositories in 1.9 format only]")},
+    {"delta-threads", SVNSERVE_OPT_DELTA_THREADS, 1,
+     N_("Deltify and compress large files with up to ARG\n"
+        "                             "
+        "threads per commit.\n"
+        "                             "
+        "Default is 1.\n"
+        "                             "
+        "[used for FSFS repositories only]")},
 #ifdef CONNECTION_HAVE_THREAD_OPTION
     /* ### Making the assumption here that WIN32 never has fork and so
      * ### this option never exists when --service exists. */
@@ -348,6 +401,12 @@ static const apr_getopt_option_t svnserve__options[] =
                                     "[mode: daemon]")},
 #endif
 #if APR_HAS_THREADS
+    {"event",            SVNSERVE_OPT_EVENT, 0,
+     N_("keep idle connections in an event loop and use\n"
+        "                             "
+        "threads only while processing commands\n"
+        "                             "
+        "[mode: daemon]")},
     {"min-threads",      SVNSERVE_OPT_MIN_THREADS, 1,
      N_("Minimum number of server threads, even if idle.\n"
         "                             "
@@ -492,6 +551,76 @@ static void sigchld_handler(int signo)
 }
 #endif
 
+/* Set when the daemon has been asked to shut down cleanly. */
+static volatile sig_atomic_t shutdown_requested = FALSE;
+
+/* The poll set the main thread waits on for new connections.  It gets
+ * woken up upon shutdown requests, no matter which thread receives the
+ * signal.  NULL if we simply block in accept(). */
+static apr_pollset_t *volatile shutdown_pollset = NULL;
+
+#if APR_HAS_FORK
+static void shutdown_handler(int signo)
+{
+  /* Make the accept() loop terminate. */
+  shutdown_requested = TRUE;
+
+#ifdef APR_POLLSET_WAKEABLE
+  /* This only writes to the wakeup pipe. */
+  if (shutdown_pollset)
+    apr_pollset_wakeup(shutdown_pollset);
+#endif
+}
+
+#ifdef APR_POLLSET_WAKEABLE
+/* Set SHUTDOWN_POLLSET to a wakeable poll set containing the server
+ * socket SOCK.  Allocate it in POOL. */
+static svn_error_t *
+create_shutdown_pollset(apr_socket_t *sock,
+                        apr_pool_t *pool)
+{
+  apr_pollset_t *pollset;
+  apr_pollfd_t pfd = { 0 };
+  apr_status_t status;
+
+  status = apr_pollset_create(&pollset, 1, pool, APR_POLLSET_WAKEABLE);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create poll set"));
+
+  pfd.p = pool;
+  pfd.desc_type = APR_POLL_SOCKET;
+  pfd.reqevents = APR_POLLIN;
+  pfd.desc.s = sock;
+
+  status = apr_pollset_add(pollset, &pfd);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't poll server socket"));
+
+  shutdown_pollset = pollset;
+  return SVN_NO_ERROR;
+}
+#endif
+#endif
+
+/* Wait until there is a new connection to accept in HANDLING_MODE.
+ * Return APR_EINTR if we have been interrupted, e.g. by a shutdown
+ * request. */
+static apr_status_t
+wait_for_connection(enum connection_handling_mode handling_mode)
+{
+  const apr_pollfd_t *events;
+  apr_int32_t count;
+
+  if (shutdown_requested)
+    return APR_EINTR;
+
+  /* In event mode, the caller polled the server socket already. */
+  if (shutdown_pollset == NULL || handling_mode == connection_mode_event)
+    return APR_SUCCESS;
+
+  return apr_pollset_poll(shutdown_pollset, -1, &count, &events);
+}
+
 /* Redirect stdout to stderr.  ARG is the pool.
  *
  * In tunnel or inetd mode, we don't want hook scripts corrupting the
@@ -515,7 +644,8 @@ static apr_status_t redirect_stdout(void *arg)
 
 /* Wait for the next client connection to come in from SOCK.  Allocate
  * the connection in a root pool from CONNECTION_POOLS and assign PARAMS.
- * Return the connection object in *CONNECTION.
+ * Return the connection object in *CONNECTION.  If we have been asked
+ * to shut down, set *CONNECTION to NULL.
  *
  * Use HANDLING_MODE for proper internal cleanup.
  */
@@ -545,8 +675,10 @@ accept_connection(connection_t **connection,
         exit(0);
       #endif
 
-      status = apr_socket_accept(&(*connection)->usock, sock,
-                                 connection_pool);
+      status = wait_for_connection(handling_mode);
+      if (status == APR_SUCCESS)
+        status = apr_socket_accept(&(*connection)->usock, sock,
+                                   connection_pool);
       if (handling_mode == connection_mode_fork)
         {
           apr_proc_t proc;
@@ -557,10 +689,19 @@ accept_connection(connection_t **connection,
             ;
         }
     }
-  while (APR_STATUS_IS_EINTR(status)
+  while ((APR_STATUS_IS_EINTR(status) && !shutdown_requested)
     || APR_STATUS_IS_ECONNABORTED(status)
     || APR_STATUS_IS_ECONNRESET(status));
 
+  /* Have we been asked to shut down?  The signal may also have arrived
+   * while we were accepting a connection.  Just drop that one. */
+  if (shutdown_requested || APR_STATUS_IS_EINTR(status))
+    {
+      svn_pool_destroy(connection_pool);
+      *connection = NULL;
+      return SVN_NO_ERROR;
+    }
+
   return status
        ? svn_error_wrap_apr(status, _("Can't accept client connection"))
        : SVN_NO_ERROR;
@@ -656,6 +797,162 @@ static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
   return NULL;
 }
 
+/* In event mode, all idle connections wait in this poll set for their
+   next command. */
+static apr_pollset_t *pollset;
+
+/* Load determination callback for serve_interruptable in event mode:
+   Always serve only the current command, such that the thread returns
+   to THREADS and idle connections don't occupy any. */
+static svn_boolean_t
+is_event_driven(connection_t *connection)
+{
+  return TRUE;
+}
+
+/* Wait in POLLSET for the client of CONNECTION to send its next command. */
+static apr_status_t
+park_connection(connection_t *connection)
+{
+  apr_pollfd_t pfd = { 0 };
+
+  pfd.p = connection->pool;
+  pfd.desc_type = APR_POLL_SOCKET;
+  pfd.reqevents = APR_POLLIN;
+  pfd.desc.s = connection->usock;
+  pfd.client_data = connection;
+
+  return apr_pollset_add(pollset, &pfd);
+}
+
+/* Serve the pending command of the connection given by DATA, if any.
+   Afterwards, re-schedule the connection if the client already sent
+   another command or park it in POLLSET otherwise.  The first call
+   for a connection also performs the handshake. */
+static void * APR_THREAD_FUNC serve_event_thread(apr_thread_t *tid,
+                                                 void *data)
+{
+  svn_boolean_t done;
+  svn_boolean_t has_command = FALSE;
+  connection_t *connection = data;
+  svn_error_t *err;
+
+  apr_pool_t *pool = svn_root_pools__acquire_pool(connection_pools);
+
+  /* process the actual request and log errors */
+  err = serve_interruptable(&done, connection, is_event_driven, pool);
+  if (!err && !done)
+    err = svn_ra_svn__has_command(&has_command, &done, connection->conn,
+                                  pool);
+
+  /* The client must see our response before we stop listening to it. */
+  if (!err && !done && !has_command)
+    err = svn_ra_svn__flush(connection->conn, pool);
+
+  if (err)
+    {
+      logger__log_error(connection->params->logger, err, NULL,
+                        get_client_info(connection->conn, connection->params,
+                                        pool));
+      svn_error_clear(err);
+      done = TRUE;
+    }
+  svn_root_pools__release_pool(pool, connection_pools);
+
+  /* Close, re-schedule or park connection. */
+  if (done)
+    close_connection(connection);
+  else if (has_command)
+    apr_thread_pool_push(threads, serve_event_thread, connection, 0, NULL);
+  else if (park_connection(connection))
+    close_connection(connection);
+
+  return NULL;
+}
+
+/* Accept connections from SOCK and serve them in event mode until we
+   have been asked to shut down.  Connections get PARAMS assigned.
+
+   The main thread only waits for new connections and for incoming
+   commands on idle connections.  Processing happens in THREADS, one
+   command at a time per task, such that the number of connections is
+   not limited by the number of threads.  Use POOL for allocations. */
+static svn_error_t *
+serve_events(apr_socket_t *sock,
+             serve_params_t *params,
+             apr_pool_t *pool)
+{
+  apr_pollfd_t listen_pfd = { 0 };
+  apr_status_t status;
+
+  /* Worker threads park connections while we are waiting for events.
+     Shutdown requests may arrive in any thread, so they wake us up
+     through the poll set. */
+#ifdef APR_POLLSET_WAKEABLE
+  status = apr_pollset_create(&pollset, EVENT_POLLSET_SIZE, pool,
+                              APR_POLLSET_THREADSAFE | APR_POLLSET_WAKEABLE);
+#else
+  status = apr_pollset_create(&pollset, EVENT_POLLSET_SIZE, pool,
+                              APR_POLLSET_THREADSAFE);
+#endif
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create poll set"));
+
+  listen_pfd.p = pool;
+  listen_pfd.desc_type = APR_POLL_SOCKET;
+  listen_pfd.reqevents = APR_POLLIN;
+  listen_pfd.desc.s = sock;
+  listen_pfd.client_data = NULL;
+
+  status = apr_pollset_add(pollset, &listen_pfd);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't poll server socket"));
+
+  shutdown_pollset = pollset;
+  while (!shutdown_requested)
+    {
+      const apr_pollfd_t *events;
+      apr_int32_t count, i;
+
+      status = apr_pollset_poll(pollset, -1, &count, &events);
+      if (APR_STATUS_IS_EINTR(status))
+        continue;
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't poll connections"));
+
+      for (i = 0; i < count; i++)
+        {
+          connection_t *connection = events[i].client_data;
+
+          if (connection == NULL)
+            {
+              /* The server speaks first, so serve new connections right
+                 away instead of waiting for them to send data. */
+              SVN_ERR(accept_connection(&connection, sock, params,
+                                        connection_mode_event, pool));
+              if (connection == NULL)
+                break;
+            }
+          else
+            {
+              /* Only one thread may serve the connection at a time. */
+              status = apr_pollset_remove(pollset, &events[i]);
+              if (status)
+                return svn_error_wrap_apr(status,
+                                          _("Can't remove connection from "
+                                            "poll set"));
+            }
+
+          status = apr_thread_pool_push(threads, serve_event_thread,
+                                        connection, 0, NULL);
+          if (status)
+            return svn_error_wrap_apr(status, _("Can't push task"));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
 #endif
 
 /* Write the PID of the current process as a decimal number, followed by a
@@ -725,6 +1022,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_boolean_t cache_txdeltas = TRUE;
   svn_boolean_t cache_revprops = FALSE;
   svn_boolean_t use_block_read = FALSE;
+  int delta_threads = 1;
   apr_uint16_t port = SVN_RA_SVN_PORT;
   const char *host = NULL;
   int family = APR_INET;
@@ -739,6 +1037,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   const char *config_filename = NULL;
   const char *pid_filename = NULL;
   const char *log_filename = NULL;
+  const char *cache_snapshot = NULL;
+  const char *cache_name = NULL;
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
   apr_size_t max_thread_count = THREADPOOL_MAX_SIZE;
@@ -892,6 +1192,11 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           handling_opt_count++;
           break;
 
+        case SVNSERVE_OPT_EVENT:
+          handling_mode = connection_mode_event;
+          handling_opt_count++;
+          break;
+
         case 'c':
           params.compression_level = atoi(arg);
           if (params.compression_level < SVN_DELTA_COMPRESSION_LEVEL_NONE)
@@ -909,6 +1214,29 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           }
           break;
 
+        case SVNSERVE_OPT_CACHE_NAME:
+          cache_name = arg;
+          svn_cache__config_set_shared_name(cache_name);
+          break;
+
+        case SVNSERVE_OPT_CACHE_SNAPSHOT:
+          SVN_ERR(svn_utf_cstring_to_utf8(&cache_snapshot, arg, pool));
+          cache_snapshot = svn_dirent_internal_style(cache_snapshot, pool);
+          SVN_ERR(svn_dirent_get_absolute(&cache_snapshot, cache_snapshot,
+                                          pool));
+          svn_cache__config_set_snapshot_path(cache_snapshot);
+          break;
+
+        case SVNSERVE_OPT_CACHE_POLICY:
+          if (strcmp(arg, "default") == 0)
+            svn_cache__config_set_policy(svn_cache__membuffer_policy_default);
+          else if (strcmp(arg, "tinylfu") == 0)
+            svn_cache__config_set_policy(svn_cache__membuffer_policy_tinylfu);
+          else
+            return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                     _("Invalid cache policy '%s'"), arg);
+          break;
+
         case SVNSERVE_OPT_CACHE_TXDELTAS:
           cache_txdeltas = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
@@ -929,6 +1257,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_DELTA_THREADS:
+          delta_threads = (int)apr_strtoi64(arg, NULL, 0);
+          break;
+
         case SVNSERVE_OPT_CLIENT_SPEED:
           {
             apr_size_t bandwidth = (apr_size_t)apr_strtoi64(arg, NULL, 0);
@@ -1029,7 +1361,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   if (handling_opt_count > 1)
     {
       svn_error_clear(svn_cmdline_fputs(
-                      _("You may only specify one of -T or --single-thread\n"),
+                      _("You may only specify one of -T, --event or "
+                        "--single-thread\n"),
                       stderr, pool));
       usage(argv[0], pool);
       *exit_code = EXIT_FAILURE;
@@ -1037,7 +1370,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     }
 
   /* construct object pools */
-  is_multi_threaded = handling_mode == connection_mode_thread;
+  is_multi_threaded = handling_mode == connection_mode_thread
+                   || handling_mode == connection_mode_event;
   params.fs_config = apr_hash_make(pool);
   svn_hash_sets(params.fs_config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS,
                 cache_txdeltas ? "1" :"0");
@@ -1049,6 +1383,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                 cache_revprops ? "2" :"0");
   svn_hash_sets(params.fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ,
                 use_block_read ? "1" :"0");
+  svn_hash_sets(params.fs_config, SVN_FS_CONFIG_FSFS_DELTA_THREADS,
+                apr_itoa(pool, delta_threads));
 
   SVN_ERR(svn_repos__config_pool_create(&params.config_pool,
                                         is_multi_threaded,
@@ -1280,7 +1616,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       settings.cache_size = params.memory_cache_size;
 
     settings.single_threaded = TRUE;
-    if (handling_mode == connection_mode_thread)
+    if (is_multi_threaded)
       {
 #if APR_HAS_THREADS
         settings.single_threaded = FALSE;
@@ -1297,10 +1633,45 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_set(&settings);
   }
 
+  /* Don't let a misconfigured shared cache go unnoticed.  We can still
+   * serve requests with a process-local cache, though. */
+  if (cache_name)
+    {
+      err = svn_cache__init_global_membuffer_cache();
+      if (err)
+        {
+          if (params.logger)
+            logger__log_error(params.logger, err, NULL, NULL);
+          else
+            svn_handle_warning2(stderr, err, "svnserve: ");
+          svn_error_clear(err);
+        }
+    }
+
+  /* Load the cache snapshot before serving any connection such that
+   * forked workers start with a warm cache as well.  Only a clean
+   * shutdown will save the cache contents again. */
+  if (cache_snapshot)
+    {
+      svn_cache__get_global_membuffer_cache();
+
+#if APR_HAS_FORK
+#ifdef APR_POLLSET_WAKEABLE
+      /* In threaded mode, any thread may receive the signal.  So, don't
+       * rely on it to interrupt the main thread's accept(). */
+      if (handling_mode != connection_mode_event)
+        SVN_ERR(create_shutdown_pollset(sock, pool));
+#endif
+
+      apr_signal(SIGTERM, shutdown_handler);
+      apr_signal(SIGINT, shutdown_handler);
+#endif
+    }
+
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
-  if (handling_mode == connection_mode_thread)
+  if (is_multi_threaded)
     {
       /* create the thread pool with a valid range of threads */
       if (max_thread_count < 1)
@@ -1328,6 +1699,16 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     {
       threads = NULL;
     }
+
+  if (handling_mode == connection_mode_event
+      && run_mode != run_mode_listen_once)
+    {
+      SVN_ERR(serve_events(sock, &params, pool));
+
+      /* We only get here upon a clean shutdown. */
+      apr_socket_close(sock);
+      return svn_error_trace(svn_cache__save_global_membuffer_cache(pool));
+    }
 #endif
 
   while (1)
@@ -1335,6 +1716,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       connection_t *connection = NULL;
       SVN_ERR(accept_connection(&connection, sock, &params, handling_mode,
                                 pool));
+      if (connection == NULL)
+        break;
+
       if (run_mode == run_mode_listen_once)
         {
           err = serve_socket(connection, connection->pool);
@@ -1352,6 +1736,13 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
               /* the child would't listen to the main server's socket */
               apr_socket_close(sock);
 
+              /* only the main server saves the cache snapshot */
+              if (cache_snapshot)
+                {
+                  apr_signal(SIGTERM, SIG_DFL);
+                  apr_signal(SIGINT, SIG_DFL);
+                }
+
               /* serve_socket() logs any error it returns, so ignore it. */
               svn_error_clear(serve_socket(connection, connection->pool));
               close_connection(connection);
@@ -1382,6 +1773,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 #endif
           break;
 
+        case connection_mode_event:
+          /* Handled by serve_events() above. */
+          break;
+
         case connection_mode_single:
           /* Serve one connection at a time. */
           /* serve_socket() logs any error it returns, so ignore it. */
@@ -1391,7 +1786,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       close_connection(connection);
     }
 
-  /* NOTREACHED */
+  /* We only get here upon a clean shutdown. */
+  apr_socket_close(sock);
+  return svn_error_trace(svn_cache__save_global_membuffer_cache(pool));
 }
 
 int
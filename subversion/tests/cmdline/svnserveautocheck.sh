@@ -39,6 +39,8 @@
 #  make svnserveautocheck BLOCK_READ=1       # run svnserve --block-read on
 #
 #  make svnserveautocheck THREADED=1         # run svnserve -T
+#
+#  make svnserveautocheck EVENT=1            # run svnserve --event
 
 PYTHON=${PYTHON:-python}
 
@@ -128,6 +130,10 @@ if [ "$THREADED" != "" ]; then
   SVNSERVE_ARGS="-T"
 fi
 
+if [ ${EVENT:+set} ]; then
+  SVNSERVE_ARGS="$SVNSERVE_ARGS --event"
+fi
+
 if [ ${CACHE_REVPROPS:+set} ]; then
   SVNSERVE_ARGS="$SVNSERVE_ARGS --cache-revprops on"
 fi
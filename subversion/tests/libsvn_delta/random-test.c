@@ -34,9 +34,14 @@
 #include "../svn_test.h"
 
 #include "svn_delta.h"
+#include "svn_dirent_uri.h"
 #include "svn_pools.h"
 #include "svn_error.h"
+#include "svn_sorts.h"
 
+#include "private/svn_delta_private.h"
+#include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
 
@@ -280,6 +285,13 @@ copy_tempfile(apr_file_t *fp, apr_pool_t *pool)
 
 
 
+/* Return the number of svndiff versions this build can write and read. */
+static int
+svndiff_version_count(void)
+{
+  return svn__zstd_available() ? 4 : 3;
+}
+
 /* (Note: *LAST_SEED is an output parameter.) */
 static svn_error_t *
 do_random_test(apr_pool_t *pool,
@@ -330,8 +342,9 @@ do_random_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
-                              i % 10, delta_pool);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream,
+                              i % svndiff_version_count(), i % 10,
+                              delta_pool);
 
       /* Make stage 1: create the text delta.  */
       svn_txdelta2(&txdelta_stream,
@@ -426,8 +439,9 @@ do_random_combine_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
-                              i % 10, delta_pool);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream,
+                              i % svndiff_version_count(), i % 10,
+                              delta_pool);
 
       /* Make stage 1: create the text deltas.  */
 
@@ -605,6 +619,312 @@ random_txdelta_to_svndiff_stream_test(apr_pool_t *pool)
   return err;
 }
 
+/* Size of the synthetic data used by xdelta_throughput_test. */
+#define THROUGHPUT_DATA_SIZE (4 * 1024 * 1024)
+
+/* Return a copy of SOURCE, allocated in POOL, with small random
+   modifications (insertions, deletions and replacements) spread across
+   the whole text.  Use and update SEED. */
+static svn_stringbuf_t *
+modify_text(const svn_stringbuf_t *source,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *target = svn_stringbuf_create_ensure(source->len, pool);
+  apr_size_t pos = 0;
+
+  while (pos < source->len)
+    {
+      apr_size_t chunk = 256 + svn_test_rand(seed) % 8192;
+      apr_size_t edit = svn_test_rand(seed) % 16;
+
+      if (chunk > source->len - pos)
+        chunk = source->len - pos;
+
+      svn_stringbuf_appendbytes(target, source->data + pos, chunk);
+      pos += chunk;
+
+      switch (svn_test_rand(seed) % 3)
+        {
+          case 0: /* insertion */
+            while (edit--)
+              svn_stringbuf_appendbyte(target,
+                                       (char)svn_test_rand(seed));
+            break;
+
+          case 1: /* deletion */
+            pos += edit;
+            break;
+
+          default: /* replacement */
+            for (; edit > 0 && pos < source->len; --edit, ++pos)
+              svn_stringbuf_appendbyte(target, (char)~source->data[pos]);
+            break;
+        }
+    }
+
+  return target;
+}
+
+/* Compute the txdelta between SOURCE and TARGET ITERATIONS times and
+   return the target throughput in MB/s in *MB_PER_SEC.
+   Use POOL for temporary allocations. */
+static svn_error_t *
+measure_xdelta_throughput(double *mb_per_sec,
+                          svn_stringbuf_t *source,
+                          svn_stringbuf_t *target,
+                          int iterations,
+                          apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_time_t start = apr_time_now();
+  apr_time_t duration;
+  int i;
+
+  for (i = 0; i < iterations; ++i)
+    {
+      svn_txdelta_stream_t *txdelta_stream;
+      svn_txdelta_window_t *window;
+
+      svn_pool_clear(iterpool);
+      svn_txdelta2(&txdelta_stream,
+                   svn_stream_from_stringbuf(source, iterpool),
+                   svn_stream_from_stringbuf(target, iterpool),
+                   FALSE, iterpool);
+
+      do
+        SVN_ERR(svn_txdelta_next_window(&window, txdelta_stream, iterpool));
+      while (window);
+    }
+
+  duration = apr_time_now() - start;
+  svn_pool_destroy(iterpool);
+
+  /* Avoid division by zero on very fast machines / coarse timers. */
+  if (duration == 0)
+    duration = 1;
+
+  *mb_per_sec = (double)target->len * iterations
+              / ((double)duration / APR_USEC_PER_SEC) / (1024.0 * 1024.0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the txdelta between SOURCE and TARGET reconstructs TARGET
+   when applied to SOURCE.  Use POOL for temporary allocations. */
+static svn_error_t *
+check_xdelta_roundtrip(svn_stringbuf_t *source,
+                       svn_stringbuf_t *target,
+                       apr_pool_t *pool)
+{
+  svn_txdelta_stream_t *txdelta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stringbuf_t *result = svn_stringbuf_create_empty(pool);
+
+  svn_txdelta2(&txdelta_stream,
+               svn_stream_from_stringbuf(source, pool),
+               svn_stream_from_stringbuf(target, pool),
+               FALSE, pool);
+  svn_txdelta_apply(svn_stream_from_stringbuf(source, pool),
+                    svn_stream_from_stringbuf(result, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  SVN_ERR(svn_txdelta_send_txstream(txdelta_stream, handler, handler_baton,
+                                    pool));
+
+  SVN_TEST_ASSERT(svn_stringbuf_compare(result, target));
+
+  return SVN_NO_ERROR;
+}
+
+/* Micro-benchmark for the xdelta engine.  Delta synthetic data as well
+   as one of our source files against slightly modified copies of
+   themselves.  Report the throughput in verbose mode. */
+static svn_error_t *
+xdelta_throughput_test(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0;
+  svn_stringbuf_t *source;
+  svn_stringbuf_t *target;
+  const char *srcdir;
+  double mb_per_sec;
+  apr_size_t i;
+
+  /* Synthetic, binary data that is almost incompressible but shows lots
+     of matches between source and target. */
+  source = svn_stringbuf_create_ensure(THROUGHPUT_DATA_SIZE, pool);
+  for (i = 0; i < THROUGHPUT_DATA_SIZE; ++i)
+    svn_stringbuf_appendbyte(source, (char)svn_test_rand(&seed));
+
+  target = modify_text(source, &seed, pool);
+  SVN_ERR(check_xdelta_roundtrip(source, target, pool));
+  SVN_ERR(measure_xdelta_throughput(&mb_per_sec, source, target, 4, pool));
+  if (opts->verbose)
+    printf("xdelta synthetic data: %.1f MB/s\n", mb_per_sec);
+
+  /* Real-world text. */
+  SVN_ERR(svn_test_get_srcdir(&srcdir, opts, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&source,
+                                   svn_dirent_join(srcdir, "random-test.c",
+                                                   pool),
+                                   pool));
+
+  target = modify_text(source, &seed, pool);
+  SVN_ERR(check_xdelta_roundtrip(source, target, pool));
+  SVN_ERR(measure_xdelta_throughput(&mb_per_sec, source, target, 200, pool));
+  if (opts->verbose)
+    printf("xdelta source code: %.1f MB/s\n", mb_per_sec);
+
+  return SVN_NO_ERROR;
+}
+
+/* Compare the optimized block checksum and match length functions used
+   by the xdelta engine with their portable / naive counterparts, at all
+   alignments and for lengths that are not multiples of the vector size. */
+static svn_error_t *
+xdelta_matcher_test(apr_pool_t *pool)
+{
+  enum { DATA_SIZE = 1024 };
+  apr_uint32_t seed = 0;
+  apr_size_t block_size = svn_txdelta__xdelta_block_size();
+  char *a = apr_palloc(pool, DATA_SIZE);
+  char *b = apr_palloc(pool, DATA_SIZE);
+  apr_size_t i;
+
+  for (i = 0; i < DATA_SIZE; ++i)
+    a[i] = (char)(svn_test_rand(&seed) >> 24);
+
+  /* Block checksums, including the worst case for overflows. */
+  for (i = 0; i + block_size <= DATA_SIZE; ++i)
+    {
+      apr_uint32_t checksum, portable_checksum;
+
+      svn_txdelta__xdelta_block_checksums(&checksum, &portable_checksum,
+                                          a + i);
+      SVN_TEST_ASSERT(checksum == portable_checksum);
+    }
+
+  memset(b, 0xff, DATA_SIZE);
+  for (i = 0; i < 17; ++i)
+    {
+      apr_uint32_t checksum, portable_checksum;
+
+      svn_txdelta__xdelta_block_checksums(&checksum, &portable_checksum,
+                                          b + i);
+      SVN_TEST_ASSERT(checksum == portable_checksum);
+    }
+
+  /* Forward and backward match lengths for all alignments, lengths and
+     positions of the first difference within a vector. */
+  for (i = 0; i < 200; ++i)
+    {
+      apr_size_t offset_a = svn_test_rand(&seed) % 17;
+      apr_size_t offset_b = svn_test_rand(&seed) % 17;
+      apr_size_t max_len = svn_test_rand(&seed) % (DATA_SIZE / 2 - 17);
+      apr_size_t diff = svn_test_rand(&seed) % (DATA_SIZE / 2 - 17);
+      apr_size_t expected = diff < max_len ? diff : max_len;
+      const char *end_a, *end_b;
+
+      memcpy(b + offset_b, a + offset_a, DATA_SIZE / 2);
+      b[offset_b + diff] = (char)~a[offset_a + diff];
+      SVN_TEST_INT_ASSERT(svn_cstring__match_length(a + offset_a,
+                                                    b + offset_b,
+                                                    max_len),
+                          expected);
+
+      /* Mirror image: the difference is DIFF bytes before the ends. */
+      end_a = a + offset_a + DATA_SIZE / 2;
+      end_b = b + offset_b + DATA_SIZE / 2;
+      memcpy(b + offset_b, a + offset_a, DATA_SIZE / 2);
+      b[offset_b + DATA_SIZE / 2 - 1 - diff]
+        = (char)~a[offset_a + DATA_SIZE / 2 - 1 - diff];
+      SVN_TEST_INT_ASSERT(svn_cstring__reverse_match_length(end_a, end_b,
+                                                            max_len),
+                          expected);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Push TARGET through a target-push delta stream against SOURCE and
+   return the resulting svndiff VERSION data in *SVNDIFF.  Use THREAD_COUNT
+   threads for deltification and compression.  Allocate it in POOL. */
+static svn_error_t *
+target_push_to_svndiff(svn_stringbuf_t **svndiff,
+                       svn_stringbuf_t *source,
+                       svn_stringbuf_t *target,
+                       int version,
+                       int thread_count,
+                       apr_pool_t *pool)
+{
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *push_stream;
+  apr_size_t pos, len;
+
+  *svndiff = svn_stringbuf_create_empty(pool);
+  SVN_ERR(svn_txdelta__to_svndiff_parallel(&handler, &handler_baton,
+                                           svn_stream_from_stringbuf(*svndiff,
+                                                                     pool),
+                                           version,
+                                           SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                                           NULL, thread_count, pool));
+  SVN_ERR(svn_txdelta__target_push_parallel(&push_stream,
+                                            handler, handler_baton,
+                                            svn_stream_from_stringbuf(source,
+                                                                      pool),
+                                            thread_count, pool));
+
+  /* Use odd chunk sizes to exercise the window buffering. */
+  for (pos = 0; pos < target->len; pos += len)
+    {
+      len = MIN(target->len - pos, 12345);
+      SVN_ERR(svn_stream_write(push_stream, target->data + pos, &len));
+    }
+
+  return svn_error_trace(svn_stream_close(push_stream));
+}
+
+/* Verify that concurrent deltification and svndiff encoding produce
+   exactly the same svndiff data as the single-threaded code. */
+static svn_error_t *
+parallel_target_push_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0;
+  svn_stringbuf_t *source;
+  svn_stringbuf_t *target;
+  svn_stringbuf_t *empty = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *expected;
+  svn_stringbuf_t *actual;
+  apr_size_t i;
+  int version;
+
+  source = svn_stringbuf_create_ensure(THROUGHPUT_DATA_SIZE, pool);
+  for (i = 0; i < THROUGHPUT_DATA_SIZE; ++i)
+    svn_stringbuf_appendbyte(source, (char)svn_test_rand(&seed));
+
+  target = modify_text(source, &seed, pool);
+
+  for (version = 0; version < svndiff_version_count(); ++version)
+    {
+      SVN_ERR(target_push_to_svndiff(&expected, source, target, version, 1,
+                                     pool));
+      SVN_ERR(target_push_to_svndiff(&actual, source, target, version, 4,
+                                     pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(expected, actual));
+
+      /* Same for an empty target. */
+      SVN_ERR(target_push_to_svndiff(&expected, source, empty, version, 1,
+                                     pool));
+      SVN_ERR(target_push_to_svndiff(&actual, source, empty, version, 4,
+                                     pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(expected, actual));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Change to 1 to enable the unit test for the delta combiner's range index: */
 #if 0
 #include "range-index-test.h"
@@ -625,6 +945,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random combine delta test"),
     SVN_TEST_PASS2(random_txdelta_to_svndiff_stream_test,
                    "random txdelta to svndiff stream test"),
+    SVN_TEST_OPTS_PASS(xdelta_throughput_test,
+                       "xdelta throughput benchmark"),
+    SVN_TEST_PASS2(xdelta_matcher_test,
+                   "xdelta checksums and match lengths"),
+    SVN_TEST_PASS2(parallel_target_push_test,
+                   "concurrent delta and svndiff encoding test"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
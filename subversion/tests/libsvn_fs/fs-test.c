@@ -35,6 +35,7 @@
 #include "svn_string.h"
 #include "svn_fs.h"
 #include "svn_checksum.h"
+#include "svn_dirent_uri.h"
 #include "svn_mergeinfo.h"
 #include "svn_props.h"
 #include "svn_version.h"
@@ -7441,6 +7442,98 @@ test_closest_copy_file_replaced_with_dir(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_file_contents_location(const svn_test_opts_t *opts,
+                            apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_fs_root_t *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  apr_file_t *file;
+  apr_off_t offset;
+  svn_filesize_t length;
+  const char *expected = "This is the file 'iota'.\n";
+  const char *name;
+  char buffer[100];
+  apr_off_t header_offset;
+  svn_boolean_t expect_plain = FALSE;
+
+  /* Prepare a filesystem. */
+  SVN_ERR(svn_test__create_fs(&fs, "test-file-contents-location",
+                              opts, pool));
+
+  /* Without compression, FSFS stores new files as PLAIN reps. */
+  if (strcmp(opts->fs_type, "fsfs") == 0
+      && (opts->server_minor_version == 0
+          || opts->server_minor_version >= 6))
+    {
+      SVN_ERR(svn_io_file_create(svn_dirent_join(svn_fs_path(fs, pool),
+                                                 "fsfs.conf", pool),
+                                 "[deltification]\n"
+                                 "compression = none\n",
+                                 pool));
+      SVN_ERR(svn_fs_open2(&fs, svn_fs_path(fs, pool), NULL, pool, pool));
+      expect_plain = TRUE;
+    }
+
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest_rev, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+
+  /* Uncommitted contents must not be handed out. */
+  SVN_ERR(svn_fs__file_contents_location(&file, &offset, &length,
+                                         txn_root, "/iota", pool, pool));
+  SVN_TEST_ASSERT(file == NULL);
+
+  SVN_ERR(test_commit_txn(&youngest_rev, txn, NULL, pool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, pool));
+
+  /* Only FSFS can provide the location. */
+  SVN_ERR(svn_fs__file_contents_location(&file, &offset, &length,
+                                         rev_root, "/iota", pool, pool));
+  if (!expect_plain)
+    {
+      SVN_TEST_ASSERT(file == NULL);
+      return SVN_NO_ERROR;
+    }
+
+  /* The range must be exactly the fulltext within r1's rev file, right
+     after the PLAIN rep header. */
+  SVN_TEST_ASSERT(file != NULL);
+  SVN_ERR(svn_io_file_name_get(&name, file, pool));
+  SVN_TEST_STRING_ASSERT(svn_dirent_basename(name, pool), "1");
+  SVN_TEST_INT_ASSERT(length, strlen(expected));
+
+  header_offset = offset - 6;
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &header_offset, pool));
+  SVN_ERR(svn_io_file_read_full2(file, buffer, (apr_size_t)length + 6,
+                                 NULL, NULL, pool));
+  buffer[length + 6] = '\0';
+  SVN_TEST_STRING_ASSERT(buffer,
+                         apr_pstrcat(pool, "PLAIN\n", expected,
+                                     SVN_VA_NULL));
+
+  /* Deltified contents have no such range. */
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest_rev, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      "This is the file 'iota'.\n"
+                                      "Now with a second line.\n", pool));
+  SVN_ERR(test_commit_txn(&youngest_rev, txn, NULL, pool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs__file_contents_location(&file, &offset, &length,
+                                         rev_root, "/iota", pool, pool));
+  SVN_TEST_ASSERT(file == NULL);
+
+  /* The PLAIN reps must read back normally as well. */
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, 1, pool));
+  SVN_ERR(svn_test__check_greek_tree(rev_root, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* ------------------------------------------------------------------------ */
 
 /* The test table.  */
@@ -7587,6 +7680,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test issue SVN-4677 regression"),
     SVN_TEST_OPTS_PASS(test_closest_copy_file_replaced_with_dir,
                        "svn_fs_closest_copy after replacing file with dir"),
+    SVN_TEST_OPTS_PASS(test_file_contents_location,
+                       "test svn_fs__file_contents_location"),
     SVN_TEST_NULL
   };
 
@@ -26,6 +26,7 @@
 
 #include "../svn_test.h"
 #include "../../libsvn_fs/fs-loader.h"
+#include "../../libsvn_fs_fs/cached_data.h"
 #include "../../libsvn_fs_fs/fs.h"
 #include "../../libsvn_fs_fs/fs_fs.h"
 #include "../../libsvn_fs_fs/low_level.h"
@@ -37,6 +38,7 @@
 #include "svn_props.h"
 #include "svn_fs.h"
 #include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
 
 #include "../svn_test_fs.h"
 
@@ -190,7 +192,7 @@ create_packed_filesystem(const char *dir,
   /* Now pack the FS */
   pnb.expected_shard = 0;
   pnb.expected_action = svn_fs_pack_notify_start;
-  return svn_fs_pack(dir, pack_notify, &pnb, NULL, NULL, pool);
+  return svn_fs_pack2(dir, NULL, pack_notify, &pnb, NULL, NULL, pool);
 }
 
 /* Create a packed FSFS filesystem for revprop tests at REPO_NAME with
@@ -225,7 +227,7 @@ prepare_revprop_repo(svn_fs_t **fs,
   svn_pool_destroy(subpool);
 
   /* Pack the repository. */
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -662,7 +664,7 @@ recover_fully_packed(const svn_test_opts_t *opts,
   SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, subpool));
   SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(after_rev));
   svn_pool_destroy(subpool);
-  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
   SVN_ERR(svn_fs_recover(REPO_NAME, NULL, NULL, pool));
 
   /* Now, delete the youngest revprop file, and recover again.  This
@@ -1001,7 +1003,7 @@ upgrade_txns_to_log_addressing(const svn_test_opts_t *opts,
   /* Pack repo to verify that old and new shard get packed according to
      their respective addressing mode */
 
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   /* verify that our changes got in */
 
@@ -1811,6 +1813,61 @@ pack_with_limited_memory(const svn_test_opts_t *opts,
 #undef MAX_REV
 #undef SHARD_SIZE
 
+/* ------------------------------------------------------------------------ */
+/* Pack multiple shards concurrently and check that the result is the same
+   as for sequential packing. */
+#define REPO_NAME "test-repo-pack-concurrently"
+#define SHARD_SIZE 4
+#define MAX_REV (10 * SHARD_SIZE + 1)
+static svn_error_t *
+pack_concurrently(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  struct pack_notify_baton pnb;
+  apr_hash_t *fs_config;
+  svn_fs_t *fs;
+  svn_fs_root_t *root;
+  svn_stringbuf_t *contents;
+  svn_revnum_t rev;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+
+  /* Notifications must still arrive in shard order. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_PACK_THREADS, "4");
+
+  pnb.expected_shard = 0;
+  pnb.expected_action = svn_fs_pack_notify_start;
+  SVN_ERR(svn_fs_pack2(REPO_NAME, fs_config, pack_notify, &pnb, NULL, NULL,
+                       pool));
+  SVN_TEST_ASSERT(pnb.expected_shard == (MAX_REV + 1) / SHARD_SIZE);
+
+  /* All shards are packed and the contents are still intact. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+
+  for (rev = 2; rev <= MAX_REV; ++rev)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_test__get_file_contents(root, "iota", &contents,
+                                          iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             get_rev_contents(rev, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
 /* ------------------------------------------------------------------------ */
 
 #define REPO_NAME "test-repo-large_delta_against_plain"
@@ -1887,8 +1944,262 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-zstd_dictionary"
+#define COPY_NAME "test-repo-zstd_dictionary-copy"
+
+static svn_error_t *
+zstd_dictionary(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *dict;
+  svn_stringbuf_t *contents;
+  svn_stringbuf_t *read_back;
+  apr_hash_t *fs_config;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+  if (!svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "built without zstd support");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_SVNDIFF3_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "zstd requires format 9 or higher");
+
+  /* Provide a raw content dictionary that matches our file closely. */
+  dict = svn_stringbuf_create_empty(pool);
+  for (i = 0; i < 200; ++i)
+    svn_stringbuf_appendcstr(dict,
+                             apr_psprintf(pool,
+                                          "This is line %d of the file.\n",
+                                          i));
+  SVN_ERR(svn_io_file_create_bytes(svn_dirent_join(REPO_NAME,
+                                                   PATH_ZSTD_DICTIONARY,
+                                                   pool),
+                                   dict->data, dict->len, pool));
+
+  /* Re-open the FS to pick up the dictionary and compress with it. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  ffd = fs->fsap_data;
+  SVN_TEST_ASSERT(ffd->zstd_dict && ffd->zstd_dict->len == dict->len);
+  ffd->delta_compression_type = compression_type_zstd;
+  ffd->delta_compression_level = SVN_FS_FS__ZSTD_DEFAULT_LEVEL;
+
+  contents = svn_stringbuf_create("A new first line.\n", pool);
+  svn_stringbuf_appendstr(contents, dict);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "f", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "f", contents->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* A hotcopy must bring the dictionary along to be readable. */
+  SVN_ERR(svn_io_remove_dir2(COPY_NAME, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(COPY_NAME);
+  SVN_ERR(svn_fs_hotcopy3(REPO_NAME, COPY_NAME, FALSE, FALSE, NULL, NULL,
+                          NULL, NULL, pool));
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, COPY_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "f", &read_back, pool));
+  SVN_TEST_STRING_ASSERT(read_back->data, contents->data);
+
+  /* Without it, the contents cannot be reconstructed. */
+  SVN_ERR(svn_io_remove_file2(svn_dirent_join(COPY_NAME,
+                                              PATH_ZSTD_DICTIONARY, pool),
+                              FALSE, pool));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, COPY_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_TEST_ASSERT_ANY_ERROR(svn_test__get_file_contents(root, "f",
+                                                        &read_back, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef COPY_NAME
+
+/* ------------------------------------------------------------------------ */
+/* Commit large files while deltifying them with several threads. */
+#define REPO_NAME "test-repo-delta_threads"
+#define REFERENCE_NAME "test-repo-delta_threads-reference"
+
+/* Create a repository named NAME with OPTS, committing two revisions of
+ * a large file with up to THREAD_COUNT delta threads.  Return the
+ * repository in *FS and the file contents of r1 and r2 in *CONTENTS1 and
+ * *CONTENTS2.  Use POOL for allocations. */
+static svn_error_t *
+commit_large_file(svn_fs_t **fs,
+                  svn_stringbuf_t **contents1,
+                  svn_stringbuf_t **contents2,
+                  const char *name,
+                  const svn_test_opts_t *opts,
+                  int thread_count,
+                  apr_pool_t *pool)
+{
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  int i;
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_DELTA_THREADS,
+                apr_itoa(pool, thread_count));
+  SVN_ERR(svn_test__create_fs2(fs, name, opts, fs_config, pool));
+
+  /* Several delta windows worth of data, with a few scattered changes
+     in the second version. */
+  *contents1 = svn_stringbuf_create_empty(pool);
+  *contents2 = svn_stringbuf_create_empty(pool);
+  for (i = 0; i < 20000; ++i)
+    {
+      const char *line = apr_psprintf(pool, "This is line %d of the file.\n",
+                                      i);
+      svn_stringbuf_appendcstr(*contents1, line);
+      svn_stringbuf_appendcstr(*contents2, i % 1000 ? line : "Changed.\n");
+    }
+
+  SVN_ERR(svn_fs_begin_txn(&txn, *fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "f", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "f", (*contents1)->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, *fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "f", (*contents2)->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+delta_threads(const svn_test_opts_t *opts,
+              apr_pool_t *pool)
+{
+  svn_fs_t *fs, *reference_fs;
+  fs_fs_data_t *ffd;
+  svn_fs_root_t *root;
+  svn_stringbuf_t *contents1, *contents2, *read_back;
+  svn_revnum_t rev;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  SVN_ERR(commit_large_file(&fs, &contents1, &contents2, REPO_NAME, opts,
+                            4, pool));
+  ffd = fs->fsap_data;
+  SVN_TEST_INT_ASSERT(ffd->delta_threads, 4);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, 1, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "f", &read_back, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(read_back, contents1));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, 2, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "f", &read_back, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(read_back, contents2));
+
+  /* Deltifying and compressing the windows in parallel must write the
+     very same revisions as doing it sequentially. */
+  SVN_ERR(commit_large_file(&reference_fs, &contents1, &contents2,
+                            REFERENCE_NAME, opts, 1, pool));
+  for (rev = 1; rev <= 2; ++rev)
+    {
+      const char *rev_path = svn_fs_fs__path_rev_absolute(fs, rev, pool);
+      const char *reference_path
+        = svn_fs_fs__path_rev_absolute(reference_fs, rev, pool);
+      svn_stringbuf_t *rev_contents, *reference_contents;
+
+      SVN_ERR(svn_stringbuf_from_file2(&rev_contents, rev_path, pool));
+      SVN_ERR(svn_stringbuf_from_file2(&reference_contents, reference_path,
+                                       pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(rev_contents,
+                                            reference_contents));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef REFERENCE_NAME
+
 
 
+/* ------------------------------------------------------------------------ */
+/* Check when block reads count as sequential and give read-ahead hints. */
+#define REPO_NAME "test-repo-block-read-sequence"
+static svn_error_t *
+block_read_sequence(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_fs__revision_file_t rev_file = { 0 };
+  svn_fs_fs__revision_file_t pack_file = { 0 };
+  apr_off_t size;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  size = ffd->block_size;
+
+  /* The non-packed r5 and the pack file that starts with it. */
+  rev_file.start_revision = 5;
+  pack_file.start_revision = 5;
+  pack_file.is_packed = TRUE;
+
+  /* Nothing to continue from. */
+  SVN_TEST_ASSERT(!svn_fs_fs__continues_block_read(fs, &rev_file, 0, size));
+
+  /* Following blocks and re-reading the last one are sequential. */
+  SVN_TEST_ASSERT(svn_fs_fs__continues_block_read(fs, &rev_file, size,
+                                                  2 * size));
+  SVN_TEST_ASSERT(svn_fs_fs__continues_block_read(fs, &rev_file, size,
+                                                  3 * size));
+  SVN_TEST_ASSERT(svn_fs_fs__continues_block_read(fs, &rev_file, 3 * size,
+                                                  4 * size));
+
+  /* Going backwards or skipping blocks is random access. */
+  SVN_TEST_ASSERT(!svn_fs_fs__continues_block_read(fs, &rev_file, 0, size));
+  SVN_TEST_ASSERT(!svn_fs_fs__continues_block_read(fs, &rev_file, 2 * size,
+                                                   3 * size));
+
+  /* The same offsets in a different file are random access as well. */
+  SVN_TEST_ASSERT(!svn_fs_fs__continues_block_read(fs, &pack_file, 3 * size,
+                                                   4 * size));
+  SVN_TEST_ASSERT(svn_fs_fs__continues_block_read(fs, &pack_file, 4 * size,
+                                                  5 * size));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -1942,6 +2253,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(pack_concurrently,
+                       "pack multiple shards concurrently"),
+    SVN_TEST_OPTS_PASS(zstd_dictionary,
+                       "compress with a zstd dictionary and hotcopy it"),
+    SVN_TEST_OPTS_PASS(delta_threads,
+                       "commit large files with several delta threads"),
+    SVN_TEST_OPTS_PASS(block_read_sequence,
+                       "detect sequential block reads"),
     SVN_TEST_NULL
   };
 
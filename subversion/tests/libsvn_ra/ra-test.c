@@ -36,6 +36,11 @@
 #include "svn_cmdline.h"
 #include "svn_dirent_uri.h"
 #include "svn_hash.h"
+#include "svn_config.h"
+#include "svn_path.h"
+#include "svn_repos.h"
+
+#include "private/svn_ra_private.h"
 
 #include "../svn_test.h"
 #include "../svn_test_fs.h"
@@ -142,6 +147,7 @@ typedef struct tunnel_baton_t
 {
   int magic; /* TUNNEL_MAGIC */
   int open_count;
+  int opened;
   svn_boolean_t last_check;
 } tunnel_baton_t;
 
@@ -232,6 +238,7 @@ open_tunnel(svn_stream_t **request, svn_stream_t **response,
   *close_func = close_tunnel;
   *close_baton = cb;
   ++b->open_count;
+  ++b->opened;
   return SVN_NO_ERROR;
 }
 
@@ -242,22 +249,24 @@ close_tunnel(void *tunnel_context, void *tunnel_baton)
 
   if (b->magic != CLOSE_MAGIC)
     abort();
-  if (--b->tb->open_count == 0)
-    {
-      apr_status_t child_exit_status;
-      int child_exit_code;
-      apr_exit_why_e child_exit_why;
+  --b->tb->open_count;
 
-      SVN_TEST_ASSERT_NO_RETURN(0 == apr_file_close(b->proc->in));
-      SVN_TEST_ASSERT_NO_RETURN(0 == apr_file_close(b->proc->out));
+  /* Sessions may open several tunnels, so wait for each of them. */
+  {
+    apr_status_t child_exit_status;
+    int child_exit_code;
+    apr_exit_why_e child_exit_why;
 
-      child_exit_status =
-        apr_proc_wait(b->proc, &child_exit_code, &child_exit_why, APR_WAIT);
+    SVN_TEST_ASSERT_NO_RETURN(0 == apr_file_close(b->proc->in));
+    SVN_TEST_ASSERT_NO_RETURN(0 == apr_file_close(b->proc->out));
 
-      SVN_TEST_ASSERT_NO_RETURN(child_exit_status == APR_CHILD_DONE);
-      SVN_TEST_ASSERT_NO_RETURN(child_exit_code == 0);
-      SVN_TEST_ASSERT_NO_RETURN(child_exit_why == APR_PROC_EXIT);
-    }
+    child_exit_status =
+      apr_proc_wait(b->proc, &child_exit_code, &child_exit_why, APR_WAIT);
+
+    SVN_TEST_ASSERT_NO_RETURN(child_exit_status == APR_CHILD_DONE);
+    SVN_TEST_ASSERT_NO_RETURN(child_exit_code == 0);
+    SVN_TEST_ASSERT_NO_RETURN(child_exit_why == APR_PROC_EXIT);
+  }
 }
 
 
@@ -620,6 +629,68 @@ get_dir_test(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Test svn_ra__get_dirs(). */
+static svn_error_t *
+get_dirs_test(const svn_test_opts_t *opts,
+              apr_pool_t *pool)
+{
+  svn_ra_session_t *session;
+  apr_array_header_t *paths;
+  apr_hash_t *dirents, *entries;
+  svn_dirent_t *ent;
+  int i;
+
+  SVN_ERR(make_and_open_repos(&session, "test-get-dirs", opts, pool));
+  SVN_ERR(commit_tree(session, pool));
+
+  /* Enough paths to fill more than one pipeline window. */
+  paths = apr_array_make(pool, 0, sizeof(const char *));
+  for (i = 0; i < 20; i++)
+    {
+      APR_ARRAY_PUSH(paths, const char *) = "A/B";
+      APR_ARRAY_PUSH(paths, const char *) = "A";
+      APR_ARRAY_PUSH(paths, const char *) = "A/BB";
+      APR_ARRAY_PUSH(paths, const char *) = "";
+    }
+
+  SVN_ERR(svn_ra__get_dirs(session, &dirents, paths, 1,
+                           SVN_DIRENT_KIND | SVN_DIRENT_CREATED_REV,
+                           pool, pool));
+  SVN_TEST_INT_ASSERT(apr_hash_count(dirents), 4);
+
+  entries = svn_hash_gets(dirents, "");
+  SVN_TEST_ASSERT(entries);
+  SVN_TEST_INT_ASSERT(apr_hash_count(entries), 1);
+  ent = svn_hash_gets(entries, "A");
+  SVN_TEST_ASSERT(ent && ent->kind == svn_node_dir);
+
+  entries = svn_hash_gets(dirents, "A");
+  SVN_TEST_ASSERT(entries);
+  SVN_TEST_INT_ASSERT(apr_hash_count(entries), 2);
+  SVN_TEST_ASSERT(svn_hash_gets(entries, "B"));
+  SVN_TEST_ASSERT(svn_hash_gets(entries, "BB"));
+
+  entries = svn_hash_gets(dirents, "A/BB");
+  SVN_TEST_ASSERT(entries);
+  SVN_TEST_INT_ASSERT(apr_hash_count(entries), 2);
+  ent = svn_hash_gets(entries, "g");
+  SVN_TEST_ASSERT(ent && ent->kind == svn_node_file);
+  SVN_TEST_INT_ASSERT(ent->created_rev, 1);
+
+  /* A failing request must not disturb the others nor the session. */
+  APR_ARRAY_PUSH(paths, const char *) = "non/existing/relpath";
+  APR_ARRAY_PUSH(paths, const char *) = "A/B";
+  SVN_TEST_ASSERT_ERROR(svn_ra__get_dirs(session, &dirents, paths, 1,
+                                         SVN_DIRENT_KIND, pool, pool),
+                        SVN_ERR_FS_NOT_FOUND);
+
+  SVN_ERR(svn_ra_get_dir2(session, &entries, NULL, NULL, "A/B", 1,
+                          SVN_DIRENT_KIND, pool));
+  SVN_TEST_INT_ASSERT(apr_hash_count(entries), 2);
+
+  return SVN_NO_ERROR;
+}
+
 /* Implements svn_commit_callback2_t for commit_callback_failure() */
 static svn_error_t *
 commit_callback_with_failure(const svn_commit_info_t *info,
@@ -1784,6 +1855,375 @@ commit_locked_file(const svn_test_opts_t *opts, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Edit baton for the update_skeleton test: records the full texts of
+   all files that an update or switch sends, applying the deltas to the
+   contents in BASE_ROOT. */
+typedef struct skel_edit_baton_t
+{
+  svn_fs_root_t *base_root;
+
+  /* Repository path that the edit is anchored at. */
+  const char *anchor;
+
+  /* If not NULL, the report linked LINK_FROM to LINK_TO (both relative
+     to the repository root). */
+  const char *link_from;
+  const char *link_to;
+
+  /* Relpath -> svn_stringbuf_t * with the resulting file contents. */
+  apr_hash_t *files;
+  apr_pool_t *pool;
+} skel_edit_baton_t;
+
+typedef struct skel_file_baton_t
+{
+  skel_edit_baton_t *eb;
+  const char *path;
+  svn_boolean_t added;
+  svn_stringbuf_t *contents;
+} skel_file_baton_t;
+
+/* Return the repository path that edit path PATH of EB maps to. */
+static const char *
+skel_repos_path(skel_edit_baton_t *eb,
+                const char *path,
+                apr_pool_t *result_pool)
+{
+  const char *relpath = svn_relpath_join(eb->anchor, path, result_pool);
+
+  if (eb->link_from)
+    {
+      const char *remainder = svn_relpath_skip_ancestor(eb->link_from,
+                                                        relpath);
+      if (remainder)
+        relpath = svn_relpath_join(eb->link_to, remainder, result_pool);
+    }
+
+  return relpath;
+}
+
+static svn_error_t *
+skel_open_root(void *edit_baton,
+               svn_revnum_t base_revision,
+               apr_pool_t *result_pool,
+               void **root_baton)
+{
+  *root_baton = edit_baton;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+skel_add_directory(const char *path,
+                   void *parent_baton,
+                   const char *copyfrom_path,
+                   svn_revnum_t copyfrom_revision,
+                   apr_pool_t *result_pool,
+                   void **child_baton)
+{
+  *child_baton = parent_baton;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+skel_open_directory(const char *path,
+                    void *parent_baton,
+                    svn_revnum_t base_revision,
+                    apr_pool_t *result_pool,
+                    void **child_baton)
+{
+  *child_baton = parent_baton;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+skel_add_file(const char *path,
+              void *parent_baton,
+              const char *copyfrom_path,
+              svn_revnum_t copyfrom_revision,
+              apr_pool_t *result_pool,
+              void **file_baton)
+{
+  skel_edit_baton_t *eb = parent_baton;
+  skel_file_baton_t *fb = apr_pcalloc(eb->pool, sizeof(*fb));
+
+  fb->eb = eb;
+  fb->path = apr_pstrdup(eb->pool, path);
+  fb->added = TRUE;
+  *file_baton = fb;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+skel_open_file(const char *path,
+               void *parent_baton,
+               svn_revnum_t base_revision,
+               apr_pool_t *result_pool,
+               void **file_baton)
+{
+  SVN_ERR(skel_add_file(path, parent_baton, NULL, SVN_INVALID_REVNUM,
+                        result_pool, file_baton));
+  ((skel_file_baton_t *)*file_baton)->added = FALSE;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+skel_apply_textdelta(void *file_baton,
+                     const char *base_checksum,
+                     apr_pool_t *result_pool,
+                     svn_txdelta_window_handler_t *handler,
+                     void **handler_baton)
+{
+  skel_file_baton_t *fb = file_baton;
+  skel_edit_baton_t *eb = fb->eb;
+  svn_stream_t *source;
+
+  if (fb->added)
+    source = svn_stream_empty(eb->pool);
+  else
+    SVN_ERR(svn_fs_file_contents(&source, eb->base_root,
+                                 skel_repos_path(eb, fb->path, eb->pool),
+                                 eb->pool));
+
+  fb->contents = svn_stringbuf_create_empty(eb->pool);
+  svn_txdelta_apply(source, svn_stream_from_stringbuf(fb->contents,
+                                                      eb->pool),
+                    NULL, fb->path, eb->pool, handler, handler_baton);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+skel_close_file(void *file_baton,
+                const char *text_checksum,
+                apr_pool_t *scratch_pool)
+{
+  skel_file_baton_t *fb = file_baton;
+
+  if (fb->contents)
+    svn_hash_sets(fb->eb->files, fb->path, fb->contents);
+  return SVN_NO_ERROR;
+}
+
+/* Update TARGET at ANCHOR from BASE_REV to HEAD of FS over a tunnel to
+   REPOS_URL with at most MAX_CONNECTIONS connections.  If LINK_FROM is
+   not NULL, report it as linked to LINK_TO@BASE_REV.  Return the
+   resulting file contents in *FILES and the number of tunnels opened in
+   *TUNNELS. */
+static svn_error_t *
+run_skeleton_update(apr_hash_t **files,
+                    int *tunnels,
+                    svn_fs_t *fs,
+                    const char *repos_url,
+                    const char *anchor,
+                    const char *target,
+                    svn_revnum_t base_rev,
+                    const char *link_from,
+                    const char *link_to,
+                    int max_connections,
+                    apr_pool_t *pool)
+{
+  tunnel_baton_t *tb = apr_pcalloc(pool, sizeof(*tb));
+  svn_ra_callbacks2_t *cbtable;
+  svn_ra_session_t *session;
+  apr_hash_t *config = apr_hash_make(pool);
+  svn_config_t *servers;
+  const svn_ra_reporter3_t *reporter;
+  void *report_baton;
+  svn_delta_editor_t *editor = svn_delta_default_editor(pool);
+  skel_edit_baton_t *eb = apr_pcalloc(pool, sizeof(*eb));
+
+  tb->magic = TUNNEL_MAGIC;
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  cbtable->check_tunnel_func = check_tunnel;
+  cbtable->open_tunnel_func = open_tunnel;
+  cbtable->tunnel_baton = tb;
+
+  SVN_ERR(svn_config_create2(&servers, FALSE, FALSE, pool));
+  svn_config_set(servers, SVN_CONFIG_SECTION_GLOBAL,
+                 SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS,
+                 apr_itoa(pool, max_connections));
+  svn_hash_sets(config, SVN_CONFIG_CATEGORY_SERVERS, servers);
+
+  SVN_ERR(svn_ra_open4(&session, NULL,
+                       svn_path_url_add_component2(repos_url, anchor, pool),
+                       NULL, cbtable, NULL, config, pool));
+
+  eb->anchor = anchor;
+  eb->link_from = link_from;
+  eb->link_to = link_to;
+  eb->files = apr_hash_make(pool);
+  eb->pool = pool;
+  SVN_ERR(svn_fs_revision_root(&eb->base_root, fs, base_rev, pool));
+
+  editor->open_root = skel_open_root;
+  editor->add_directory = skel_add_directory;
+  editor->open_directory = skel_open_directory;
+  editor->add_file = skel_add_file;
+  editor->open_file = skel_open_file;
+  editor->apply_textdelta = skel_apply_textdelta;
+  editor->close_file = skel_close_file;
+
+  SVN_ERR(svn_ra_do_update3(session, &reporter, &report_baton,
+                            SVN_INVALID_REVNUM, target,
+                            svn_depth_infinity, FALSE, FALSE,
+                            editor, eb, pool, pool));
+
+  SVN_ERR(reporter->set_path(report_baton, "", base_rev, svn_depth_infinity,
+                             FALSE, NULL, pool));
+  if (link_from)
+    SVN_ERR(reporter->link_path(report_baton,
+                                svn_relpath_skip_ancestor(anchor, link_from),
+                                svn_path_url_add_component2(repos_url,
+                                                            link_to, pool),
+                                base_rev, svn_depth_infinity, FALSE, NULL,
+                                pool));
+  SVN_ERR(reporter->finish_report(report_baton, pool));
+
+  *files = eb->files;
+  *tunnels = tb->opened;
+  return SVN_NO_ERROR;
+}
+
+/* Verify that FILES, as recorded by an update anchored at ANCHOR, match
+   HEAD_ROOT and contain the same paths as REFERENCE. */
+static svn_error_t *
+verify_skeleton_update(apr_hash_t *files,
+                       apr_hash_t *reference,
+                       const char *anchor,
+                       const char *link_from,
+                       const char *link_to,
+                       svn_fs_root_t *head_root,
+                       apr_pool_t *pool)
+{
+  skel_edit_baton_t eb = { 0 };
+  apr_hash_index_t *hi;
+
+  eb.anchor = anchor;
+  eb.link_from = link_from;
+  eb.link_to = link_to;
+
+  SVN_TEST_INT_ASSERT(apr_hash_count(files), apr_hash_count(reference));
+  for (hi = apr_hash_first(pool, files); hi; hi = apr_hash_next(hi))
+    {
+      const char *path = apr_hash_this_key(hi);
+      svn_stringbuf_t *contents = apr_hash_this_val(hi);
+      svn_stringbuf_t *expected;
+      svn_stream_t *stream;
+
+      SVN_TEST_ASSERT(svn_hash_gets(reference, path));
+      SVN_ERR(svn_fs_file_contents(&stream, head_root,
+                                   skel_repos_path(&eb, path, pool), pool));
+      SVN_ERR(svn_stringbuf_from_stream(&expected, stream, 0, pool));
+      SVN_TEST_STRING_ASSERT(contents->data, expected->data);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Check that updates using the ra_svn fetch editor give the same result
+   as updates that get the texts inline, also if the report switches a
+   subtree to a different URL. */
+static svn_error_t *
+update_skeleton(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  const char repos_name[] = "test-update-skeleton";
+  const char *repos_url;
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root, *head_root;
+  svn_revnum_t youngest_rev = 0;
+  apr_hash_t *files, *reference;
+  int tunnels;
+
+  if (strcmp(opts->fs_type, "bdb") == 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this test needs concurrent repository access");
+
+  SVN_ERR(svn_test__create_repos(&repos, repos_name, opts, pool));
+  fs = svn_repos_fs(repos);
+  repos_url = apr_pstrcat(pool, "svn+test://localhost/", repos_name,
+                          SVN_VA_NULL);
+
+  /* r1: greek tree */
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest_rev, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r2: copy A/D/G to G2 */
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest_rev, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_copy(rev_root, "A/D/G", txn_root, "G2", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "mu r2
+", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r3: change files in and outside of both A/D/G and G2 */
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest_rev, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "iota r3
+", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "mu r3
+", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/D/G/tau", "tau r3
+",
+                                      pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "G2/rho", "G2 rho r3
+",
+                                      pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "G2/new", "G2 new r3
+",
+                                      pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+  SVN_ERR(svn_fs_revision_root(&head_root, fs, youngest_rev, pool));
+
+  /* Plain update.  With a single connection, the client cannot use the
+     fetch editor, just like with servers that don't support it. */
+  SVN_ERR(run_skeleton_update(&reference, &tunnels, fs, repos_url, "", "",
+                              1, NULL, NULL, 1, pool));
+  SVN_TEST_INT_ASSERT(tunnels, 1);
+  SVN_TEST_ASSERT(svn_hash_gets(reference, "G2/new"));
+  SVN_ERR(verify_skeleton_update(reference, reference, "", NULL, NULL,
+                                 head_root, pool));
+  SVN_ERR(run_skeleton_update(&files, &tunnels, fs, repos_url, "", "",
+                              1, NULL, NULL, 4, pool));
+  SVN_TEST_ASSERT(tunnels > 1);
+  SVN_ERR(verify_skeleton_update(files, reference, "", NULL, NULL,
+                                 head_root, pool));
+
+  /* Update with A/D/G switched to G2.  The update follows the link, so
+     A/D/G must get G2's changes and not those of A/D/G. */
+  SVN_ERR(run_skeleton_update(&reference, &tunnels, fs, repos_url, "", "",
+                              2, "A/D/G", "G2", 1, pool));
+  SVN_TEST_INT_ASSERT(tunnels, 1);
+  SVN_TEST_ASSERT(svn_hash_gets(reference, "A/D/G/rho"));
+  SVN_TEST_ASSERT(svn_hash_gets(reference, "A/D/G/new"));
+  SVN_TEST_ASSERT(!svn_hash_gets(reference, "A/D/G/tau"));
+  SVN_ERR(verify_skeleton_update(reference, reference, "", "A/D/G", "G2",
+                                 head_root, pool));
+  SVN_ERR(run_skeleton_update(&files, &tunnels, fs, repos_url, "", "",
+                              2, "A/D/G", "G2", 4, pool));
+  SVN_TEST_INT_ASSERT(tunnels, 1);
+  SVN_ERR(verify_skeleton_update(files, reference, "", "A/D/G", "G2",
+                                 head_root, pool));
+
+  /* Update of a single file target. */
+  SVN_ERR(run_skeleton_update(&reference, &tunnels, fs, repos_url, "A",
+                              "mu", 1, NULL, NULL, 1, pool));
+  SVN_TEST_INT_ASSERT(apr_hash_count(reference), 1);
+  SVN_ERR(verify_skeleton_update(reference, reference, "A", NULL, NULL,
+                                 head_root, pool));
+  SVN_ERR(run_skeleton_update(&files, &tunnels, fs, repos_url, "A", "mu",
+                              1, NULL, NULL, 4, pool));
+  SVN_TEST_ASSERT(tunnels > 1);
+  SVN_ERR(verify_skeleton_update(files, reference, "A", NULL, NULL,
+                                 head_root, pool));
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -1802,6 +2242,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "lock multiple paths"),
     SVN_TEST_OPTS_PASS(get_dir_test,
                        "test ra_get_dir2"),
+    SVN_TEST_OPTS_PASS(get_dirs_test,
+                       "test ra__get_dirs"),
     SVN_TEST_OPTS_PASS(commit_callback_failure,
                        "commit callback failure"),
     SVN_TEST_OPTS_PASS(base_revision_above_youngest,
@@ -1820,6 +2262,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "check how last change applies to empty commit"),
     SVN_TEST_OPTS_PASS(commit_locked_file,
                        "check commit editor for a locked file"),
+    SVN_TEST_OPTS_PASS(update_skeleton,
+                       "compare updates with and without fetching texts"),
     SVN_TEST_NULL
   };
 
@@ -39,6 +39,9 @@
 #include "svn_props.h"
 #include "svn_sorts.h"
 #include "svn_version.h"
+#include "svn_time.h"
+#include "svn_dirent_uri.h"
+#include "svn_uuid.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_dep_compat.h"
 
@@ -4466,6 +4469,768 @@ test_list(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Baton for verify_notify. */
+typedef struct verify_notify_baton_t
+{
+  /* Next revision for which we expect a verify_rev_end notification. */
+  svn_revnum_t next_rev;
+
+  /* Set when we have received the verify_end notification. */
+  svn_boolean_t done;
+
+  /* Set when notifications arrived out of order. */
+  svn_boolean_t out_of_order;
+} verify_notify_baton_t;
+
+/* Implements svn_repos_notify_func_t.  Check the order of revision
+ * notifications during verification. */
+static void
+verify_notify(void *baton,
+              const svn_repos_notify_t *notify,
+              apr_pool_t *scratch_pool)
+{
+  verify_notify_baton_t *b = baton;
+
+  if (notify->action == svn_repos_notify_verify_rev_end)
+    {
+      if (b->done || notify->revision != b->next_rev)
+        b->out_of_order = TRUE;
+
+      b->next_rev = notify->revision + 1;
+    }
+  else if (notify->action == svn_repos_notify_verify_end)
+    {
+      b->done = TRUE;
+    }
+}
+
+static svn_error_t *
+test_verify_parallel(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  verify_notify_baton_t baton = { 0 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* Create a repository with more revisions than fit into a single
+   * verification task. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-verify-parallel",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  for (i = 0; i < 40; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(iterpool,
+                                                       "change %d\n", i),
+                                          iterpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Results must be reported in revision order. */
+  SVN_ERR(svn_repos_verify_fs4(repos, 0, youngest_rev, FALSE, FALSE, 4,
+                               verify_notify, &baton, NULL, NULL,
+                               NULL, NULL, pool));
+  SVN_TEST_ASSERT(!baton.out_of_order);
+  SVN_TEST_ASSERT(baton.done);
+  SVN_TEST_INT_ASSERT(baton.next_rev, youngest_rev + 1);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for verify_corrupted_callback and verify_corrupted_notify. */
+typedef struct verify_corrupted_baton_t
+{
+  /* The revision that we corrupted. */
+  svn_revnum_t corrupted_rev;
+
+  /* Number of failures reported. */
+  int errors;
+
+  /* Set when a failure got reported for an unexpected revision. */
+  svn_boolean_t unexpected;
+
+  /* Number of revisions that verified successfully. */
+  int verified;
+} verify_corrupted_baton_t;
+
+/* Implements svn_repos_verify_callback_t.  Count the failure and keep
+ * going. */
+static svn_error_t *
+verify_corrupted_callback(void *baton,
+                          svn_revnum_t revision,
+                          svn_error_t *verify_err,
+                          apr_pool_t *scratch_pool)
+{
+  verify_corrupted_baton_t *b = baton;
+
+  ++b->errors;
+  if (SVN_IS_VALID_REVNUM(revision) && revision != b->corrupted_rev)
+    b->unexpected = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_notify_func_t.  Count the verified revisions. */
+static void
+verify_corrupted_notify(void *baton,
+                        const svn_repos_notify_t *notify,
+                        apr_pool_t *scratch_pool)
+{
+  verify_corrupted_baton_t *b = baton;
+
+  if (notify->action == svn_repos_notify_verify_rev_end)
+    {
+      ++b->verified;
+      if (notify->revision == b->corrupted_rev)
+        b->unexpected = TRUE;
+    }
+}
+
+static svn_error_t *
+test_verify_parallel_corrupted(const svn_test_opts_t *opts,
+                               apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  verify_corrupted_baton_t baton = { 0 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  const char *rev_path;
+  svn_node_kind_t kind;
+  apr_file_t *file;
+  apr_off_t offset = 0;
+  apr_hash_t *fs_config;
+  char c;
+  int i;
+
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_FSFS) != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this test corrupts FSFS revision files");
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-verify-corrupted",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  for (i = 0; i < 40; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(iterpool,
+                                                       "change %d\n", i),
+                                          iterpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Overwrite the first byte of the youngest revision, which is the start
+   * of its first representation.  No other revision depends on it. */
+  baton.corrupted_rev = youngest_rev;
+  rev_path = svn_dirent_join_many(pool, svn_repos_path(repos, pool), "db",
+                                  "revs", "0",
+                                  apr_psprintf(pool, "%ld",
+                                               baton.corrupted_rev),
+                                  SVN_VA_NULL);
+  SVN_ERR(svn_io_check_path(rev_path, &kind, pool));
+  if (kind != svn_node_file)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "unexpected FSFS repository layout");
+
+  SVN_ERR(svn_io_file_open(&file, rev_path, APR_READ | APR_WRITE,
+                           APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_getc(&c, file, pool));
+  c = (c == 'X') ? 'Y' : 'X';
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+  SVN_ERR(svn_io_file_putc(c, file, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  /* Don't read the data from cache. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_repos_open3(&repos, svn_repos_path(repos, pool), fs_config,
+                          pool, pool));
+
+  /* Keep going and report the corrupted revision only. */
+  SVN_ERR(svn_repos_verify_fs4(repos, 0, youngest_rev, FALSE, FALSE, 4,
+                               verify_corrupted_notify, &baton,
+                               verify_corrupted_callback, &baton,
+                               NULL, NULL, pool));
+  SVN_TEST_ASSERT(baton.errors > 0);
+  SVN_TEST_ASSERT(!baton.unexpected);
+  SVN_TEST_INT_ASSERT(baton.verified, youngest_rev);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set the svn:date of REVISION in REPOS to TM, bypassing all hooks.
+ * If DIRECT is set, bypass the repos layer and with it the date index.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+set_rev_date(svn_repos_t *repos,
+             svn_revnum_t revision,
+             apr_time_t tm,
+             svn_boolean_t direct,
+             apr_pool_t *pool)
+{
+  const svn_string_t *date = svn_string_create(svn_time_to_cstring(tm, pool),
+                                               pool);
+
+  if (direct)
+    SVN_ERR(svn_fs_change_rev_prop2(svn_repos_fs(repos), revision,
+                                    SVN_PROP_REVISION_DATE, NULL, date,
+                                    pool));
+  else
+    SVN_ERR(svn_repos_fs_change_rev_prop4(repos, revision, NULL,
+                                          SVN_PROP_REVISION_DATE, NULL, date,
+                                          FALSE, FALSE, NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that svn_repos_dated_revision returns EXPECTED for TM in REPOS.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+check_dated_revision(svn_repos_t *repos,
+                     apr_time_t tm,
+                     svn_revnum_t expected,
+                     apr_pool_t *pool)
+{
+  svn_revnum_t revision;
+
+  SVN_ERR(svn_repos_dated_revision(&revision, repos, tm, pool));
+  SVN_TEST_INT_ASSERT(revision, expected);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_dated_revision_index(const svn_test_opts_t *opts,
+                          apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev = 0;
+  const apr_time_t base = apr_time_from_sec(1000000000);
+  const apr_time_t hour = apr_time_from_sec(3600);
+  const char *index_path;
+  svn_node_kind_t kind;
+  int i;
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-dated-revision-index",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+  index_path = svn_dirent_join(svn_repos_db_env(repos, pool), "rev-dates",
+                               pool);
+
+  /* Revision N will be N hours younger than BASE. */
+  SVN_ERR(set_rev_date(repos, 0, base, FALSE, pool));
+  for (i = 1; i <= 10; ++i)
+    {
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+      SVN_ERR(svn_fs_make_dir(txn_root, apr_psprintf(pool, "dir%d", i),
+                              pool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      pool));
+      SVN_ERR(set_rev_date(repos, youngest_rev, base + i * hour, FALSE,
+                           pool));
+    }
+
+  /* Lookups using the index. */
+  SVN_ERR(svn_io_check_path(index_path, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  SVN_ERR(check_dated_revision(repos, base - 1, 0, pool));
+  SVN_ERR(check_dated_revision(repos, base, 0, pool));
+  SVN_ERR(check_dated_revision(repos, base + 3 * hour - 1, 2, pool));
+  SVN_ERR(check_dated_revision(repos, base + 3 * hour, 3, pool));
+  SVN_ERR(check_dated_revision(repos, base + 3 * hour + 1, 3, pool));
+  SVN_ERR(check_dated_revision(repos, base + 10 * hour + 1, 10, pool));
+
+  /* A stale index must not produce wrong results. */
+  SVN_ERR(set_rev_date(repos, 5, base + 5 * hour + hour / 2, TRUE, pool));
+  SVN_ERR(check_dated_revision(repos, base + 5 * hour + hour / 4, 4, pool));
+  SVN_ERR(check_dated_revision(repos, base + 5 * hour + hour / 2, 5, pool));
+
+  /* Neither must a missing index. */
+  SVN_ERR(svn_io_remove_file2(index_path, FALSE, pool));
+  SVN_ERR(check_dated_revision(repos, base + 7 * hour, 7, pool));
+  SVN_ERR(check_dated_revision(repos, base + 5 * hour + hour / 4, 4, pool));
+
+  /* Rebuild the index and use it again. */
+  SVN_ERR(svn_repos__rebuild_indexes(repos, NULL, NULL, pool));
+  SVN_ERR(svn_io_check_path(index_path, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  SVN_ERR(check_dated_revision(repos, base + 5 * hour + hour / 4, 4, pool));
+  SVN_ERR(check_dated_revision(repos, base + 8 * hour + 1, 8, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Log receiver which appends the revision of every entry to the
+ * apr_array_header_t of svn_revnum_t in BATON. */
+static svn_error_t *
+log_revision_receiver(void *baton,
+                      svn_repos_log_entry_t *log_entry,
+                      apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *revisions = baton;
+
+  if (SVN_IS_VALID_REVNUM(log_entry->revision))
+    APR_ARRAY_PUSH(revisions, svn_revnum_t) = log_entry->revision;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the revisions reported by svn_repos_get_logs5 for PATH in REPOS,
+ * from its youngest revision down to 0, in *REVISIONS.  This includes
+ * merged revisions if INCLUDE_MERGED_REVISIONS is set.  Allocate the
+ * result in POOL. */
+static svn_error_t *
+get_log_revisions(apr_array_header_t **revisions,
+                  svn_repos_t *repos,
+                  const char *path,
+                  svn_boolean_t strict_node_history,
+                  svn_boolean_t include_merged_revisions,
+                  apr_pool_t *pool)
+{
+  apr_array_header_t *paths = apr_array_make(pool, 1, sizeof(const char *));
+
+  APR_ARRAY_PUSH(paths, const char *) = path;
+  *revisions = apr_array_make(pool, 8, sizeof(svn_revnum_t));
+
+  SVN_ERR(svn_repos_get_logs5(repos, paths, SVN_INVALID_REVNUM, 0, 0,
+                              strict_node_history, include_merged_revisions,
+                              NULL, NULL, NULL,
+                              NULL, NULL, log_revision_receiver, *revisions,
+                              pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the revision lists EXPECTED and ACTUAL for PATH match. */
+static svn_error_t *
+compare_log_revisions(const apr_array_header_t *expected,
+                      const apr_array_header_t *actual,
+                      const char *path,
+                      svn_boolean_t strict_node_history)
+{
+  int i;
+
+  for (i = 0; i < expected->nelts && i < actual->nelts; ++i)
+    if (   APR_ARRAY_IDX(expected, i, svn_revnum_t)
+        != APR_ARRAY_IDX(actual, i, svn_revnum_t))
+      break;
+
+  if (i != expected->nelts || i != actual->nelts)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Log of '%s' (strict=%d) differs at entry %d",
+                             path, strict_node_history, i);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_log_index(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  const char *index_path;
+  apr_array_header_t *indexed[2][5];
+  apr_array_header_t *revisions;
+  svn_node_kind_t kind;
+  int i, strict;
+  static const char *const paths[5]
+    = { "/B/mu", "/B", "/A/mu", "/B/D/G/rho", "/iota" };
+  static const svn_revnum_t b_mu_history[] = { 8, 6, 5, 2, 1 };
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-log-index", opts, pool));
+  fs = svn_repos_fs(repos);
+  index_path = svn_dirent_join(svn_repos_db_env(repos, pool), "log-index.db",
+                               pool);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 2:  Modify A/mu. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "r2", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 3:  Copy A to B. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "B", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 4:  Modify B/mu and iota. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "B/mu", "r4", subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "r4", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 5:  Modify A/mu. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "r5", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 6:  Replace B/mu with a copy of A/mu. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_delete(txn_root, "B/mu", subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "A/mu", txn_root, "B/mu", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 7:  Set a property on B. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "B", "prop",
+                                  svn_string_create("r7", subpool),
+                                  subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 8:  Modify B/mu. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "B/mu", "r8", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_destroy(subpool);
+
+  /* Logs using the index. */
+  SVN_ERR(svn_io_check_path(index_path, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  for (strict = 0; strict < 2; ++strict)
+    for (i = 0; i < 5; ++i)
+      SVN_ERR(get_log_revisions(&indexed[strict][i], repos, paths[i],
+                                strict, FALSE, pool));
+
+  revisions = indexed[0][0];
+  SVN_TEST_INT_ASSERT(revisions->nelts,
+                      sizeof(b_mu_history) / sizeof(b_mu_history[0]));
+  for (i = 0; i < revisions->nelts; ++i)
+    SVN_TEST_INT_ASSERT(APR_ARRAY_IDX(revisions, i, svn_revnum_t),
+                        b_mu_history[i]);
+
+  revisions = indexed[1][0];
+  SVN_TEST_INT_ASSERT(revisions->nelts, 2);
+  SVN_TEST_INT_ASSERT(APR_ARRAY_IDX(revisions, 1, svn_revnum_t), 6);
+
+  /* The node history must report exactly the same. */
+  SVN_ERR(svn_io_remove_file2(index_path, FALSE, pool));
+  for (strict = 0; strict < 2; ++strict)
+    for (i = 0; i < 5; ++i)
+      {
+        SVN_ERR(get_log_revisions(&revisions, repos, paths[i], strict,
+                                  FALSE, pool));
+        SVN_ERR(compare_log_revisions(revisions, indexed[strict][i],
+                                      paths[i], strict));
+      }
+
+  /* So must a rebuilt index. */
+  SVN_ERR(svn_repos__rebuild_indexes(repos, NULL, NULL, pool));
+  for (strict = 0; strict < 2; ++strict)
+    for (i = 0; i < 5; ++i)
+      {
+        SVN_ERR(get_log_revisions(&revisions, repos, paths[i], strict,
+                                  FALSE, pool));
+        SVN_ERR(compare_log_revisions(indexed[strict][i], revisions,
+                                      paths[i], strict));
+      }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_log_index_mergeinfo(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t youngest_rev = 0;
+  const char *index_path;
+  apr_array_header_t *indexed, *revisions;
+  int i;
+  static const svn_revnum_t b_history[] = { 5, 4, 2, 1 };
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-log-index-mergeinfo",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+  index_path = svn_dirent_join(svn_repos_db_env(repos, pool), "log-index.db",
+                               pool);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 2:  Branch A to B. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_copy(rev_root, "A", txn_root, "B", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 3:  Modify A/mu on trunk. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "r3", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 4:  Merge r3 into B. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "B/mu", "r3", subpool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "B", SVN_PROP_MERGEINFO,
+                                  svn_string_create("/A:3", subpool),
+                                  subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 5:  Reverse-merge r3 from B again. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "B/mu",
+                                      "This is the file 'mu'.\n", subpool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "B", SVN_PROP_MERGEINFO,
+                                  NULL, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_destroy(subpool);
+
+  /* Merged revisions using the index. */
+  SVN_ERR(get_log_revisions(&indexed, repos, "/B", FALSE, TRUE, pool));
+  SVN_ERR(get_log_revisions(&revisions, repos, "/B", FALSE, FALSE, pool));
+  SVN_TEST_INT_ASSERT(revisions->nelts,
+                      sizeof(b_history) / sizeof(b_history[0]));
+  for (i = 0; i < revisions->nelts; ++i)
+    SVN_TEST_INT_ASSERT(APR_ARRAY_IDX(revisions, i, svn_revnum_t),
+                        b_history[i]);
+
+  /* At least the merge of r3 in r4 must show up. */
+  SVN_TEST_ASSERT(indexed->nelts > revisions->nelts);
+
+  /* The filesystem must report exactly the same. */
+  SVN_ERR(svn_io_remove_file2(index_path, FALSE, pool));
+  SVN_ERR(get_log_revisions(&revisions, repos, "/B", FALSE, TRUE, pool));
+  SVN_ERR(compare_log_revisions(revisions, indexed, "/B", FALSE));
+
+  /* So must a rebuilt index. */
+  SVN_ERR(svn_repos__rebuild_indexes(repos, NULL, NULL, pool));
+  SVN_ERR(get_log_revisions(&revisions, repos, "/B", FALSE, TRUE, pool));
+  SVN_ERR(compare_log_revisions(indexed, revisions, "/B", FALSE));
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that CHUNKS as returned by svn_repos__get_blame match the
+   COUNT elements of EXPECTED. */
+static svn_error_t *
+check_blame(const apr_array_header_t *chunks,
+            const svn_repos__blame_chunk_t *expected,
+            int count)
+{
+  int i;
+
+  SVN_TEST_INT_ASSERT(chunks->nelts, count);
+  for (i = 0; i < count; ++i)
+    {
+      const svn_repos__blame_chunk_t *chunk
+        = &APR_ARRAY_IDX(chunks, i, svn_repos__blame_chunk_t);
+
+      SVN_TEST_ASSERT(chunk->start == expected[i].start);
+      SVN_TEST_INT_ASSERT(chunk->revision, expected[i].revision);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_get_blame(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev = 0;
+  apr_array_header_t *chunks;
+  svn_diff_file_options_t *diff_options;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  static const svn_repos__blame_chunk_t blame_r3[] =
+    { { 0, 2 }, { 1, 3 }, { 2, 2 } };
+  static const svn_repos__blame_chunk_t blame_r5[] =
+    { { 0, 5 }, { 1, 2 }, { 2, 3 }, { 3, 2 } };
+  static const svn_repos__blame_chunk_t blame_r3_r5[] =
+    { { 0, 5 }, { 1, SVN_INVALID_REVNUM }, { 2, 3 },
+      { 3, SVN_INVALID_REVNUM } };
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-get-blame", opts, pool));
+  fs = svn_repos_fs(repos);
+  diff_options = svn_diff_file_options_create(pool);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 2:  Replace all of iota. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      "one\ntwo\nthree\n", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 3:  Modify the second line. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      "one\nTWO\nthree\n", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  SVN_ERR(svn_repos__get_blame(&chunks, repos, "/iota", 1, youngest_rev,
+                               diff_options, 0, NULL, NULL, NULL, NULL,
+                               pool, pool));
+  SVN_ERR(check_blame(chunks, blame_r3, 3));
+
+  /* Revision 4:  Leave iota alone. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "r4\n", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_clear(subpool);
+
+  /* Revision 5:  Prepend a line.  This may extend the cached blame. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      "zero\none\nTWO\nthree\n", subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_destroy(subpool);
+
+  SVN_ERR(svn_repos__get_blame(&chunks, repos, "/iota", 1, youngest_rev,
+                               diff_options, 0, NULL, NULL, NULL, NULL,
+                               pool, pool));
+  SVN_ERR(check_blame(chunks, blame_r5, 4));
+
+  /* Again, now possibly from the cache. */
+  SVN_ERR(svn_repos__get_blame(&chunks, repos, "/iota", 1,
+                               SVN_INVALID_REVNUM, diff_options, 0,
+                               NULL, NULL, NULL, NULL, pool, pool));
+  SVN_ERR(check_blame(chunks, blame_r5, 4));
+
+  /* Older changes are not being attributed. */
+  SVN_ERR(svn_repos__get_blame(&chunks, repos, "/iota", 3, youngest_rev,
+                               diff_options, 0, NULL, NULL, NULL, NULL,
+                               pool, pool));
+  SVN_ERR(check_blame(chunks, blame_r3_r5, 4));
+
+  /* Intermediate revisions still report their own state. */
+  SVN_ERR(svn_repos__get_blame(&chunks, repos, "/iota", 1, 4,
+                               diff_options, 0, NULL, NULL, NULL, NULL,
+                               pool, pool));
+  SVN_ERR(check_blame(chunks, blame_r3, 3));
+
+  /* Directories have no blame. */
+  SVN_TEST_ASSERT_ERROR(svn_repos__get_blame(&chunks, repos, "/A", 1,
+                                             youngest_rev, diff_options,
+                                             0, NULL, NULL, NULL, NULL,
+                                             pool, pool),
+                        SVN_ERR_FS_NOT_FILE);
+
+  /* Texts above the size limit are refused. */
+  SVN_ERR(svn_repos__get_blame(&chunks, repos, "/iota", 3, youngest_rev,
+                               diff_options, 19, NULL, NULL, NULL, NULL,
+                               pool, pool));
+  SVN_TEST_ASSERT_ERROR(svn_repos__get_blame(&chunks, repos, "/iota", 3,
+                                             youngest_rev, diff_options,
+                                             18, NULL, NULL, NULL, NULL,
+                                             pool, pool),
+                        SVN_ERR_REPOS_BLAME_REFUSED);
+
+  /* Revision 6:  Declare iota binary, which gets it refused as well. */
+  subpool = svn_pool_create(pool);
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "iota", SVN_PROP_MIME_TYPE,
+                                  svn_string_create("application/octet-stream",
+                                                    subpool),
+                                  subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+  svn_pool_destroy(subpool);
+
+  SVN_TEST_ASSERT_ERROR(svn_repos__get_blame(&chunks, repos, "/iota", 1,
+                                             youngest_rev, diff_options,
+                                             0, NULL, NULL, NULL, NULL,
+                                             pool, pool),
+                        SVN_ERR_REPOS_BLAME_REFUSED);
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -4537,6 +5302,18 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "optional authz wildcard performance test"),
     SVN_TEST_OPTS_PASS(test_list,
                        "test svn_repos_list"),
+    SVN_TEST_OPTS_PASS(test_verify_parallel,
+                       "test svn_repos_verify_fs4 with multiple jobs"),
+    SVN_TEST_OPTS_PASS(test_verify_parallel_corrupted,
+                       "test parallel verification of a corrupted rev"),
+    SVN_TEST_OPTS_PASS(test_dated_revision_index,
+                       "test svn_repos_dated_revision with date index"),
+    SVN_TEST_OPTS_PASS(test_log_index,
+                       "test svn_repos_get_logs5 with changed-paths index"),
+    SVN_TEST_OPTS_PASS(test_log_index_mergeinfo,
+                       "test svn_repos_get_logs5 -g with log index"),
+    SVN_TEST_OPTS_PASS(test_get_blame,
+                       "test svn_repos__get_blame"),
     SVN_TEST_NULL
   };
 
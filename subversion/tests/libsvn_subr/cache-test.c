@@ -26,7 +26,13 @@
 #include <apr_general.h>
 #include <apr_lib.h>
 #include <apr_time.h>
+#include <apr_thread_proc.h>
 
+#if APR_HAS_FORK
+#include <unistd.h>
+#endif
+
+#include "svn_io.h"
 #include "svn_pools.h"
 
 #include "private/svn_cache.h"
@@ -590,7 +596,645 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS
+
+/* Baton for concurrent_cache_access. */
+typedef struct concurrency_baton_t
+{
+  /* Cache backend shared by all threads. */
+  svn_membuffer_t *membuffer;
+
+  /* Seed for the random key selection.  Unique per thread. */
+  apr_uint32_t seed;
+
+  /* Error returned by the thread, if any. */
+  svn_error_t *err;
+} concurrency_baton_t;
+
+/* Number of different keys used in the concurrency test. */
+#define CONCURRENCY_KEY_COUNT 1000
+
+/* Return the value that we store for KEY_INDEX in the concurrency test.
+ * The sizes vary such that data gets shifted and evicted frequently. */
+static svn_stringbuf_t *
+concurrency_test_value(int key_index,
+                       apr_pool_t *pool)
+{
+  apr_size_t len = (key_index * 37) % 3000;
+  svn_stringbuf_t *value = svn_stringbuf_create_ensure(len, pool);
+
+  svn_stringbuf_appendfill(value, (char)('a' + key_index % 26), len);
+  return value;
+}
+
+/* Randomly read and write the membuffer cache in BATON and verify that
+ * all data read is consistent. */
+static svn_error_t *
+concurrent_cache_access(concurrency_baton_t *baton,
+                        apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_cache__t *cache;
+  int i;
+
+  /* Each thread has its own front-end but they share the same backend
+   * and key space. */
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, baton->membuffer,
+                                            NULL, NULL,
+                                            APR_HASH_KEY_STRING,
+                                            "concurrency:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  for (i = 0; i < 20000; ++i)
+    {
+      int key_index = (svn_test_rand(&baton->seed) >> 8)
+                    % CONCURRENCY_KEY_COUNT;
+      const char *key;
+      svn_stringbuf_t *expected;
+
+      svn_pool_clear(iterpool);
+      key = apr_psprintf(iterpool, "key %d", key_index);
+      expected = concurrency_test_value(key_index, iterpool);
+
+      if ((svn_test_rand(&baton->seed) >> 8) % 4 == 0)
+        {
+          SVN_ERR(svn_cache__set(cache, key, expected, iterpool));
+        }
+      else
+        {
+          svn_stringbuf_t *value;
+          svn_boolean_t found;
+
+          SVN_ERR(svn_cache__get((void **)&value, &found, cache, key,
+                                 iterpool));
+          if (found && !svn_stringbuf_compare(value, expected))
+            return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                     "inconsistent cache data for '%s'",
+                                     key);
+
+          SVN_ERR(svn_cache__has_key(&found, cache, key, iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static void *
+APR_THREAD_FUNC concurrency_thread_func(apr_thread_t *tid, void *data)
+{
+  concurrency_baton_t *baton = data;
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  baton->err = concurrent_cache_access(baton, pool);
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+#endif
+
+static svn_error_t *
+test_membuffer_cache_concurrency(apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  enum { THREAD_COUNT = 8 };
+  svn_membuffer_t *membuffer;
+  apr_thread_t *threads[THREAD_COUNT];
+  concurrency_baton_t batons[THREAD_COUNT];
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  /* Small enough for frequent evictions, with 2 segments. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024 * 1024, 0, 2,
+                                            TRUE, TRUE, pool));
+
+  for (i = 0; i < THREAD_COUNT; ++i)
+    {
+      apr_status_t status;
+
+      batons[i].membuffer = membuffer;
+      batons[i].seed = i;
+      batons[i].err = SVN_NO_ERROR;
+
+      status = apr_thread_create(&threads[i], NULL, concurrency_thread_func,
+                                 &batons[i], pool);
+      if (status)
+        return svn_error_wrap_apr(status, NULL);
+    }
+
+  /* wait for the threads to finish */
+  for (i = 0; i < THREAD_COUNT; ++i)
+    {
+      apr_status_t retval;
+      apr_status_t status = apr_thread_join(&retval, threads[i]);
+      if (status)
+        return svn_error_wrap_apr(status, NULL);
+
+      err = svn_error_compose_create(err, batons[i].err);
+    }
+
+  SVN_ERR(err);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+
+static svn_error_t *
+test_membuffer_shared_cache(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer1, *membuffer2, *membuffer3;
+  svn_cache__t *cache1, *cache2;
+  svn_revnum_t twenty = 20, *answer;
+  svn_boolean_t found;
+  const char *name = apr_psprintf(pool, "svn-cache-test-%" APR_TIME_T_FMT,
+                                  apr_time_now());
+  const char *long_key = "a key that is longer than 16 bytes";
+  svn_error_t *err;
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer1, name,
+                                                 1024 * 1024, 0, 2, TRUE,
+                                                 pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, err,
+                            "shared memory caches not supported");
+  SVN_ERR(err);
+
+  /* Attaching a second time is what other processes would do. */
+  err = svn_cache__membuffer_cache_create_shared(&membuffer2, name,
+                                                 1024 * 1024, 0, 2, TRUE,
+                                                 pool);
+
+  /* Attaching with a different size must fail. */
+  if (!err)
+    {
+      err = svn_cache__membuffer_cache_create_shared(&membuffer3, name,
+                                                     2 * 1024 * 1024, 0, 2,
+                                                     TRUE, pool);
+      if (err && err->apr_err == SVN_ERR_INCORRECT_PARAMS)
+        {
+          svn_error_clear(err);
+          err = SVN_NO_ERROR;
+        }
+      else if (!err)
+        {
+          err = svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                                 "incompatible shared cache accepted");
+        }
+    }
+
+  /* Existing mappings remain valid.  Don't leave the region behind. */
+  SVN_ERR(svn_error_compose_create(
+            err, svn_cache__membuffer_remove_shared(name, pool)));
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache1, membuffer1,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache2, membuffer2,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  /* Data written through one mapping must be visible through the other. */
+  SVN_ERR(svn_cache__set(cache1, "twenty", &twenty, pool));
+  SVN_ERR(svn_cache__set(cache1, long_key, &twenty, pool));
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache2, "twenty", pool));
+  SVN_TEST_ASSERT(found && *answer == 20);
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache2, long_key, pool));
+  SVN_TEST_ASSERT(found && *answer == 20);
+
+  /* Clearing affects all mappings. */
+  SVN_ERR(svn_cache__membuffer_clear(membuffer2));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache1, "twenty", pool));
+  SVN_TEST_ASSERT(!found);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_FORK
+
+/* Attach to the single-segment shared memory cache NAME, creating it if
+ * necessary, and return a revnum cache for it in *CACHE. */
+static svn_error_t *
+open_shared_revnum_cache(svn_cache__t **cache,
+                         const char *name,
+                         svn_boolean_t allow_blocking_writes,
+                         apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+
+  SVN_ERR(svn_cache__membuffer_cache_create_shared(&membuffer, name,
+                                                   1024 * 1024, 0, 1,
+                                                   allow_blocking_writes,
+                                                   pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Wait for the child process PROC and verify that it exited normally. */
+static svn_error_t *
+wait_for_child(apr_proc_t *proc)
+{
+  int exitcode;
+  apr_exit_why_e why;
+  apr_status_t status = apr_proc_wait(proc, &exitcode, &why, APR_WAIT);
+
+  if (status != APR_CHILD_DONE)
+    return svn_error_wrap_apr(status, "apr_proc_wait");
+
+  SVN_TEST_ASSERT(APR_PROC_CHECK_EXIT(why) && exitcode == 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* The part of test_membuffer_shared_cache_fork that needs NAME to be
+ * removed afterwards. */
+static svn_error_t *
+shared_cache_fork_body(const char *name,
+                       apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_revnum_t *answer;
+  svn_boolean_t found;
+  apr_proc_t proc;
+  apr_status_t status;
+
+  SVN_ERR(open_shared_revnum_cache(&cache, name, TRUE, pool));
+
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      /* Attach on our own, like a newly started worker process would. */
+      svn_cache__t *child_cache;
+      svn_revnum_t value = 42;
+      svn_error_t *err = open_shared_revnum_cache(&child_cache, name, TRUE,
+                                                  pool);
+      if (!err)
+        err = svn_cache__set(child_cache, "from child", &value, pool);
+
+      _exit(err ? 1 : 0);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "apr_proc_fork");
+
+  SVN_ERR(wait_for_child(&proc));
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "from child",
+                         pool));
+  SVN_TEST_ASSERT(found && *answer == 42);
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+static svn_error_t *
+test_membuffer_shared_cache_fork(apr_pool_t *pool)
+{
+#if APR_HAS_FORK
+  const char *name = apr_psprintf(pool, "svn-cache-test-fork-%"
+                                  APR_TIME_T_FMT, apr_time_now());
+  svn_membuffer_t *membuffer;
+  svn_error_t *err;
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, name,
+                                                 1024 * 1024, 0, 1, TRUE,
+                                                 pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, err,
+                            "shared memory caches not supported");
+  if (!err)
+    err = shared_cache_fork_body(name, pool);
+
+  return svn_error_compose_create(
+           err, svn_cache__membuffer_remove_shared(name, pool));
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "fork() not supported");
+#endif
+}
+
+#if APR_HAS_FORK
+
+/* Implements svn_cache__partial_getter_func_t.  Terminate the process
+ * while the cache segment lock is being held. */
+static svn_error_t *
+exit_while_locked(void **out,
+                  const void *data,
+                  apr_size_t data_len,
+                  void *baton,
+                  apr_pool_t *result_pool)
+{
+  _exit(0);
+
+  /* Not reached. */
+  return SVN_NO_ERROR;
+}
+
+/* The part of test_membuffer_shared_cache_owner_died that needs NAME to
+ * be removed afterwards. */
+static svn_error_t *
+shared_cache_owner_died_body(const char *name,
+                             apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_revnum_t one = 1, two = 2, three = 3, *answer;
+  svn_boolean_t found;
+  apr_proc_t proc;
+  apr_status_t status;
+
+  /* Never block on the segment lock.  If recovery does not work, we want
+   * this test to fail instead of to hang. */
+  SVN_ERR(open_shared_revnum_cache(&cache, name, FALSE, pool));
+  SVN_ERR(svn_cache__set(cache, "one", &one, pool));
+  SVN_ERR(svn_cache__set(cache, "two", &two, pool));
+
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      void *value;
+      svn_error_t *err = svn_cache__get_partial(&value, &found, cache, "one",
+                                                exit_while_locked, NULL,
+                                                pool);
+
+      /* Only reached if the entry has not been found. */
+      _exit(err ? 1 : 2);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "apr_proc_fork");
+
+  SVN_ERR(wait_for_child(&proc));
+
+  /* The child died while holding the lock of our only segment.  The next
+   * writer must recover the lock and reset the possibly corrupted segment. */
+  SVN_ERR(svn_cache__set(cache, "three", &three, pool));
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "two", pool));
+  SVN_TEST_ASSERT(!found);
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "three", pool));
+  SVN_TEST_ASSERT(found && *answer == 3);
+
+  /* The lock must be fully usable again. */
+  SVN_ERR(svn_cache__set(cache, "two", &two, pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "two", pool));
+  SVN_TEST_ASSERT(found && *answer == 2);
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+static svn_error_t *
+test_membuffer_shared_cache_owner_died(apr_pool_t *pool)
+{
+#if APR_HAS_FORK
+  const char *name = apr_psprintf(pool, "svn-cache-test-died-%"
+                                  APR_TIME_T_FMT, apr_time_now());
+  svn_membuffer_t *membuffer;
+  svn_error_t *err;
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, name,
+                                                 1024 * 1024, 0, 1, FALSE,
+                                                 pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, err,
+                            "shared memory caches not supported");
+  if (!err)
+    err = shared_cache_owner_died_body(name, pool);
+
+  return svn_error_compose_create(
+           err, svn_cache__membuffer_remove_shared(name, pool));
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "fork() not supported");
+#endif
+}
+
 
+static svn_error_t *
+test_membuffer_snapshot(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *fixed_cache, *string_cache;
+  svn_revnum_t value, *answer;
+  svn_boolean_t found;
+  const char *path = "cache-test-snapshot";
+  const char *fixed_key = "12345678";
+  const char *long_key = "a key that is longer than 16 bytes";
+  int i;
+
+  SVN_ERR(svn_io_remove_file2(path, TRUE, pool));
+
+  /* Fill a cache using both key types. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024 * 1024,
+                                            64 * 1024, 2,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&fixed_cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            8 /* klen*/,
+                                            "snapshot-fixed:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&string_cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "snapshot-string:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  for (i = 0; i < 100; ++i)
+    {
+      value = i;
+      SVN_ERR(svn_cache__set(string_cache, apr_psprintf(pool, "%d", i),
+                             &value, pool));
+    }
+
+  value = 42;
+  SVN_ERR(svn_cache__set(fixed_cache, fixed_key, &value, pool));
+  SVN_ERR(svn_cache__set(string_cache, long_key, &value, pool));
+
+  SVN_ERR(svn_cache__membuffer_save(membuffer, path, pool));
+
+  /* Load the snapshot into a fresh cache with a different geometry. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 2 * 1024 * 1024,
+                                            64 * 1024, 4, TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_load(membuffer, path, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&fixed_cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            8 /* klen*/,
+                                            "snapshot-fixed:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&string_cache, membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "snapshot-string:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, fixed_cache, fixed_key,
+                         pool));
+  SVN_TEST_ASSERT(found && *answer == 42);
+  SVN_ERR(svn_cache__get((void **) &answer, &found, string_cache, long_key,
+                         pool));
+  SVN_TEST_ASSERT(found && *answer == 42);
+
+  for (i = 0; i < 100; ++i)
+    {
+      SVN_ERR(svn_cache__get((void **) &answer, &found, string_cache,
+                             apr_psprintf(pool, "%d", i), pool));
+      SVN_TEST_ASSERT(found && *answer == i);
+    }
+
+  /* Foreign files must be ignored. */
+  SVN_ERR(svn_io_file_create(path, "not a cache snapshot", pool));
+  SVN_ERR(svn_cache__membuffer_clear(membuffer));
+  SVN_ERR(svn_cache__membuffer_load(membuffer, path, pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, fixed_cache, fixed_key,
+                         pool));
+  SVN_TEST_ASSERT(!found);
+
+  /* Missing files are an error. */
+  SVN_ERR(svn_io_remove_file2(path, FALSE, pool));
+  SVN_TEST_ASSERT_ANY_ERROR(svn_cache__membuffer_load(membuffer, path,
+                                                      pool));
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Access a working set of HOT_COUNT keys repeatedly in a membuffer cache
+ * using POLICY, then read SCAN_COUNT other keys, each one twice in a row,
+ * as e.g. an export would do.  Return the number of working set entries
+ * still in cache in *REMAINING and the cache statistics in *INFO.  Use
+ * POOL for allocations.
+ */
+static svn_error_t *
+run_scan(int *remaining,
+         svn_cache__info_t *info,
+         svn_cache__membuffer_policy_t policy,
+         int hot_count,
+         int scan_count,
+         apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  svn_stringbuf_t *value = svn_stringbuf_create_ensure(4000, pool);
+  svn_stringbuf_t *answer;
+  svn_boolean_t found;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i, k;
+
+  svn_stringbuf_appendfill(value, 'x', 4000);
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024 * 1024,
+                                            64 * 1024, 1, TRUE, TRUE, pool));
+  svn_cache__membuffer_set_policy(membuffer, policy);
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer, NULL, NULL,
+                                            APR_HASH_KEY_STRING, "scan:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE, FALSE, pool, pool));
+
+  /* Establish the working set.  Read-through as the FS layer does. */
+  for (k = 0; k < 5; ++k)
+    for (i = 0; i < hot_count; ++i)
+      {
+        const char *key;
+
+        svn_pool_clear(iterpool);
+        key = apr_psprintf(iterpool, "hot %d", i);
+        SVN_ERR(svn_cache__get((void **)&answer, &found, cache, key,
+                               iterpool));
+        if (!found)
+          SVN_ERR(svn_cache__set(cache, key, value, iterpool));
+      }
+
+  /* One large scan. */
+  for (i = 0; i < scan_count; ++i)
+    {
+      const char *key;
+
+      svn_pool_clear(iterpool);
+      key = apr_psprintf(iterpool, "scan %d", i);
+      SVN_ERR(svn_cache__get((void **)&answer, &found, cache, key,
+                             iterpool));
+      if (!found)
+        SVN_ERR(svn_cache__set(cache, key, value, iterpool));
+
+      /* The scanned data gets used once more right away.  Once aged,
+       * hot entries would lose against such entries under the default
+       * policy. */
+      SVN_ERR(svn_cache__get((void **)&answer, &found, cache, key,
+                             iterpool));
+    }
+
+  *remaining = 0;
+  for (i = 0; i < hot_count; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_cache__has_key(&found, cache,
+                                 apr_psprintf(iterpool, "hot %d", i),
+                                 iterpool));
+      if (found)
+        ++*remaining;
+    }
+
+  SVN_ERR(svn_cache__get_info(cache, info, FALSE, pool));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_tinylfu_scan(apr_pool_t *pool)
+{
+  enum { HOT_COUNT = 100, SCAN_COUNT = 1000 };
+  svn_cache__info_t info;
+  int remaining;
+  int default_remaining;
+
+  SVN_ERR(run_scan(&remaining, &info, svn_cache__membuffer_policy_tinylfu,
+                   HOT_COUNT, SCAN_COUNT, pool));
+
+  /* The scan did not fit into the cache but must not have replaced the
+   * working set. */
+  SVN_TEST_ASSERT(info.evictions + info.rejections > 0);
+  SVN_TEST_ASSERT(remaining >= HOT_COUNT * 9 / 10);
+
+  /* The same access pattern under the default policy. */
+  SVN_ERR(run_scan(&default_remaining, &info,
+                   svn_cache__membuffer_policy_default,
+                   HOT_COUNT, SCAN_COUNT, pool));
+  SVN_TEST_ASSERT(info.evictions + info.rejections > 0);
+
+  /* TinyLFU must give us a better hit rate on the working set. */
+  SVN_TEST_ASSERT(remaining > default_remaining);
+
+  return SVN_NO_ERROR;
+}
+
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -616,6 +1260,19 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_SKIP2(test_membuffer_cache_concurrency,
+                   ! APR_HAS_THREADS,
+                   "test concurrent membuffer cache access"),
+    SVN_TEST_PASS2(test_membuffer_shared_cache,
+                   "test membuffer cache in shared memory"),
+    SVN_TEST_PASS2(test_membuffer_shared_cache_fork,
+                   "test shared memory cache across processes"),
+    SVN_TEST_PASS2(test_membuffer_shared_cache_owner_died,
+                   "test recovery from a process dying in the cache"),
+    SVN_TEST_PASS2(test_membuffer_snapshot,
+                   "test saving and loading membuffer cache snapshots"),
+    SVN_TEST_PASS2(test_membuffer_tinylfu_scan,
+                   "test scan resistance of the TinyLFU cache policy"),
     SVN_TEST_NULL
   };
 
@@ -21,10 +21,150 @@
  * ====================================================================
  */
 
+#include <apr_time.h>
+
 #include "svn_pools.h"
 #include "private/svn_subr_private.h"
 #include "../svn_test.h"
 
+#include "svn_private_config.h"
+
+#ifdef SVN_HAVE_ZSTD
+#include <zdict.h>
+#endif
+
+/* Size of the largest sample used for round-trip and throughput tests.
+   This is about the size of the largest svndiff window section. */
+#define SAMPLE_SIZE (200 * 1024)
+
+/* Compression algorithms used in svndiff. */
+typedef enum algorithm_t
+{
+  algorithm_zlib,
+  algorithm_lz4,
+  algorithm_zstd
+} algorithm_t;
+
+/* Compression method, i.e. algorithm and level, under test. */
+typedef struct compressor_t
+{
+  /* Name to show in benchmark results. */
+  const char *name;
+
+  /* Algorithm to use. */
+  algorithm_t algorithm;
+
+  /* Compression level.  Ignored for LZ4. */
+  int level;
+} compressor_t;
+
+/* All compression methods that we can use in svndiff. */
+static const compressor_t compressors[] =
+{
+  { "zlib-0", algorithm_zlib, SVN__COMPRESSION_NONE },
+  { "zlib-1", algorithm_zlib, SVN__COMPRESSION_ZLIB_MIN },
+  { "zlib-5", algorithm_zlib, SVN__COMPRESSION_ZLIB_DEFAULT },
+  { "zlib-9", algorithm_zlib, SVN__COMPRESSION_ZLIB_MAX },
+  { "lz4", algorithm_lz4, 0 },
+  { "zstd-1", algorithm_zstd, 1 },
+  { "zstd-3", algorithm_zstd, 3 },
+  { "zstd-19", algorithm_zstd, 19 }
+};
+
+/* Return TRUE if COMPRESSOR can be used with this build. */
+static svn_boolean_t
+is_available(const compressor_t *compressor)
+{
+  return compressor->algorithm != algorithm_zstd || svn__zstd_available();
+}
+
+/* Kinds of sample data with different degrees of compressibility. */
+typedef enum sample_kind_t
+{
+  sample_random,
+  sample_text,
+  sample_repetitive
+} sample_kind_t;
+
+/* Return LEN bytes of sample data of the given KIND, allocated in POOL.
+   Use and update SEED. */
+static svn_stringbuf_t *
+make_sample(sample_kind_t kind,
+            apr_size_t len,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  static const char * const words[] =
+    {
+      "svn_error_t", "apr_pool_t", "return", "SVN_NO_ERROR", "static",
+      "const", "char", "*", "(", ")", "{", "}", ";", "\n", "if", "else",
+      "svn_stringbuf_t", "SVN_ERR", "scratch_pool", "result_pool"
+    };
+  svn_stringbuf_t *sample = svn_stringbuf_create_ensure(len, pool);
+
+  while (sample->len < len)
+    {
+      switch (kind)
+        {
+          case sample_random:
+            svn_stringbuf_appendbyte(sample,
+                                     (char)(svn_test_rand(seed) >> 24));
+            break;
+
+          case sample_text:
+            svn_stringbuf_appendcstr(sample,
+                                     words[(svn_test_rand(seed) >> 16)
+                                           % (sizeof(words)
+                                              / sizeof(words[0]))]);
+            svn_stringbuf_appendbyte(sample, ' ');
+            break;
+
+          default:
+            svn_stringbuf_appendcstr(sample, "aaaabbbbccccdddd");
+            break;
+        }
+    }
+
+  svn_stringbuf_chop(sample, sample->len - len);
+  return sample;
+}
+
+/* Compress DATA with COMPRESSOR into OUT. */
+static svn_error_t *
+compress(const compressor_t *compressor,
+         const svn_stringbuf_t *data,
+         svn_stringbuf_t *out)
+{
+  if (compressor->algorithm == algorithm_lz4)
+    SVN_ERR(svn__compress_lz4(data->data, data->len, out));
+  else if (compressor->algorithm == algorithm_zstd)
+    SVN_ERR(svn__compress_zstd(data->data, data->len, out,
+                               compressor->level, NULL));
+  else
+    SVN_ERR(svn__compress_zlib(data->data, data->len, out,
+                               compressor->level));
+
+  return SVN_NO_ERROR;
+}
+
+/* Decompress DATA, which has been compressed by COMPRESSOR, into OUT.
+   The result must not exceed LIMIT bytes. */
+static svn_error_t *
+decompress(const compressor_t *compressor,
+           const svn_stringbuf_t *data,
+           svn_stringbuf_t *out,
+           apr_size_t limit)
+{
+  if (compressor->algorithm == algorithm_lz4)
+    SVN_ERR(svn__decompress_lz4(data->data, data->len, out, limit));
+  else if (compressor->algorithm == algorithm_zstd)
+    SVN_ERR(svn__decompress_zstd(data->data, data->len, out, limit, NULL));
+  else
+    SVN_ERR(svn__decompress_zlib(data->data, data->len, out, limit));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_decompress_lz4(apr_pool_t *pool)
 {
@@ -76,6 +216,206 @@ test_compress_lz4_empty(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_compress_roundtrip(apr_pool_t *pool)
+{
+  static const apr_size_t sizes[] = { 0, 1, 63, 511, 512, 4096, SAMPLE_SIZE };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint32_t seed = 0;
+  int kind;
+  apr_size_t i, k;
+
+  for (kind = sample_random; kind <= sample_repetitive; ++kind)
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+      for (k = 0; k < sizeof(compressors) / sizeof(compressors[0]); ++k)
+        {
+          svn_stringbuf_t *sample, *compressed, *decompressed;
+
+          if (!is_available(&compressors[k]))
+            continue;
+
+          svn_pool_clear(iterpool);
+          sample = make_sample(kind, sizes[i], &seed, iterpool);
+          compressed = svn_stringbuf_create_empty(iterpool);
+          decompressed = svn_stringbuf_create_empty(iterpool);
+
+          SVN_ERR(compress(&compressors[k], sample, compressed));
+          SVN_ERR(decompress(&compressors[k], compressed, decompressed,
+                             sample->len));
+          SVN_TEST_ASSERT(svn_stringbuf_compare(sample, decompressed));
+
+          /* Incompressible data must not grow beyond the size header. */
+          SVN_TEST_ASSERT(compressed->len
+                          <= sample->len + SVN__MAX_ENCODED_UINT_LEN);
+
+          /* A limit smaller than the original size must be detected. */
+          if (sample->len > 0)
+            SVN_TEST_ASSERT_ANY_ERROR(decompress(&compressors[k], compressed,
+                                                 decompressed,
+                                                 sample->len - 1));
+        }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_compress_throughput(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  static const char * const kind_names[] = { "random", "text", "repetitive" };
+  enum { ITERATIONS = 16 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint32_t seed = 0;
+  int kind;
+  apr_size_t k;
+
+  for (kind = sample_random; kind <= sample_repetitive; ++kind)
+    {
+      svn_stringbuf_t *sample = make_sample(kind, SAMPLE_SIZE, &seed, pool);
+
+      for (k = 0; k < sizeof(compressors) / sizeof(compressors[0]); ++k)
+        {
+          svn_stringbuf_t *compressed = svn_stringbuf_create_empty(iterpool);
+          svn_stringbuf_t *decompressed = svn_stringbuf_create_empty(iterpool);
+          apr_time_t start, compress_time, decompress_time;
+          int i;
+
+          if (!is_available(&compressors[k]))
+            continue;
+
+          start = apr_time_now();
+          for (i = 0; i < ITERATIONS; ++i)
+            SVN_ERR(compress(&compressors[k], sample, compressed));
+          compress_time = apr_time_now() - start;
+
+          start = apr_time_now();
+          for (i = 0; i < ITERATIONS; ++i)
+            SVN_ERR(decompress(&compressors[k], compressed, decompressed,
+                               sample->len));
+          decompress_time = apr_time_now() - start;
+
+          SVN_TEST_ASSERT(svn_stringbuf_compare(sample, decompressed));
+
+          /* Avoid division by zero on very fast machines / coarse timers. */
+          if (compress_time == 0)
+            compress_time = 1;
+          if (decompress_time == 0)
+            decompress_time = 1;
+
+          if (opts->verbose)
+            printf("%-10s %-6s: ratio %5.1f%%, compress %7.1f MB/s, "
+                   "decompress %7.1f MB/s\n",
+                   kind_names[kind], compressors[k].name,
+                   100.0 * compressed->len / sample->len,
+                   (double)sample->len * ITERATIONS / compress_time,
+                   (double)sample->len * ITERATIONS / decompress_time);
+
+          svn_pool_clear(iterpool);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_compress_zstd_unavailable(apr_pool_t *pool)
+{
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+
+  if (svn__zstd_available())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "built with zstd support");
+
+  SVN_TEST_ASSERT_ERROR(svn__compress_zstd("abc", 3, compressed, 3, NULL),
+                        SVN_ERR_UNSUPPORTED_FEATURE);
+  SVN_TEST_ASSERT_ERROR(svn__decompress_zstd("abc", 3, compressed, 3, NULL),
+                        SVN_ERR_UNSUPPORTED_FEATURE);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_compress_zstd_dictionary(apr_pool_t *pool)
+{
+#ifdef SVN_HAVE_ZSTD
+  enum { SAMPLE_COUNT = 1000, SMALL_SAMPLE = 300 };
+  apr_uint32_t seed = 0;
+  svn_stringbuf_t *samples = svn_stringbuf_create_empty(pool);
+  size_t sample_sizes[SAMPLE_COUNT];
+  char dict_buf[16 * 1024];
+  char other_dict_buf[16 * 1024];
+  size_t dict_len, other_dict_len;
+  svn_string_t raw_dict, dict, other_dict;
+  svn_stringbuf_t *sample, *plain, *with_dict, *decompressed;
+  int i;
+
+  /* Train a real dictionary, i.e. one with an ID, on small text files. */
+  for (i = 0; i < SAMPLE_COUNT; ++i)
+    {
+      sample = make_sample(sample_text, SMALL_SAMPLE, &seed, pool);
+      svn_stringbuf_appendstr(samples, sample);
+      sample_sizes[i] = sample->len;
+    }
+
+  dict_len = ZDICT_trainFromBuffer(dict_buf, sizeof(dict_buf), samples->data,
+                                   sample_sizes, SAMPLE_COUNT);
+  SVN_TEST_ASSERT(!ZDICT_isError(dict_len));
+  dict.data = dict_buf;
+  dict.len = dict_len;
+
+  /* The dictionary must help with a small file of the same kind. */
+  sample = make_sample(sample_text, SMALL_SAMPLE, &seed, pool);
+  plain = svn_stringbuf_create_empty(pool);
+  with_dict = svn_stringbuf_create_empty(pool);
+  decompressed = svn_stringbuf_create_empty(pool);
+
+  SVN_ERR(svn__compress_zstd(sample->data, sample->len, plain, 3, NULL));
+  SVN_ERR(svn__compress_zstd(sample->data, sample->len, with_dict, 3, &dict));
+  SVN_TEST_ASSERT(with_dict->len < plain->len);
+
+  SVN_ERR(svn__decompress_zstd(with_dict->data, with_dict->len, decompressed,
+                               sample->len, &dict));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(sample, decompressed));
+
+  /* Without the dictionary or with a different one, we must fail
+     cleanly. */
+  SVN_TEST_ASSERT_ERROR(svn__decompress_zstd(with_dict->data, with_dict->len,
+                                             decompressed, sample->len,
+                                             NULL),
+                        SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA);
+
+  other_dict_len = ZDICT_trainFromBuffer(other_dict_buf,
+                                         sizeof(other_dict_buf),
+                                         samples->data + sample_sizes[0],
+                                         sample_sizes + 1, SAMPLE_COUNT - 1);
+  SVN_TEST_ASSERT(!ZDICT_isError(other_dict_len));
+  other_dict.data = other_dict_buf;
+  other_dict.len = other_dict_len;
+  if (ZDICT_getDictID(other_dict_buf, other_dict_len)
+      != ZDICT_getDictID(dict_buf, dict_len))
+    SVN_TEST_ASSERT_ERROR(svn__decompress_zstd(with_dict->data,
+                                               with_dict->len, decompressed,
+                                               sample->len, &other_dict),
+                          SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA);
+
+  /* Raw content dictionaries have no ID but work as well. */
+  raw_dict.data = samples->data;
+  raw_dict.len = 4096;
+  SVN_ERR(svn__compress_zstd(sample->data, sample->len, with_dict, 3,
+                             &raw_dict));
+  SVN_ERR(svn__decompress_zstd(with_dict->data, with_dict->len, decompressed,
+                               sample->len, &raw_dict));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(sample, decompressed));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "built without zstd support");
+#endif
+}
+
 static int max_threads = -1;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -87,6 +427,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                  "test svn__compress_lz4()"),
   SVN_TEST_PASS2(test_compress_lz4_empty,
                  "test svn__compress_lz4() with empty input"),
+  SVN_TEST_PASS2(test_compress_roundtrip,
+                 "round-trip all svndiff compression methods"),
+  SVN_TEST_PASS2(test_compress_zstd_unavailable,
+                 "zstd functions fail cleanly without zstd"),
+  SVN_TEST_PASS2(test_compress_zstd_dictionary,
+                 "zstd compression with dictionaries"),
+  SVN_TEST_OPTS_PASS(test_compress_throughput,
+                     "compression throughput benchmark"),
   SVN_TEST_NULL
 };
 
@@ -1147,6 +1147,65 @@ test_apr_trunc_workaround(apr_pool_t *pool)
   return SVN_NO_ERROR;  
 }
 
+static svn_error_t *
+test_file_copy_range(apr_pool_t *pool)
+{
+  const char *tmp_dir;
+  apr_file_t *source, *dest;
+  apr_size_t len;
+  apr_off_t offset;
+  apr_off_t copied;
+  svn_boolean_t hit_eof;
+  char buffer[20];
+
+  /* create a temp folder & schedule it for automatic cleanup */
+  SVN_ERR(svn_dirent_get_absolute(&tmp_dir, "test_file_copy_range", pool));
+  SVN_ERR(svn_io_remove_dir2(tmp_dir, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_io_make_dir_recursively(tmp_dir, pool));
+  svn_test_add_dir_cleanup(tmp_dir);
+
+  SVN_ERR(svn_io_file_open(&source, svn_dirent_join(tmp_dir, "source", pool),
+                           APR_READ | APR_WRITE | APR_BUFFERED | APR_CREATE |
+                              APR_TRUNCATE,
+                           APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_open(&dest, svn_dirent_join(tmp_dir, "dest", pool),
+                           APR_READ | APR_WRITE | APR_BUFFERED | APR_CREATE |
+                              APR_TRUNCATE,
+                           APR_OS_DEFAULT, pool));
+
+  SVN_ERR(svn_io_file_write_full(source, "0123456789", 10, NULL, pool));
+  SVN_ERR(svn_io_file_write_full(dest, "abc", 3, NULL, pool));
+
+  /* Copy 5 bytes from the middle of SOURCE to the (buffered) end of DEST. */
+  offset = 2;
+  SVN_ERR(svn_io_file_seek(source, APR_SET, &offset, pool));
+  SVN_ERR(svn_io__file_copy_range(&copied, dest, source, 5, pool));
+  SVN_TEST_ASSERT(copied >= 0 && copied <= 5);
+
+  /* Both positions must have been advanced by COPIED.  Copy the remainder
+   * the traditional way as any caller would. */
+  SVN_ERR(svn_io_file_get_offset(&offset, source, pool));
+  SVN_TEST_INT_ASSERT(offset, 2 + copied);
+  SVN_ERR(svn_io_file_get_offset(&offset, dest, pool));
+  SVN_TEST_INT_ASSERT(offset, 3 + copied);
+
+  len = (apr_size_t)(5 - copied);
+  SVN_ERR(svn_io_file_read_full2(source, buffer, len, NULL, NULL, pool));
+  SVN_ERR(svn_io_file_write_full(dest, buffer, len, NULL, pool));
+
+  /* Verify the result. */
+  offset = 0;
+  SVN_ERR(svn_io_file_seek(dest, APR_SET, &offset, pool));
+  SVN_ERR(svn_io_file_read_full2(dest, buffer, sizeof(buffer) - 1, &len,
+                                 &hit_eof, pool));
+  SVN_TEST_ASSERT(hit_eof);
+  SVN_TEST_INT_ASSERT(len, 8);
+  buffer[len] = '\0';
+  SVN_TEST_STRING_ASSERT(buffer, "abc23456");
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 3;
@@ -1184,6 +1243,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test svn_io_open_uniquely_named()"),
     SVN_TEST_PASS2(test_apr_trunc_workaround,
                    "test workaround for APR in svn_io_file_trunc"),
+    SVN_TEST_PASS2(test_file_copy_range,
+                   "test svn_io__file_copy_range"),
     SVN_TEST_NULL
   };
 
@@ -0,0 +1,265 @@
+/*
+ * task-test.c:  a collection of svn_task__* tests
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* ====================================================================
+   To add tests, look toward the bottom of this file.
+
+*/
+
+
+
+#include <apr_pools.h>
+
+#include "../svn_test.h"
+
+#include "svn_error.h"
+#include "svn_pools.h"
+#include "private/svn_atomic.h"
+#include "private/svn_task.h"
+
+/* Number of tasks to run in each test. */
+#define TASK_COUNT 500
+
+/* Index of the task that fails in the error tests. */
+#define FAILING_TASK 123
+
+/* Baton type for the test tasks. */
+typedef struct task_baton_t
+{
+  /* Sequence number of the task. */
+  int index;
+
+  /* If set, the process function will fail. */
+  svn_boolean_t fail;
+
+  /* If not NULL, the number of tasks currently being processed. */
+  volatile svn_atomic_t *running;
+
+  /* Set to TRUE, if more than THREAD_COUNT tasks ran at the same time. */
+  volatile svn_atomic_t *exceeded;
+
+  /* Number of threads that the queue may use. */
+  int thread_count;
+} task_baton_t;
+
+/* Output baton collecting the results. */
+typedef struct output_baton_t
+{
+  /* Number of results received so far. */
+  int count;
+
+  /* If not negative, fail upon receiving this result. */
+  int fail_at;
+} output_baton_t;
+
+/* Implements svn_task__process_func_t.
+ * Do some busy work of varying duration and return the task index. */
+static svn_error_t *
+process_func(void **result,
+             void *baton,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  task_baton_t *task = baton;
+  int *value = apr_palloc(result_pool, sizeof(*value));
+  apr_uint32_t seed = task->index;
+  int i, rounds = (task->index * 7919) % 10000;
+
+  if (task->fail)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Task %d failed", task->index);
+
+  if (task->running
+      && svn_atomic_inc(task->running) >= (svn_atomic_t)task->thread_count)
+    svn_atomic_set(task->exceeded, TRUE);
+
+  for (i = 0; i < rounds; ++i)
+    svn_test_rand(&seed);
+
+  if (task->running)
+    svn_atomic_dec(task->running);
+
+  *value = task->index;
+  *result = value;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ * Verify that we receive the results in order. */
+static svn_error_t *
+output_func(void *result,
+            void *output_baton,
+            apr_pool_t *scratch_pool)
+{
+  output_baton_t *output = output_baton;
+  int value = *(int *)result;
+
+  SVN_TEST_INT_ASSERT(value, output->count);
+  if (value == output->fail_at)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Output of task %d failed", value);
+
+  ++output->count;
+  return SVN_NO_ERROR;
+}
+
+/* Run TASK_COUNT tasks with THREAD_COUNT threads and allow for up to
+ * MAX_PENDING tasks in flight.  If FAIL_PROCESS is set, let task
+ * FAILING_TASK fail.  If FAIL_OUTPUT is set, let its output fail.
+ * Return the number of successfully processed results in *COUNT.
+ * If EXCEEDED is not NULL, set it to TRUE if more than THREAD_COUNT
+ * tasks were being processed at the same time.  Use POOL for allocations.
+ */
+static svn_error_t *
+run_tasks(int *count,
+          volatile svn_atomic_t *exceeded,
+          int thread_count,
+          int max_pending,
+          svn_boolean_t fail_process,
+          svn_boolean_t fail_output,
+          apr_pool_t *pool)
+{
+  svn_task__queue_t *queue;
+  output_baton_t output = { 0 };
+  volatile svn_atomic_t running = 0;
+  int i;
+
+  output.fail_at = fail_output ? FAILING_TASK : -1;
+  SVN_ERR(svn_task__queue_create(&queue, thread_count, max_pending,
+                                 process_func, output_func, &output, pool));
+
+  for (i = 0; i < TASK_COUNT; ++i)
+    {
+      svn_error_t *err;
+      apr_pool_t *task_pool = svn_task__queue_task_pool(queue);
+      task_baton_t *task = apr_pcalloc(task_pool, sizeof(*task));
+
+      task->index = i;
+      task->fail = fail_process && i == FAILING_TASK;
+      task->running = exceeded ? &running : NULL;
+      task->exceeded = exceeded;
+      task->thread_count = thread_count;
+
+      err = svn_task__queue_add(queue, task, task_pool);
+      if (err)
+        {
+          *count = output.count;
+          return svn_error_trace(err);
+        }
+    }
+
+  *count = output.count;
+  SVN_ERR(svn_task__queue_finish(queue));
+  *count = output.count;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_synchronous(apr_pool_t *pool)
+{
+  int count;
+  SVN_ERR(run_tasks(&count, NULL, 1, 2, FALSE, FALSE, pool));
+  SVN_TEST_INT_ASSERT(count, TASK_COUNT);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_concurrent(apr_pool_t *pool)
+{
+  int count;
+  SVN_ERR(run_tasks(&count, NULL, 8, 16, FALSE, FALSE, pool));
+  SVN_TEST_INT_ASSERT(count, TASK_COUNT);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_thread_limit(apr_pool_t *pool)
+{
+  int count;
+  volatile svn_atomic_t exceeded = FALSE;
+
+  /* Keep many more tasks in flight than there may be threads. */
+  SVN_ERR(run_tasks(&count, &exceeded, 3, 64, FALSE, FALSE, pool));
+  SVN_TEST_INT_ASSERT(count, TASK_COUNT);
+  SVN_TEST_ASSERT(!svn_atomic_read(&exceeded));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_process_error(apr_pool_t *pool)
+{
+  int count;
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  SVN_TEST_ASSERT_ERROR(run_tasks(&count, NULL, 8, 16, TRUE, FALSE, subpool),
+                        SVN_ERR_TEST_FAILED);
+  SVN_TEST_INT_ASSERT(count, FAILING_TASK);
+
+  /* Must wait for all tasks still in flight. */
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_output_error(apr_pool_t *pool)
+{
+  int count;
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  SVN_TEST_ASSERT_ERROR(run_tasks(&count, NULL, 8, 16, FALSE, TRUE, subpool),
+                        SVN_ERR_TEST_FAILED);
+  SVN_TEST_INT_ASSERT(count, FAILING_TASK);
+
+  /* Must wait for all tasks still in flight. */
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* An array of all test functions */
+
+static int max_threads = 4;
+
+static struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(test_synchronous,
+                   "process tasks synchronously"),
+    SVN_TEST_PASS2(test_concurrent,
+                   "process tasks concurrently"),
+    SVN_TEST_PASS2(test_thread_limit,
+                   "limit the number of concurrent tasks"),
+    SVN_TEST_PASS2(test_process_error,
+                   "handle processing errors"),
+    SVN_TEST_PASS2(test_output_error,
+                   "handle output errors"),
+    SVN_TEST_NULL
+  };
+
+SVN_TEST_MAIN
@@ -23,6 +23,11 @@
 
 #include <apr_pools.h>
 #include <apr_general.h>
+#include <apr_thread_proc.h>
+
+#if APR_HAS_FORK
+#include <unistd.h>
+#endif
 
 #include "svn_types.h"
 
@@ -36,6 +41,8 @@
 
 #include "svn_dirent_uri.h"
 #include "svn_pools.h"
+#include "svn_config.h"
+#include "svn_wc.h"
 
 #include "private/svn_sqlite.h"
 
@@ -1402,6 +1409,303 @@ test_work_queue(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_work_queue_batch(apr_pool_t *pool)
+{
+  svn_wc__db_t *db;
+  const char *local_abspath;
+  svn_skel_t *work_item;
+  apr_array_header_t *ids;
+  apr_array_header_t *work_items;
+  apr_array_header_t *completed_ids = apr_array_make(pool, 0,
+                                                     sizeof(apr_uint64_t));
+  apr_uint64_t id;
+  int i;
+
+  SVN_ERR(create_open(&db, &local_abspath, "test_work_queue_batch", pool));
+
+  /* Create five work items.  */
+  for (i = 0; i < 5; i++)
+    {
+      work_item = svn_skel__make_empty_list(pool);
+      svn_skel__prepend_int(i, work_item, pool);
+      SVN_ERR(svn_wc__db_wq_add(db, local_abspath, work_item, pool));
+    }
+
+  /* Fetch the first three, in order.  */
+  SVN_ERR(svn_wc__db_wq_record_and_fetch_batch(&ids, &work_items,
+                                               db, local_abspath,
+                                               completed_ids, NULL, 3,
+                                               pool, pool));
+  SVN_TEST_ASSERT(ids->nelts == 3);
+  SVN_TEST_ASSERT(work_items->nelts == 3);
+  for (i = 0; i < 3; i++)
+    SVN_TEST_ASSERT(detect_work_item(APR_ARRAY_IDX(work_items, i,
+                                                   svn_skel_t *)) == i);
+
+  /* Complete the first two.  The third one must be fetched again.  */
+  APR_ARRAY_PUSH(completed_ids, apr_uint64_t)
+    = APR_ARRAY_IDX(ids, 0, apr_uint64_t);
+  APR_ARRAY_PUSH(completed_ids, apr_uint64_t)
+    = APR_ARRAY_IDX(ids, 1, apr_uint64_t);
+  SVN_ERR(svn_wc__db_wq_record_and_fetch_batch(&ids, &work_items,
+                                               db, local_abspath,
+                                               completed_ids, NULL, 10,
+                                               pool, pool));
+  SVN_TEST_ASSERT(ids->nelts == 3);
+  for (i = 0; i < 3; i++)
+    SVN_TEST_ASSERT(detect_work_item(APR_ARRAY_IDX(work_items, i,
+                                                   svn_skel_t *)) == i + 2);
+
+  /* Completing without fetching leaves the queue empty.  */
+  apr_array_clear(completed_ids);
+  for (i = 0; i < ids->nelts; i++)
+    APR_ARRAY_PUSH(completed_ids, apr_uint64_t)
+      = APR_ARRAY_IDX(ids, i, apr_uint64_t);
+  SVN_ERR(svn_wc__db_wq_record_and_fetch_batch(&ids, &work_items,
+                                               db, local_abspath,
+                                               completed_ids, NULL, 0,
+                                               pool, pool));
+  SVN_TEST_ASSERT(ids->nelts == 0);
+
+  SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db,
+                                   local_abspath, 0, pool, pool));
+  SVN_TEST_ASSERT(work_item == NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Queue a test work item with the operation NUMBER in the working copy
+   at LOCAL_ABSPATH in DB. */
+static svn_error_t *
+add_test_work_item(svn_wc__db_t *db,
+                   const char *local_abspath,
+                   int number,
+                   apr_pool_t *pool)
+{
+  svn_skel_t *work_item = svn_skel__make_empty_list(pool);
+
+  svn_skel__prepend_int(number, work_item, pool);
+  return svn_error_trace(svn_wc__db_wq_add(db, local_abspath, work_item,
+                                           pool));
+}
+
+/* Verify that the work queue of the working copy at LOCAL_ABSPATH, as seen
+   through DB, holds the test work items with the operations listed in
+   EXPECTED, terminated by -1. */
+static svn_error_t *
+verify_queued(svn_wc__db_t *db,
+              const char *local_abspath,
+              const int *expected,
+              apr_pool_t *pool)
+{
+  apr_array_header_t *ids;
+  apr_array_header_t *work_items;
+  int i;
+
+  SVN_ERR(svn_wc__db_wq_record_and_fetch_batch(&ids, &work_items,
+                                               db, local_abspath,
+                                               apr_array_make(pool, 0,
+                                                 sizeof(apr_uint64_t)),
+                                               NULL, 100, pool, pool));
+
+  for (i = 0; expected[i] >= 0; i++)
+    {
+      SVN_TEST_ASSERT(i < work_items->nelts);
+      SVN_TEST_INT_ASSERT(detect_work_item(APR_ARRAY_IDX(work_items, i,
+                                                         svn_skel_t *)),
+                          expected[i]);
+    }
+  SVN_TEST_INT_ASSERT(work_items->nelts, i);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for add_test_work_item_and_fail(). */
+struct add_and_fail_baton_t
+{
+  svn_wc__db_t *db;
+  const char *local_abspath;
+  int number;
+};
+
+/* Implements svn_sqlite__transaction_callback_t.  Queue the test work
+   item described by the add_and_fail_baton_t BATON, then fail. */
+static svn_error_t *
+add_test_work_item_and_fail(void *baton,
+                            svn_sqlite__db_t *sdb,
+                            apr_pool_t *scratch_pool)
+{
+  struct add_and_fail_baton_t *b = baton;
+
+  SVN_ERR(add_test_work_item(b->db, b->local_abspath, b->number,
+                             scratch_pool));
+
+  return svn_error_create(SVN_ERR_TEST_FAILED, NULL, "Roll back");
+}
+
+static svn_error_t *
+test_db_batch(apr_pool_t *pool)
+{
+  svn_wc__db_t *db;
+  svn_wc__db_t *other_db;
+  const char *local_abspath;
+  svn_sqlite__db_t *sdb;
+  struct add_and_fail_baton_t baton;
+  static const int none[] = { -1 };
+  static const int one[] = { 1, -1 };
+  static const int two[] = { 1, 2, -1 };
+  static const int three[] = { 1, 2, 3, -1 };
+  static const int five[] = { 1, 2, 3, 5, -1 };
+
+  SVN_ERR(create_open(&db, &local_abspath, "test_db_batch", pool));
+
+  /* Another connection only sees committed changes. */
+  SVN_ERR(svn_wc__db_open(&other_db, NULL, FALSE, FALSE, pool, pool));
+
+  /* Nested batches commit when flushed or when the outermost one ends. */
+  SVN_ERR(svn_wc__db_begin_batch(db, local_abspath, pool));
+  SVN_ERR(svn_wc__db_begin_batch(db, local_abspath, pool));
+  SVN_ERR(add_test_work_item(db, local_abspath, 1, pool));
+  SVN_ERR(verify_queued(db, local_abspath, one, pool));
+  SVN_ERR(verify_queued(other_db, local_abspath, none, pool));
+
+  SVN_ERR(svn_wc__db_end_batch(db, local_abspath, pool));
+  SVN_ERR(verify_queued(other_db, local_abspath, none, pool));
+
+  SVN_ERR(svn_wc__db_flush_batch(db, local_abspath, pool));
+  SVN_ERR(verify_queued(other_db, local_abspath, one, pool));
+
+  SVN_ERR(add_test_work_item(db, local_abspath, 2, pool));
+  SVN_ERR(verify_queued(other_db, local_abspath, one, pool));
+
+  SVN_ERR(svn_wc__db_end_batch(db, local_abspath, pool));
+  SVN_ERR(verify_queued(other_db, local_abspath, two, pool));
+
+  /* Flushing outside of a batch does nothing. */
+  SVN_ERR(svn_wc__db_flush_batch(db, local_abspath, pool));
+
+  /* A failed inner transaction is rolled back, but the batch goes on. */
+  SVN_ERR(svn_wc__db_begin_batch(db, local_abspath, pool));
+  SVN_ERR(add_test_work_item(db, local_abspath, 3, pool));
+
+  baton.db = db;
+  baton.local_abspath = local_abspath;
+  baton.number = 4;
+  SVN_ERR(svn_wc__db_temp_borrow_sdb(&sdb, db, local_abspath, pool));
+  SVN_TEST_ASSERT_ERROR(svn_sqlite__with_lock(sdb,
+                                              add_test_work_item_and_fail,
+                                              &baton, pool),
+                        SVN_ERR_TEST_FAILED);
+  SVN_ERR(verify_queued(db, local_abspath, three, pool));
+
+  SVN_ERR(svn_wc__db_end_batch(db, local_abspath, pool));
+  SVN_ERR(verify_queued(other_db, local_abspath, three, pool));
+
+  /* Closing the db commits a batch that has not been ended. */
+  SVN_ERR(svn_wc__db_begin_batch(db, local_abspath, pool));
+  SVN_ERR(add_test_work_item(db, local_abspath, 5, pool));
+  SVN_ERR(verify_queued(other_db, local_abspath, three, pool));
+  SVN_ERR(svn_wc__db_close(db));
+  SVN_ERR(verify_queued(other_db, local_abspath, five, pool));
+
+  SVN_ERR(svn_wc__db_close(other_db));
+
+  return SVN_NO_ERROR;
+}
+
+/* Open DB such that batches switch to write-ahead logging. */
+static svn_error_t *
+open_wal_db(svn_wc__db_t **db,
+            apr_pool_t *pool)
+{
+  svn_config_t *config;
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set_bool(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                      SVN_CONFIG_OPTION_SQLITE_EXCLUSIVE, TRUE);
+  svn_config_set_bool(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                      SVN_CONFIG_OPTION_SQLITE_WAL, TRUE);
+
+  return svn_error_trace(svn_wc__db_open(db, config, FALSE, FALSE,
+                                         pool, pool));
+}
+
+static svn_error_t *
+test_db_batch_wal(apr_pool_t *pool)
+{
+  svn_wc__db_t *db;
+  const char *local_abspath;
+  const char *wal_abspath;
+  svn_node_kind_t kind;
+  static const int one[] = { 1, -1 };
+#if APR_HAS_FORK
+  static const int two[] = { 1, 2, -1 };
+  apr_proc_t proc;
+  apr_status_t status;
+  int exitcode;
+  apr_exit_why_e why;
+#endif
+
+  SVN_ERR(create_open(&db, &local_abspath, "test_db_batch_wal", pool));
+  SVN_ERR(svn_wc__db_close(db));
+  wal_abspath = svn_dirent_join_many(pool, local_abspath,
+                                     svn_wc_get_adm_dir(pool), "wc.db-wal",
+                                     SVN_VA_NULL);
+
+  /* The write-ahead log exists only while a batch is open. */
+  SVN_ERR(open_wal_db(&db, pool));
+  SVN_ERR(svn_wc__db_begin_batch(db, local_abspath, pool));
+  SVN_ERR(add_test_work_item(db, local_abspath, 1, pool));
+  SVN_ERR(svn_wc__db_flush_batch(db, local_abspath, pool));
+  SVN_ERR(svn_io_check_path(wal_abspath, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  SVN_ERR(svn_wc__db_end_batch(db, local_abspath, pool));
+  SVN_ERR(svn_io_check_path(wal_abspath, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  SVN_ERR(verify_queued(db, local_abspath, one, pool));
+  SVN_ERR(svn_wc__db_close(db));
+
+#if APR_HAS_FORK
+  /* Die in the middle of a batch, leaving the database in WAL mode. */
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      svn_error_t *err = open_wal_db(&db, pool);
+
+      if (!err)
+        err = svn_wc__db_begin_batch(db, local_abspath, pool);
+      if (!err)
+        err = add_test_work_item(db, local_abspath, 2, pool);
+      if (!err)
+        err = svn_wc__db_flush_batch(db, local_abspath, pool);
+
+      _exit(err ? 1 : 0);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "apr_proc_fork");
+
+  status = apr_proc_wait(&proc, &exitcode, &why, APR_WAIT);
+  if (status != APR_CHILD_DONE)
+    return svn_error_wrap_apr(status, "apr_proc_wait");
+  SVN_TEST_ASSERT(APR_PROC_CHECK_EXIT(why) && exitcode == 0);
+
+  SVN_ERR(svn_io_check_path(wal_abspath, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  /* The next open without exclusive locking switches back to the
+     rollback journal and keeps what has been committed. */
+  SVN_ERR(svn_wc__db_open(&db, NULL, FALSE, FALSE, pool, pool));
+  SVN_ERR(verify_queued(db, local_abspath, two, pool));
+  SVN_ERR(svn_io_check_path(wal_abspath, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  SVN_ERR(svn_wc__db_close(db));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_externals_store(apr_pool_t *pool)
 {
@@ -1548,6 +1852,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "relocating a node"),
     SVN_TEST_PASS2(test_work_queue,
                    "work queue processing"),
+    SVN_TEST_PASS2(test_work_queue_batch,
+                   "work queue batch processing"),
+    SVN_TEST_PASS2(test_db_batch,
+                   "batching wc.db changes"),
+    SVN_TEST_PASS2(test_db_batch_wal,
+                   "write-ahead logging in batches"),
     SVN_TEST_PASS2(test_externals_store,
                    "externals store"),
     SVN_TEST_NULL
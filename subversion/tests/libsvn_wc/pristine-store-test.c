@@ -34,6 +34,7 @@
 #define SVN_DEPRECATED
 #include "svn_io.h"
 
+#include "svn_config.h"
 #include "svn_dirent_uri.h"
 #include "svn_pools.h"
 #include "svn_repos.h"
@@ -306,6 +307,221 @@ reject_mismatching_text(const svn_test_opts_t *opts,
 #endif
 }
 
+/* Check that two working copies using the same shared pristine store get
+ * links to the same file, and that cleanup removes it only after both
+ * working copies released it. */
+static svn_error_t *
+pristine_shared_store(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_wc__db_t *db;
+  svn_config_t *config;
+  const char *wc_abspath[2];
+  const char *pristine_abspath[2];
+  const char *store_abspath;
+  const char data[] = "Blah";
+  svn_checksum_t *data_sha1, *data_md5;
+  apr_finfo_t finfo[2];
+  int i;
+
+  SVN_ERR(create_repos_and_wc(&wc_abspath[0], &db,
+                              "pristine_shared_store_1", opts, pool));
+  SVN_ERR(create_repos_and_wc(&wc_abspath[1], &db,
+                              "pristine_shared_store_2", opts, pool));
+
+  store_abspath = svn_dirent_join(svn_dirent_dirname(wc_abspath[0], pool),
+                                  "pristine_shared_store", pool);
+  SVN_ERR(svn_io_remove_dir2(store_abspath, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(store_abspath);
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE, store_abspath);
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, TRUE, pool, pool));
+
+  for (i = 0; i < 2; i++)
+    {
+      svn_wc__db_install_data_t *install_data;
+      svn_stream_t *pristine_stream;
+      apr_size_t sz;
+
+      SVN_ERR(svn_wc__db_pristine_prepare_install(&pristine_stream,
+                                                  &install_data,
+                                                  &data_sha1, &data_md5,
+                                                  db, wc_abspath[i],
+                                                  pool, pool));
+
+      sz = strlen(data);
+      SVN_ERR(svn_stream_write(pristine_stream, data, &sz));
+      SVN_ERR(svn_stream_close(pristine_stream));
+      SVN_ERR(svn_wc__db_pristine_install(install_data,
+                                          data_sha1, data_md5, pool));
+
+      SVN_ERR(svn_wc__db_pristine_get_path(&pristine_abspath[i], db,
+                                           wc_abspath[i], data_sha1,
+                                           pool, pool));
+      SVN_ERR(svn_io_stat(&finfo[i], pristine_abspath[i],
+                          APR_FINFO_NLINK | APR_FINFO_INODE | APR_FINFO_DEV,
+                          pool));
+    }
+
+  if (!(finfo[1].valid & APR_FINFO_NLINK) || finfo[1].nlink == 1)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "Hard links are not supported here");
+
+  /* The shared store and both working copies refer to the same file. */
+  SVN_TEST_ASSERT(finfo[1].nlink == 3);
+  if ((finfo[0].valid & APR_FINFO_INODE) && (finfo[0].valid & APR_FINFO_DEV))
+    {
+      SVN_TEST_ASSERT(finfo[0].inode == finfo[1].inode);
+      SVN_TEST_ASSERT(finfo[0].device == finfo[1].device);
+    }
+
+  /* While one working copy still has the text, it stays in the store. */
+  SVN_ERR(svn_wc__db_pristine_remove(db, wc_abspath[0], data_sha1, pool));
+  SVN_ERR(svn_wc__db_pristine_cleanup(db, wc_abspath[0], pool));
+  SVN_ERR(svn_io_stat(&finfo[1], pristine_abspath[1], APR_FINFO_NLINK,
+                      pool));
+  SVN_TEST_ASSERT(finfo[1].nlink == 2);
+
+  SVN_ERR(svn_wc__db_pristine_remove(db, wc_abspath[1], data_sha1, pool));
+  SVN_ERR(svn_wc__db_pristine_cleanup(db, wc_abspath[1], pool));
+
+  /* The store uses the same layout as the one in the working copy. */
+  {
+    const char *shared_abspath;
+    svn_node_kind_t kind;
+
+    shared_abspath = svn_dirent_join_many(
+                       pool, store_abspath,
+                       svn_dirent_basename(
+                         svn_dirent_dirname(pristine_abspath[1], pool), pool),
+                       svn_dirent_basename(pristine_abspath[1], pool),
+                       SVN_VA_NULL);
+    SVN_ERR(svn_io_check_path(shared_abspath, &kind, pool));
+    SVN_TEST_ASSERT(kind == svn_node_none);
+  }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Install DATA as a pristine text into the working copy at WC_ABSPATH in
+ * DB.  Set *PRISTINE_ABSPATH to the path of the pristine file and *NLINK
+ * to its link count, or to 0 if that is unknown. */
+static svn_error_t *
+install_text(const char **pristine_abspath,
+             apr_int32_t *nlink,
+             svn_wc__db_t *db,
+             const char *wc_abspath,
+             const char *data,
+             apr_pool_t *pool)
+{
+  svn_wc__db_install_data_t *install_data;
+  svn_stream_t *pristine_stream;
+  svn_checksum_t *data_sha1, *data_md5;
+  svn_stringbuf_t *contents;
+  apr_finfo_t finfo;
+  apr_size_t sz = strlen(data);
+
+  SVN_ERR(svn_wc__db_pristine_prepare_install(&pristine_stream,
+                                              &install_data,
+                                              &data_sha1, &data_md5,
+                                              db, wc_abspath,
+                                              pool, pool));
+  SVN_ERR(svn_stream_write(pristine_stream, data, &sz));
+  SVN_ERR(svn_stream_close(pristine_stream));
+  SVN_ERR(svn_wc__db_pristine_install(install_data,
+                                      data_sha1, data_md5, pool));
+
+  SVN_ERR(svn_wc__db_pristine_get_path(pristine_abspath, db, wc_abspath,
+                                       data_sha1, pool, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&contents, *pristine_abspath, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, data);
+
+  SVN_ERR(svn_io_stat(&finfo, *pristine_abspath, APR_FINFO_NLINK, pool));
+  *nlink = (finfo.valid & APR_FINFO_NLINK) ? finfo.nlink : 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Check that a working copy does not link to files in the shared pristine
+ * store that may have been tampered with. */
+static svn_error_t *
+pristine_shared_store_untrusted(const svn_test_opts_t *opts,
+                                apr_pool_t *pool)
+{
+  svn_wc__db_t *db;
+  svn_config_t *config;
+  const char *wc_abspath;
+  const char *store_abspath;
+  const char *shared_abspath;
+  const char *pristine_abspath;
+  const char *hexdigest;
+  const char data[] = "Blah";
+  svn_checksum_t *data_sha1;
+  apr_int32_t nlink;
+
+  SVN_ERR(create_repos_and_wc(&wc_abspath, &db,
+                              "pristine_shared_store_untrusted", opts, pool));
+
+  store_abspath = svn_dirent_join(svn_dirent_dirname(wc_abspath, pool),
+                                  "pristine_shared_store_untrusted_store",
+                                  pool);
+  SVN_ERR(svn_io_remove_dir2(store_abspath, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(store_abspath);
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE, store_abspath);
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, TRUE, pool, pool));
+
+  /* Where the store keeps DATA. */
+  SVN_ERR(svn_checksum(&data_sha1, svn_checksum_sha1, data, strlen(data),
+                       pool));
+  hexdigest = svn_checksum_to_cstring(data_sha1, pool);
+  shared_abspath = svn_dirent_join_many(pool, store_abspath,
+                                        apr_pstrndup(pool, hexdigest, 2),
+                                        apr_pstrcat(pool, hexdigest,
+                                                    ".svn-base",
+                                                    SVN_VA_NULL),
+                                        SVN_VA_NULL);
+  SVN_ERR(svn_io_make_dir_recursively(svn_dirent_dirname(shared_abspath,
+                                                         pool),
+                                      pool));
+
+  /* A file of the right size but with different contents. */
+  SVN_ERR(svn_io_file_create(shared_abspath, "Blub", pool));
+  SVN_ERR(svn_io_set_file_read_only(shared_abspath, FALSE, pool));
+
+  SVN_ERR(install_text(&pristine_abspath, &nlink, db, wc_abspath, data,
+                       pool));
+  SVN_TEST_ASSERT(nlink <= 1);
+  SVN_ERR(svn_wc__db_pristine_remove(db, wc_abspath, data_sha1, pool));
+
+  /* The right contents, but anyone may change them later. */
+  SVN_ERR(svn_io_remove_file2(shared_abspath, FALSE, pool));
+  SVN_ERR(svn_io_file_create(shared_abspath, data, pool));
+  SVN_ERR(svn_io_set_file_read_write(shared_abspath, FALSE, pool));
+
+  SVN_ERR(install_text(&pristine_abspath, &nlink, db, wc_abspath, data,
+                       pool));
+  SVN_TEST_ASSERT(nlink <= 1);
+  SVN_ERR(svn_wc__db_pristine_remove(db, wc_abspath, data_sha1, pool));
+
+  /* Once that has been fixed, the file gets shared. */
+  SVN_ERR(svn_io_set_file_read_only(shared_abspath, FALSE, pool));
+
+  SVN_ERR(install_text(&pristine_abspath, &nlink, db, wc_abspath, data,
+                       pool));
+  if (nlink <= 1)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "Hard links are not supported here");
+  SVN_TEST_ASSERT(nlink == 2);
+
+  return SVN_NO_ERROR;
+}
+
 
 static int max_threads = -1;
 
@@ -318,6 +534,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pristine_delete_while_open"),
     SVN_TEST_OPTS_PASS(reject_mismatching_text,
                        "reject_mismatching_text"),
+    SVN_TEST_OPTS_PASS(pristine_shared_store,
+                       "pristine_shared_store"),
+    SVN_TEST_OPTS_PASS(pristine_shared_store_untrusted,
+                       "pristine_shared_store_untrusted"),
     SVN_TEST_NULL
   };
 
@@ -24,6 +24,12 @@
 #include <apr_pools.h>
 #include <apr_general.h>
 #include <apr_md5.h>
+#include <apr_thread_proc.h>
+
+#if APR_HAS_FORK
+#include <signal.h>
+#include <unistd.h>
+#endif
 
 #define SVN_DEPRECATED
 
@@ -43,6 +49,9 @@
 #include "private/svn_dep_compat.h"
 #include "../../libsvn_wc/wc.h"
 #include "../../libsvn_wc/wc_db.h"
+#include "../../libsvn_wc/adm_files.h"
+#include "../../libsvn_wc/changes.h"
+#include "../../libsvn_wc/workqueue.h"
 #define SVN_WC__I_AM_WC_DB
 #include "../../libsvn_wc/wc_db_private.h"
 
@@ -493,6 +502,626 @@ test_internal_file_modified(const svn_test_opts_t *opts, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Move the affected time of LOCAL_ABSPATH one second into the future
+   without changing its contents. */
+static svn_error_t *
+touch_file(const char *local_abspath, apr_pool_t *pool)
+{
+  apr_time_t time;
+
+  SVN_ERR(svn_io_file_affected_time(&time, local_abspath, pool));
+  SVN_ERR(svn_io_set_file_affected_time(time + apr_time_from_sec(1),
+                                        local_abspath, pool));
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_internal_file_modified_split(const svn_test_opts_t *opts,
+                                  apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_wc__text_check_t *check;
+  svn_wc__text_check_result_t result;
+  svn_boolean_t modified;
+  const char *iota_path;
+  const char *lambda_path;
+  const char *pi_path;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "internal_file_modified_split",
+                                   opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+
+  iota_path = sbox_wc_path(&b, "iota");
+  lambda_path = sbox_wc_path(&b, "A/B/lambda");
+  pi_path = sbox_wc_path(&b, "A/D/G/pi");
+
+  /* Same size, new timestamp, different contents. */
+  SVN_ERR(sbox_file_write(&b, "iota", "This is the file 'IOTA'.\n"));
+  SVN_ERR(touch_file(iota_path, pool));
+
+  SVN_ERR(svn_wc__internal_file_modified_prepare(&check, b.wc_ctx->db,
+                                                 iota_path, pool, pool));
+  SVN_TEST_ASSERT(check != NULL);
+  SVN_ERR(svn_wc__internal_file_modified_run(&result, check, pool));
+  SVN_TEST_ASSERT(result.compared);
+  SVN_TEST_ASSERT(result.modified);
+  SVN_ERR(svn_wc__internal_file_modified_finish(&modified, b.wc_ctx->db,
+                                                iota_path, &result, pool));
+  SVN_TEST_ASSERT(modified);
+
+  /* Only the timestamp changed: compared, unmodified and repaired. */
+  SVN_ERR(touch_file(lambda_path, pool));
+
+  SVN_ERR(svn_wc__internal_file_modified_prepare(&check, b.wc_ctx->db,
+                                                 lambda_path, pool, pool));
+  SVN_TEST_ASSERT(check != NULL);
+  SVN_ERR(svn_wc__internal_file_modified_run(&result, check, pool));
+  SVN_TEST_ASSERT(result.compared);
+  SVN_TEST_ASSERT(!result.modified);
+  SVN_ERR(svn_wc__internal_file_modified_finish(&modified, b.wc_ctx->db,
+                                                lambda_path, &result, pool));
+  SVN_TEST_ASSERT(!modified);
+
+  /* After the timestamp repair, no comparison is needed anymore. */
+  SVN_ERR(svn_wc__internal_file_modified_prepare(&check, b.wc_ctx->db,
+                                                 lambda_path, pool, pool));
+  SVN_ERR(svn_wc__internal_file_modified_run(&result, check, pool));
+  SVN_TEST_ASSERT(!result.compared);
+  SVN_TEST_ASSERT(!result.modified);
+
+  /* A missing file is neither compared nor modified. */
+  SVN_ERR(svn_io_remove_file2(pi_path, FALSE, pool));
+
+  SVN_ERR(svn_wc__internal_file_modified_prepare(&check, b.wc_ctx->db,
+                                                 pi_path, pool, pool));
+  SVN_TEST_ASSERT(check != NULL);
+  SVN_ERR(svn_wc__internal_file_modified_run(&result, check, pool));
+  SVN_TEST_ASSERT(!result.compared);
+  SVN_TEST_ASSERT(!result.modified);
+  SVN_ERR(svn_wc__internal_file_modified_finish(&modified, b.wc_ctx->db,
+                                                pi_path, &result, pool));
+  SVN_TEST_ASSERT(!modified);
+
+  /* Directories have no pristine to compare with. */
+  SVN_ERR(svn_wc__internal_file_modified_prepare(&check, b.wc_ctx->db,
+                                                 sbox_wc_path(&b, "A"),
+                                                 pool, pool));
+  SVN_TEST_ASSERT(check == NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for collect_status(). */
+struct collect_status_baton_t
+{
+  /* Maps relative paths to svn_wc_status_kind, allocated in POOL. */
+  apr_hash_t *statuses;
+  const char *wc_abspath;
+  apr_pool_t *pool;
+
+  /* Return SVN_ERR_CANCELLED after this many calls to cancel_after(),
+     if not negative. */
+  int cancel_countdown;
+};
+
+/* Implements svn_wc_status_func4_t. */
+static svn_error_t *
+collect_status(void *baton,
+               const char *local_abspath,
+               const svn_wc_status3_t *status,
+               apr_pool_t *scratch_pool)
+{
+  struct collect_status_baton_t *csb = baton;
+  svn_wc_status_kind *kind = apr_palloc(csb->pool, sizeof(*kind));
+
+  *kind = status->node_status;
+  svn_hash_sets(csb->statuses,
+                svn_dirent_skip_ancestor(csb->wc_abspath,
+                                         apr_pstrdup(csb->pool,
+                                                     local_abspath)),
+                kind);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cancel_func_t. */
+static svn_error_t *
+cancel_after(void *baton)
+{
+  struct collect_status_baton_t *csb = baton;
+
+  if (csb->cancel_countdown < 0)
+    return SVN_NO_ERROR;
+
+  if (csb->cancel_countdown-- == 0)
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Walk the status of the working copy in B using THREADS worker threads
+   and verify the result against the modifications made by
+   test_status_worker_threads(). */
+static svn_error_t *
+verify_status_walk(svn_test__sandbox_t *b,
+                   int threads,
+                   apr_pool_t *pool)
+{
+  struct collect_status_baton_t csb;
+  apr_hash_index_t *hi;
+  int i;
+  struct expected_t {
+    const char *relpath;
+    svn_wc_status_kind status;
+  } expected[] = {
+    { "",             svn_wc_status_normal },
+    { "iota",         svn_wc_status_modified },
+    { "A/mu",         svn_wc_status_normal },
+    { "A/B/lambda",   svn_wc_status_normal },
+    { "A/D/gamma",    svn_wc_status_modified },
+    { "A/D/G/pi",     svn_wc_status_missing },
+    { "A/D/G/rho",    svn_wc_status_modified },
+    { "A/D/H/omega",  svn_wc_status_normal },
+    { NULL }
+  };
+
+  b->wc_ctx->db->worker_threads = threads;
+
+  csb.statuses = apr_hash_make(pool);
+  csb.wc_abspath = b->wc_abspath;
+  csb.pool = pool;
+  csb.cancel_countdown = -1;
+
+  SVN_ERR(svn_wc_walk_status(b->wc_ctx, b->wc_abspath, svn_depth_infinity,
+                             TRUE, FALSE, FALSE, NULL,
+                             collect_status, &csb,
+                             cancel_after, &csb, pool));
+
+  /* The greek tree has 20 nodes plus the root. */
+  SVN_TEST_INT_ASSERT(apr_hash_count(csb.statuses), 21);
+
+  for (i = 0; expected[i].relpath; i++)
+    {
+      svn_wc_status_kind *kind = svn_hash_gets(csb.statuses,
+                                               expected[i].relpath);
+
+      SVN_TEST_ASSERT(kind != NULL);
+      if (*kind != expected[i].status)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "Status of '%s' is %d instead of %d "
+                                 "with %d threads",
+                                 expected[i].relpath, *kind,
+                                 expected[i].status, threads);
+    }
+
+  /* Everything else is unmodified. */
+  for (hi = apr_hash_first(pool, csb.statuses); hi; hi = apr_hash_next(hi))
+    {
+      const char *relpath = apr_hash_this_key(hi);
+      svn_wc_status_kind *kind = apr_hash_this_val(hi);
+
+      for (i = 0; expected[i].relpath; i++)
+        if (!strcmp(expected[i].relpath, relpath))
+          break;
+
+      if (!expected[i].relpath && *kind != svn_wc_status_normal)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "Unexpected status %d of '%s' "
+                                 "with %d threads",
+                                 *kind, relpath, threads);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_status_worker_threads(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  struct collect_status_baton_t csb;
+  int countdown;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "status_worker_threads",
+                                   opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+
+  /* Same size, new timestamp, different contents. */
+  SVN_ERR(sbox_file_write(&b, "iota", "This is the file 'IOTA'.\n"));
+  SVN_ERR(touch_file(sbox_wc_path(&b, "iota"), pool));
+
+  /* Different size. */
+  SVN_ERR(sbox_file_write(&b, "A/D/gamma", "new gamma\n"));
+  SVN_ERR(sbox_file_write(&b, "A/D/G/rho", "new rho\n"));
+
+  /* New timestamps only. */
+  SVN_ERR(touch_file(sbox_wc_path(&b, "A/mu"), pool));
+  SVN_ERR(touch_file(sbox_wc_path(&b, "A/B/lambda"), pool));
+  SVN_ERR(touch_file(sbox_wc_path(&b, "A/D/H/omega"), pool));
+
+  /* Missing. */
+  SVN_ERR(svn_io_remove_file2(sbox_wc_path(&b, "A/D/G/pi"), FALSE, pool));
+
+  /* The concurrent walk must report the same as the sequential one, both
+     before and after the timestamps got repaired. */
+  SVN_ERR(verify_status_walk(&b, 4, pool));
+  SVN_ERR(verify_status_walk(&b, 1, pool));
+
+  SVN_ERR(touch_file(sbox_wc_path(&b, "A/mu"), pool));
+  SVN_ERR(verify_status_walk(&b, 1, pool));
+  SVN_ERR(verify_status_walk(&b, 4, pool));
+
+  /* Cancel in each of the first directories while read-ahead tasks are
+     pending.  The walk must fail cleanly and leave the db usable. */
+  b.wc_ctx->db->worker_threads = 4;
+  for (countdown = 0; countdown < 8; countdown++)
+    {
+      csb.statuses = apr_hash_make(pool);
+      csb.wc_abspath = b.wc_abspath;
+      csb.pool = pool;
+      csb.cancel_countdown = countdown;
+
+      SVN_TEST_ASSERT_ERROR(svn_wc_walk_status(b.wc_ctx, b.wc_abspath,
+                                               svn_depth_infinity,
+                                               TRUE, FALSE, FALSE, NULL,
+                                               collect_status, &csb,
+                                               cancel_after, &csb, pool),
+                            SVN_ERR_CANCELLED);
+    }
+
+  SVN_ERR(verify_status_walk(&b, 4, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_FORK
+
+/* The header of a change journal, without the generation. */
+#define CHANGES_JOURNAL_HEADER "SVN-WC-CHANGES 1 "
+
+/* Act like svn-wc-watch on the working copy WCROOT_ABSPATH: lock its
+   change journal, truncating it first if TRUNCATE is set, and append
+   CONTENTS.  Then signal READY and confirm every sync cookie that shows
+   up until killed. */
+static svn_error_t *
+run_fake_watcher(const char *wcroot_abspath,
+                 const char *contents,
+                 svn_boolean_t truncate,
+                 apr_file_t *ready,
+                 apr_pool_t *pool)
+{
+  const char *tmp_abspath = svn_wc__adm_child(wcroot_abspath,
+                                              SVN_WC__ADM_TMP, pool);
+  apr_hash_t *confirmed = apr_hash_make(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_file_t *journal;
+
+  SVN_ERR(svn_io_file_open(&journal,
+                           svn_wc__adm_child(wcroot_abspath,
+                                             SVN_WC__ADM_CHANGES, pool),
+                           APR_WRITE | APR_CREATE | APR_APPEND
+                           | (truncate ? APR_TRUNCATE : 0),
+                           APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_lock_open_file(journal, TRUE, FALSE, pool));
+  SVN_ERR(svn_io_file_write_full(journal, contents, strlen(contents), NULL,
+                                 pool));
+  SVN_ERR(svn_io_file_flush(journal, pool));
+  SVN_ERR(svn_io_file_write_full(ready, "R", 1, NULL, pool));
+
+  while (TRUE)
+    {
+      apr_hash_t *dirents;
+      apr_hash_index_t *hi;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_io_get_dirents3(&dirents, tmp_abspath, TRUE,
+                                  iterpool, iterpool));
+
+      /* Confirm each cookie once while it exists. */
+      for (hi = apr_hash_first(iterpool, confirmed); hi;
+           hi = apr_hash_next(hi))
+        if (!svn_hash_gets(dirents, apr_hash_this_key(hi)))
+          svn_hash_sets(confirmed, apr_hash_this_key(hi), NULL);
+
+      for (hi = apr_hash_first(iterpool, dirents); hi;
+           hi = apr_hash_next(hi))
+        {
+          const char *name = apr_hash_this_key(hi);
+          const char *line;
+
+          if (strncmp(name, "changes-sync", 12) != 0
+              || svn_hash_gets(confirmed, name))
+            continue;
+
+          line = apr_pstrcat(iterpool, "s ", name, "\n", SVN_VA_NULL);
+          SVN_ERR(svn_io_file_write_full(journal, line, strlen(line), NULL,
+                                         iterpool));
+          SVN_ERR(svn_io_file_flush(journal, iterpool));
+          svn_hash_sets(confirmed, apr_pstrdup(pool, name), "");
+        }
+
+      apr_sleep(apr_time_from_msec(1));
+    }
+}
+
+/* Start run_fake_watcher() in the child process PROC and wait until it
+   holds the journal lock. */
+static svn_error_t *
+start_fake_watcher(apr_proc_t *proc,
+                   const char *wcroot_abspath,
+                   const char *contents,
+                   svn_boolean_t truncate,
+                   apr_pool_t *pool)
+{
+  apr_file_t *ready_read;
+  apr_file_t *ready_write;
+  apr_status_t status;
+  apr_size_t len;
+  svn_boolean_t eof;
+  char c;
+
+  status = apr_file_pipe_create(&ready_read, &ready_write, pool);
+  if (status)
+    return svn_error_wrap_apr(status, "apr_file_pipe_create");
+
+  status = apr_proc_fork(proc, pool);
+  if (status == APR_INCHILD)
+    {
+      svn_error_clear(run_fake_watcher(wcroot_abspath, contents, truncate,
+                                       ready_write, pool));
+      _exit(1);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "apr_proc_fork");
+
+  SVN_ERR(svn_io_file_close(ready_write, pool));
+  SVN_ERR(svn_io_file_read_full2(ready_read, &c, 1, &len, &eof, pool));
+  SVN_ERR(svn_io_file_close(ready_read, pool));
+
+  if (eof)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "The fake watcher failed to start");
+
+  return SVN_NO_ERROR;
+}
+
+/* Terminate the child process PROC started by start_fake_watcher(). */
+static svn_error_t *
+stop_fake_watcher(apr_proc_t *proc)
+{
+  int exitcode;
+  apr_exit_why_e why;
+  apr_status_t status = apr_proc_kill(proc, SIGKILL);
+
+  if (status)
+    return svn_error_wrap_apr(status, "apr_proc_kill");
+
+  status = apr_proc_wait(proc, &exitcode, &why, APR_WAIT);
+  if (status != APR_CHILD_DONE)
+    return svn_error_wrap_apr(status, "apr_proc_wait");
+
+  return SVN_NO_ERROR;
+}
+
+/* Open the change journal of the working copy in B while a fake watcher
+   appends CONTENTS to it as described for run_fake_watcher().  Return
+   the result in *CHANGES. */
+static svn_error_t *
+open_changes_with_watcher(svn_wc__changes_t **changes,
+                          svn_test__sandbox_t *b,
+                          const char *contents,
+                          svn_boolean_t truncate,
+                          apr_pool_t *pool)
+{
+  apr_proc_t proc;
+  svn_error_t *err;
+
+  SVN_ERR(start_fake_watcher(&proc, b->wc_abspath, contents, truncate,
+                             pool));
+  err = svn_wc__changes_open(changes, b->wc_ctx->db, b->wc_abspath,
+                             pool, pool);
+
+  return svn_error_compose_create(err, stop_fake_watcher(&proc));
+}
+
+/* Verify that CHANGES reports the directories in the NULL terminated
+   list UNCHANGED as unchanged and those in CHANGED as changed.  Either
+   list may be NULL. */
+static svn_error_t *
+verify_changes(svn_wc__changes_t *changes,
+               svn_test__sandbox_t *b,
+               const char *const *unchanged,
+               const char *const *changed,
+               apr_pool_t *pool)
+{
+  for (; unchanged && *unchanged; unchanged++)
+    if (!svn_wc__changes_dir_unchanged(changes,
+                                       sbox_wc_path(b, *unchanged), pool))
+      return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                               "'%s' should be unchanged", *unchanged);
+
+  for (; changed && *changed; changed++)
+    if (svn_wc__changes_dir_unchanged(changes,
+                                      sbox_wc_path(b, *changed), pool))
+      return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                               "'%s' should be changed", *changed);
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+static svn_error_t *
+test_changes_journal(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+#if APR_HAS_FORK
+  svn_test__sandbox_t b;
+  svn_wc__changes_t *changes;
+  static const char *const all_dirs[] = {
+    "", "A", "A/B", "A/B/E", "A/B/F", "A/C", "A/D", "A/D/G", "A/D/H", NULL
+  };
+  static const char *const unchanged_dirs[] = {
+    "", "A/B/E", "A/B/F", NULL
+  };
+  static const char *const changed_dirs[] = {
+    "A", "A/B", "A/C", "A/D", "A/D/G", "A/D/H", NULL
+  };
+
+  SVN_ERR(svn_test__sandbox_create(&b, "changes_journal", opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+
+  /* No journal. */
+  SVN_ERR(svn_wc__changes_open(&changes, b.wc_ctx->db, b.wc_abspath,
+                               pool, pool));
+  SVN_TEST_ASSERT(changes == NULL);
+
+  /* A journal that no watcher is maintaining. */
+  SVN_ERR(svn_io_file_create(svn_wc__adm_child(b.wc_abspath,
+                                               SVN_WC__ADM_CHANGES, pool),
+                             CHANGES_JOURNAL_HEADER "gen1\n", pool));
+  SVN_ERR(svn_wc__changes_open(&changes, b.wc_ctx->db, b.wc_abspath,
+                               pool, pool));
+  SVN_TEST_ASSERT(changes == NULL);
+
+  /* Without a baseline, nothing is known to be unchanged. */
+  SVN_ERR(open_changes_with_watcher(&changes, &b, "", FALSE, pool));
+  SVN_TEST_ASSERT(changes != NULL);
+  SVN_ERR(verify_changes(changes, &b, NULL, all_dirs, pool));
+
+  /* Store a baseline in which A/C did not match the wc.db. */
+  svn_wc__changes_mark_irregular(changes, sbox_wc_path(&b, "A/C"));
+  SVN_ERR(svn_wc__changes_save(changes, b.wc_abspath, pool));
+
+  /* A changed file marks its directory and the parents as changed;
+     a changed directory also everything below it. */
+  SVN_ERR(open_changes_with_watcher(&changes, &b,
+                                    "c A/B/lambda\nc A/D\n", FALSE, pool));
+  SVN_TEST_ASSERT(changes != NULL);
+  SVN_ERR(verify_changes(changes, &b, unchanged_dirs, changed_dirs, pool));
+  SVN_ERR(svn_wc__changes_save(changes, b.wc_abspath, pool));
+
+  /* Nothing changed since the last walk: everything can be skipped. */
+  SVN_ERR(open_changes_with_watcher(&changes, &b, "", FALSE, pool));
+  SVN_TEST_ASSERT(changes != NULL);
+  SVN_ERR(verify_changes(changes, &b, all_dirs, NULL, pool));
+  SVN_ERR(svn_wc__changes_save(changes, b.wc_abspath, pool));
+
+  /* A malformed path reports a change of everything. */
+  SVN_ERR(open_changes_with_watcher(&changes, &b, "c A//B\n", FALSE, pool));
+  SVN_TEST_ASSERT(changes != NULL);
+  SVN_ERR(verify_changes(changes, &b, NULL, all_dirs, pool));
+  SVN_ERR(svn_wc__changes_save(changes, b.wc_abspath, pool));
+
+  /* A new generation makes the baseline stale. */
+  SVN_ERR(open_changes_with_watcher(&changes, &b,
+                                    CHANGES_JOURNAL_HEADER "gen2\n", TRUE,
+                                    pool));
+  SVN_TEST_ASSERT(changes != NULL);
+  SVN_ERR(verify_changes(changes, &b, NULL, all_dirs, pool));
+  SVN_ERR(svn_wc__changes_save(changes, b.wc_abspath, pool));
+
+  /* Once the watcher has stopped, the journal is not used anymore. */
+  SVN_ERR(svn_wc__changes_open(&changes, b.wc_ctx->db, b.wc_abspath,
+                               pool, pool));
+  SVN_TEST_ASSERT(changes == NULL);
+
+  /* A journal of an unknown format is not used, even with a watcher. */
+  SVN_ERR(open_changes_with_watcher(&changes, &b, "SVN-WC-CHANGES 2 gen3\n",
+                                    TRUE, pool));
+  SVN_TEST_ASSERT(changes == NULL);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "fork() not supported");
+#endif
+}
+
+static svn_error_t *
+test_work_queue_install_failure(const svn_test_opts_t *opts,
+                                apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  apr_array_header_t *ids;
+  apr_array_header_t *work_items;
+  svn_node_kind_t kind;
+  int i;
+  static const char *const files[] = {
+    "iota", "A/mu", "A/B/lambda", "A/D/gamma",
+    "A/D/G/pi", "A/D/G/rho", "A/D/G/tau", NULL
+  };
+  const int failing = 3;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "work_queue_install_failure",
+                                   opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+  b.wc_ctx->db->worker_threads = 4;
+
+  /* Queue installations of removed working files, in order.  The one in
+     the middle can't be moved into place over a directory. */
+  for (i = 0; files[i]; i++)
+    {
+      const char *local_abspath = sbox_wc_path(&b, files[i]);
+      svn_skel_t *work_item;
+
+      SVN_ERR(svn_io_remove_file2(local_abspath, FALSE, pool));
+      SVN_ERR(svn_wc__wq_build_file_install(&work_item, b.wc_ctx->db,
+                                            local_abspath, NULL, FALSE, TRUE,
+                                            pool, pool));
+      SVN_ERR(svn_wc__db_wq_add(b.wc_ctx->db, b.wc_abspath, work_item,
+                                pool));
+    }
+
+  SVN_ERR(svn_io_make_dir_recursively(sbox_wc_path(&b, "A/D/gamma/sub"),
+                                      pool));
+
+  SVN_TEST_ASSERT_ANY_ERROR(svn_wc__wq_run(b.wc_ctx->db, b.wc_abspath,
+                                           NULL, NULL, pool));
+
+  /* The installations before the failure completed and are no longer
+     queued.  */
+  for (i = 0; i < failing; i++)
+    {
+      SVN_ERR(svn_io_check_path(sbox_wc_path(&b, files[i]), &kind, pool));
+      SVN_TEST_ASSERT(kind == svn_node_file);
+    }
+
+  /* The failed one and all after it are still queued, in order, even if
+     some of them did run. */
+  SVN_ERR(svn_wc__db_wq_record_and_fetch_batch(&ids, &work_items,
+                                               b.wc_ctx->db, b.wc_abspath,
+                                               apr_array_make(pool, 0,
+                                                 sizeof(apr_uint64_t)),
+                                               NULL, 256, pool, pool));
+  SVN_TEST_INT_ASSERT(work_items->nelts, 4);
+  for (i = 0; i < work_items->nelts; i++)
+    {
+      const svn_skel_t *arg1
+        = APR_ARRAY_IDX(work_items, i, const svn_skel_t *)->children->next;
+
+      SVN_TEST_STRING_ASSERT(apr_pstrmemdup(pool, arg1->data, arg1->len),
+                             files[failing + i]);
+    }
+
+  /* Once the obstruction is gone, the rest of the queue completes. */
+  SVN_ERR(svn_io_remove_dir2(sbox_wc_path(&b, "A/D/gamma"), FALSE,
+                             NULL, NULL, pool));
+  SVN_ERR(svn_wc__wq_run(b.wc_ctx->db, b.wc_abspath, NULL, NULL, pool));
+
+  for (i = 0; files[i]; i++)
+    {
+      SVN_ERR(svn_io_check_path(sbox_wc_path(&b, files[i]), &kind, pool));
+      SVN_TEST_ASSERT(kind == svn_node_file);
+    }
+
+  SVN_ERR(svn_wc__db_wq_record_and_fetch_batch(&ids, &work_items,
+                                               b.wc_ctx->db, b.wc_abspath,
+                                               apr_array_make(pool, 0,
+                                                 sizeof(apr_uint64_t)),
+                                               NULL, 256, pool, pool));
+  SVN_TEST_INT_ASSERT(work_items->nelts, 0);
+
+  return SVN_NO_ERROR;
+}
+
 /* ---------------------------------------------------------------------- */
 /* The list of test functions */
 
@@ -515,6 +1144,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test legacy commit2"),
     SVN_TEST_OPTS_PASS(test_internal_file_modified,
                        "test internal_file_modified"),
+    SVN_TEST_OPTS_PASS(test_internal_file_modified_split,
+                       "test internal_file_modified_prepare/run/finish"),
+    SVN_TEST_OPTS_PASS(test_status_worker_threads,
+                       "status walk with worker threads"),
+    SVN_TEST_OPTS_PASS(test_changes_journal,
+                       "use the change journal of a watcher"),
+    SVN_TEST_OPTS_PASS(test_work_queue_install_failure,
+                       "work queue with a failing concurrent install"),
     SVN_TEST_NULL
   };
 
@@ -0,0 +1,584 @@
+/*
+ * svn-wc-watch.c:  Maintain the change journal of a working copy.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* ==================================================================== */
+
+
+
+/*** Includes. ***/
+
+#include <string.h>
+
+#include <apr_strings.h>
+#include <apr_hash.h>
+#include <apr_general.h>
+
+#include "svn_cmdline.h"
+#include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_path.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_string.h"
+#include "svn_utf.h"
+#include "svn_uuid.h"
+#include "svn_version.h"
+#include "svn_wc.h"
+
+#include "private/svn_cmdline_private.h"
+#include "private/svn_wc_private.h"
+
+#include "svn_private_config.h"
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+/* The journal format, see subversion/libsvn_wc/changes.h. */
+#define JOURNAL_NAME "changes"
+#define JOURNAL_HEADER "SVN-WC-CHANGES 1 "
+#define TMP_DIR_NAME "tmp"
+#define SYNC_COOKIE_PREFIX "changes-sync"
+
+/* Replace the journal with an empty one once it grows beyond this size. */
+#define MAX_JOURNAL_SIZE (16 * 1024 * 1024)
+
+/* Don't bother to compact the watches for fewer removed ones than this. */
+#define MIN_STALE_WATCHES 1024
+
+/* Version compatibility check */
+static svn_error_t *
+check_lib_versions(void)
+{
+  static const svn_version_checklist_t checklist[] =
+    {
+      { "svn_subr",   svn_subr_version },
+      { "svn_wc",     svn_wc_version },
+      { NULL, NULL }
+    };
+  SVN_VERSION_DEFINE(my_version);
+
+  return svn_ver_check_list2(&my_version, checklist, svn_ver_equal);
+}
+
+static svn_error_t *
+print_usage(apr_pool_t *pool)
+{
+  return svn_cmdline_fputs(
+    _("usage: svn-wc-watch WCPATH\n"
+      "\n"
+      "  Watch the working copy at WCPATH for changes and record them in\n"
+      "  its change journal until interrupted.  'svn status' and other\n"
+      "  commands use that journal to skip unchanged directories.\n"),
+    stdout, pool);
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+typedef struct watch_baton_t
+{
+  /* The working copy root and its administrative area. */
+  const char *wcroot_abspath;
+  const char *adm_abspath;
+
+  /* The journal we currently write to and the pool it lives in.
+     Destroying that pool closes the journal and releases our lock. */
+  apr_file_t *journal;
+  apr_off_t journal_size;
+  apr_pool_t *journal_pool;
+
+  /* Our inotify instance and the watch on the adm tmp directory. */
+  int inotify_fd;
+  int tmp_wd;
+
+  /* Maps watch descriptors (int) to the relpaths (const char *) of the
+     watched directories below WCROOT_ABSPATH. */
+  apr_hash_t *watches;
+  apr_pool_t *watch_pool;
+
+  /* Number of watches allocated in WATCH_POOL, including those that have
+     been removed from WATCHES since. */
+  apr_size_t allocated_watches;
+} watch_baton_t;
+
+/* Return an error for the failed system call described by MSG and
+   the path LOCAL_ABSPATH, based on errno. */
+static svn_error_t *
+inotify_error(const char *msg,
+              const char *local_abspath,
+              apr_pool_t *scratch_pool)
+{
+  return svn_error_wrap_apr(APR_FROM_OS_ERROR(errno), msg,
+                            svn_dirent_local_style(local_abspath,
+                                                   scratch_pool));
+}
+
+/* Start a new journal generation: create a journal containing nothing
+   but its header, lock it and move it into place.  Close the previous
+   journal, if any, afterwards. */
+static svn_error_t *
+start_journal(watch_baton_t *wb,
+              apr_pool_t *pool,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *journal_pool = svn_pool_create(pool);
+  const char *tmp_abspath;
+  const char *header;
+  apr_file_t *journal;
+
+  SVN_ERR(svn_io_open_unique_file3(&journal, &tmp_abspath, wb->adm_abspath,
+                                   svn_io_file_del_none,
+                                   journal_pool, scratch_pool));
+  SVN_ERR(svn_io_lock_open_file(journal, TRUE, TRUE, journal_pool));
+
+  header = apr_pstrcat(scratch_pool, JOURNAL_HEADER,
+                       svn_uuid_generate(scratch_pool), "\n", SVN_VA_NULL);
+  SVN_ERR(svn_io_file_write_full(journal, header, strlen(header), NULL,
+                                 scratch_pool));
+  SVN_ERR(svn_io_file_flush(journal, scratch_pool));
+  SVN_ERR(svn_io_file_rename2(tmp_abspath,
+                              svn_dirent_join(wb->adm_abspath, JOURNAL_NAME,
+                                              scratch_pool),
+                              FALSE, scratch_pool));
+
+  if (wb->journal_pool)
+    svn_pool_destroy(wb->journal_pool);
+  wb->journal = journal;
+  wb->journal_size = strlen(header);
+  wb->journal_pool = journal_pool;
+
+  return SVN_NO_ERROR;
+}
+
+/* Watch the directory RELPATH below the working copy root and all its
+   subdirectories that are not administrative areas. */
+static svn_error_t *
+add_watches(watch_baton_t *wb,
+            const char *relpath,
+            apr_pool_t *scratch_pool)
+{
+  const char *local_abspath = svn_dirent_join(wb->wcroot_abspath, relpath,
+                                              scratch_pool);
+  const char *path_apr;
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool;
+  svn_error_t *err;
+  const char *watched_relpath;
+  int wd;
+
+  SVN_ERR(svn_path_cstring_from_utf8(&path_apr, local_abspath,
+                                     scratch_pool));
+  wd = inotify_add_watch(wb->inotify_fd, path_apr,
+                         IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB
+                         | IN_MOVED_FROM | IN_MOVED_TO
+                         | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK);
+  if (wd < 0)
+    {
+      /* The directory has been removed or replaced in the meantime.
+         Its parent has been told about that. */
+      if (errno == ENOENT || errno == ENOTDIR)
+        return SVN_NO_ERROR;
+
+      if (errno == ENOSPC)
+        return svn_error_createf(SVN_ERR_IO_WRITE_ERROR, NULL,
+                                 _("Too many directories to watch at '%s'; "
+                                   "consider raising the limit in "
+                                   "/proc/sys/fs/inotify/max_user_watches"),
+                                 svn_dirent_local_style(local_abspath,
+                                                        scratch_pool));
+
+      return svn_error_trace(inotify_error(_("Can't watch directory '%s'"),
+                                           local_abspath, scratch_pool));
+    }
+
+  /* Watching the same directory again returns the same descriptor. */
+  watched_relpath = apr_hash_get(wb->watches, &wd, sizeof(wd));
+  if (!watched_relpath || strcmp(watched_relpath, relpath) != 0)
+    {
+      int *key = apr_pmemdup(wb->watch_pool, &wd, sizeof(wd));
+
+      apr_hash_set(wb->watches, key, sizeof(*key),
+                   apr_pstrdup(wb->watch_pool, relpath));
+      wb->allocated_watches++;
+    }
+
+  err = svn_io_get_dirents3(&dirents, local_abspath, TRUE,
+                            scratch_pool, scratch_pool);
+  if (err && (APR_STATUS_IS_ENOENT(err->apr_err)
+              || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+
+      svn_pool_clear(iterpool);
+
+      if (dirent->kind != svn_node_dir || dirent->special
+          || svn_wc_is_adm_dir(name, iterpool))
+        continue;
+
+      SVN_ERR(add_watches(wb, svn_relpath_join(relpath, name, iterpool),
+                          iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Stop watching the directory RELPATH and everything below it. */
+static void
+remove_watches(watch_baton_t *wb,
+               const char *relpath,
+               apr_pool_t *scratch_pool)
+{
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(scratch_pool, wb->watches); hi;
+       hi = apr_hash_next(hi))
+    {
+      const int *wd = apr_hash_this_key(hi);
+
+      if (svn_relpath_skip_ancestor(relpath, apr_hash_this_val(hi)))
+        {
+          inotify_rm_watch(wb->inotify_fd, *wd);
+          apr_hash_set(wb->watches, wd, sizeof(*wd), NULL);
+        }
+    }
+}
+
+/* Copy the live watches into a new pool once most of the memory of the
+   watch pool is taken up by removed ones.  Allocate the new pool in
+   POOL. */
+static void
+compact_watches(watch_baton_t *wb,
+                apr_pool_t *pool)
+{
+  apr_pool_t *watch_pool;
+  apr_hash_t *watches;
+  apr_hash_index_t *hi;
+
+  if (wb->allocated_watches
+      < 2 * apr_hash_count(wb->watches) + MIN_STALE_WATCHES)
+    return;
+
+  watch_pool = svn_pool_create(pool);
+  watches = apr_hash_make(watch_pool);
+  for (hi = apr_hash_first(watch_pool, wb->watches); hi;
+       hi = apr_hash_next(hi))
+    {
+      const int *wd = apr_hash_this_key(hi);
+
+      apr_hash_set(watches, apr_pmemdup(watch_pool, wd, sizeof(*wd)),
+                   sizeof(*wd),
+                   apr_pstrdup(watch_pool, apr_hash_this_val(hi)));
+    }
+
+  svn_pool_destroy(wb->watch_pool);
+  wb->watch_pool = watch_pool;
+  wb->watches = watches;
+  wb->allocated_watches = apr_hash_count(watches);
+}
+
+/* Throw away all state and start over with a new journal generation.
+
+   The previous journal gets closed first, so that nobody relies on it
+   while we set up our watches.  The new journal only appears once all
+   directories are being watched, as any change to a directory that we
+   do not watch yet would go unnoticed otherwise. */
+static svn_error_t *
+restart(watch_baton_t *wb,
+        apr_pool_t *pool,
+        apr_pool_t *scratch_pool)
+{
+  const char *tmp_abspath;
+  const char *path_apr;
+
+  if (wb->journal_pool)
+    svn_pool_destroy(wb->journal_pool);
+  wb->journal_pool = NULL;
+  wb->journal = NULL;
+
+  if (wb->inotify_fd >= 0)
+    close(wb->inotify_fd);
+  svn_pool_clear(wb->watch_pool);
+  wb->watches = apr_hash_make(wb->watch_pool);
+  wb->allocated_watches = 0;
+
+  wb->inotify_fd = inotify_init1(IN_CLOEXEC);
+  if (wb->inotify_fd < 0)
+    return svn_error_trace(inotify_error(_("Can't watch directory '%s'"),
+                                         wb->wcroot_abspath, scratch_pool));
+
+  tmp_abspath = svn_dirent_join(wb->adm_abspath, TMP_DIR_NAME, scratch_pool);
+  SVN_ERR(svn_path_cstring_from_utf8(&path_apr, tmp_abspath, scratch_pool));
+  wb->tmp_wd = inotify_add_watch(wb->inotify_fd, path_apr,
+                                 IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+  if (wb->tmp_wd < 0)
+    return svn_error_trace(inotify_error(_("Can't watch directory '%s'"),
+                                         tmp_abspath, scratch_pool));
+
+  SVN_ERR(add_watches(wb, "", scratch_pool));
+
+  return svn_error_trace(start_journal(wb, pool, scratch_pool));
+}
+
+/* Append the journal line consisting of TYPE and the path or name
+   VALUE to BUF. */
+static void
+append_line(svn_stringbuf_t *buf,
+            char type,
+            const char *value)
+{
+  svn_stringbuf_appendbyte(buf, type);
+  svn_stringbuf_appendbyte(buf, ' ');
+  svn_stringbuf_appendcstr(buf, value);
+  svn_stringbuf_appendbyte(buf, '\n');
+}
+
+/* Translate the LEN bytes of inotify events in EVENTS into journal lines
+   appended to BUF and update our watches accordingly.  Set *OVERFLOW if
+   the kernel has dropped events. */
+static svn_error_t *
+process_events(svn_boolean_t *overflow,
+               svn_stringbuf_t *buf,
+               watch_baton_t *wb,
+               const char *events,
+               apr_size_t len,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  const char *p;
+
+  *overflow = FALSE;
+  for (p = events; p < events + len;
+       p += sizeof(struct inotify_event)
+            + ((const struct inotify_event *)p)->len)
+    {
+      const struct inotify_event *event = (const void *)p;
+      const char *relpath;
+      const char *name;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+
+      if (event->mask & IN_Q_OVERFLOW)
+        {
+          *overflow = TRUE;
+          continue;
+        }
+
+      if (event->wd == wb->tmp_wd)
+        {
+          if (event->len
+              && strncmp(event->name, SYNC_COOKIE_PREFIX,
+                         sizeof(SYNC_COOKIE_PREFIX) - 1) == 0
+              && !strchr(event->name, '\n'))
+            append_line(buf, 's', event->name);
+          continue;
+        }
+
+      relpath = apr_hash_get(wb->watches, &event->wd, sizeof(event->wd));
+      if (!relpath)
+        continue;
+
+      if (event->mask & IN_IGNORED)
+        {
+          apr_hash_set(wb->watches, &event->wd, sizeof(event->wd), NULL);
+          continue;
+        }
+
+      /* Changes of the directory itself are not interesting. */
+      if (!event->len)
+        continue;
+
+      /* If we can't represent the name, report the whole directory. */
+      err = svn_path_cstring_to_utf8(&name, event->name, iterpool);
+      if (err || strchr(name, '\n'))
+        {
+          svn_error_clear(err);
+          append_line(buf, 'c', relpath);
+          continue;
+        }
+
+      if (!*relpath && svn_wc_is_adm_dir(name, iterpool))
+        continue;
+
+      append_line(buf, 'c', svn_relpath_join(relpath, name, iterpool));
+
+      if (!(event->mask & IN_ISDIR) || svn_wc_is_adm_dir(name, iterpool))
+        continue;
+
+      if (event->mask & IN_MOVED_FROM)
+        remove_watches(wb, svn_relpath_join(relpath, name, iterpool),
+                       iterpool);
+      else if (event->mask & (IN_CREATE | IN_MOVED_TO))
+        SVN_ERR(add_watches(wb, svn_relpath_join(relpath, name, iterpool),
+                            iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Watch the working copy at WCROOT_ABSPATH until interrupted. */
+static svn_error_t *
+watch(const char *wcroot_abspath,
+      apr_pool_t *pool)
+{
+  watch_baton_t wb = { 0 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+  char events[0x10000];
+
+  wb.wcroot_abspath = wcroot_abspath;
+  wb.adm_abspath = svn_dirent_join(wcroot_abspath, svn_wc_get_adm_dir(pool),
+                                   pool);
+  wb.inotify_fd = -1;
+  wb.watch_pool = svn_pool_create(pool);
+
+  SVN_ERR(restart(&wb, pool, iterpool));
+
+  while (TRUE)
+    {
+      svn_boolean_t overflow;
+      ssize_t len;
+
+      svn_pool_clear(iterpool);
+
+      len = read(wb.inotify_fd, events, sizeof(events));
+      if (len < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          return svn_error_trace(inotify_error(_("Can't watch directory "
+                                                 "'%s'"),
+                                               wcroot_abspath, iterpool));
+        }
+
+      svn_stringbuf_setempty(buf);
+      SVN_ERR(process_events(&overflow, buf, &wb, events, len, iterpool));
+      if (overflow)
+        {
+          SVN_ERR(restart(&wb, pool, iterpool));
+          continue;
+        }
+
+      compact_watches(&wb, pool);
+
+      if (buf->len)
+        {
+          SVN_ERR(svn_io_file_write_full(wb.journal, buf->data, buf->len,
+                                         NULL, iterpool));
+          SVN_ERR(svn_io_file_flush(wb.journal, iterpool));
+          wb.journal_size += buf->len;
+        }
+
+      if (wb.journal_size > MAX_JOURNAL_SIZE)
+        SVN_ERR(start_journal(&wb, pool, iterpool));
+    }
+}
+
+#endif /* HAVE_SYS_INOTIFY_H */
+
+/*
+ * On success, leave *EXIT_CODE untouched and return SVN_NO_ERROR. On error,
+ * either return an error to be displayed, or set *EXIT_CODE to non-zero and
+ * return SVN_NO_ERROR.
+ */
+static svn_error_t *
+sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
+{
+  const char *path;
+  const char *local_abspath;
+  const char *wcroot_abspath;
+  svn_wc_context_t *wc_ctx;
+
+  /* Check library versions */
+  SVN_ERR(check_lib_versions());
+
+  if (argc != 2 || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help"))
+    {
+      SVN_ERR(print_usage(pool));
+      if (argc != 2)
+        *exit_code = EXIT_FAILURE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_utf_cstring_to_utf8(&path, argv[1], pool));
+  SVN_ERR(svn_dirent_get_absolute(&local_abspath,
+                                  svn_dirent_internal_style(path, pool),
+                                  pool));
+
+  SVN_ERR(svn_wc_context_create(&wc_ctx, NULL, pool, pool));
+  SVN_ERR(svn_wc__get_wcroot(&wcroot_abspath, wc_ctx, local_abspath,
+                             pool, pool));
+  SVN_ERR(svn_wc_context_destroy(wc_ctx));
+
+#ifdef HAVE_SYS_INOTIFY_H
+  return svn_error_trace(watch(wcroot_abspath, pool));
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Watching working copies is not supported "
+                            "on this platform"));
+#endif
+}
+
+int
+main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  int exit_code = EXIT_SUCCESS;
+  svn_error_t *err;
+
+  /* Initialize the app. */
+  if (svn_cmdline_init("svn-wc-watch", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  /* Create our top-level pool.  Use a separate mutexless allocator,
+   * given this application is single threaded.
+   */
+  pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+
+  err = sub_main(&exit_code, argc, argv, pool);
+
+  if (err)
+    {
+      exit_code = EXIT_FAILURE;
+      svn_cmdline_handle_exit_error(err, NULL, "svn-wc-watch: ");
+    }
+
+  svn_pool_destroy(pool);
+
+  return exit_code;
+}